@@ -5,8 +5,8 @@
  * Korvo1 hardware:
  * - ESP32-S3 (16MB flash, 8MB PSRAM)
  * - ES8311 audio codec
- * - PDM microphone on I2S1
- * - Speaker output on I2S0
+ * - PDM microphone on I2S0 (the only ESP32-S3 port with PDM RX)
+ * - Speaker output on I2S1
  * - 12x WS2812 RGB LED ring
  * - Grove expansion interface
  */
@@ -21,9 +21,10 @@ extern "C" {
 #endif
 
 // ============================================================================
-// I2S SPEAKER OUTPUT (I2S0)
+// I2S SPEAKER OUTPUT (driven by I2S1, see AUDIO_I2S_NUM)
 // ============================================================================
-// Korvo1 BSP pin definitions for speaker output via ES8311 codec
+// Korvo1 BSP pin definitions for speaker output via ES8311 codec. The BSP
+// names say I2S0; any port can drive these pins through the GPIO matrix.
 
 // Master clock
 #define GPIO_I2S0_MCLK      (42)  // BSP_I2S0_MCLK
@@ -41,12 +42,12 @@ extern "C" {
 #define GPIO_I2S0_DIN       (GPIO_NUM_NC)
 
 // ============================================================================
-// I2S MICROPHONE INPUT (I2S1, PDM Mode)
+// I2S MICROPHONE INPUT (PDM mode, driven by I2S0, see MIC_I2S_NUM)
 // ============================================================================
-// Korvo1 has separate I2S1 port for PDM microphone input
+// PDM RX needs no master clock, so GPIO 0 (BOOT button) stays free
 
 // Master clock
-#define GPIO_I2S1_MCLK      (0)   // Shared with I2S0
+#define GPIO_I2S1_MCLK      (GPIO_NUM_NC)
 
 // Data input (PDM microphone)
 #define GPIO_I2S1_DIN       (35)  // PDM data line
@@ -80,9 +81,10 @@ extern "C" {
 // BUTTON & CONTROL
 // ============================================================================
 // Korvo1 has power button and boot button (hardware-handled)
-// GPIO 0 may be available for user button
+// GPIO 0 (BOOT) reads low while pressed once the system is up; the voice
+// assistant uses it as a wake button (VOICE_ASSISTANT_WAKE_BUTTON_GPIO)
 
-#define GPIO_BUTTON         (GPIO_NUM_NC)  // Not defined on Korvo1
+#define GPIO_BUTTON         (0)
 
 // ============================================================================
 // GROVE INTERFACE (I2C Expansion)
@@ -101,9 +103,10 @@ extern "C" {
 // ============================================================================
 // I2S CONFIGURATION
 // ============================================================================
-// I2S0 for speaker output, I2S1 for PDM microphone input
-#define AUDIO_I2S_NUM           (I2S_NUM_0)
-#define MIC_I2S_NUM             (I2S_NUM_1)
+// On the ESP32-S3 only I2S0 can receive PDM, so the microphone takes I2S0
+// and the speaker (standard I2S to the ES8311) takes I2S1
+#define AUDIO_I2S_NUM           (I2S_NUM_1)
+#define MIC_I2S_NUM             (I2S_NUM_0)
 
 // DMA buffer configuration
 #define I2S_DMA_BUFFER_COUNT    (4)
@@ -0,0 +1,206 @@
+// Host benchmark: streaming_base64 throughput against mbedtls_base64
+//
+// Decodes and encodes a 256 KiB buffer of PCM-like data and prints MB/s
+// (of base64 text) for each case. Before timing, every split point of a
+// short input is decoded in two pieces and compared with the one-shot
+// result; a mismatch exits with status 1.
+//
+// Usage: base64_bench [rounds]
+//   rounds  passes over the buffer per case (default 40)
+
+#include "streaming_base64.h"
+#include "mbedtls/base64.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RAW_BYTES   (256 * 1024)
+#define B64_CHARS   ((RAW_BYTES + 2) / 3 * 4)
+#define LINE_CHARS  76      // Escaped "\n" every LINE_CHARS characters
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, size_t chars, int rounds, double seconds)
+{
+    printf("%-34s %8.1f MB/s\n", name, (double)chars * rounds / seconds / 1e6);
+}
+
+// Streaming decode of `text` in pieces of `chunk` characters
+static size_t decode_chunked(const uint8_t *text, size_t len, size_t chunk, uint8_t *out)
+{
+    streaming_base64_decoder_t dec;
+    streaming_base64_decoder_init(&dec);
+    size_t o = 0;
+    for (size_t i = 0; i < len; i += chunk) {
+        size_t n = len - i < chunk ? len - i : chunk;
+        size_t cap = streaming_base64_decode_bound(n);
+        if (streaming_base64_decode(&dec, text + i, n, out + o, &cap) != ESP_OK) {
+            return 0;
+        }
+        o += cap;
+    }
+    size_t tail = 0;
+    return streaming_base64_decode_finish(&dec, NULL, &tail) == ESP_OK ? o : 0;
+}
+
+// Every two-piece split of short inputs (all padding lengths, an escaped
+// newline and "\/") must decode to the one-shot result
+static int check_splits(void)
+{
+    static const char *const cases[] = {
+        "TWFu", "TWE=", "TQ==", "TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu",
+        "TWFueSBoYW5kcyBt\\nYWtlIGxpZ2h0IHdvcmsu", "P\\/8A\\/w==", "AAEC\r\nAwQF BgcI",
+    };
+    static const char *const expect[] = {
+        "Man", "Ma", "M", "Many hands make light work.",
+        "Many hands make light work.", "?\xff\x00\xff", "\x00\x01\x02\x03\x04\x05\x06\x07\x08",
+    };
+    static const size_t expect_len[] = { 3, 2, 1, 27, 27, 4, 9 };
+    int failures = 0;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const uint8_t *text = (const uint8_t *)cases[c];
+        size_t len = strlen(cases[c]);
+        for (size_t split = 0; split <= len; split++) {
+            streaming_base64_decoder_t dec;
+            streaming_base64_decoder_init(&dec);
+            uint8_t out[64];
+            size_t a = streaming_base64_decode_bound(split);
+            size_t b = streaming_base64_decode_bound(len - split);
+            size_t tail = 0;
+            if (streaming_base64_decode(&dec, text, split, out, &a) != ESP_OK ||
+                streaming_base64_decode(&dec, text + split, len - split, out + a, &b) != ESP_OK ||
+                streaming_base64_decode_finish(&dec, NULL, &tail) != ESP_OK ||
+                a + b != expect_len[c] || memcmp(out, expect[c], expect_len[c]) != 0) {
+                fprintf(stderr, "split mismatch: \"%s\" at %zu\n", cases[c], split);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 40;
+    if (rounds < 1) {
+        rounds = 1;
+    }
+    if (check_splits() != 0) {
+        return 1;
+    }
+
+    uint8_t *raw = malloc(RAW_BYTES);
+    uint8_t *text = malloc(B64_CHARS + 1);
+    uint8_t *escaped = malloc(B64_CHARS + B64_CHARS / LINE_CHARS * 2 + 1);
+    uint8_t *work = malloc(B64_CHARS + 1);
+    uint8_t *out = malloc(RAW_BYTES + 4);
+    if (!raw || !text || !escaped || !work || !out) {
+        return 1;
+    }
+    // A slow sine with noise, so the text looks like a TTS response
+    uint32_t seed = 1;
+    for (size_t i = 0; i < RAW_BYTES / 2; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int16_t s = (int16_t)((int)((i * 37) % 4000) - 2000 + (int)((seed >> 16) & 255));
+        memcpy(raw + i * 2, &s, 2);
+    }
+    size_t text_len = 0;
+    mbedtls_base64_encode(text, B64_CHARS + 1, &text_len, raw, RAW_BYTES);
+    size_t esc_len = 0;
+    for (size_t i = 0; i < text_len; i++) {
+        escaped[esc_len++] = text[i];
+        if (i % LINE_CHARS == LINE_CHARS - 1) {
+            escaped[esc_len++] = '\\';
+            escaped[esc_len++] = 'n';
+        }
+    }
+
+    // Correctness on the full buffer before timing
+    size_t n = decode_chunked(text, text_len, 1460, out);
+    if (n != RAW_BYTES || memcmp(out, raw, RAW_BYTES) != 0) {
+        fprintf(stderr, "chunked decode mismatch\n");
+        return 1;
+    }
+    n = decode_chunked(escaped, esc_len, 1460, out);
+    if (n != RAW_BYTES || memcmp(out, raw, RAW_BYTES) != 0) {
+        fprintf(stderr, "escaped decode mismatch\n");
+        return 1;
+    }
+
+    printf("%zu base64 characters, %d rounds\n", text_len, rounds);
+
+    double t = now_s();
+    for (int r = 0; r < rounds; r++) {
+        mbedtls_base64_decode(out, RAW_BYTES + 4, &n, text, text_len);
+    }
+    report("decode mbedtls one-shot", text_len, rounds, now_s() - t);
+
+    static const size_t chunks[] = { 64, 1460, 4096 };
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        char name[48];
+        snprintf(name, sizeof(name), "decode streaming, %zu-char pieces", chunks[c]);
+        t = now_s();
+        for (int r = 0; r < rounds; r++) {
+            decode_chunked(text, text_len, chunks[c], out);
+        }
+        report(name, text_len, rounds, now_s() - t);
+    }
+
+    t = now_s();
+    for (int r = 0; r < rounds; r++) {
+        decode_chunked(escaped, esc_len, 1460, out);
+    }
+    report("decode streaming, escaped \\n", esc_len, rounds, now_s() - t);
+
+    double total = 0;
+    for (int r = 0; r < rounds; r++) {
+        memcpy(work, text, text_len);
+        t = now_s();
+        n = decode_chunked(work, text_len, text_len, work);
+        total += now_s() - t;
+    }
+    if (n != RAW_BYTES || memcmp(work, raw, RAW_BYTES) != 0) {
+        fprintf(stderr, "in-place decode mismatch\n");
+        return 1;
+    }
+    report("decode streaming, in place", text_len, rounds, total);
+
+    t = now_s();
+    for (int r = 0; r < rounds; r++) {
+        mbedtls_base64_encode(work, B64_CHARS + 1, &n, raw, RAW_BYTES);
+    }
+    report("encode mbedtls one-shot", text_len, rounds, now_s() - t);
+
+    t = now_s();
+    for (int r = 0; r < rounds; r++) {
+        streaming_base64_encoder_t enc;
+        streaming_base64_encoder_init(&enc);
+        size_t o = 0;
+        for (size_t i = 0; i < RAW_BYTES; i += 1024) {
+            size_t cap = streaming_base64_encode_bound(1024);
+            streaming_base64_encode(&enc, raw + i, 1024, (char *)work + o, &cap);
+            o += cap;
+        }
+        size_t cap = 4;
+        streaming_base64_encode_finish(&enc, (char *)work + o, &cap);
+        n = o + cap;
+    }
+    report("encode streaming, 1024-byte pieces", text_len, rounds, now_s() - t);
+    if (n != text_len || memcmp(work, text, text_len) != 0) {
+        fprintf(stderr, "streaming encode mismatch\n");
+        return 1;
+    }
+
+    free(raw);
+    free(text);
+    free(escaped);
+    free(work);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,441 @@
+// Host benchmark: time to first audio and peak heap of a voice turn
+//
+// Runs STT -> LLM -> TTS against mock_server.py through the real gemini
+// client code, with esp_http_client replaced by a plain-HTTP shim.
+//
+// Usage: gemini_bench <blocking|streaming|audio|live> [turns] [utterance_ms]
+//   blocking      gemini_stt, gemini_llm, then gemini_tts of the whole reply;
+//                 audio is available when gemini_tts returns
+//   streaming     gemini_stt, gemini_llm_stream, and gemini_tts_ex per
+//                 sentence with progressive decoding; audio is available
+//                 at the first decoded PCM of the first sentence
+//   audio         gemini_audio_query (utterance and prompt in one
+//                 streamGenerateContent request, no STT), then TTS per
+//                 sentence as in streaming
+//   live          one gemini_live session for all turns; the utterance is
+//                 streamed up in real time and timing starts at
+//                 gemini_live_activity_end (stt_ms is the input transcript,
+//                 requests the realtimeInput messages of the turn)
+//   turns         number of turns (default 5); the first one opens the connections
+//   utterance_ms  length of the synthetic utterance sent to STT (default 3000)
+//
+// Environment:
+//   GEMINI_MOCK_ADDR   host:port of the mock server (default 127.0.0.1:8080)
+//   GEMINI_BENCH_LOG   0 none, 1 error, 2 warning (default), 3 info, 4 debug
+//   GEMINI_BENCH_TRACE file to write the last turn's spans to (Chrome trace JSON)
+//   GEMINI_BENCH_COLD  1: every turn starts with no open connections, as
+//                      after a wake past the pool's idle timeout
+//   GEMINI_BENCH_SPEECH_MS  time the user speaks between wake and end of
+//                      speech (default 0); timing starts at end of speech
+//   GEMINI_BENCH_PREWARM    1: call gemini_api_prewarm() at wake
+//   GEMINI_MOCK_CONNECT_MS  added to every new connection, standing in for
+//                      DNS, TCP and the TLS handshake (host shim)
+//
+// One JSON object per turn is printed to stdout. first_byte_ms is end of
+// speech to the response headers of the turn's first request.
+
+#include "gemini_api.h"
+#include "gemini_live.h"
+#include "esp_timer.h"
+#include "heap_track.h"
+#include "span_trace.h"
+#include "turn_arena.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef GEMINI_BENCH_VARIANT
+#define GEMINI_BENCH_VARIANT "default"
+#endif
+
+#define STT_RATE_HZ 16000
+#define TTS_MAX_SAMPLES (24000 * 30)
+#define LIVE_FEED_MS 20
+#define LIVE_TURN_TIMEOUT_MS 30000
+
+int esp_log_host_level = 2;
+
+static bool env_flag(const char *name)
+{
+    const char *value = getenv(name);
+    return value && *value && strcmp(value, "0") != 0;
+}
+
+static esp_err_t trace_file_write(const char *data, size_t len, void *ctx)
+{
+    return fwrite(data, 1, len, (FILE *)ctx) == len ? ESP_OK : ESP_FAIL;
+}
+
+typedef struct {
+    int64_t turn_start_us;
+    int64_t first_audio_us;
+    int64_t first_text_us;
+    int16_t *pcm;
+    char sentence[512];
+    size_t sentence_len;
+    size_t samples;
+    int tts_requests;
+    esp_err_t tts_err;
+    int64_t transcript_us;
+    SemaphoreHandle_t done;
+    gemini_live_event_t end_event;
+} turn_ctx_t;
+
+// Voiced-speech stand-in: a pitch glide with harmonics and a little noise,
+// so the FLAC variant compresses about as well as it does on real speech
+static int16_t *make_utterance(size_t samples)
+{
+    int16_t *pcm = malloc(samples * sizeof(int16_t));
+    if (!pcm) {
+        return NULL;
+    }
+    uint32_t rng = 12345;
+    double phase = 0.0;
+    for (size_t i = 0; i < samples; i++) {
+        double t = (double)i / STT_RATE_HZ;
+        phase += 2.0 * M_PI * (120.0 + 40.0 * sin(2.0 * M_PI * 0.7 * t)) / STT_RATE_HZ;
+        double env = 0.5 + 0.5 * sin(2.0 * M_PI * 3.0 * t);
+        rng = rng * 1664525u + 1013904223u;
+        double noise = ((int32_t)(rng >> 16) - 32768) / 32768.0;
+        double v = env * (sin(phase) + 0.5 * sin(2 * phase) + 0.25 * sin(3 * phase)) + 0.02 * noise;
+        pcm[i] = (int16_t)(v * 6000.0);
+    }
+    return pcm;
+}
+
+static void on_tts_progress(size_t samples_ready, void *user_ctx)
+{
+    turn_ctx_t *ctx = (turn_ctx_t *)user_ctx;
+    if (samples_ready > 0 && ctx->first_audio_us == 0) {
+        ctx->first_audio_us = esp_timer_get_time();
+    }
+}
+
+static void speak_sentence(turn_ctx_t *ctx)
+{
+    ctx->sentence[ctx->sentence_len] = '\0';
+    if (ctx->sentence_len == 0 || ctx->tts_err != ESP_OK) {
+        ctx->sentence_len = 0;
+        return;
+    }
+    const gemini_tts_opts_t opts = { .on_progress = on_tts_progress, .user_ctx = ctx };
+    size_t samples = 0;
+    ctx->tts_err = gemini_tts_ex(ctx->sentence, ctx->pcm, TTS_MAX_SAMPLES, &samples, &opts);
+    ctx->samples += samples;
+    ctx->tts_requests++;
+    ctx->sentence_len = 0;
+}
+
+// Same split as the firmware: synthesize each sentence as soon as it is complete
+static bool on_llm_text(const char *text, void *user_ctx)
+{
+    turn_ctx_t *ctx = (turn_ctx_t *)user_ctx;
+    if (ctx->first_text_us == 0) {
+        ctx->first_text_us = esp_timer_get_time();
+    }
+    for (const char *p = text; *p; p++) {
+        if (ctx->sentence_len < sizeof(ctx->sentence) - 1) {
+            ctx->sentence[ctx->sentence_len++] = *p;
+        }
+        if ((*p == '.' || *p == '!' || *p == '?') && (p[1] == ' ' || p[1] == '\0')) {
+            speak_sentence(ctx);
+        }
+    }
+    return ctx->tts_err == ESP_OK;
+}
+
+static esp_err_t run_turn(const char *mode, const int16_t *audio, size_t audio_len, turn_ctx_t *ctx,
+                          int64_t *stt_us)
+{
+    if (strcmp(mode, "audio") == 0) {
+        *stt_us = -1000;
+        esp_err_t err = gemini_audio_query(audio, audio_len, NULL, on_llm_text, ctx);
+        if (err == ESP_OK) {
+            speak_sentence(ctx);
+            err = ctx->tts_err;
+        }
+        return err;
+    }
+
+    bool streaming = strcmp(mode, "streaming") == 0;
+    char transcript[512];
+    esp_err_t err = gemini_stt(audio, audio_len, transcript, sizeof(transcript));
+    *stt_us = esp_timer_get_time() - ctx->turn_start_us;
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (streaming) {
+        err = gemini_llm_stream(transcript, on_llm_text, ctx);
+        if (err == ESP_OK) {
+            speak_sentence(ctx);
+            err = ctx->tts_err;
+        }
+        return err;
+    }
+
+    static char reply[4096];
+    err = gemini_llm(transcript, reply, sizeof(reply));
+    ctx->first_text_us = esp_timer_get_time();
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = gemini_tts(reply, ctx->pcm, TTS_MAX_SAMPLES, &ctx->samples);
+    ctx->tts_requests = 1;
+    if (err == ESP_OK && ctx->samples > 0) {
+        ctx->first_audio_us = esp_timer_get_time();
+    }
+    return err;
+}
+
+static void on_live_audio(const int16_t *pcm, size_t samples, int sample_rate_hz, void *user_ctx)
+{
+    turn_ctx_t *ctx = (turn_ctx_t *)user_ctx;
+    if (ctx->first_audio_us == 0) {
+        ctx->first_audio_us = esp_timer_get_time();
+    }
+    ctx->samples += samples;
+}
+
+static void on_live_event(gemini_live_event_t event, const char *text, void *user_ctx)
+{
+    turn_ctx_t *ctx = (turn_ctx_t *)user_ctx;
+    switch (event) {
+    case GEMINI_LIVE_EVENT_INPUT_TRANSCRIPT:
+        ctx->transcript_us = esp_timer_get_time();
+        break;
+    case GEMINI_LIVE_EVENT_OUTPUT_TRANSCRIPT:
+        if (ctx->first_text_us == 0) {
+            ctx->first_text_us = esp_timer_get_time();
+        }
+        break;
+    case GEMINI_LIVE_EVENT_TURN_COMPLETE:
+    case GEMINI_LIVE_EVENT_INTERRUPTED:
+    case GEMINI_LIVE_EVENT_CLOSED:
+        ctx->end_event = event;
+        xSemaphoreGive(ctx->done);
+        break;
+    default:
+        break;
+    }
+}
+
+// Speak the utterance into the session at real-time pace, end the activity
+// and wait for the model's turn to finish
+static esp_err_t run_live_turn(gemini_live_session_t *session, const int16_t *audio, size_t audio_len,
+                               turn_ctx_t *ctx)
+{
+    // Drop a completion left over from the previous turn
+    xSemaphoreTake(ctx->done, 0);
+    esp_err_t err = gemini_live_activity_start(session);
+    const size_t step = STT_RATE_HZ * LIVE_FEED_MS / 1000;
+    for (size_t off = 0; err == ESP_OK && off < audio_len; off += step) {
+        size_t n = audio_len - off < step ? audio_len - off : step;
+        err = gemini_live_send_audio(session, audio + off, n);
+        vTaskDelay(pdMS_TO_TICKS(LIVE_FEED_MS));
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    ctx->turn_start_us = esp_timer_get_time();
+    err = gemini_live_activity_end(session);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (xSemaphoreTake(ctx->done, pdMS_TO_TICKS(LIVE_TURN_TIMEOUT_MS)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return ctx->end_event == GEMINI_LIVE_EVENT_TURN_COMPLETE ? ESP_OK : ESP_FAIL;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || (strcmp(argv[1], "blocking") != 0 && strcmp(argv[1], "streaming") != 0 &&
+                     strcmp(argv[1], "audio") != 0 && strcmp(argv[1], "live") != 0)) {
+        fprintf(stderr, "usage: %s <blocking|streaming|audio|live> [turns] [utterance_ms]\n", argv[0]);
+        return 2;
+    }
+    bool live = strcmp(argv[1], "live") == 0;
+    int turns = argc > 2 ? atoi(argv[2]) : 5;
+    int utterance_ms = argc > 3 ? atoi(argv[3]) : 3000;
+    const char *level = getenv("GEMINI_BENCH_LOG");
+    if (level && *level) {
+        esp_log_host_level = atoi(level);
+    }
+
+    size_t audio_len = (size_t)utterance_ms * STT_RATE_HZ / 1000;
+    int16_t *audio = make_utterance(audio_len);
+    int16_t *pcm = malloc(TTS_MAX_SAMPLES * sizeof(int16_t));
+    if (!audio || !pcm) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    gemini_config_t config = {0};
+    snprintf(config.api_key, sizeof(config.api_key), "bench-key");
+    if (gemini_api_init(&config) != ESP_OK) {
+        fprintf(stderr, "gemini_api_init failed\n");
+        return 1;
+    }
+    // Turn scratch buffers come from the arena as in the firmware, unless
+    // GEMINI_BENCH_NO_ARENA is set to compare against the heap
+    const char *no_arena = getenv("GEMINI_BENCH_NO_ARENA");
+    if (!(no_arena && *no_arena) && turn_arena_init(CONFIG_TURN_ARENA_SIZE_KB * 1024) != ESP_OK) {
+        fprintf(stderr, "turn_arena_init failed\n");
+        return 1;
+    }
+
+    bool cold = env_flag("GEMINI_BENCH_COLD");
+    bool prewarm = env_flag("GEMINI_BENCH_PREWARM");
+    const char *speech = getenv("GEMINI_BENCH_SPEECH_MS");
+    int speech_ms = speech && *speech ? atoi(speech) : 0;
+    uint32_t services = GEMINI_SERVICE_LLM | GEMINI_SERVICE_TTS;
+    if (strcmp(argv[1], "audio") != 0) {
+        services |= GEMINI_SERVICE_STT;
+    }
+
+    // The session callbacks always point at the current turn's context
+    turn_ctx_t ctx = { .pcm = pcm, .done = xSemaphoreCreateBinary() };
+    gemini_live_session_t *session = NULL;
+    gemini_live_stats_t live_prev = {0};
+    int failures = 0;
+    uint32_t trace_turn = 0;
+    for (int turn = 0; turn < turns; turn++) {
+        ctx = (turn_ctx_t){ .pcm = pcm, .done = ctx.done };
+        int64_t stt_us = 0;
+        gemini_turn_metrics_t net = {0};
+        gemini_http_timing_t timings[16];
+        gemini_http_timing_t first = {0};
+        if (!live && cold && turn > 0) {
+            // Drops the pool; latency history starts over too
+            gemini_api_deinit();
+            if (gemini_api_init(&config) != ESP_OK) {
+                fprintf(stderr, "gemini_api_init failed\n");
+                return 1;
+            }
+        }
+        if (!live) {
+            // Wake: the user speaks while the connections are opened
+            if (prewarm) {
+                gemini_api_prewarm(services);
+            }
+            if (speech_ms > 0) {
+                vTaskDelay(pdMS_TO_TICKS(speech_ms));
+            }
+        }
+        // Peak is measured above what is live between turns, which leaves
+        // out the benchmark's own buffers and the open connections
+        size_t base = heap_track_current();
+        unsigned long allocs_base = heap_track_allocs();
+        heap_track_reset_peak();
+        gemini_api_metrics_turn_begin();
+        trace_turn = span_trace_new_turn();
+        turn_arena_begin();
+        ctx.turn_start_us = esp_timer_get_time();
+        esp_err_t err;
+        if (live) {
+            if (!session) {
+                const char *addr = getenv("GEMINI_MOCK_ADDR");
+                char url[256];
+                snprintf(url, sizeof(url),
+                         "ws://%s/ws/google.ai.generativelanguage.v1beta.GenerativeService.BidiGenerateContent",
+                         addr && *addr ? addr : "127.0.0.1:8080");
+                const gemini_live_config_t live_config = {
+                    .url = url,
+                    .client_activity = true,
+                    .transcripts = true,
+                    .on_audio = on_live_audio,
+                    .on_event = on_live_event,
+                    .user_ctx = &ctx,
+                };
+                // The session's own buffers count towards the first turn only
+                net.new_connections = 1;
+                err = gemini_live_start(&live_config, &session);
+            } else {
+                err = ESP_OK;
+            }
+            if (err == ESP_OK) {
+                err = run_live_turn(session, audio, audio_len, &ctx);
+            }
+            stt_us = ctx.transcript_us ? ctx.transcript_us - ctx.turn_start_us : -1000;
+        } else {
+            err = run_turn(argv[1], audio, audio_len, &ctx, &stt_us);
+        }
+        int64_t end_us = esp_timer_get_time();
+        span_trace_add("turn", argv[1], ctx.turn_start_us, end_us);
+        turn_arena_reset();
+        gemini_api_metrics_turn_end();
+        size_t peak = heap_track_peak() - base;
+        unsigned long allocs = heap_track_allocs() - allocs_base;
+
+        if (live && session) {
+            gemini_live_stats_t stats;
+            gemini_live_get_stats(session, &stats);
+            net.requests = stats.messages_sent - live_prev.messages_sent;
+            net.bytes_up = stats.bytes_up - live_prev.bytes_up;
+            net.bytes_down = stats.bytes_down - live_prev.bytes_down;
+            live_prev = stats;
+        } else if (!live) {
+            size_t n = gemini_api_get_turn_metrics(timings, sizeof(timings) / sizeof(timings[0]), &net);
+            // Timings are in completion order; the first request started earliest
+            for (size_t i = 0; i < n && i < sizeof(timings) / sizeof(timings[0]); i++) {
+                if (first.start_us == 0 || timings[i].start_us < first.start_us) {
+                    first = timings[i];
+                }
+            }
+        }
+        double first_byte_ms = -1.0;
+        if (first.ttfb_us) {
+            first_byte_ms = (first.start_us + first.dns_us + first.connect_us + first.upload_us + first.ttfb_us -
+                             ctx.turn_start_us) / 1000.0;
+        }
+        if (err != ESP_OK) {
+            failures++;
+        }
+        printf("{\"variant\":\"%s\",\"mode\":\"%s\",\"turn\":%d,\"ok\":%s,\"error\":\"%s\","
+               "\"first_byte_ms\":%.1f,\"stt_ms\":%.1f,\"first_text_ms\":%.1f,\"ttfa_ms\":%.1f,\"total_ms\":%.1f,"
+               "\"peak_heap\":%zu,\"allocs\":%lu,\"samples\":%zu,\"tts_requests\":%d,"
+               "\"requests\":%u,\"new_connections\":%u,\"bytes_up\":%zu,\"bytes_down\":%zu}\n",
+               GEMINI_BENCH_VARIANT, argv[1], turn, err == ESP_OK ? "true" : "false", esp_err_to_name(err),
+               first_byte_ms, stt_us / 1000.0,
+               ctx.first_text_us ? (ctx.first_text_us - ctx.turn_start_us) / 1000.0 : -1.0,
+               ctx.first_audio_us ? (ctx.first_audio_us - ctx.turn_start_us) / 1000.0 : -1.0,
+               (end_us - ctx.turn_start_us) / 1000.0,
+               peak, allocs, ctx.samples, ctx.tts_requests,
+               (unsigned)net.requests, (unsigned)net.new_connections, net.bytes_up, net.bytes_down);
+        fflush(stdout);
+    }
+
+    // Latency history per endpoint, on stderr so run_bench.py only sees turns
+    gemini_http_endpoint_stats_t endpoints[6];
+    size_t n_endpoints = gemini_api_get_endpoint_stats(endpoints, sizeof(endpoints) / sizeof(endpoints[0]));
+    for (size_t i = 0; i < n_endpoints; i++) {
+        const gemini_http_endpoint_stats_t *ep = &endpoints[i];
+        fprintf(stderr, "%s %s %-40s p50 %5u p95 %5u p99 %5u ms | %u req, %u hedged (%u won), %u past deadline\n",
+                GEMINI_BENCH_VARIANT, argv[1], ep->endpoint, (unsigned)ep->p50_ms, (unsigned)ep->p95_ms,
+                (unsigned)ep->p99_ms, (unsigned)ep->requests, (unsigned)ep->hedged, (unsigned)ep->hedge_wins,
+                (unsigned)ep->deadline_misses);
+    }
+
+    const char *trace_path = getenv("GEMINI_BENCH_TRACE");
+    if (trace_path && *trace_path) {
+        FILE *f = fopen(trace_path, "w");
+        if (!f || span_trace_dump(trace_turn, trace_file_write, f) != ESP_OK) {
+            fprintf(stderr, "could not write %s\n", trace_path);
+        }
+        if (f) {
+            fclose(f);
+        }
+    }
+
+    gemini_live_stop(session);
+    vSemaphoreDelete(ctx.done);
+    gemini_api_deinit();
+    free(pcm);
+    free(audio);
+    return failures == turns ? 1 : 0;
+}
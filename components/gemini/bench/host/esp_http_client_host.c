@@ -0,0 +1,475 @@
+// Host shim: minimal HTTP/1.1 client with esp_http_client semantics
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const char *TAG = "http_host";
+
+#define MAX_HEADERS 8
+#define RX_BUF_SIZE 4096
+
+typedef enum {
+    BODY_LENGTH,        // Content-Length
+    BODY_CHUNKED,       // Transfer-Encoding: chunked
+    BODY_UNTIL_CLOSE,   // Neither: body ends when the server closes
+} body_framing_t;
+
+typedef enum {
+    CHUNK_SIZE_LINE,
+    CHUNK_DATA,
+    CHUNK_DATA_CRLF,
+    CHUNK_TRAILER,
+} chunk_state_t;
+
+struct esp_http_client {
+    char *url;
+    char host[128];             // Host named by the URL (sent as Host:)
+    char path[1024];            // Path and query
+    esp_http_client_method_t method;
+    http_event_handle_cb handler;
+    void *user_data;
+    int timeout_ms;
+    char *header_keys[MAX_HEADERS];
+    char *header_values[MAX_HEADERS];
+
+    int fd;
+    uint8_t rx[RX_BUF_SIZE];
+    size_t rx_len;
+    size_t rx_pos;
+
+    int status;
+    body_framing_t framing;
+    int64_t content_length;
+    int64_t remaining;          // BODY_LENGTH: bytes left; BODY_CHUNKED: bytes left in chunk
+    chunk_state_t chunk_state;
+    bool close_after;
+    bool body_done;
+};
+
+static void dispatch(esp_http_client_handle_t client, esp_http_client_event_id_t id,
+                     void *data, int len, char *key, char *value)
+{
+    if (!client->handler) {
+        return;
+    }
+    esp_http_client_event_t evt = {
+        .event_id = id,
+        .client = client,
+        .data = data,
+        .data_len = len,
+        .user_data = client->user_data,
+        .header_key = key,
+        .header_value = value,
+    };
+    client->handler(&evt);
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+    if (!client) {
+        return NULL;
+    }
+    client->fd = -1;
+    client->handler = config->event_handler;
+    client->user_data = config->user_data;
+    client->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 5000;
+    client->method = HTTP_METHOD_GET;
+    if (config->url && esp_http_client_set_url(client, config->url) != ESP_OK) {
+        free(client);
+        return NULL;
+    }
+    return client;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    size_t host_len = strcspn(p, "/?");
+    if (host_len >= sizeof(client->host)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(client->host, p, host_len);
+    client->host[host_len] = '\0';
+    snprintf(client->path, sizeof(client->path), "%s%s", p[host_len] == '/' ? "" : "/", p + host_len);
+    free(client->url);
+    client->url = strdup(url);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    esp_http_client_delete_header(client, key);
+    for (int i = 0; i < MAX_HEADERS; i++) {
+        if (!client->header_keys[i]) {
+            client->header_keys[i] = strdup(key);
+            client->header_values[i] = strdup(value);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key)
+{
+    for (int i = 0; i < MAX_HEADERS; i++) {
+        if (client->header_keys[i] && strcasecmp(client->header_keys[i], key) == 0) {
+            free(client->header_keys[i]);
+            free(client->header_values[i]);
+            client->header_keys[i] = NULL;
+            client->header_values[i] = NULL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data)
+{
+    client->user_data = data;
+    return ESP_OK;
+}
+
+static void set_socket_timeout(int fd, int timeout_ms)
+{
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms)
+{
+    client->timeout_ms = timeout_ms;
+    if (client->fd >= 0) {
+        set_socket_timeout(client->fd, timeout_ms);
+    }
+    return ESP_OK;
+}
+
+static int connect_to_mock(int timeout_ms)
+{
+    const char *addr = getenv("GEMINI_MOCK_ADDR");
+    char host[128];
+    snprintf(host, sizeof(host), "%s", addr && *addr ? addr : "127.0.0.1:8080");
+    char *colon = strrchr(host, ':');
+    const char *port = "8080";
+    if (colon) {
+        *colon = '\0';
+        port = colon + 1;
+    }
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, port, &hints, &res) != 0 || !res) {
+        ESP_LOGE(TAG, "Cannot resolve mock server %s:%s", host, port);
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        ESP_LOGE(TAG, "Cannot connect to mock server %s:%s: %s", host, port, strerror(errno));
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        return -1;
+    }
+    set_socket_timeout(fd, timeout_ms);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    // Stand-in for DNS, TCP and the TLS handshake over a real link
+    const char *connect_ms = getenv("GEMINI_MOCK_CONNECT_MS");
+    if (connect_ms && atoi(connect_ms) > 0) {
+        usleep((useconds_t)atoi(connect_ms) * 1000);
+    }
+    return fd;
+}
+
+static int send_all(int fd, const char *data, size_t len)
+{
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, data + sent, len - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        sent += (size_t)n;
+    }
+    return (int)sent;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    // A response that was not read to the end leaves the connection unusable
+    if (client->fd >= 0 && (!client->body_done || client->close_after)) {
+        esp_http_client_close(client);
+    }
+    if (client->fd < 0) {
+        client->fd = connect_to_mock(client->timeout_ms);
+        if (client->fd < 0) {
+            return ESP_ERR_HTTP_CONNECT;
+        }
+        client->rx_len = 0;
+        client->rx_pos = 0;
+        dispatch(client, HTTP_EVENT_ON_CONNECTED, NULL, 0, NULL, NULL);
+    }
+
+    char head[2048];
+    int n = snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32 HTTP Client/1.0\r\n",
+                     client->method == HTTP_METHOD_POST ? "POST" : "GET", client->path, client->host);
+    for (int i = 0; i < MAX_HEADERS; i++) {
+        if (client->header_keys[i]) {
+            n += snprintf(head + n, sizeof(head) - n, "%s: %s\r\n", client->header_keys[i], client->header_values[i]);
+        }
+    }
+    if (write_len < 0) {
+        n += snprintf(head + n, sizeof(head) - n, "Transfer-Encoding: chunked\r\n\r\n");
+    } else {
+        n += snprintf(head + n, sizeof(head) - n, "Content-Length: %d\r\n\r\n", write_len);
+    }
+    if (n >= (int)sizeof(head)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (send_all(client->fd, head, (size_t)n) < 0) {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    dispatch(client, HTTP_EVENT_HEADERS_SENT, NULL, 0, NULL, NULL);
+
+    client->status = 0;
+    client->body_done = false;
+    client->close_after = false;
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len)
+{
+    if (client->fd < 0) {
+        return -1;
+    }
+    return send_all(client->fd, buffer, (size_t)len);
+}
+
+// Make at least one unread byte available in rx; returns false on EOF/error
+static bool rx_fill(esp_http_client_handle_t client)
+{
+    if (client->rx_pos < client->rx_len) {
+        return true;
+    }
+    client->rx_pos = 0;
+    client->rx_len = 0;
+    for (;;) {
+        ssize_t n = recv(client->fd, client->rx, sizeof(client->rx), 0);
+        if (n > 0) {
+            client->rx_len = (size_t)n;
+            return true;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return false;
+    }
+}
+
+// Read one CRLF-terminated line (without the CRLF); false on EOF or overflow
+static bool read_line(esp_http_client_handle_t client, char *line, size_t cap)
+{
+    size_t len = 0;
+    for (;;) {
+        if (!rx_fill(client)) {
+            return false;
+        }
+        char c = (char)client->rx[client->rx_pos++];
+        if (c == '\n') {
+            if (len > 0 && line[len - 1] == '\r') {
+                len--;
+            }
+            line[len] = '\0';
+            return true;
+        }
+        if (len + 1 >= cap) {
+            return false;
+        }
+        line[len++] = c;
+    }
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    if (client->fd < 0) {
+        return ESP_FAIL;
+    }
+    char line[1024];
+    if (!read_line(client, line, sizeof(line)) || sscanf(line, "HTTP/%*d.%*d %d", &client->status) != 1) {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+
+    client->framing = BODY_UNTIL_CLOSE;
+    client->content_length = -1;
+    for (;;) {
+        if (!read_line(client, line, sizeof(line))) {
+            esp_http_client_close(client);
+            return ESP_FAIL;
+        }
+        if (line[0] == '\0') {
+            break;
+        }
+        char *colon = strchr(line, ':');
+        if (!colon) {
+            continue;
+        }
+        *colon = '\0';
+        char *value = colon + 1;
+        while (*value == ' ') {
+            value++;
+        }
+        if (strcasecmp(line, "Content-Length") == 0) {
+            client->content_length = strtoll(value, NULL, 10);
+            if (client->framing != BODY_CHUNKED) {
+                client->framing = BODY_LENGTH;
+            }
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasecmp(value, "chunked") == 0) {
+            client->framing = BODY_CHUNKED;
+        } else if (strcasecmp(line, "Connection") == 0 && strcasecmp(value, "close") == 0) {
+            client->close_after = true;
+        }
+        dispatch(client, HTTP_EVENT_ON_HEADER, NULL, 0, line, value);
+    }
+
+    client->remaining = client->framing == BODY_LENGTH ? client->content_length : 0;
+    client->chunk_state = CHUNK_SIZE_LINE;
+    client->body_done = (client->framing == BODY_LENGTH && client->remaining == 0);
+    if (client->framing == BODY_UNTIL_CLOSE) {
+        client->close_after = true;
+    }
+    // Same convention as esp_http_client: no usable length reads as chunked
+    return client->content_length > 0 && client->framing == BODY_LENGTH ? client->content_length : 0;
+}
+
+static void finish_body(esp_http_client_handle_t client)
+{
+    client->body_done = true;
+    dispatch(client, HTTP_EVENT_ON_FINISH, NULL, 0, NULL, NULL);
+    if (client->close_after) {
+        esp_http_client_close(client);
+    }
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    int out = 0;
+    while (out < len && !client->body_done) {
+        if (client->fd < 0) {
+            return -1;
+        }
+        if (client->framing == BODY_CHUNKED && client->chunk_state != CHUNK_DATA) {
+            char line[128];
+            if (!read_line(client, line, sizeof(line))) {
+                esp_http_client_close(client);
+                return -1;
+            }
+            if (client->chunk_state == CHUNK_SIZE_LINE) {
+                client->remaining = strtoll(line, NULL, 16);
+                client->chunk_state = client->remaining > 0 ? CHUNK_DATA : CHUNK_TRAILER;
+            } else if (client->chunk_state == CHUNK_DATA_CRLF) {
+                client->chunk_state = CHUNK_SIZE_LINE;
+            } else if (line[0] == '\0') {
+                finish_body(client);
+            }
+            continue;
+        }
+
+        if (!rx_fill(client)) {
+            if (client->framing == BODY_UNTIL_CLOSE) {
+                finish_body(client);
+                esp_http_client_close(client);
+                break;
+            }
+            esp_http_client_close(client);
+            return -1;
+        }
+        size_t n = client->rx_len - client->rx_pos;
+        if (n > (size_t)(len - out)) {
+            n = (size_t)(len - out);
+        }
+        if (client->framing != BODY_UNTIL_CLOSE && (int64_t)n > client->remaining) {
+            n = (size_t)client->remaining;
+        }
+        memcpy(buffer + out, client->rx + client->rx_pos, n);
+        client->rx_pos += n;
+        dispatch(client, HTTP_EVENT_ON_DATA, buffer + out, (int)n, NULL, NULL);
+        out += (int)n;
+        if (client->framing != BODY_UNTIL_CLOSE) {
+            client->remaining -= (int64_t)n;
+            if (client->remaining == 0) {
+                if (client->framing == BODY_LENGTH) {
+                    finish_body(client);
+                } else {
+                    client->chunk_state = CHUNK_DATA_CRLF;
+                }
+            }
+        }
+        // Hand data over as soon as it arrives, like a socket read would
+        if (client->rx_pos == client->rx_len) {
+            break;
+        }
+    }
+    return out;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client)
+{
+    return client->framing != BODY_LENGTH;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    if (client->fd >= 0) {
+        close(client->fd);
+        client->fd = -1;
+        client->rx_len = 0;
+        client->rx_pos = 0;
+        dispatch(client, HTTP_EVENT_DISCONNECTED, NULL, 0, NULL, NULL);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (!client) {
+        return ESP_FAIL;
+    }
+    esp_http_client_close(client);
+    for (int i = 0; i < MAX_HEADERS; i++) {
+        free(client->header_keys[i]);
+        free(client->header_values[i]);
+    }
+    free(client->url);
+    free(client);
+    return ESP_OK;
+}
@@ -0,0 +1,14 @@
+// Host shim: ESP_LOGx to stderr, filtered by esp_log_host_level at run time
+#pragma once
+#include <stdio.h>
+
+// 0 = none, 1 = error, 2 = warning, 3 = info, 4 = debug (default: warning)
+extern int esp_log_host_level;
+
+#define ESP_HOST_LOG(level, letter, tag, fmt, ...) \
+    do { if (esp_log_host_level >= (level)) fprintf(stderr, letter " %s: " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_HOST_LOG(1, "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_HOST_LOG(2, "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_HOST_LOG(3, "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_HOST_LOG(4, "D", tag, fmt, ##__VA_ARGS__)
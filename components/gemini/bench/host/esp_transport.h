@@ -0,0 +1,19 @@
+// Host shim: esp_transport over plain TCP sockets (esp_transport_host.c)
+#pragma once
+#include "esp_err.h"
+
+typedef struct esp_transport_item_t *esp_transport_handle_t;
+
+enum {
+    ERR_TCP_TRANSPORT_NO_MEM = -3,
+    ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT = -2,
+    ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN = 0,
+    ERR_TCP_TRANSPORT_CONNECTION_FAILED = -1,
+};
+
+int esp_transport_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms);
+int esp_transport_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms);
+int esp_transport_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms);
+int esp_transport_poll_read(esp_transport_handle_t t, int timeout_ms);
+int esp_transport_close(esp_transport_handle_t t);
+esp_err_t esp_transport_destroy(esp_transport_handle_t t);
@@ -0,0 +1,109 @@
+// Host shim: esp_transport on plain TCP sockets
+#include "esp_transport.h"
+#include "esp_transport_ssl.h"
+#include "esp_transport_tcp.h"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct esp_transport_item_t {
+    int fd;
+};
+
+esp_transport_handle_t esp_transport_tcp_init(void)
+{
+    esp_transport_handle_t t = calloc(1, sizeof(*t));
+    if (t) {
+        t->fd = -1;
+    }
+    return t;
+}
+
+esp_transport_handle_t esp_transport_ssl_init(void)
+{
+    return esp_transport_tcp_init();
+}
+
+int esp_transport_connect(esp_transport_handle_t t, const char *host, int port, int timeout_ms)
+{
+    (void)timeout_ms;
+    char service[8];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, service, &hints, &res) != 0 || !res) {
+        return -1;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    t->fd = fd;
+    return 0;
+}
+
+int esp_transport_poll_read(esp_transport_handle_t t, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = t->fd, .events = POLLIN };
+    int ret = poll(&pfd, 1, timeout_ms);
+    if (ret > 0 && (pfd.revents & (POLLERR | POLLNVAL))) {
+        return -1;
+    }
+    return ret;
+}
+
+int esp_transport_read(esp_transport_handle_t t, char *buffer, int len, int timeout_ms)
+{
+    int poll_ret = esp_transport_poll_read(t, timeout_ms);
+    if (poll_ret < 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    }
+    if (poll_ret == 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT;
+    }
+    ssize_t n = recv(t->fd, buffer, (size_t)len, 0);
+    if (n < 0) {
+        return ERR_TCP_TRANSPORT_CONNECTION_FAILED;
+    }
+    return n == 0 ? ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN : (int)n;
+}
+
+int esp_transport_write(esp_transport_handle_t t, const char *buffer, int len, int timeout_ms)
+{
+    struct pollfd pfd = { .fd = t->fd, .events = POLLOUT };
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+        return -1;
+    }
+    ssize_t n = send(t->fd, buffer, (size_t)len, MSG_NOSIGNAL);
+    return n < 0 ? -1 : (int)n;
+}
+
+int esp_transport_close(esp_transport_handle_t t)
+{
+    if (t->fd >= 0) {
+        close(t->fd);
+        t->fd = -1;
+    }
+    return 0;
+}
+
+esp_err_t esp_transport_destroy(esp_transport_handle_t t)
+{
+    if (t) {
+        esp_transport_close(t);
+        free(t);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,11 @@
+// Host shim: the mock server speaks plain TCP, so "SSL" is the TCP transport
+#pragma once
+#include "esp_transport.h"
+
+esp_transport_handle_t esp_transport_ssl_init(void);
+
+static inline void esp_transport_ssl_crt_bundle_attach(esp_transport_handle_t t, esp_err_t (*attach)(void *conf))
+{
+    (void)t;
+    (void)attach;
+}
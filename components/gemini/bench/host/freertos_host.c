@@ -0,0 +1,169 @@
+// Host shim: FreeRTOS semaphores and tasks on pthreads
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct host_semaphore {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+static SemaphoreHandle_t create(UBaseType_t max, UBaseType_t initial)
+{
+    SemaphoreHandle_t sem = malloc(sizeof(*sem));
+    if (sem) {
+        pthread_mutex_init(&sem->mutex, NULL);
+        pthread_cond_init(&sem->cond, NULL);
+        sem->count = initial;
+        sem->max = max;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return create(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return create(max, initial);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&sem->mutex);
+    while (sem->count == 0) {
+        int err = ticks == portMAX_DELAY ? pthread_cond_wait(&sem->cond, &sem->mutex)
+                                         : pthread_cond_timedwait(&sem->cond, &sem->mutex, &deadline);
+        if (err == ETIMEDOUT) {
+            pthread_mutex_unlock(&sem->mutex);
+            return pdFALSE;
+        }
+    }
+    sem->count--;
+    pthread_mutex_unlock(&sem->mutex);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->mutex);
+    BaseType_t ok = sem->count < sem->max ? pdTRUE : pdFALSE;
+    if (ok) {
+        sem->count++;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->mutex);
+    return ok;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    if (sem) {
+        pthread_cond_destroy(&sem->cond);
+        pthread_mutex_destroy(&sem->mutex);
+        free(sem);
+    }
+}
+
+typedef struct {
+    TaskFunction_t fn;
+    void *arg;
+    char name[16];
+} task_start_t;
+
+static __thread char t_task_name[16] = "main";
+
+static void *task_entry(void *p)
+{
+    task_start_t start = *(task_start_t *)p;
+    free(p);
+    memcpy(t_task_name, start.name, sizeof(t_task_name));
+    start.fn(start.arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    (void)priority;
+    task_start_t *start = malloc(sizeof(*start));
+    if (!start) {
+        return pdFALSE;
+    }
+    start->fn = fn;
+    start->arg = arg;
+    snprintf(start->name, sizeof(start->name), "%s", name ? name : "");
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    // Keep the device stack budget so an overflow shows up here too
+    pthread_attr_setstacksize(&attr, stack_depth < 16384 ? 16384 : stack_depth);
+    pthread_t thread;
+    int err = pthread_create(&thread, &attr, task_entry, start);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        free(start);
+        return pdFALSE;
+    }
+    if (handle) {
+        *handle = (TaskHandle_t)(uintptr_t)thread;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL) {
+        pthread_exit(NULL);
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t)(uintptr_t)pthread_self();
+}
+
+// Only the calling task's own name is kept
+char *pcTaskGetName(TaskHandle_t task)
+{
+    (void)task;
+    return t_task_name;
+}
+
+// Priorities are not modelled; every thread runs at the same one
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    (void)task;
+    return 5;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
@@ -0,0 +1,45 @@
+// Host shim: the TTS cache is disabled so every benchmark run measures the network path
+#include "gemini_tts_cache.h"
+#include <string.h>
+
+void gemini_tts_cache_key(const char *voice, int sample_rate_hz, const char *text,
+                          uint8_t key[GEMINI_TTS_CACHE_KEY_LEN])
+{
+    (void)voice;
+    (void)sample_rate_hz;
+    (void)text;
+    memset(key, 0, GEMINI_TTS_CACHE_KEY_LEN);
+}
+
+esp_err_t gemini_tts_cache_init(void)
+{
+    return ESP_OK;
+}
+
+bool gemini_tts_cache_lookup(const uint8_t key[GEMINI_TTS_CACHE_KEY_LEN], int16_t *out,
+                             size_t max_samples, size_t *samples)
+{
+    (void)key;
+    (void)out;
+    (void)max_samples;
+    (void)samples;
+    return false;
+}
+
+void gemini_tts_cache_store(const uint8_t key[GEMINI_TTS_CACHE_KEY_LEN], const int16_t *pcm,
+                            size_t samples, bool persist)
+{
+    (void)key;
+    (void)pcm;
+    (void)samples;
+    (void)persist;
+}
+
+void gemini_tts_cache_get_stats(gemini_tts_cache_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void gemini_tts_cache_deinit(void)
+{
+}
@@ -0,0 +1,89 @@
+// Host shim: malloc interposition that tracks live and peak heap usage and
+// counts allocation calls
+//
+// Sizes come from malloc_usable_size(), so allocator rounding is included
+// the way it would be in heap_caps_get_free_size() on the device.
+#include "heap_track.h"
+#include <malloc.h>
+#include <stdatomic.h>
+#include <string.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void __libc_free(void *p);
+
+static atomic_long s_current;
+static atomic_long s_peak;
+static atomic_ulong s_allocs;
+
+static void track_add(long delta)
+{
+    long now = atomic_fetch_add(&s_current, delta) + delta;
+    long peak = atomic_load(&s_peak);
+    while (now > peak && !atomic_compare_exchange_weak(&s_peak, &peak, now)) {
+    }
+}
+
+void *malloc(size_t size)
+{
+    void *p = __libc_malloc(size);
+    if (p) {
+        atomic_fetch_add(&s_allocs, 1);
+        track_add((long)malloc_usable_size(p));
+    }
+    return p;
+}
+
+void *calloc(size_t n, size_t size)
+{
+    void *p = __libc_calloc(n, size);
+    if (p) {
+        atomic_fetch_add(&s_allocs, 1);
+        track_add((long)malloc_usable_size(p));
+    }
+    return p;
+}
+
+void *realloc(void *old, size_t size)
+{
+    long old_size = old ? (long)malloc_usable_size(old) : 0;
+    void *p = __libc_realloc(old, size);
+    if (p) {
+        atomic_fetch_add(&s_allocs, 1);
+        track_add((long)malloc_usable_size(p) - old_size);
+    } else if (size == 0) {
+        track_add(-old_size);
+    }
+    return p;
+}
+
+void free(void *p)
+{
+    if (p) {
+        track_add(-(long)malloc_usable_size(p));
+        __libc_free(p);
+    }
+}
+
+size_t heap_track_current(void)
+{
+    long now = atomic_load(&s_current);
+    return now > 0 ? (size_t)now : 0;
+}
+
+size_t heap_track_peak(void)
+{
+    long peak = atomic_load(&s_peak);
+    return peak > 0 ? (size_t)peak : 0;
+}
+
+unsigned long heap_track_allocs(void)
+{
+    return atomic_load(&s_allocs);
+}
+
+void heap_track_reset_peak(void)
+{
+    atomic_store(&s_peak, atomic_load(&s_current));
+}
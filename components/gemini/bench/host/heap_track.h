@@ -0,0 +1,8 @@
+// Host shim: heap usage of the benchmark process (heap_track.c)
+#pragma once
+#include <stddef.h>
+
+size_t heap_track_current(void);
+size_t heap_track_peak(void);
+void heap_track_reset_peak(void);
+unsigned long heap_track_allocs(void);    // malloc/calloc/realloc calls so far
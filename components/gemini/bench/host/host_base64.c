@@ -0,0 +1,83 @@
+// Host shim: mbedtls_base64_encode/decode with mbedtls semantics
+#include "mbedtls/base64.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+static const char ENCODE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int decode_char(unsigned char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
+                          const unsigned char *src, size_t slen)
+{
+    size_t need = (slen + 2) / 3 * 4;
+    if (slen == 0) {
+        *olen = 0;
+        return 0;
+    }
+    if (!dst || dlen < need + 1) {
+        *olen = need + 1;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+    size_t o = 0;
+    size_t i = 0;
+    for (; i + 2 < slen; i += 3) {
+        uint32_t v = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+        dst[o++] = ENCODE[v >> 18];
+        dst[o++] = ENCODE[(v >> 12) & 63];
+        dst[o++] = ENCODE[(v >> 6) & 63];
+        dst[o++] = ENCODE[v & 63];
+    }
+    if (i < slen) {
+        uint32_t v = (uint32_t)src[i] << 16 | (i + 1 < slen ? (uint32_t)src[i + 1] << 8 : 0);
+        dst[o++] = ENCODE[v >> 18];
+        dst[o++] = ENCODE[(v >> 12) & 63];
+        dst[o++] = i + 1 < slen ? ENCODE[(v >> 6) & 63] : '=';
+        dst[o++] = '=';
+    }
+    dst[o] = 0;
+    *olen = o;
+    return 0;
+}
+
+int mbedtls_base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
+                          const unsigned char *src, size_t slen)
+{
+    // Whitespace is not expected from the callers; reject like bad characters
+    if (slen % 4 != 0) {
+        return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+    }
+    size_t pad = 0;
+    if (slen > 0 && src[slen - 1] == '=') pad++;
+    if (slen > 1 && src[slen - 2] == '=') pad++;
+    size_t need = slen / 4 * 3 - pad;
+    if (!dst || dlen < need) {
+        *olen = need;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+    size_t o = 0;
+    for (size_t i = 0; i < slen; i += 4) {
+        bool last = (i + 4 == slen);
+        int a = decode_char(src[i]);
+        int b = decode_char(src[i + 1]);
+        int c = (last && pad == 2) ? 0 : decode_char(src[i + 2]);
+        int d = (last && pad >= 1) ? 0 : decode_char(src[i + 3]);
+        if (a < 0 || b < 0 || c < 0 || d < 0) {
+            return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+        }
+        uint32_t v = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | (uint32_t)d;
+        dst[o++] = (unsigned char)(v >> 16);
+        if (!(last && pad == 2)) dst[o++] = (unsigned char)(v >> 8);
+        if (!(last && pad >= 1)) dst[o++] = (unsigned char)v;
+    }
+    *olen = o;
+    return 0;
+}
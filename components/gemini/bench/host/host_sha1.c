@@ -0,0 +1,75 @@
+// Host shim: one-shot SHA-1 (FIPS 180-1), enough for Sec-WebSocket-Accept
+#include "mbedtls/sha1.h"
+#include <stdint.h>
+#include <string.h>
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void block(uint32_t h[5], const unsigned char *p)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t t = ROL(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROL(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+int mbedtls_sha1(const unsigned char *input, size_t ilen, unsigned char output[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    size_t full = ilen / 64 * 64;
+    for (size_t i = 0; i < full; i += 64) {
+        block(h, input + i);
+    }
+
+    unsigned char tail[128] = { 0 };
+    size_t rest = ilen - full;
+    memcpy(tail, input + full, rest);
+    tail[rest] = 0x80;
+    size_t tail_len = rest + 9 <= 64 ? 64 : 128;
+    uint64_t bits = (uint64_t)ilen * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_len - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+    for (size_t i = 0; i < tail_len; i += 64) {
+        block(h, tail + i);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        output[4 * i] = (unsigned char)(h[i] >> 24);
+        output[4 * i + 1] = (unsigned char)(h[i] >> 16);
+        output[4 * i + 2] = (unsigned char)(h[i] >> 8);
+        output[4 * i + 3] = (unsigned char)h[i];
+    }
+    return 0;
+}
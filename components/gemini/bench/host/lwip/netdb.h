@@ -0,0 +1,25 @@
+// Host shim: lwIP's netdb is the BSD one, except that every name resolves to
+// the mock server (GEMINI_MOCK_ADDR), so the DNS phase is timed without a network
+#pragma once
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline int host_mock_getaddrinfo(const char *node, const char *service,
+                                        const struct addrinfo *hints, struct addrinfo **res)
+{
+    (void)node;
+    const char *addr = getenv("GEMINI_MOCK_ADDR");
+    char host[128];
+    snprintf(host, sizeof(host), "%s", addr && *addr ? addr : "127.0.0.1:8080");
+    char *colon = strrchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+    }
+    return getaddrinfo(host, service, hints, res);
+}
+
+#define getaddrinfo host_mock_getaddrinfo
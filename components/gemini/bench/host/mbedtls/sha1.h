@@ -0,0 +1,5 @@
+// Host shim: mbedtls_sha1 (host_sha1.c)
+#pragma once
+#include <stddef.h>
+
+int mbedtls_sha1(const unsigned char *input, size_t ilen, unsigned char output[20]);
@@ -0,0 +1,27 @@
+// Host shim: Kconfig defaults of the gemini, span_trace and turn_arena components
+// The STT/TTS encoding choices are set per benchmark variant in CMakeLists.txt.
+#pragma once
+
+#define CONFIG_GEMINI_HTTP_TIMEOUT_MS 30000
+#define CONFIG_GEMINI_HTTP_POOL_SIZE 3
+#define CONFIG_GEMINI_HTTP_POOL_IDLE_TIMEOUT_MS 60000
+#define CONFIG_GEMINI_HTTP_UPLOAD_CHUNK_SIZE 2048
+#define CONFIG_GEMINI_HTTP_RESPONSE_SEGMENT_SIZE 2048
+#define CONFIG_GEMINI_HTTP_RESPONSE_POOL_SEGMENTS 4
+#define CONFIG_GEMINI_TURN_BUDGET_MS 15000
+#define CONFIG_GEMINI_HTTP_FIRST_BYTE_TIMEOUT_MS 8000
+// -DGEMINI_BENCH_NO_HEDGE builds the client without request hedging
+#ifndef GEMINI_BENCH_NO_HEDGE
+#define CONFIG_GEMINI_HTTP_HEDGE 1
+#define CONFIG_GEMINI_HTTP_HEDGE_DELAY_MS 1500
+#define CONFIG_GEMINI_HTTP_HEDGE_STACK_SIZE 8192
+#endif
+#define CONFIG_GEMINI_HTTP_PREWARM_STACK_SIZE 8192
+#define CONFIG_GEMINI_TTS_CACHE_RAM_KB 0
+#define CONFIG_GEMINI_TTS_CACHE_PARTITION "tts_cache"
+#define CONFIG_GEMINI_LIVE_MODEL "gemini-2.0-flash-live-001"
+#define CONFIG_GEMINI_LIVE_UPLOAD_CHUNK_MS 100
+#define CONFIG_GEMINI_LIVE_UPLOAD_BUFFER_MS 2000
+#define CONFIG_SPAN_TRACE 1
+#define CONFIG_SPAN_TRACE_RECORDS 512
+#define CONFIG_TURN_ARENA_SIZE_KB 32
@@ -0,0 +1,568 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Speech-to-Text, Gemini and Text-to-Speech endpoints.
+
+Serves plain HTTP/1.1 with keep-alive and routes by path, so the host build
+of components/gemini (see gemini_bench.c) can run full voice turns without a
+network connection:
+
+  POST /v1/speech:recognize                         STT transcript
+  POST /v1beta/models/<model>:generateContent        LLM reply
+  POST /v1beta/models/<model>:streamGenerateContent  LLM reply as SSE (also
+                                                     for an inline audio query)
+  POST /v1/text:synthesize                           TTS audio (LINEAR16 or MP3)
+  GET  /ws/...BidiGenerateContent                    Live session (WebSocket)
+  GET  /                                             404 page on a kept-alive
+                                                     connection (connection
+                                                     warm-up, as Google does)
+
+Responses are replayed from a fixture directory when one is given (see
+--fixtures and --record), otherwise synthesized. Link conditions are
+configurable per endpoint:
+
+  --latency-ms 300              delay before response headers, or per endpoint:
+  --latency-ms stt=400,llm=600,tts=250,live=700,audio=650
+                                (audio: generateContent requests with inline
+                                audio; defaults to the llm value)
+  --token-ms 40                 gap between streamed LLM events
+  --rate-kbps 512               downstream bandwidth cap
+  --chunk-bytes 1460            size of each body write
+  --chunked                     Transfer-Encoding: chunked for every response
+  --error-rate 0.1 --error-mode 503|reset|truncate|stall|mixed
+                                (stall: headers only after --stall-ms, like
+                                a request lost on a flaky link)
+
+The Live session answers setup with setupComplete and every utterance
+(realtimeInput audio closed by activityEnd) with an input transcription,
+the reply as 24 kHz PCM chunks with its output transcription, and
+turnComplete. An activityStart while the answer is still being sent stops
+it with `interrupted`. --latency-ms live=N delays the first audio chunk,
+--rate-kbps paces the chunks and --chunked splits every server message into
+WebSocket fragments of --chunk-bytes.
+
+Prints "listening on <port>" once ready (use --port 0 for a free port).
+"""
+
+import argparse
+import base64
+import hashlib
+import json
+import math
+import os
+import random
+import re
+import socket
+import struct
+import sys
+import threading
+import time
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+TRANSCRIPT = "what's the weather like in lisbon tomorrow"
+REPLY = ("Tomorrow in Lisbon expect sunshine with a few clouds in the afternoon. "
+         "Temperatures will reach about twenty four degrees. "
+         "There is no rain in the forecast, so it is a good day to be outside.")
+
+# Spoken duration per character of synthesized text, roughly 14 characters a second
+TTS_SECONDS_PER_CHAR = 0.07
+
+LIVE_RATE = 24000
+# Model audio per Live message, as the real service sends it
+LIVE_CHUNK_SECONDS = 0.04
+WS_GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+FIXTURE_FILES = {
+    "stt": "stt.json",
+    "llm": "llm.json",
+    "llm_stream": "llm_stream.sse",
+    "llm_audio": "llm_audio_stream.sse",
+    "tts_LINEAR16": "tts_LINEAR16.json",
+    "tts_MP3": "tts_MP3.json",
+}
+
+UPSTREAM = {
+    "stt": "https://speech.googleapis.com",
+    "llm": "https://generativelanguage.googleapis.com",
+    "llm_stream": "https://generativelanguage.googleapis.com",
+    "llm_audio": "https://generativelanguage.googleapis.com",
+    "tts": "https://texttospeech.googleapis.com",
+}
+
+
+def wav_bytes(pcm, rate):
+    data = struct.pack("<%dh" % len(pcm), *pcm)
+    return (b"RIFF" + struct.pack("<I", 36 + len(data)) + b"WAVE" +
+            b"fmt " + struct.pack("<IHHIIHH", 16, 1, 1, rate, rate * 2, 2, 16) +
+            b"data" + struct.pack("<I", len(data)) + data)
+
+
+def synth_linear16(text, rate):
+    samples = int(len(text) * TTS_SECONDS_PER_CHAR * rate)
+    pcm = [int(3000 * math.sin(2 * math.pi * 220 * i / rate)) for i in range(samples)]
+    return wav_bytes(pcm, rate)
+
+
+def synth_mp3(text, rate):
+    # Silent MPEG-2 Layer III frames, 24 kHz mono 32 kbps: 96 bytes and 576
+    # samples each. Zero side info decodes to silence in any decoder.
+    if rate != 24000:
+        rate = 24000
+    header = bytes([0xFF, 0xF3, 0x44, 0xC0])
+    frame = header + bytes(96 - len(header))
+    frames = max(1, int(len(text) * TTS_SECONDS_PER_CHAR * rate / 576))
+    return frame * frames
+
+
+def sse_events(text):
+    words = text.split(" ")
+    events = []
+    for i in range(0, len(words), 3):
+        piece = " ".join(words[i:i + 3]) + (" " if i + 3 < len(words) else "")
+        chunk = {"candidates": [{"content": {"parts": [{"text": piece}], "role": "model"}, "index": 0}]}
+        if i + 3 >= len(words):
+            chunk["candidates"][0]["finishReason"] = "STOP"
+        events.append(b"data: " + json.dumps(chunk).encode() + b"\r\n\r\n")
+    return events
+
+
+def parse_latency(spec):
+    out = {"stt": 0.0, "llm": 0.0, "tts": 0.0, "live": 0.0, "audio": None}
+    if not spec:
+        spec = "0"
+    if "=" not in spec:
+        return {k: float(spec) / 1000.0 for k in out}
+    for part in spec.split(","):
+        key, value = part.split("=", 1)
+        if key not in out:
+            raise SystemExit("unknown endpoint in --latency-ms: %s" % key)
+        out[key] = float(value) / 1000.0
+    if out["audio"] is None:
+        out["audio"] = out["llm"]
+    return out
+
+
+# The inline audio part of an audio query must be a complete FLAC or WAV file
+def check_audio_query(request):
+    try:
+        parts = json.loads(request)["contents"][0]["parts"]
+        inline = next(p["inline_data"] for p in parts if "inline_data" in p)
+        audio = base64.b64decode(inline["data"], validate=True)
+    except (ValueError, KeyError, IndexError, StopIteration) as e:
+        return "malformed audio query: %r" % e
+    magic = {"audio/flac": b"fLaC", "audio/wav": b"RIFF"}.get(inline.get("mime_type"))
+    if magic is None or not audio.startswith(magic):
+        return "audio does not match mime_type %s" % inline.get("mime_type")
+    return None
+
+
+class MockHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "GeminiMock/1.0"
+
+    def log_message(self, fmt, *args):
+        if self.server.opts.verbose:
+            sys.stderr.write("mock: " + fmt % args + "\n")
+
+    # The STT upload is streamed with chunked encoding, which
+    # BaseHTTPRequestHandler does not decode
+    def read_body(self):
+        if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+            body = bytearray()
+            while True:
+                size = int(self.rfile.readline().split(b";")[0].strip() or b"0", 16)
+                if size == 0:
+                    while self.rfile.readline() not in (b"\r\n", b"\n", b""):
+                        pass
+                    return bytes(body)
+                body += self.rfile.read(size)
+                self.rfile.readline()
+        return self.rfile.read(int(self.headers.get("Content-Length", "0")))
+
+    def do_POST(self):
+        body = self.read_body()
+        path = self.path.split("?", 1)[0]
+        if path == "/v1/speech:recognize":
+            endpoint = "stt"
+        elif path.endswith(":streamGenerateContent"):
+            endpoint = "llm_audio" if b'"inline_data"' in body else "llm_stream"
+        elif path.endswith(":generateContent"):
+            endpoint = "llm"
+        elif path == "/v1/text:synthesize":
+            endpoint = "tts"
+        else:
+            self.send_error(404)
+            return
+
+        opts = self.server.opts
+        if endpoint == "llm_audio":
+            problem = check_audio_query(body)
+            if problem:
+                self.send_json(400, json.dumps({"error": {"code": 400, "message": "mock: " + problem}}).encode())
+                return
+        time.sleep(opts.latency[{"llm_stream": "llm", "llm_audio": "audio"}.get(endpoint, endpoint)])
+
+        fault = None
+        if opts.error_rate > 0 and self.server.rng.random() < opts.error_rate:
+            fault = opts.error_mode
+            if fault == "mixed":
+                fault = self.server.rng.choice(["503", "reset", "truncate"])
+        self.server.count(endpoint, fault)
+        if fault == "reset":
+            self.reset_connection()
+            return
+        if fault == "stall":
+            time.sleep(opts.stall_ms / 1000.0)
+            fault = None
+        if fault == "503":
+            self.send_json(503, b'{"error": {"code": 503, "message": "mock: injected", "status": "UNAVAILABLE"}}')
+            return
+
+        if endpoint in ("llm_stream", "llm_audio"):
+            self.send_stream(self.stream_events(endpoint, body), truncate=fault == "truncate")
+        else:
+            self.send_json(200, self.response_body(endpoint, body), truncate=fault == "truncate")
+
+    def response_body(self, endpoint, request):
+        fixture_key = endpoint
+        encoding = "LINEAR16"
+        if endpoint == "tts":
+            req = json.loads(request or b"{}")
+            encoding = req.get("audioConfig", {}).get("audioEncoding", "LINEAR16")
+            fixture_key = "tts_" + encoding
+
+        if self.server.opts.record:
+            return self.server.record(fixture_key, endpoint, self.path, request)
+        fixture = self.server.fixture(fixture_key)
+        if fixture is not None:
+            return fixture
+
+        if endpoint == "stt":
+            return json.dumps({"results": [{"alternatives": [{"transcript": TRANSCRIPT, "confidence": 0.94}],
+                                            "languageCode": "en-us"}]}).encode()
+        if endpoint == "llm":
+            return json.dumps({"candidates": [{"content": {"parts": [{"text": REPLY}], "role": "model"},
+                                               "finishReason": "STOP", "index": 0}]}).encode()
+        text = req.get("input", {}).get("text", "")
+        rate = int(req.get("audioConfig", {}).get("sampleRateHertz", 24000))
+        if encoding == "MP3":
+            audio = synth_mp3(text, rate)
+        elif encoding == "LINEAR16":
+            audio = synth_linear16(text, rate)
+        else:
+            self.send_json(400, b'{"error": {"code": 400, "message": "mock: unsupported audioEncoding"}}')
+            return None
+        # Google pretty-prints this response; keep the same shape
+        return b'{\n  "audioContent": "' + base64.b64encode(audio) + b'"\n}\n'
+
+    def stream_events(self, endpoint, request):
+        if self.server.opts.record:
+            raw = self.server.record(endpoint, endpoint, self.path, request)
+            return [e + b"\r\n\r\n" for e in re.split(rb"\r?\n\r?\n", raw) if e.strip()]
+        fixture = self.server.fixture(endpoint)
+        if fixture is not None:
+            return [e + b"\r\n\r\n" for e in re.split(rb"\r?\n\r?\n", fixture) if e.strip()]
+        return sse_events(REPLY)
+
+    def reset_connection(self):
+        # SO_LINGER 0 turns close() into a TCP RST
+        self.connection.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+        self.close_connection = True
+
+    def write_body(self, data, chunked):
+        opts = self.server.opts
+        step = max(1, opts.chunk_bytes)
+        for off in range(0, len(data), step):
+            piece = data[off:off + step]
+            if chunked:
+                self.wfile.write(b"%x\r\n" % len(piece) + piece + b"\r\n")
+            else:
+                self.wfile.write(piece)
+            self.wfile.flush()
+            if opts.rate_kbps > 0:
+                time.sleep(len(piece) * 8 / (opts.rate_kbps * 1000.0))
+
+    def send_json(self, status, body, truncate=False):
+        if body is None:
+            return
+        chunked = self.server.opts.chunked
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json; charset=UTF-8")
+        if chunked:
+            self.send_header("Transfer-Encoding", "chunked")
+        else:
+            self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if truncate:
+            self.write_body(body[:len(body) // 2], chunked)
+            self.reset_connection()
+            return
+        self.write_body(body, chunked)
+        if chunked:
+            self.wfile.write(b"0\r\n\r\n")
+            self.wfile.flush()
+
+    def send_stream(self, events, truncate=False):
+        self.send_response(200)
+        self.send_header("Content-Type", "text/event-stream")
+        self.send_header("Transfer-Encoding", "chunked")
+        self.end_headers()
+        if truncate:
+            events = events[:max(1, len(events) // 2)]
+        for i, event in enumerate(events):
+            if i > 0:
+                time.sleep(self.server.opts.token_ms / 1000.0)
+            self.write_body(event, True)
+        if truncate:
+            self.reset_connection()
+            return
+        self.wfile.write(b"0\r\n\r\n")
+        self.wfile.flush()
+
+
+    def do_GET(self):
+        if self.path == "/":
+            # send_error() would close the connection the client is warming up
+            body = b"<!DOCTYPE html><title>Error 404 (Not Found)</title>"
+            self.send_response(404)
+            self.send_header("Content-Type", "text/html; charset=UTF-8")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+            self.wfile.flush()
+            return
+        if "BidiGenerateContent" not in self.path or self.headers.get("Upgrade", "").lower() != "websocket":
+            self.send_error(404)
+            return
+        key = self.headers.get("Sec-WebSocket-Key", "").encode()
+        accept = base64.b64encode(hashlib.sha1(key + WS_GUID).digest()).decode()
+        self.send_response(101)
+        self.send_header("Upgrade", "websocket")
+        self.send_header("Connection", "Upgrade")
+        self.send_header("Sec-WebSocket-Accept", accept)
+        self.end_headers()
+        self.wfile.flush()
+        self.close_connection = True
+        LiveSession(self).run()
+
+
+class LiveSession:
+    """One WebSocket Live session: the handler thread reads client messages,
+    an answer thread per utterance writes the reply."""
+
+    def __init__(self, handler):
+        self.handler = handler
+        self.opts = handler.server.opts
+        self.server = handler.server
+        self.write_lock = threading.Lock()
+        self.answer = None
+        self.speaking = False
+        self.cancel = threading.Event()
+        self.closed = False
+
+    def read_exact(self, n):
+        data = self.handler.rfile.read(n)
+        if len(data) != n:
+            raise ConnectionError("client went away")
+        return data
+
+    def read_frame(self):
+        b0, b1 = self.read_exact(2)
+        length = b1 & 0x7F
+        if length == 126:
+            length = struct.unpack(">H", self.read_exact(2))[0]
+        elif length == 127:
+            length = struct.unpack(">Q", self.read_exact(8))[0]
+        mask = self.read_exact(4) if b1 & 0x80 else None
+        payload = bytearray(self.read_exact(length))
+        if mask:
+            for i in range(length):
+                payload[i] ^= mask[i & 3]
+        return bool(b0 & 0x80), b0 & 0x0F, bytes(payload)
+
+    # Whole messages from the client; control frames are handled here
+    def read_message(self):
+        opcode, parts = None, []
+        while True:
+            fin, op, payload = self.read_frame()
+            if op == 0x8:
+                self.send_frame(0x8, payload[:2])
+                return None
+            if op == 0x9:
+                self.send_frame(0xA, payload)
+                continue
+            if op == 0xA:
+                continue
+            if op != 0x0:
+                opcode = op
+            parts.append(payload)
+            if fin:
+                return opcode, b"".join(parts)
+
+    def send_frame(self, opcode, payload, fin=True):
+        head = bytes([(0x80 if fin else 0) | opcode])
+        n = len(payload)
+        if n < 126:
+            head += bytes([n])
+        elif n < 65536:
+            head += bytes([126]) + struct.pack(">H", n)
+        else:
+            head += bytes([127]) + struct.pack(">Q", n)
+        self.handler.wfile.write(head + payload)
+        self.handler.wfile.flush()
+
+    def send_json(self, obj):
+        data = json.dumps(obj).encode()
+        with self.write_lock:
+            if self.closed:
+                return
+            if not self.opts.chunked:
+                self.send_frame(0x1, data)
+            else:
+                step = max(1, self.opts.chunk_bytes)
+                pieces = [data[i:i + step] for i in range(0, len(data), step)]
+                for i, piece in enumerate(pieces):
+                    self.send_frame(0x1 if i == 0 else 0x0, piece, fin=i == len(pieces) - 1)
+        if self.opts.rate_kbps > 0:
+            time.sleep(len(data) * 8 / (self.opts.rate_kbps * 1000.0))
+
+    def run(self):
+        try:
+            while True:
+                msg = self.read_message()
+                if msg is None:
+                    break
+                self.handle(json.loads(msg[1]))
+        except (ConnectionError, OSError, ValueError) as e:
+            if self.opts.verbose:
+                sys.stderr.write("mock: live session ended: %s\n" % e)
+        finally:
+            self.cancel.set()
+            with self.write_lock:
+                self.closed = True
+            if self.answer:
+                self.answer.join()
+
+    def handle(self, msg):
+        if "setup" in msg:
+            self.server.count("live", None)
+            self.send_json({"setupComplete": {}})
+            return
+        realtime = msg.get("realtimeInput", {})
+        if "activityStart" in realtime and self.speaking:
+            self.cancel.set()
+            self.answer.join()
+            self.speaking = False
+            self.send_json({"serverContent": {"interrupted": True}})
+        if "activityEnd" in realtime:
+            if self.answer:
+                self.cancel.set()
+                self.answer.join()
+            self.cancel = threading.Event()
+            self.answer = threading.Thread(target=self.speak, args=(self.cancel,), daemon=True)
+            self.speaking = True
+            self.answer.start()
+
+    def speak(self, cancel):
+        pcm = self.server.live_pcm
+        if cancel.wait(self.opts.latency["live"]):
+            return
+        self.send_json({"serverContent": {"inputTranscription": {"text": TRANSCRIPT}}})
+        step = int(LIVE_RATE * LIVE_CHUNK_SECONDS) * 2
+        for off in range(0, len(pcm), step):
+            if cancel.is_set():
+                return
+            content = {"modelTurn": {"parts": [{"inlineData": {
+                "mimeType": "audio/pcm;rate=%d" % LIVE_RATE,
+                "data": base64.b64encode(pcm[off:off + step]).decode()}}]}}
+            if off == 0:
+                content["outputTranscription"] = {"text": REPLY}
+            self.send_json({"serverContent": content})
+        if not cancel.is_set():
+            self.speaking = False
+            self.send_json({"serverContent": {"turnComplete": True}})
+
+
+class MockServer(ThreadingHTTPServer):
+    daemon_threads = True
+
+    # A client that gave up on a stalled request (deadline, hedged duplicate
+    # answered first) closes its socket; that is expected, not an error
+    def handle_error(self, request, client_address):
+        if isinstance(sys.exc_info()[1], ConnectionError):
+            return
+        super().handle_error(request, client_address)
+
+    def __init__(self, addr, opts):
+        super().__init__(addr, MockHandler)
+        self.opts = opts
+        self.rng = random.Random(opts.seed)
+        self.lock = threading.Lock()
+        self.stats = {}
+        self.fixtures = {}
+        # Synthesizing the reply takes longer than a turn's latency; do it once
+        self.live_pcm = synth_linear16(REPLY, LIVE_RATE)[44:]
+        if opts.fixtures and not opts.record:
+            for key, name in FIXTURE_FILES.items():
+                path = os.path.join(opts.fixtures, name)
+                if os.path.exists(path):
+                    with open(path, "rb") as f:
+                        self.fixtures[key] = f.read()
+
+    def fixture(self, key):
+        return self.fixtures.get(key)
+
+    def count(self, endpoint, fault):
+        with self.lock:
+            entry = self.stats.setdefault(endpoint, {"requests": 0, "faults": 0})
+            entry["requests"] += 1
+            entry["faults"] += 1 if fault else 0
+
+    # Forward to the real endpoint with the given API key and keep the body
+    # as a fixture; the last response of each kind wins
+    def record(self, fixture_key, endpoint, path, request):
+        path = re.sub(r"key=[^&]*", "key=" + self.opts.api_key, path)
+        req = urllib.request.Request(UPSTREAM[endpoint] + path, data=request, method="POST",
+                                     headers={"Content-Type": "application/json"})
+        with urllib.request.urlopen(req, timeout=60) as resp:
+            body = resp.read()
+        os.makedirs(self.opts.record, exist_ok=True)
+        with open(os.path.join(self.opts.record, FIXTURE_FILES[fixture_key]), "wb") as f:
+            f.write(body)
+        return body
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--fixtures", help="directory of recorded responses to replay")
+    parser.add_argument("--record", metavar="DIR", help="proxy to Google with --api-key and save responses to DIR")
+    parser.add_argument("--api-key", default=os.environ.get("GEMINI_API_KEY", ""))
+    parser.add_argument("--latency-ms", default="0", help="delay before headers: N or stt=N,llm=N,tts=N,live=N,audio=N")
+    parser.add_argument("--token-ms", type=float, default=40.0, help="gap between streamed LLM events")
+    parser.add_argument("--rate-kbps", type=float, default=0.0, help="downstream bandwidth cap (0 = unlimited)")
+    parser.add_argument("--chunk-bytes", type=int, default=1460, help="size of each body write")
+    parser.add_argument("--chunked", action="store_true", help="chunked encoding for every response")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="probability of a fault per request")
+    parser.add_argument("--error-mode", default="503", choices=["503", "reset", "truncate", "stall", "mixed"])
+    parser.add_argument("--stall-ms", type=float, default=8000.0, help="delay of a stalled response")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("-v", "--verbose", action="store_true")
+    opts = parser.parse_args()
+    opts.latency = parse_latency(opts.latency_ms)
+    if opts.record and not opts.api_key:
+        parser.error("--record needs --api-key or GEMINI_API_KEY")
+
+    server = MockServer((opts.host, opts.port), opts)
+    print("listening on %d" % server.server_address[1], flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if opts.verbose:
+            sys.stderr.write("mock: %s\n" % json.dumps(server.stats))
+
+
+if __name__ == "__main__":
+    main()
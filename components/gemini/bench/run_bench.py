@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Run the gemini host benchmark against the local mock server.
+
+Starts mock_server.py on a free port, runs every built variant
+(gemini_bench_linear16, gemini_bench_compressed) in each client mode
+(blocking, streaming, audio), plus the Live session once, and prints time
+to first audio (median of the warm turns and worst turn), peak heap and heap
+allocations per request:
+
+  python3 components/gemini/bench/run_bench.py --build build/gemini_bench
+  python3 components/gemini/bench/run_bench.py --build build/gemini_bench \\
+      --latency-ms stt=300,llm=500,tts=250,live=700,audio=600 --rate-kbps 512
+
+The first turn of each run opens the connections and is reported as
+"cold"; the warm figures are medians over the remaining turns.
+
+For CI, save a baseline once and compare later runs against it:
+
+  run_bench.py --build ... --save-baseline bench_baseline.json
+  run_bench.py --build ... --baseline bench_baseline.json --tolerance 0.15
+
+The comparison exits with status 1 when warm TTFA or peak heap of any
+variant/mode grows by more than the tolerance, or when a turn fails
+without error injection.
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+VARIANTS = ["linear16", "compressed"]
+MODES = ["blocking", "streaming", "audio", "live"]
+# The Live session carries PCM both ways whatever the HTTP encodings are,
+# so it only runs with one variant
+LIVE_VARIANT = "linear16"
+# Timing on a shared CI machine is noisy; ignore TTFA changes smaller than this
+TTFA_SLACK_MS = 20.0
+
+
+def start_mock(args):
+    cmd = [sys.executable, os.path.join(HERE, "mock_server.py"), "--port", "0",
+           "--latency-ms", args.latency_ms, "--token-ms", str(args.token_ms),
+           "--rate-kbps", str(args.rate_kbps), "--chunk-bytes", str(args.chunk_bytes),
+           "--error-rate", str(args.error_rate), "--error-mode", args.error_mode,
+           "--stall-ms", str(args.stall_ms), "--seed", str(args.seed)]
+    if args.chunked:
+        cmd.append("--chunked")
+    if args.fixtures:
+        cmd += ["--fixtures", args.fixtures]
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, text=True)
+    line = proc.stdout.readline()
+    if not line.startswith("listening on "):
+        proc.kill()
+        raise SystemExit("mock server failed to start")
+    return proc, int(line.split()[-1])
+
+
+def run_one(args, port, variant, mode):
+    exe = os.path.join(args.build, "gemini_bench_" + variant)
+    if not os.path.exists(exe):
+        return None
+    env = dict(os.environ, GEMINI_MOCK_ADDR="127.0.0.1:%d" % port, GEMINI_BENCH_LOG=str(args.log))
+    out = subprocess.run([exe, mode, str(args.turns), str(args.utterance_ms)], env=env,
+                         stdout=subprocess.PIPE, text=True, timeout=600)
+    turns = [json.loads(line) for line in out.stdout.splitlines() if line.startswith("{")]
+    if not turns:
+        raise SystemExit("%s %s produced no results" % (variant, mode))
+    ok = [t for t in turns if t["ok"]]
+    warm = [t for t in ok if t["turn"] > 0] or ok
+    return {
+        "turns": len(turns),
+        "failed": len(turns) - len(ok),
+        "cold_ttfa_ms": turns[0]["ttfa_ms"] if turns[0]["ok"] else None,
+        "ttfa_ms": statistics.median(t["ttfa_ms"] for t in warm) if warm else None,
+        "max_ttfa_ms": max(t["ttfa_ms"] for t in ok) if ok else None,
+        "total_ms": statistics.median(t["total_ms"] for t in warm) if warm else None,
+        "peak_heap": max(t["peak_heap"] for t in turns),
+        "allocs_per_request": (statistics.median(t["allocs"] / max(t["requests"], 1) for t in warm)
+                               if warm else None),
+        "bytes_up": turns[-1]["bytes_up"],
+        "bytes_down": turns[-1]["bytes_down"],
+    }
+
+
+def fmt(value, unit=""):
+    return "-" if value is None else ("%.0f%s" % (value, unit))
+
+
+def compare(results, baseline, tolerance, allow_failures):
+    regressions = []
+    for key, cur in results.items():
+        if cur["failed"] and not allow_failures:
+            regressions.append("%s: %d failed turn(s)" % (key, cur["failed"]))
+        ref = baseline.get(key)
+        if not ref:
+            continue
+        if cur["ttfa_ms"] is not None and ref.get("ttfa_ms") is not None:
+            limit = max(ref["ttfa_ms"] * (1 + tolerance), ref["ttfa_ms"] + TTFA_SLACK_MS)
+            if cur["ttfa_ms"] > limit:
+                regressions.append("%s: TTFA %.0f ms > %.0f ms baseline" % (key, cur["ttfa_ms"], ref["ttfa_ms"]))
+        if ref.get("peak_heap") and cur["peak_heap"] > ref["peak_heap"] * (1 + tolerance):
+            regressions.append("%s: peak heap %d B > %d B baseline" % (key, cur["peak_heap"], ref["peak_heap"]))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--build", default="build/gemini_bench", help="directory with the gemini_bench_* binaries")
+    parser.add_argument("--turns", type=int, default=5)
+    parser.add_argument("--utterance-ms", type=int, default=3000)
+    parser.add_argument("--log", type=int, default=1, help="client log level (0-4)")
+    parser.add_argument("--json", action="store_true", help="print results as JSON instead of a table")
+    parser.add_argument("--baseline", help="fail if results regress against this file")
+    parser.add_argument("--save-baseline", metavar="FILE", help="write results as a new baseline")
+    parser.add_argument("--tolerance", type=float, default=0.15, help="allowed relative regression")
+    mock = parser.add_argument_group("mock server (see mock_server.py)")
+    mock.add_argument("--fixtures")
+    mock.add_argument("--latency-ms", default="stt=300,llm=450,tts=250,live=700,audio=550")
+    mock.add_argument("--token-ms", type=float, default=40.0)
+    mock.add_argument("--rate-kbps", type=float, default=1000.0)
+    mock.add_argument("--chunk-bytes", type=int, default=1460)
+    mock.add_argument("--chunked", action="store_true")
+    mock.add_argument("--error-rate", type=float, default=0.0)
+    mock.add_argument("--error-mode", default="503")
+    mock.add_argument("--stall-ms", type=float, default=8000.0)
+    mock.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    proc, port = start_mock(args)
+    results = {}
+    try:
+        for variant in VARIANTS:
+            for mode in MODES:
+                if mode == "live" and variant != LIVE_VARIANT:
+                    continue
+                res = run_one(args, port, variant, mode)
+                if res:
+                    results["%s/%s" % (variant, mode)] = res
+    finally:
+        proc.kill()
+        proc.wait()
+    if not results:
+        raise SystemExit("no gemini_bench_* binaries in %s" % args.build)
+
+    if args.json:
+        print(json.dumps(results, indent=2))
+    else:
+        print("%-22s %6s %10s %10s %10s %10s %10s %10s %9s %9s" %
+              ("variant/mode", "failed", "cold TTFA", "TTFA", "max TTFA", "total", "peak heap", "allocs/req",
+               "up", "down"))
+        for key, r in results.items():
+            print("%-22s %6d %10s %10s %10s %10s %10s %10s %9s %9s" %
+                  (key, r["failed"], fmt(r["cold_ttfa_ms"], " ms"), fmt(r["ttfa_ms"], " ms"),
+                   fmt(r["max_ttfa_ms"], " ms"),
+                   fmt(r["total_ms"], " ms"), fmt(r["peak_heap"] / 1024.0, " KB"),
+                   fmt(r["allocs_per_request"]),
+                   fmt(r["bytes_up"] / 1024.0, " KB"), fmt(r["bytes_down"] / 1024.0, " KB")))
+
+    if args.save_baseline:
+        with open(args.save_baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+            f.write("\n")
+    if args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare(results, json.load(f), args.tolerance, args.error_rate > 0)
+        for r in regressions:
+            print("REGRESSION " + r, file=sys.stderr)
+        return 1 if regressions else 0
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
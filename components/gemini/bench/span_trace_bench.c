@@ -0,0 +1,140 @@
+// Host benchmark: cost of recording latency spans
+//
+// Times span_trace_begin/end pairs on one task and on several at once
+// (contending for the ring's claim counter), marks, and a dump of the full
+// ring. Before timing, a nested pair is recorded and the dump is checked
+// for the parent link; a mismatch exits with status 1.
+//
+// Usage: span_trace_bench [pairs]
+//   pairs  begin/end pairs per task (default 1000000)
+
+#include "span_trace.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREADS 4
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} sink_t;
+
+static esp_err_t sink_write(const char *data, size_t len, void *ctx)
+{
+    sink_t *sink = (sink_t *)ctx;
+    if (sink->len + len + 1 > sink->cap) {
+        size_t cap = (sink->len + len + 1) * 2;
+        char *buf = realloc(sink->buf, cap);
+        if (!buf) {
+            return ESP_ERR_NO_MEM;
+        }
+        sink->buf = buf;
+        sink->cap = cap;
+    }
+    memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+    sink->buf[sink->len] = '\0';
+    return ESP_OK;
+}
+
+static int check_nesting(void)
+{
+    uint32_t turn = span_trace_new_turn();
+    span_trace_id_t outer = span_trace_begin("outer", NULL);
+    span_trace_id_t inner = span_trace_begin("inner", "detail");
+    span_trace_end(inner);
+    span_trace_id_t sibling = span_trace_begin("sibling", NULL);
+    span_trace_end(sibling);
+    span_trace_end(outer);
+    span_trace_id_t after = span_trace_begin("after", NULL);
+    span_trace_end(after);
+
+    sink_t sink = {0};
+    if (span_trace_dump(turn, sink_write, &sink) != ESP_OK || !sink.buf) {
+        fprintf(stderr, "dump failed\n");
+        return 1;
+    }
+    char expect[4][96];
+    snprintf(expect[0], sizeof(expect[0]), "\"id\":%u,\"parent\":%u,\"detail\":\"detail\"", inner, outer);
+    snprintf(expect[1], sizeof(expect[1]), "\"id\":%u,\"parent\":%u}", sibling, outer);
+    snprintf(expect[2], sizeof(expect[2]), "\"id\":%u,\"parent\":0}", outer);
+    snprintf(expect[3], sizeof(expect[3]), "\"id\":%u,\"parent\":0}", after);
+    int bad = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!strstr(sink.buf, expect[i])) {
+            fprintf(stderr, "missing %s in:\n%s", expect[i], sink.buf);
+            bad = 1;
+        }
+    }
+    free(sink.buf);
+    return bad;
+}
+
+typedef struct {
+    long pairs;
+    SemaphoreHandle_t done;
+} worker_t;
+
+static void worker(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    for (long i = 0; i < w->pairs; i++) {
+        span_trace_id_t id = span_trace_begin("work", NULL);
+        span_trace_end(id);
+    }
+    xSemaphoreGive(w->done);
+    vTaskDelete(NULL);
+}
+
+int main(int argc, char **argv)
+{
+    long pairs = argc > 1 ? atol(argv[1]) : 1000000;
+    if (check_nesting() != 0) {
+        return 1;
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (long i = 0; i < pairs; i++) {
+        span_trace_id_t id = span_trace_begin("work", NULL);
+        span_trace_end(id);
+    }
+    double pair_ns = (esp_timer_get_time() - start) * 1000.0 / pairs;
+
+    start = esp_timer_get_time();
+    for (long i = 0; i < pairs; i++) {
+        span_trace_mark("mark", start);
+    }
+    double mark_ns = (esp_timer_get_time() - start) * 1000.0 / pairs;
+
+    worker_t w = { .pairs = pairs, .done = xSemaphoreCreateCounting(THREADS, 0) };
+    start = esp_timer_get_time();
+    for (int i = 0; i < THREADS; i++) {
+        xTaskCreate(worker, "worker", 16384, &w, 5, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        xSemaphoreTake(w.done, portMAX_DELAY);
+    }
+    double contended_ns = (esp_timer_get_time() - start) * 1000.0 / pairs;
+    vSemaphoreDelete(w.done);
+
+    sink_t sink = {0};
+    start = esp_timer_get_time();
+    span_trace_dump(0, sink_write, &sink);
+    int64_t dump_us = esp_timer_get_time() - start;
+
+    span_trace_stats_t stats;
+    span_trace_get_stats(&stats);
+    printf("begin+end      %7.1f ns per pair\n", pair_ns);
+    printf("mark           %7.1f ns\n", mark_ns);
+    printf("%d tasks       %7.1f ns per pair per task (wall)\n", THREADS, contended_ns);
+    printf("dump           %7lld us for %u records, %zu bytes of JSON\n",
+           (long long)dump_us, (unsigned)stats.capacity, sink.len);
+    free(sink.buf);
+    return 0;
+}
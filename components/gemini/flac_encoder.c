@@ -0,0 +1,381 @@
+#include "flac_encoder.h"
+#include "esp_timer.h"
+#include "turn_arena.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define MAX_FIXED_ORDER      4
+#define MAX_PARTITION_ORDER  8
+#define MAX_RICE_PARAM       14      // 4-bit parameters; 15 is the escape code
+#define OUT_BUF_SIZE         256
+
+struct flac_encoder {
+    flac_encoder_write_cb_t write;
+    void *ctx;
+    esp_err_t err;                  // Sticky output error
+    uint8_t sample_rate_code;
+    uint32_t frame_number;
+
+    int16_t block[FLAC_ENCODER_BLOCK_SIZE];
+    size_t block_len;
+    uint64_t part_sum[1 << MAX_PARTITION_ORDER];
+    uint8_t rice_param[1 << MAX_PARTITION_ORDER];
+
+    // Bit writer
+    uint64_t acc;
+    int acc_bits;
+    uint8_t out[OUT_BUF_SIZE];
+    size_t out_len;
+    uint16_t crc16;
+    uint8_t crc8;
+
+    flac_encoder_stats_t stats;
+    int64_t callback_us;
+};
+
+static void flush_out(flac_encoder_t *enc)
+{
+    if (enc->out_len == 0) {
+        return;
+    }
+    if (enc->err == ESP_OK) {
+        int64_t start_us = esp_timer_get_time();
+        enc->err = enc->write(enc->out, enc->out_len, enc->ctx);
+        enc->callback_us += esp_timer_get_time() - start_us;
+    }
+    enc->stats.bytes_out += enc->out_len;
+    enc->out_len = 0;
+}
+
+static void emit_byte(flac_encoder_t *enc, uint8_t b)
+{
+    // CRC-8 (poly 0x07) covers the frame header, CRC-16 (poly 0x8005) the whole frame
+    enc->crc8 ^= b;
+    for (int i = 0; i < 8; i++) {
+        enc->crc8 = (enc->crc8 & 0x80) ? (uint8_t)((enc->crc8 << 1) ^ 0x07) : (uint8_t)(enc->crc8 << 1);
+    }
+    enc->crc16 ^= (uint16_t)b << 8;
+    for (int i = 0; i < 8; i++) {
+        enc->crc16 = (enc->crc16 & 0x8000) ? (uint16_t)((enc->crc16 << 1) ^ 0x8005) : (uint16_t)(enc->crc16 << 1);
+    }
+
+    enc->out[enc->out_len++] = b;
+    if (enc->out_len == sizeof(enc->out)) {
+        flush_out(enc);
+    }
+}
+
+// Append the low n bits of value (n <= 32), MSB first
+static void put_bits(flac_encoder_t *enc, uint32_t value, int n)
+{
+    if (n == 0) {
+        return;
+    }
+    uint64_t mask = (n == 32) ? 0xFFFFFFFFull : ((1ull << n) - 1);
+    enc->acc = (enc->acc << n) | (value & mask);
+    enc->acc_bits += n;
+    while (enc->acc_bits >= 8) {
+        enc->acc_bits -= 8;
+        emit_byte(enc, (uint8_t)(enc->acc >> enc->acc_bits));
+    }
+}
+
+static void align_byte(flac_encoder_t *enc)
+{
+    if (enc->acc_bits > 0) {
+        put_bits(enc, 0, 8 - enc->acc_bits);
+    }
+}
+
+static void put_rice(flac_encoder_t *enc, uint32_t u, int k)
+{
+    uint32_t q = u >> k;
+    if (q + 1 + k <= 32) {
+        put_bits(enc, (1u << k) | (u & ((1u << k) - 1)), (int)q + 1 + k);
+        return;
+    }
+    while (q >= 32) {
+        put_bits(enc, 0, 32);
+        q -= 32;
+    }
+    put_bits(enc, 1, (int)q + 1);
+    put_bits(enc, u & ((1u << k) - 1), k);
+}
+
+// Frame numbers use the UTF-8 style variable length code
+static void put_utf8(flac_encoder_t *enc, uint32_t v)
+{
+    if (v < 0x80) {
+        put_bits(enc, v, 8);
+        return;
+    }
+    int extra = v < 0x800 ? 1 : v < 0x10000 ? 2 : v < 0x200000 ? 3 : v < 0x4000000 ? 4 : 5;
+    uint8_t lead_mask = (uint8_t)(0xFF << (7 - extra));
+    put_bits(enc, lead_mask | (v >> (6 * extra)), 8);
+    for (int i = extra - 1; i >= 0; i--) {
+        put_bits(enc, 0x80 | ((v >> (6 * i)) & 0x3F), 8);
+    }
+}
+
+static int32_t fixed_residual(const int16_t *x, size_t i, int order)
+{
+    switch (order) {
+        case 0: return x[i];
+        case 1: return (int32_t)x[i] - x[i - 1];
+        case 2: return (int32_t)x[i] - 2 * x[i - 1] + x[i - 2];
+        case 3: return (int32_t)x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+        default: return (int32_t)x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+    }
+}
+
+static uint32_t fold(int32_t r)
+{
+    return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+// Cheapest Rice parameter for a partition, and its cost in bits
+static uint64_t rice_cost(uint64_t sum, size_t count, uint8_t *param)
+{
+    uint64_t best = UINT64_MAX;
+    for (int k = 0; k <= MAX_RICE_PARAM; k++) {
+        uint64_t bits = (uint64_t)count * (k + 1) + (sum >> k);
+        if (bits < best) {
+            best = bits;
+            *param = (uint8_t)k;
+        }
+    }
+    return best;
+}
+
+// Pick the partition order for the given predictor; returns the residual size in bits
+static uint64_t choose_partitions(flac_encoder_t *enc, const int16_t *x, size_t n, int order, int *best_order)
+{
+    int max_p = 0;
+    while (max_p < MAX_PARTITION_ORDER && (n % (1u << (max_p + 1))) == 0 &&
+           (n >> (max_p + 1)) > (size_t)order) {
+        max_p++;
+    }
+
+    // Sums at the finest order; coarser orders are merged from them
+    size_t part_len = n >> max_p;
+    for (int p = 0; p < (1 << max_p); p++) {
+        uint64_t sum = 0;
+        size_t start = (p == 0) ? (size_t)order : p * part_len;
+        for (size_t i = start; i < (p + 1) * part_len; i++) {
+            sum += fold(fixed_residual(x, i, order));
+        }
+        enc->part_sum[p] = sum;
+    }
+
+    uint64_t best_bits = UINT64_MAX;
+    for (int p = max_p; p >= 0; p--) {
+        if (p < max_p) {
+            for (int j = 0; j < (1 << p); j++) {
+                enc->part_sum[j] = enc->part_sum[2 * j] + enc->part_sum[2 * j + 1];
+            }
+        }
+        uint64_t bits = 0;
+        uint8_t unused;
+        for (int j = 0; j < (1 << p); j++) {
+            size_t count = (n >> p) - (j == 0 ? order : 0);
+            bits += 4 + rice_cost(enc->part_sum[j], count, &unused);
+        }
+        if (bits < best_bits) {
+            best_bits = bits;
+            *best_order = p;
+        }
+    }
+    return best_bits;
+}
+
+static void encode_subframe(flac_encoder_t *enc, const int16_t *x, size_t n)
+{
+    bool constant = true;
+    for (size_t i = 1; i < n && constant; i++) {
+        constant = x[i] == x[0];
+    }
+    if (constant) {
+        put_bits(enc, 0x00, 8);                 // CONSTANT
+        put_bits(enc, (uint16_t)x[0], 16);
+        return;
+    }
+
+    // Predictor order with the smallest residual magnitude
+    int order = -1;
+    if (n > MAX_FIXED_ORDER) {
+        uint64_t best = UINT64_MAX;
+        for (int o = 0; o <= MAX_FIXED_ORDER; o++) {
+            uint64_t sum = 0;
+            for (size_t i = MAX_FIXED_ORDER; i < n; i++) {
+                int32_t r = fixed_residual(x, i, o);
+                sum += (uint32_t)(r < 0 ? -r : r);
+            }
+            if (sum < best) {
+                best = sum;
+                order = o;
+            }
+        }
+    }
+
+    int part_order = 0;
+    uint64_t fixed_bits = UINT64_MAX;
+    if (order >= 0) {
+        fixed_bits = 8 + 16 * order + 6 + choose_partitions(enc, x, n, order, &part_order);
+    }
+    if (fixed_bits >= 8 + 16 * (uint64_t)n) {
+        put_bits(enc, 0x02, 8);                 // VERBATIM
+        for (size_t i = 0; i < n; i++) {
+            put_bits(enc, (uint16_t)x[i], 16);
+        }
+        return;
+    }
+
+    // part_sum[] has been merged down to order 0; redo the chosen partitioning
+    size_t part_len = n >> part_order;
+    for (int j = 0; j < (1 << part_order); j++) {
+        uint64_t sum = 0;
+        for (size_t i = (j == 0 ? (size_t)order : j * part_len); i < (j + 1) * part_len; i++) {
+            sum += fold(fixed_residual(x, i, order));
+        }
+        rice_cost(sum, part_len - (j == 0 ? order : 0), &enc->rice_param[j]);
+    }
+
+    put_bits(enc, (uint32_t)(8 + order) << 1, 8);  // FIXED, no wasted bits
+    for (int i = 0; i < order; i++) {
+        put_bits(enc, (uint16_t)x[i], 16);
+    }
+    put_bits(enc, 0, 2);                           // Rice, 4-bit parameters
+    put_bits(enc, part_order, 4);
+    for (int j = 0; j < (1 << part_order); j++) {
+        int k = enc->rice_param[j];
+        put_bits(enc, k, 4);
+        for (size_t i = (j == 0 ? (size_t)order : j * part_len); i < (j + 1) * part_len; i++) {
+            put_rice(enc, fold(fixed_residual(x, i, order)), k);
+        }
+    }
+}
+
+static void encode_frame(flac_encoder_t *enc, const int16_t *x, size_t n)
+{
+    enc->crc8 = 0;
+    enc->crc16 = 0;
+
+    put_bits(enc, 0xFFF8, 16);                     // Sync, fixed blocksize
+    int bs_code = (n == FLAC_ENCODER_BLOCK_SIZE) ? 12 : 7;
+    put_bits(enc, bs_code, 4);
+    put_bits(enc, enc->sample_rate_code, 4);
+    put_bits(enc, 0x08, 8);                        // Mono, 16 bits per sample
+    put_utf8(enc, enc->frame_number++);
+    if (bs_code == 7) {
+        put_bits(enc, (uint32_t)(n - 1), 16);
+    }
+    put_bits(enc, enc->crc8, 8);
+
+    encode_subframe(enc, x, n);
+    align_byte(enc);
+    put_bits(enc, enc->crc16, 16);
+    enc->stats.samples += n;
+}
+
+static uint8_t sample_rate_code(int hz)
+{
+    switch (hz) {
+        case 8000: return 4;
+        case 16000: return 5;
+        case 22050: return 6;
+        case 24000: return 7;
+        case 32000: return 8;
+        case 44100: return 9;
+        case 48000: return 10;
+        default: return 0;      // Taken from STREAMINFO
+    }
+}
+
+esp_err_t flac_encoder_create(int sample_rate_hz, uint64_t total_samples,
+                              flac_encoder_write_cb_t write, void *ctx, flac_encoder_t **out)
+{
+    if (!write || !out || sample_rate_hz <= 0 || sample_rate_hz >= (1 << 20)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    flac_encoder_t *enc = turn_arena_calloc(1, sizeof(flac_encoder_t));
+    if (!enc) {
+        return ESP_ERR_NO_MEM;
+    }
+    enc->write = write;
+    enc->ctx = ctx;
+    enc->sample_rate_code = sample_rate_code(sample_rate_hz);
+
+    int64_t start_us = esp_timer_get_time();
+    put_bits(enc, 0x664C6143, 32);                 // "fLaC"
+    put_bits(enc, 0x80, 8);                        // Last metadata block, STREAMINFO
+    put_bits(enc, 34, 24);
+    put_bits(enc, FLAC_ENCODER_BLOCK_SIZE, 16);    // Min / max block size
+    put_bits(enc, FLAC_ENCODER_BLOCK_SIZE, 16);
+    put_bits(enc, 0, 24);                          // Min / max frame size unknown
+    put_bits(enc, 0, 24);
+    put_bits(enc, (uint32_t)sample_rate_hz, 20);
+    put_bits(enc, 0, 3);                           // Channels - 1
+    put_bits(enc, 15, 5);                          // Bits per sample - 1
+    put_bits(enc, (uint32_t)(total_samples >> 32) & 0xF, 4);
+    put_bits(enc, (uint32_t)total_samples, 32);
+    for (int i = 0; i < 4; i++) {
+        put_bits(enc, 0, 32);                      // MD5 not computed
+    }
+    enc->stats.encode_us += esp_timer_get_time() - start_us;
+
+    *out = enc;
+    return ESP_OK;
+}
+
+esp_err_t flac_encoder_write(flac_encoder_t *enc, const int16_t *pcm, size_t samples)
+{
+    int64_t start_us = esp_timer_get_time();
+    enc->callback_us = 0;
+    while (samples > 0 && enc->err == ESP_OK) {
+        if (enc->block_len == 0 && samples >= FLAC_ENCODER_BLOCK_SIZE) {
+            // Whole blocks are encoded in place
+            encode_frame(enc, pcm, FLAC_ENCODER_BLOCK_SIZE);
+            pcm += FLAC_ENCODER_BLOCK_SIZE;
+            samples -= FLAC_ENCODER_BLOCK_SIZE;
+            continue;
+        }
+        size_t n = FLAC_ENCODER_BLOCK_SIZE - enc->block_len;
+        if (n > samples) {
+            n = samples;
+        }
+        memcpy(enc->block + enc->block_len, pcm, n * sizeof(int16_t));
+        enc->block_len += n;
+        pcm += n;
+        samples -= n;
+        if (enc->block_len == FLAC_ENCODER_BLOCK_SIZE) {
+            encode_frame(enc, enc->block, enc->block_len);
+            enc->block_len = 0;
+        }
+    }
+    enc->stats.encode_us += esp_timer_get_time() - start_us - enc->callback_us;
+    return enc->err;
+}
+
+esp_err_t flac_encoder_finish(flac_encoder_t *enc)
+{
+    int64_t start_us = esp_timer_get_time();
+    enc->callback_us = 0;
+    if (enc->block_len > 0 && enc->err == ESP_OK) {
+        encode_frame(enc, enc->block, enc->block_len);
+        enc->block_len = 0;
+    }
+    flush_out(enc);
+    enc->stats.encode_us += esp_timer_get_time() - start_us - enc->callback_us;
+    return enc->err;
+}
+
+void flac_encoder_get_stats(const flac_encoder_t *enc, flac_encoder_stats_t *stats)
+{
+    *stats = enc->stats;
+}
+
+void flac_encoder_destroy(flac_encoder_t *enc)
+{
+    turn_arena_free(enc);
+}
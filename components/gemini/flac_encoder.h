@@ -0,0 +1,75 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Streaming FLAC encoder for 16-bit mono speech
+ *
+ * Lossless, fixed-blocksize FLAC using the fixed polynomial predictors
+ * (orders 0-4) and partitioned Rice coding: no LPC, no floating point, and
+ * the whole working set is one block of input. The stream is handed to the
+ * output callback in small pieces as each frame is encoded, so it can go
+ * straight into a chunked request body.
+ */
+
+#define FLAC_ENCODER_BLOCK_SIZE 4096
+
+/**
+ * Encoded output consumer
+ * @param data: Encoded bytes
+ * @param len: Number of bytes
+ * @param ctx: User context
+ * @return ESP_OK to continue; any error aborts encoding and is returned
+ */
+typedef esp_err_t (*flac_encoder_write_cb_t)(const uint8_t *data, size_t len, void *ctx);
+
+typedef struct {
+    size_t samples;         // Input samples encoded
+    size_t bytes_out;       // Encoded stream size, headers included
+    int64_t encode_us;      // Time spent encoding (excluding the output callback)
+} flac_encoder_stats_t;
+
+typedef struct flac_encoder flac_encoder_t;
+
+/**
+ * Create an encoder and emit the stream header
+ * @param sample_rate_hz: Input sample rate
+ * @param total_samples: Stream length if known (0 for unknown)
+ * @param write: Output callback
+ * @param ctx: Context for write
+ * @param out: Created encoder
+ * @return ESP_OK on success
+ */
+esp_err_t flac_encoder_create(int sample_rate_hz, uint64_t total_samples,
+                              flac_encoder_write_cb_t write, void *ctx, flac_encoder_t **out);
+
+/**
+ * Encode samples; complete blocks are emitted immediately
+ * @param enc: Encoder
+ * @param pcm: 16-bit mono samples
+ * @param samples: Number of samples
+ * @return ESP_OK on success
+ */
+esp_err_t flac_encoder_write(flac_encoder_t *enc, const int16_t *pcm, size_t samples);
+
+/**
+ * Encode the final partial block and flush the output
+ * @param enc: Encoder
+ * @return ESP_OK on success
+ */
+esp_err_t flac_encoder_finish(flac_encoder_t *enc);
+
+/**
+ * Get encoder statistics
+ * @param enc: Encoder
+ * @param stats: Output statistics
+ */
+void flac_encoder_get_stats(const flac_encoder_t *enc, flac_encoder_stats_t *stats);
+
+/**
+ * Free an encoder
+ * @param enc: Encoder
+ */
+void flac_encoder_destroy(flac_encoder_t *enc);
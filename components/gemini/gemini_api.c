@@ -1,11 +1,18 @@
 #include "gemini_api.h"
+#include "gemini_api_internal.h"
+#include "gemini_http.h"
+#include "gemini_json.h"
+#include "gemini_sse.h"
+#include "gemini_tts_cache.h"
+#include "gemini_tts_stream.h"
+#include "flac_encoder.h"
+#include "streaming_base64.h"
+#include "span_trace.h"
 #include "esp_log.h"
-#include "esp_http_client.h"
 #include "esp_timer.h"
-#include "esp_tls.h"
-#include "esp_crt_bundle.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "cJSON.h"
-#include "mbedtls/base64.h"
 #include <string.h>
 #include <stdlib.h>
 #include <inttypes.h>
@@ -14,75 +21,82 @@ static const char *TAG = "gemini_api";
 
 static gemini_config_t s_config = {0};
 static bool s_initialized = false;
+static uint32_t s_turn_seq = 0;     // HTTP timing sequence number at turn start
+static volatile int64_t s_turn_deadline_us = 0;  // First answer audio due (0: no turn budget)
+static bool s_prewarm_running = false;
 
-// HTTP response buffer
+// Requests still to come before the first answer audio when each stage
+// starts; a stage's deadline is its share of what is left of the budget
+#define STAGES_LEFT_STT   3
+#define STAGES_LEFT_LLM   2
+#define STAGES_LEFT_TTS   1
+
+// Smallest deadline a request gets once the budget is spent: a late answer
+// beats none
+#define STAGE_MIN_DEADLINE_MS 1000
+
+// Warm-up task: the TLS handshake math runs here, so it sits below the
+// audio and turn tasks and only uses time they leave
+#define PREWARM_TASK_PRIORITY 3
+#define PREWARM_POLL_MS       10
+
+// Largest single SSE event (one GenerateContentResponse chunk) accepted
+#define LLM_SSE_MAX_EVENT 8192
+
+// TTS voice; part of the cache key, so changing it invalidates cached phrases
+#define TTS_LANGUAGE_CODE "en-US"
+#define TTS_VOICE_NAME "en-US-Neural2-D"
+#define TTS_SAMPLE_RATE_HZ 24000
+
+// Transport encoding; also part of the cache key, since decoded audio is not
+// bit-identical across encodings
+#if CONFIG_GEMINI_TTS_ENCODING_MP3
+#define TTS_AUDIO_ENCODING "MP3"
+#define TTS_STREAM_ENCODING GEMINI_TTS_STREAM_MP3
+#elif CONFIG_GEMINI_TTS_ENCODING_OGG_OPUS
+#define TTS_AUDIO_ENCODING "OGG_OPUS"
+#define TTS_STREAM_ENCODING GEMINI_TTS_STREAM_OGG_OPUS
+#else
+#define TTS_AUDIO_ENCODING "LINEAR16"
+#define TTS_STREAM_ENCODING GEMINI_TTS_STREAM_LINEAR16
+#endif
+
+// STT audio is base64-encoded in blocks of this many input bytes (multiple of 3)
+#define STT_BASE64_BLOCK 384
+
+// Text request bodies up to this size are built on the stack and sent with a
+// Content-Length; longer ones are streamed as chunks
+#define JSON_INLINE_BODY_SIZE 512
+
+#if CONFIG_GEMINI_STT_ENCODING_FLAC
+#define STT_AUDIO_ENCODING "FLAC"
+#define STT_AUDIO_MIME_TYPE "audio/flac"
+#else
+#define STT_AUDIO_ENCODING "LINEAR16"
+#define STT_AUDIO_MIME_TYPE "audio/wav"
+#endif
+
+// Instruction sent with the audio by gemini_audio_query() when none is given
+#define AUDIO_QUERY_DEFAULT_PROMPT \
+    "Listen to the user's spoken request and answer it directly. " \
+    "Your reply will be read aloud, so use plain sentences without markup."
+
+// Source for the streamed STT request body, plus what the writer measured
 typedef struct {
-    uint8_t *data;
-    size_t len;
-    size_t cap;
-} http_buffer_t;
-
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
-{
-    http_buffer_t *buf = (http_buffer_t *)evt->user_data;
-    
-    switch (evt->event_id) {
-        case HTTP_EVENT_ERROR:
-            ESP_LOGD(TAG, "HTTP_EVENT_ERROR");
-            break;
-        case HTTP_EVENT_ON_CONNECTED:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
-            break;
-        case HTTP_EVENT_HEADER_SENT:
-            ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
-            break;
-        case HTTP_EVENT_ON_HEADER:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
-            break;
-        case HTTP_EVENT_ON_DATA:
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                if (buf->len + evt->data_len > buf->cap) {
-                    size_t new_cap = buf->cap ? buf->cap * 2 : 4096;
-                    while (new_cap < buf->len + evt->data_len) {
-                        new_cap *= 2;
-                    }
-                    uint8_t *new_mem = realloc(buf->data, new_cap);
-                    if (!new_mem) {
-                        ESP_LOGE(TAG, "Failed to realloc response buffer");
-                        return ESP_ERR_NO_MEM;
-                    }
-                    buf->data = new_mem;
-                    buf->cap = new_cap;
-                }
-                memcpy(buf->data + buf->len, evt->data, evt->data_len);
-                buf->len += evt->data_len;
-            }
-            break;
-        case HTTP_EVENT_ON_FINISH:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_FINISH");
-            break;
-        case HTTP_EVENT_DISCONNECTED:
-            ESP_LOGI(TAG, "HTTP_EVENT_DISCONNECTED");
-            break;
-        default:
-            break;
-    }
-    return ESP_OK;
-}
+    gemini_pcm_parts_t pcm;
+    size_t sample_count;        // Total over both pieces
+    int sample_rate_hz;
+    size_t audio_bytes;         // Audio bytes before base64 (last attempt)
+    int64_t encode_us;          // Time spent in the encoder (last attempt)
+    int64_t upload_us;          // Time to write the whole body (last attempt)
+} stt_body_ctx_t;
 
-// Build WAV file from PCM samples
-static esp_err_t build_wav_from_pcm(const int16_t *pcm, size_t sample_count, int sample_rate_hz, uint8_t **out_buf, size_t *out_len)
+#if !CONFIG_GEMINI_STT_ENCODING_FLAC
+// Build the 44-byte WAV header for mono 16-bit PCM
+static void build_wav_header(uint8_t header[44], size_t data_bytes, int sample_rate_hz)
 {
-    size_t data_bytes = sample_count * sizeof(int16_t);
     size_t total_bytes = 44 + data_bytes; // WAV header (44 bytes) + data
-    
-    uint8_t *wav = malloc(total_bytes);
-    if (!wav) {
-        return ESP_ERR_NO_MEM;
-    }
-    
-    // WAV header
-    uint8_t header[44] = {
+    const uint8_t wav_header[44] = {
         'R', 'I', 'F', 'F',
         (uint8_t)(total_bytes - 8), (uint8_t)((total_bytes - 8) >> 8), 
         (uint8_t)((total_bytes - 8) >> 16), (uint8_t)((total_bytes - 8) >> 24),
@@ -101,86 +115,227 @@ static esp_err_t build_wav_from_pcm(const int16_t *pcm, size_t sample_count, int
         (uint8_t)(data_bytes), (uint8_t)(data_bytes >> 8),
         (uint8_t)(data_bytes >> 16), (uint8_t)(data_bytes >> 24)
     };
-    
-    memcpy(wav, header, sizeof(header));
-    memcpy(wav + sizeof(header), pcm, data_bytes);
-    
-    *out_buf = wav;
-    *out_len = total_bytes;
+    memcpy(header, wav_header, sizeof(wav_header));
+}
+#endif
+
+// Base64-encode `data` straight into the open JSON string, one block at a time
+static esp_err_t write_base64(gemini_json_writer_t *json, streaming_base64_encoder_t *enc,
+                              const uint8_t *data, size_t len)
+{
+    char encoded[(STT_BASE64_BLOCK / 3) * 4 + 8];
+    while (len > 0) {
+        size_t n = len > STT_BASE64_BLOCK ? STT_BASE64_BLOCK : len;
+        size_t encoded_len = sizeof(encoded);
+        esp_err_t ret = streaming_base64_encode(enc, data, n, encoded, &encoded_len);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        gemini_json_string_raw(json, encoded, encoded_len);
+        if (json->err != ESP_OK) {
+            return json->err;
+        }
+        data += n;
+        len -= n;
+    }
     return ESP_OK;
 }
 
-// Base64 encode with allocation
-static esp_err_t base64_encode_alloc(const uint8_t *input, size_t input_len, char **out_str)
+#if CONFIG_GEMINI_STT_ENCODING_FLAC
+typedef struct {
+    gemini_json_writer_t *json;
+    streaming_base64_encoder_t *b64;
+} stt_flac_sink_t;
+
+static esp_err_t stt_flac_write(const uint8_t *data, size_t len, void *ctx)
 {
-    if (!input || !out_str) {
-        return ESP_ERR_INVALID_ARG;
+    stt_flac_sink_t *sink = (stt_flac_sink_t *)ctx;
+    return write_base64(sink->json, sink->b64, data, len);
+}
+
+// FLAC-encode the utterance straight into the base64 stream
+static esp_err_t stt_write_audio(gemini_json_writer_t *json, streaming_base64_encoder_t *enc,
+                                 stt_body_ctx_t *ctx)
+{
+    stt_flac_sink_t sink = { .json = json, .b64 = enc };
+    flac_encoder_t *flac = NULL;
+    esp_err_t ret = flac_encoder_create(ctx->sample_rate_hz, ctx->sample_count, stt_flac_write, &sink, &flac);
+    if (ret != ESP_OK) {
+        return ret;
     }
-    size_t target_len = ((input_len + 2) / 3) * 4 + 1;
-    char *encoded = malloc(target_len);
-    if (!encoded) {
-        return ESP_ERR_NO_MEM;
+    for (int i = 0; i < 2 && ret == ESP_OK; i++) {
+        if (ctx->pcm.samples[i] > 0) {
+            ret = flac_encoder_write(flac, ctx->pcm.pcm[i], ctx->pcm.samples[i]);
+        }
     }
-    size_t written = 0;
-    int ret = mbedtls_base64_encode((unsigned char *)encoded, target_len, &written, input, input_len);
-    if (ret != 0) {
-        free(encoded);
-        return ESP_FAIL;
+    if (ret == ESP_OK) {
+        ret = flac_encoder_finish(flac);
     }
-    encoded[written] = '\0';
-    *out_str = encoded;
-    return ESP_OK;
+    flac_encoder_stats_t stats;
+    flac_encoder_get_stats(flac, &stats);
+    flac_encoder_destroy(flac);
+    ctx->audio_bytes = stats.bytes_out;
+    ctx->encode_us = stats.encode_us;
+    return ret;
+}
+#else
+// WAV header followed by the raw samples
+static esp_err_t stt_write_audio(gemini_json_writer_t *json, streaming_base64_encoder_t *enc,
+                                 stt_body_ctx_t *ctx)
+{
+    size_t data_bytes = ctx->sample_count * sizeof(int16_t);
+    uint8_t header[44];
+    build_wav_header(header, data_bytes, ctx->sample_rate_hz);
+
+    esp_err_t ret = write_base64(json, enc, header, sizeof(header));
+    for (int i = 0; i < 2 && ret == ESP_OK; i++) {
+        ret = write_base64(json, enc, (const uint8_t *)ctx->pcm.pcm[i], ctx->pcm.samples[i] * sizeof(int16_t));
+    }
+    ctx->audio_bytes = sizeof(header) + data_bytes;
+    ctx->encode_us = 0;
+    return ret;
 }
+#endif
 
-// HTTP POST request helper with proper response handling
-static esp_err_t http_post_json_with_auth(const char *url, const char *json_data, const char *auth_header, http_buffer_t *response)
+// Write the encoded utterance as one base64 string value
+static esp_err_t stt_write_audio_string(gemini_json_writer_t *json, stt_body_ctx_t *ctx)
 {
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .user_data = response,
-        .timeout_ms = 30000,
-        .skip_cert_common_name_check = false,  // Enable certificate verification
-        .crt_bundle_attach = esp_crt_bundle_attach,  // Use certificate bundle for TLS verification
-    };
-    
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        return ESP_FAIL;
+    streaming_base64_encoder_t enc;
+    streaming_base64_encoder_init(&enc);
+    gemini_json_string_begin(json);
+    esp_err_t ret = stt_write_audio(json, &enc, ctx);
+    if (ret != ESP_OK) {
+        return ret;
     }
-    
-    // Set headers
-    esp_http_client_set_method(client, HTTP_METHOD_POST);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    if (auth_header) {
-        esp_http_client_set_header(client, "Authorization", auth_header);
+
+    char tail[8];
+    size_t tail_len = sizeof(tail);
+    ret = streaming_base64_encode_finish(&enc, tail, &tail_len);
+    if (ret != ESP_OK) {
+        return ret;
     }
-    
-    // Set POST data
-    esp_http_client_set_post_field(client, json_data, strlen(json_data));
-    
-    // Perform request
-    int64_t start_time = esp_timer_get_time();
-    esp_err_t err = esp_http_client_perform(client);
-    int64_t elapsed_us = esp_timer_get_time() - start_time;
-    
-    int status_code = esp_http_client_get_status_code(client);
-    ESP_LOGI(TAG, "HTTP response: %d (took %lld ms)", status_code, elapsed_us / 1000);
-    
-    esp_http_client_cleanup(client);
-    
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP POST failed: %s", esp_err_to_name(err));
-        return err;
+    gemini_json_string_raw(json, tail, tail_len);
+    gemini_json_string_end(json);
+    return json->err;
+}
+
+static esp_err_t http_json_sink(const char *data, size_t len, void *ctx)
+{
+    return gemini_http_writer_write((gemini_http_writer_t *)ctx, data, len);
+}
+
+// Emit the Speech-to-Text request: config, then base64(encoded audio).
+// Nothing proportional to the utterance length is ever held in memory.
+// Called again from scratch if the request is retried.
+static esp_err_t stt_body_writer(gemini_http_writer_t *writer, void *arg)
+{
+    stt_body_ctx_t *ctx = (stt_body_ctx_t *)arg;
+    int64_t start_us = esp_timer_get_time();
+
+    gemini_json_writer_t json;
+    gemini_json_init_sink(&json, http_json_sink, writer);
+    gemini_json_object_begin(&json);
+    gemini_json_key(&json, "config");
+    gemini_json_object_begin(&json);
+    gemini_json_kv_string(&json, "encoding", STT_AUDIO_ENCODING);
+    gemini_json_kv_int(&json, "sampleRateHertz", ctx->sample_rate_hz);
+    gemini_json_kv_string(&json, "languageCode", "en-US");
+    gemini_json_object_end(&json);
+    gemini_json_key(&json, "audio");
+    gemini_json_object_begin(&json);
+    gemini_json_key(&json, "content");
+    esp_err_t ret = stt_write_audio_string(&json, ctx);
+    if (ret == ESP_OK) {
+        gemini_json_object_end(&json);
+        gemini_json_object_end(&json);
+        ret = gemini_json_finish(&json, NULL);
     }
-    
-    if (status_code / 100 != 2) {
-        ESP_LOGE(TAG, "HTTP request failed with status %d", status_code);
-        return ESP_FAIL;
+    ctx->upload_us = esp_timer_get_time() - start_us;
+    return ret;
+}
+
+// Text request bodies are written by a builder so the same code can fill a
+// stack buffer or, when that is too small, feed the chunked writer
+typedef void (*json_builder_t)(gemini_json_writer_t *json, const void *arg);
+
+typedef struct {
+    json_builder_t build;
+    const void *arg;
+} json_body_t;
+
+static esp_err_t json_body_writer(gemini_http_writer_t *writer, void *arg)
+{
+    const json_body_t *body = (const json_body_t *)arg;
+    gemini_json_writer_t json;
+    gemini_json_init_sink(&json, http_json_sink, writer);
+    body->build(&json, body->arg);
+    return gemini_json_finish(&json, NULL);
+}
+
+// Deadline for the response of a request made now, with `stages_left`
+// requests (this one included) still to finish before the first answer
+// audio. Outside a turn only the HTTP stall timeout applies.
+static int64_t stage_deadline(int stages_left)
+{
+    int64_t turn_deadline_us = s_turn_deadline_us;
+    if (turn_deadline_us == 0) {
+        return 0;
     }
-    
-    return ESP_OK;
+    int64_t now = esp_timer_get_time();
+    int64_t share_us = (turn_deadline_us - now) / stages_left;
+    if (share_us > (int64_t)CONFIG_GEMINI_HTTP_FIRST_BYTE_TIMEOUT_MS * 1000) {
+        share_us = (int64_t)CONFIG_GEMINI_HTTP_FIRST_BYTE_TIMEOUT_MS * 1000;
+    }
+    if (share_us < (int64_t)STAGE_MIN_DEADLINE_MS * 1000) {
+        share_us = (int64_t)STAGE_MIN_DEADLINE_MS * 1000;
+    }
+    return now + share_us;
+}
+
+// POST the document produced by `build`; nothing is allocated for the body
+static esp_err_t post_json_body(const char *url, json_builder_t build, const void *arg,
+                                gemini_http_data_cb_t on_data, void *ctx, const gemini_http_opts_t *opts)
+{
+    char inline_body[JSON_INLINE_BODY_SIZE];
+    gemini_json_writer_t json;
+    gemini_json_init_buffer(&json, inline_body, sizeof(inline_body));
+    build(&json, arg);
+    esp_err_t ret = gemini_json_finish(&json, NULL);
+    if (ret == ESP_OK) {
+        return gemini_http_post_json_cb(url, inline_body, NULL, on_data, ctx, opts);
+    }
+    if (ret != ESP_ERR_INVALID_SIZE) {
+        return ret;
+    }
+    json_body_t body = { .build = build, .arg = arg };
+    return gemini_http_post_stream_cb(url, NULL, json_body_writer, &body, on_data, ctx, opts);
+}
+
+static esp_err_t segbuf_on_data(const uint8_t *data, size_t len, void *ctx)
+{
+    return gemini_segbuf_append((gemini_segbuf_t *)ctx, data, len);
+}
+
+// Report what the upload cost and, for FLAC, roughly what it saved: at the
+// same link throughput the raw WAV would have taken raw/encoded times longer
+static void log_stt_upload(const stt_body_ctx_t *ctx)
+{
+    size_t raw_bytes = 44 + ctx->sample_count * sizeof(int16_t);
+    float audio_sec = (float)ctx->sample_count / ctx->sample_rate_hz;
+    int64_t upload_ms = (ctx->upload_us - ctx->encode_us) / 1000;
+    if (ctx->audio_bytes == 0 || audio_sec <= 0.0f) {
+        return;
+    }
+#if CONFIG_GEMINI_STT_ENCODING_FLAC
+    float ratio = (float)raw_bytes / ctx->audio_bytes;
+    ESP_LOGI(TAG, "📤 [Gemini STT] Uploaded %zu B FLAC (%zu B raw, %.2fx) in %" PRId64 " ms; "
+             "encoder %.0f us per second of audio, ~%.0f ms saved vs LINEAR16",
+             ctx->audio_bytes, raw_bytes, ratio, upload_ms,
+             ctx->encode_us / audio_sec, upload_ms * (ratio - 1.0f) - ctx->encode_us / 1000.0f);
+#else
+    ESP_LOGI(TAG, "📤 [Gemini STT] Uploaded %zu B LINEAR16 in %" PRId64 " ms",
+             raw_bytes, upload_ms);
+#endif
 }
 
 esp_err_t gemini_api_init(const gemini_config_t *config)
@@ -204,18 +359,49 @@ esp_err_t gemini_api_init(const gemini_config_t *config)
     ESP_LOGI(TAG, "Certificate bundle enabled - will be used for TLS verification");
     #endif
     
+    esp_err_t ret = gemini_http_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize HTTP connection pool: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // The cache only saves round trips; run without it if it cannot start
+    if (gemini_tts_cache_init() != ESP_OK) {
+        ESP_LOGW(TAG, "TTS cache unavailable");
+    }
+    
     s_initialized = true;
     ESP_LOGI(TAG, "Gemini API initialized (model: %s)", s_config.model);
     return ESP_OK;
 }
 
+// Total length of a recording in pieces, 0 when it is unusable
+static size_t pcm_parts_samples(const gemini_pcm_parts_t *audio)
+{
+    size_t total = 0;
+    for (int i = 0; audio && i < 2; i++) {
+        if (audio->samples[i] > 0 && !audio->pcm[i]) {
+            return 0;
+        }
+        total += audio->samples[i];
+    }
+    return total;
+}
+
 esp_err_t gemini_stt(const int16_t *audio_data, size_t audio_len, char *text_out, size_t text_len)
+{
+    const gemini_pcm_parts_t audio = { .pcm = { audio_data }, .samples = { audio_len } };
+    return gemini_stt_parts(&audio, text_out, text_len);
+}
+
+esp_err_t gemini_stt_parts(const gemini_pcm_parts_t *audio, char *text_out, size_t text_len)
 {
     if (!s_initialized) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    if (!audio_data || !text_out || audio_len == 0) {
+    size_t audio_len = pcm_parts_samples(audio);
+    if (!text_out || audio_len == 0) {
         return ESP_ERR_INVALID_ARG;
     }
     
@@ -223,73 +409,43 @@ esp_err_t gemini_stt(const int16_t *audio_data, size_t audio_len, char *text_out
     ESP_LOGI(TAG, "🔊 [Gemini STT] Starting transcription: %zu samples @ 16000 Hz (%.2f sec)", 
              audio_len, duration_sec);
     
-    // Build WAV file from PCM
-    uint8_t *wav = NULL;
-    size_t wav_len = 0;
-    esp_err_t ret = build_wav_from_pcm(audio_data, audio_len, 16000, &wav, &wav_len);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to build WAV: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Base64 encode WAV
-    char *base64_audio = NULL;
-    ret = base64_encode_alloc(wav, wav_len, &base64_audio);
-    free(wav);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to base64 encode: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Build JSON request for Google Speech-to-Text API
-    cJSON *root = cJSON_CreateObject();
-    cJSON *config = cJSON_CreateObject();
-    cJSON_AddStringToObject(config, "encoding", "LINEAR16");
-    cJSON_AddNumberToObject(config, "sampleRateHertz", 16000);
-    cJSON_AddStringToObject(config, "languageCode", "en-US");
-    cJSON_AddItemToObject(root, "config", config);
-    
-    cJSON *audio = cJSON_CreateObject();
-    cJSON_AddStringToObject(audio, "content", base64_audio);
-    cJSON_AddItemToObject(root, "audio", audio);
-    
-    char *payload = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    free(base64_audio);
-    if (!payload) {
-        ESP_LOGE(TAG, "Failed to create JSON payload");
-        return ESP_ERR_NO_MEM;
-    }
-    
     // Build URL with API key
     char url[512];
     snprintf(url, sizeof(url), "https://speech.googleapis.com/v1/speech:recognize?key=%s", s_config.api_key);
     
-    // Perform HTTP request
-    http_buffer_t response = {0};
+    // Stream the request: the audio is encoded into the body chunk by chunk
+    // instead of being copied into WAV, base64 and JSON buffers up front
+    stt_body_ctx_t body = {
+        .pcm = *audio,
+        .sample_count = audio_len,
+        .sample_rate_hz = 16000,
+    };
+    gemini_segbuf_t response = {0};
     char auth_header[256];
     snprintf(auth_header, sizeof(auth_header), "Bearer %s", s_config.api_key);
     
-    ret = http_post_json_with_auth(url, payload, auth_header, &response);
-    free(payload);
+    const gemini_http_opts_t http_opts = { .deadline_us = stage_deadline(STAGES_LEFT_STT) };
+    span_trace_id_t span = span_trace_begin("stt", NULL);
+    esp_err_t ret = gemini_http_post_stream(url, auth_header, stt_body_writer, &body, &response, &http_opts);
+    span_trace_end(span);
     
     if (ret != ESP_OK) {
-        if (response.data) free(response.data);
+        gemini_segbuf_release(&response);
         return ret;
     }
     
+    log_stt_upload(&body);
+    
     // Parse response
-    if (!response.data || response.len == 0) {
+    const char *response_str = gemini_segbuf_str(&response);
+    if (!response_str) {
         ESP_LOGE(TAG, "Empty response");
-        if (response.data) free(response.data);
+        gemini_segbuf_release(&response);
         return ESP_FAIL;
     }
     
-    response.data = realloc(response.data, response.len + 1);
-    response.data[response.len] = '\0';
-    
-    cJSON *response_json = cJSON_Parse((char *)response.data);
-    free(response.data);
+    cJSON *response_json = cJSON_Parse(response_str);
+    gemini_segbuf_release(&response);
     
     if (!response_json) {
         ESP_LOGE(TAG, "Failed to parse JSON response");
@@ -323,6 +479,129 @@ esp_err_t gemini_stt(const int16_t *audio_data, size_t audio_len, char *text_out
     return ESP_FAIL;
 }
 
+// Open {"contents":[{"role":"user","parts":[ ... the caller writes the parts
+static void llm_contents_begin(gemini_json_writer_t *json)
+{
+    gemini_json_object_begin(json);
+    gemini_json_key(json, "contents");
+    gemini_json_array_begin(json);
+    gemini_json_object_begin(json);
+    gemini_json_kv_string(json, "role", "user");
+    gemini_json_key(json, "parts");
+    gemini_json_array_begin(json);
+}
+
+static void llm_contents_end(gemini_json_writer_t *json)
+{
+    gemini_json_array_end(json);
+    gemini_json_object_end(json);
+    gemini_json_array_end(json);
+    gemini_json_object_end(json);
+}
+
+// generateContent request body for a single-turn text prompt
+static void build_llm_payload(gemini_json_writer_t *json, const void *arg)
+{
+    llm_contents_begin(json);
+    gemini_json_object_begin(json);
+    gemini_json_kv_string(json, "text", (const char *)arg);
+    gemini_json_object_end(json);
+    llm_contents_end(json);
+}
+
+// Source for the streamed audio query body: the prompt and the utterance,
+// encoded exactly as for STT
+typedef struct {
+    stt_body_ctx_t audio;
+    const char *prompt;
+} audio_query_body_t;
+
+// Emit a generateContent request with the prompt and the utterance as an
+// inline audio part. Like the STT body, regenerated from scratch on a retry.
+static esp_err_t audio_query_body_writer(gemini_http_writer_t *writer, void *arg)
+{
+    audio_query_body_t *ctx = (audio_query_body_t *)arg;
+    int64_t start_us = esp_timer_get_time();
+
+    gemini_json_writer_t json;
+    gemini_json_init_sink(&json, http_json_sink, writer);
+    llm_contents_begin(&json);
+    gemini_json_object_begin(&json);
+    gemini_json_kv_string(&json, "text", ctx->prompt);
+    gemini_json_object_end(&json);
+    gemini_json_object_begin(&json);
+    gemini_json_key(&json, "inline_data");
+    gemini_json_object_begin(&json);
+    gemini_json_kv_string(&json, "mime_type", STT_AUDIO_MIME_TYPE);
+    gemini_json_key(&json, "data");
+    esp_err_t ret = stt_write_audio_string(&json, &ctx->audio);
+    if (ret == ESP_OK) {
+        gemini_json_object_end(&json);
+        gemini_json_object_end(&json);
+        llm_contents_end(&json);
+        ret = gemini_json_finish(&json, NULL);
+    }
+    ctx->audio.upload_us = esp_timer_get_time() - start_us;
+    return ret;
+}
+
+// Streaming LLM state shared by the SSE parser and the HTTP data callback
+typedef struct {
+    gemini_sse_parser_t sse;
+    gemini_text_cb_t on_text;
+    void *user_ctx;
+    size_t chars;           // Text delivered so far
+    int64_t start_us;
+    int64_t first_text_us;
+    bool stopped;           // Callback asked to stop
+} llm_stream_ctx_t;
+
+// One SSE event = one GenerateContentResponse chunk carrying a text delta
+static esp_err_t llm_stream_on_event(const char *data, size_t len, void *arg)
+{
+    llm_stream_ctx_t *ctx = (llm_stream_ctx_t *)arg;
+    cJSON *chunk = cJSON_ParseWithLength(data, len);
+    if (!chunk) {
+        ESP_LOGW(TAG, "Skipping unparseable SSE event (%zu bytes)", len);
+        return ESP_OK;
+    }
+    
+    esp_err_t ret = ESP_OK;
+    cJSON *candidates = cJSON_GetObjectItem(chunk, "candidates");
+    cJSON *candidate = cJSON_IsArray(candidates) ? cJSON_GetArrayItem(candidates, 0) : NULL;
+    cJSON *content = candidate ? cJSON_GetObjectItem(candidate, "content") : NULL;
+    cJSON *parts = content ? cJSON_GetObjectItem(content, "parts") : NULL;
+    cJSON *part = NULL;
+    if (cJSON_IsArray(parts)) {
+        cJSON_ArrayForEach(part, parts) {
+            cJSON *text = cJSON_GetObjectItem(part, "text");
+            if (!cJSON_IsString(text) || text->valuestring[0] == '\0') {
+                continue;
+            }
+            if (ctx->chars == 0) {
+                ctx->first_text_us = esp_timer_get_time();
+                span_trace_mark("first text", ctx->first_text_us);
+                ESP_LOGI(TAG, "💬 [Gemini LLM] First text after %lld ms",
+                         (long long)((ctx->first_text_us - ctx->start_us) / 1000));
+            }
+            ctx->chars += strlen(text->valuestring);
+            if (!ctx->on_text(text->valuestring, ctx->user_ctx)) {
+                ctx->stopped = true;
+                ret = ESP_ERR_NOT_FINISHED;
+                break;
+            }
+        }
+    }
+    cJSON_Delete(chunk);
+    return ret;
+}
+
+static esp_err_t llm_stream_on_data(const uint8_t *data, size_t len, void *arg)
+{
+    llm_stream_ctx_t *ctx = (llm_stream_ctx_t *)arg;
+    return gemini_sse_parser_feed(&ctx->sse, data, len);
+}
+
 esp_err_t gemini_llm(const char *prompt, char *response, size_t response_len)
 {
     if (!s_initialized) {
@@ -336,26 +615,6 @@ esp_err_t gemini_llm(const char *prompt, char *response, size_t response_len)
     ESP_LOGI(TAG, "💬 [Gemini LLM] Generating response for: \"%.100s%s\"", 
              prompt, strlen(prompt) > 100 ? "..." : "");
     
-    // Build JSON request for Gemini API
-    cJSON *root = cJSON_CreateObject();
-    cJSON *contents = cJSON_CreateArray();
-    cJSON *content = cJSON_CreateObject();
-    cJSON *parts = cJSON_CreateArray();
-    cJSON *part = cJSON_CreateObject();
-    
-    cJSON_AddItemToObject(root, "contents", contents);
-    cJSON_AddItemToArray(contents, content);
-    cJSON_AddItemToObject(content, "parts", parts);
-    cJSON_AddItemToArray(parts, part);
-    cJSON_AddStringToObject(part, "text", prompt);
-    
-    char *payload = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    if (!payload) {
-        ESP_LOGE(TAG, "Failed to create JSON payload");
-        return ESP_ERR_NO_MEM;
-    }
-    
     // Gemini API endpoint
     char url[512];
     snprintf(url, sizeof(url), 
@@ -363,30 +622,25 @@ esp_err_t gemini_llm(const char *prompt, char *response, size_t response_len)
              s_config.model, s_config.api_key);
     
     // Perform HTTP request
-    http_buffer_t http_response = {0};
-    char auth_header[256];
-    snprintf(auth_header, sizeof(auth_header), "X-Goog-Api-Key: %s", s_config.api_key);
-    
-    esp_err_t ret = http_post_json_with_auth(url, payload, NULL, &http_response);
-    free(payload);
+    gemini_segbuf_t http_response = {0};
+    const gemini_http_opts_t http_opts = { .deadline_us = stage_deadline(STAGES_LEFT_LLM), .hedge = true };
+    esp_err_t ret = post_json_body(url, build_llm_payload, prompt, segbuf_on_data, &http_response, &http_opts);
     
     if (ret != ESP_OK) {
-        if (http_response.data) free(http_response.data);
+        gemini_segbuf_release(&http_response);
         return ret;
     }
     
     // Parse response
-    if (!http_response.data || http_response.len == 0) {
+    const char *response_str = gemini_segbuf_str(&http_response);
+    if (!response_str) {
         ESP_LOGE(TAG, "Empty response");
-        if (http_response.data) free(http_response.data);
+        gemini_segbuf_release(&http_response);
         return ESP_FAIL;
     }
     
-    http_response.data = realloc(http_response.data, http_response.len + 1);
-    http_response.data[http_response.len] = '\0';
-    
-    cJSON *response_json = cJSON_Parse((char *)http_response.data);
-    free(http_response.data);
+    cJSON *response_json = cJSON_Parse(response_str);
+    gemini_segbuf_release(&http_response);
     
     if (!response_json) {
         ESP_LOGE(TAG, "Failed to parse JSON response");
@@ -424,116 +678,460 @@ esp_err_t gemini_llm(const char *prompt, char *response, size_t response_len)
     return ESP_FAIL;
 }
 
-esp_err_t gemini_tts(const char *text, int16_t *audio_out, size_t audio_len, size_t *samples_written)
+esp_err_t gemini_llm_stream(const char *prompt, gemini_text_cb_t on_text, void *user_ctx)
 {
     if (!s_initialized) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    if (!text || !audio_out || !samples_written) {
+    if (!prompt || !on_text) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    ESP_LOGI(TAG, "🔊 [Gemini TTS] Generating speech: \"%.100s%s\"", 
-             text, strlen(text) > 100 ? "..." : "");
+    ESP_LOGI(TAG, "💬 [Gemini LLM] Streaming response for: \"%.100s%s\"", 
+             prompt, strlen(prompt) > 100 ? "..." : "");
     
-    // Build JSON request for Google Cloud Text-to-Speech API
-    cJSON *root = cJSON_CreateObject();
-    cJSON *input = cJSON_CreateObject();
-    cJSON *voice = cJSON_CreateObject();
-    cJSON *audioConfig = cJSON_CreateObject();
+    llm_stream_ctx_t ctx = {
+        .on_text = on_text,
+        .user_ctx = user_ctx,
+        .start_us = esp_timer_get_time(),
+    };
+    esp_err_t ret = gemini_sse_parser_init(&ctx.sse, LLM_SSE_MAX_EVENT, llm_stream_on_event, &ctx);
+    if (ret != ESP_OK) {
+        return ret;
+    }
     
-    cJSON_AddItemToObject(root, "input", input);
-    cJSON_AddItemToObject(root, "voice", voice);
-    cJSON_AddItemToObject(root, "audioConfig", audioConfig);
+    // alt=sse makes streamGenerateContent emit one "data: {...}" event per delta
+    char url[512];
+    snprintf(url, sizeof(url), 
+             "https://generativelanguage.googleapis.com/v1beta/models/%s:streamGenerateContent?alt=sse&key=%s",
+             s_config.model, s_config.api_key);
     
-    cJSON_AddStringToObject(input, "text", text);
-    cJSON_AddStringToObject(voice, "languageCode", "en-US");
-    cJSON_AddStringToObject(voice, "name", "en-US-Neural2-D");
-    cJSON_AddStringToObject(audioConfig, "audioEncoding", "LINEAR16");
-    cJSON_AddNumberToObject(audioConfig, "sampleRateHertz", 24000);
+    const gemini_http_opts_t http_opts = { .deadline_us = stage_deadline(STAGES_LEFT_LLM), .hedge = true };
+    span_trace_id_t span = span_trace_begin("llm", NULL);
+    ret = post_json_body(url, build_llm_payload, prompt, llm_stream_on_data, &ctx, &http_opts);
+    if (ret == ESP_OK) {
+        ret = gemini_sse_parser_finish(&ctx.sse);
+    }
+    span_trace_end(span);
+    gemini_sse_parser_deinit(&ctx.sse);
     
-    char *payload = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    if (!payload) {
-        ESP_LOGE(TAG, "Failed to create JSON payload");
-        return ESP_ERR_NO_MEM;
+    if (ctx.stopped) {
+        ESP_LOGI(TAG, "💬 [Gemini LLM] Stream stopped by caller after %zu chars", ctx.chars);
+        return ESP_OK;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ [Gemini LLM] Stream failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (ctx.chars == 0) {
+        ESP_LOGE(TAG, "❌ [Gemini LLM] Stream ended without text");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "✅ [Gemini LLM] Stream complete: %zu chars in %lld ms", ctx.chars,
+             (long long)((esp_timer_get_time() - ctx.start_us) / 1000));
+    return ESP_OK;
+}
+
+esp_err_t gemini_audio_query(const int16_t *audio_data, size_t audio_len, const char *prompt,
+                             gemini_text_cb_t on_text, void *user_ctx)
+{
+    const gemini_pcm_parts_t audio = { .pcm = { audio_data }, .samples = { audio_len } };
+    return gemini_audio_query_parts(&audio, prompt, on_text, user_ctx);
+}
+
+esp_err_t gemini_audio_query_parts(const gemini_pcm_parts_t *audio, const char *prompt,
+                                   gemini_text_cb_t on_text, void *user_ctx)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    size_t audio_len = pcm_parts_samples(audio);
+    if (audio_len == 0 || !on_text) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    ESP_LOGI(TAG, "🎙️ [Gemini Audio] Asking %s about %zu samples (%.2f sec)",
+             s_config.model, audio_len, (float)audio_len / 16000.0f);
+    
+    audio_query_body_t body = {
+        .audio = {
+            .pcm = *audio,
+            .sample_count = audio_len,
+            .sample_rate_hz = 16000,
+        },
+        .prompt = prompt ? prompt : AUDIO_QUERY_DEFAULT_PROMPT,
+    };
+    llm_stream_ctx_t ctx = {
+        .on_text = on_text,
+        .user_ctx = user_ctx,
+        .start_us = esp_timer_get_time(),
+    };
+    esp_err_t ret = gemini_sse_parser_init(&ctx.sse, LLM_SSE_MAX_EVENT, llm_stream_on_event, &ctx);
+    if (ret != ESP_OK) {
+        return ret;
     }
     
     char url[512];
     snprintf(url, sizeof(url), 
-             "https://texttospeech.googleapis.com/v1/text:synthesize?key=%s",
-             s_config.api_key);
+             "https://generativelanguage.googleapis.com/v1beta/models/%s:streamGenerateContent?alt=sse&key=%s",
+             s_config.model, s_config.api_key);
     
-    // Perform HTTP request
-    http_buffer_t http_response = {0};
-
-    // TTS uses query parameter authentication, no auth header needed
-    esp_err_t ret = http_post_json_with_auth(url, payload, NULL, &http_response);
-    free(payload);
+    // One request stands in for STT and LLM here
+    const gemini_http_opts_t http_opts = { .deadline_us = stage_deadline(STAGES_LEFT_LLM) };
+    span_trace_id_t span = span_trace_begin("audio query", NULL);
+    ret = gemini_http_post_stream_cb(url, NULL, audio_query_body_writer, &body, llm_stream_on_data, &ctx,
+                                     &http_opts);
+    if (ret == ESP_OK) {
+        ret = gemini_sse_parser_finish(&ctx.sse);
+    }
+    span_trace_end(span);
+    gemini_sse_parser_deinit(&ctx.sse);
     
+    if (ctx.stopped) {
+        ESP_LOGI(TAG, "🎙️ [Gemini Audio] Stream stopped by caller after %zu chars", ctx.chars);
+        return ESP_OK;
+    }
     if (ret != ESP_OK) {
-        if (http_response.data) free(http_response.data);
+        ESP_LOGE(TAG, "❌ [Gemini Audio] Query failed: %s", esp_err_to_name(ret));
         return ret;
     }
-    
-    // Parse response
-    if (!http_response.data || http_response.len == 0) {
-        ESP_LOGE(TAG, "Empty response");
-        if (http_response.data) free(http_response.data);
+    if (ctx.chars == 0) {
+        ESP_LOGE(TAG, "❌ [Gemini Audio] Stream ended without text");
         return ESP_FAIL;
     }
     
-    http_response.data = realloc(http_response.data, http_response.len + 1);
-    http_response.data[http_response.len] = '\0';
+    ESP_LOGI(TAG, "✅ [Gemini Audio] Answer complete: %zu chars in %lld ms (%zu B audio uploaded in %lld ms)",
+             ctx.chars, (long long)((esp_timer_get_time() - ctx.start_us) / 1000),
+             body.audio.audio_bytes, (long long)(body.audio.upload_us / 1000));
+    return ESP_OK;
+}
+
+// Google Cloud Text-to-Speech synthesize request body
+static void build_tts_payload(gemini_json_writer_t *json, const void *arg)
+{
+    gemini_json_object_begin(json);
+    gemini_json_key(json, "input");
+    gemini_json_object_begin(json);
+    gemini_json_kv_string(json, "text", (const char *)arg);
+    gemini_json_object_end(json);
+    gemini_json_key(json, "voice");
+    gemini_json_object_begin(json);
+    gemini_json_kv_string(json, "languageCode", TTS_LANGUAGE_CODE);
+    gemini_json_kv_string(json, "name", TTS_VOICE_NAME);
+    gemini_json_object_end(json);
+    gemini_json_key(json, "audioConfig");
+    gemini_json_object_begin(json);
+    gemini_json_kv_string(json, "audioEncoding", TTS_AUDIO_ENCODING);
+    gemini_json_kv_int(json, "sampleRateHertz", TTS_SAMPLE_RATE_HZ);
+    gemini_json_object_end(json);
+    gemini_json_object_end(json);
+}
+
+// Request state while a TTS response is decoded on the fly
+typedef struct {
+    gemini_tts_stream_t stream;
+    const gemini_tts_opts_t *opts;
+    int64_t first_audio_us;
+} tts_request_ctx_t;
+
+static esp_err_t tts_on_data(const uint8_t *data, size_t len, void *user_ctx)
+{
+    tts_request_ctx_t *ctx = (tts_request_ctx_t *)user_ctx;
+    return gemini_tts_stream_feed(&ctx->stream, data, len);
+}
+
+static void tts_on_progress(size_t samples_ready, void *user_ctx)
+{
+    tts_request_ctx_t *ctx = (tts_request_ctx_t *)user_ctx;
+    if (ctx->first_audio_us == 0) {
+        ctx->first_audio_us = esp_timer_get_time();
+        span_trace_mark("first pcm", ctx->first_audio_us);
+        // The turn has its first answer audio; later sentences are not urgent
+        s_turn_deadline_us = 0;
+    }
+    if (ctx->opts->on_progress) {
+        ctx->opts->on_progress(samples_ready, ctx->opts->user_ctx);
+    }
+}
+
+esp_err_t gemini_tts_ex(const char *text, int16_t *audio_out, size_t audio_len,
+                        size_t *samples_written, const gemini_tts_opts_t *opts)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
     
-    cJSON *response_json = cJSON_Parse((char *)http_response.data);
-    free(http_response.data);
+    if (!text || !audio_out || !samples_written) {
+        return ESP_ERR_INVALID_ARG;
+    }
     
-    if (!response_json) {
-        ESP_LOGE(TAG, "Failed to parse JSON response");
-        return ESP_FAIL;
+    const gemini_tts_opts_t default_opts = {0};
+    if (!opts) {
+        opts = &default_opts;
+    }
+    *samples_written = 0;
+    
+    uint8_t cache_key[GEMINI_TTS_CACHE_KEY_LEN];
+    gemini_tts_cache_key(TTS_VOICE_NAME "/" TTS_AUDIO_ENCODING, TTS_SAMPLE_RATE_HZ, text, cache_key);
+    if (gemini_tts_cache_lookup(cache_key, audio_out, audio_len, samples_written)) {
+        ESP_LOGI(TAG, "🔊 [Gemini TTS] Cache hit (%zu samples): \"%.100s%s\"", 
+                 *samples_written, text, strlen(text) > 100 ? "..." : "");
+        span_trace_mark("tts cache hit", esp_timer_get_time());
+        s_turn_deadline_us = 0;
+        if (opts->on_progress) {
+            opts->on_progress(*samples_written, opts->user_ctx);
+        }
+        return ESP_OK;
+    }
+    
+    ESP_LOGI(TAG, "🔊 [Gemini TTS] Generating speech (%s): \"%.100s%s\"", 
+             TTS_AUDIO_ENCODING, text, strlen(text) > 100 ? "..." : "");
+    
+    char url[512];
+    snprintf(url, sizeof(url), 
+             "https://texttospeech.googleapis.com/v1/text:synthesize?key=%s",
+             s_config.api_key);
+    
+    tts_request_ctx_t ctx = { .opts = opts };
+    esp_err_t ret = gemini_tts_stream_init(&ctx.stream, TTS_STREAM_ENCODING, audio_out, audio_len,
+                                           tts_on_progress, &ctx);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to allocate TTS decoder");
+        return ret;
     }
     
-    cJSON *audioContent = cJSON_GetObjectItem(response_json, "audioContent");
-    if (audioContent && cJSON_IsString(audioContent)) {
-        // Decode base64 audio
-        const char *base64_audio = audioContent->valuestring;
-        size_t base64_len = strlen(base64_audio);
-        size_t decoded_len = 0;
-        
-        // Calculate required buffer size
-        size_t max_decoded = (base64_len / 4) * 3;
-        if (max_decoded > audio_len * sizeof(int16_t)) {
-            max_decoded = audio_len * sizeof(int16_t);
+    // The response is decoded as it arrives, so audio_out fills (and can be
+    // played) while the rest of the body is still on the wire.
+    // TTS uses query parameter authentication, no auth header needed
+    int64_t start_us = esp_timer_get_time();
+    const gemini_http_opts_t http_opts = {
+        .cancel = opts->cancel,
+        .deadline_us = stage_deadline(STAGES_LEFT_TTS),
+        .hedge = true,
+    };
+    span_trace_id_t span = span_trace_begin("tts", NULL);
+    ret = post_json_body(url, build_tts_payload, text, tts_on_data, &ctx, &http_opts);
+    if (ret == ESP_OK) {
+        ret = gemini_tts_stream_finish(&ctx.stream);
+    }
+    span_trace_end(span);
+    int64_t end_us = esp_timer_get_time();
+    
+    *samples_written = ctx.stream.samples;
+    if (ret == ESP_OK && ctx.stream.encoding == GEMINI_TTS_STREAM_MP3 &&
+        ctx.stream.sample_rate_hz != TTS_SAMPLE_RATE_HZ) {
+        ESP_LOGW(TAG, "MP3 stream is %d Hz, expected %d Hz", ctx.stream.sample_rate_hz, TTS_SAMPLE_RATE_HZ);
+    }
+    bool truncated = ctx.stream.truncated;
+    size_t bytes_in = ctx.stream.bytes_in;
+    gemini_tts_stream_deinit(&ctx.stream);
+    
+    if (ret != ESP_OK) {
+        if (ret != ESP_ERR_NOT_FINISHED) {
+            ESP_LOGE(TAG, "❌ [Gemini TTS] Request failed: %s", esp_err_to_name(ret));
         }
-        
-        int mbedtls_ret = mbedtls_base64_decode((unsigned char *)audio_out, 
-                                                max_decoded,
-                                                &decoded_len,
-                                                (const unsigned char *)base64_audio,
-                                                base64_len);
-        
-        cJSON_Delete(response_json);
-        
-        if (mbedtls_ret != 0) {
-            ESP_LOGE(TAG, "❌ [Gemini TTS] Base64 decode failed: %d", mbedtls_ret);
-            return ESP_FAIL;
+        return ret;
+    }
+    
+    ESP_LOGI(TAG, "✅ [Gemini TTS] Success: %zu samples from %zu bytes %s, first audio %lld ms, total %lld ms",
+             *samples_written, bytes_in, TTS_AUDIO_ENCODING,
+             (long long)((ctx.first_audio_us - start_us) / 1000),
+             (long long)((end_us - start_us) / 1000));
+    if (!truncated) {
+        gemini_tts_cache_store(cache_key, audio_out, *samples_written, opts->persist);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_tts(const char *text, int16_t *audio_out, size_t audio_len, size_t *samples_written)
+{
+    return gemini_tts_ex(text, audio_out, audio_len, samples_written, NULL);
+}
+
+esp_err_t gemini_tts_cancellable(const char *text, int16_t *audio_out, size_t audio_len,
+                                 size_t *samples_written, const gemini_cancel_t *cancel)
+{
+    const gemini_tts_opts_t opts = { .cancel = cancel };
+    return gemini_tts_ex(text, audio_out, audio_len, samples_written, &opts);
+}
+
+esp_err_t gemini_tts_prompt(const char *text, int16_t *audio_out, size_t audio_len, size_t *samples_written)
+{
+    const gemini_tts_opts_t opts = { .persist = true };
+    return gemini_tts_ex(text, audio_out, audio_len, samples_written, &opts);
+}
+
+void gemini_api_get_tts_cache_stats(gemini_tts_cache_stats_t *stats)
+{
+    gemini_tts_cache_get_stats(stats);
+}
+
+void gemini_api_get_pool_stats(gemini_http_pool_stats_t *stats)
+{
+    gemini_http_get_pool_stats(stats);
+}
+
+size_t gemini_api_get_endpoint_stats(gemini_http_endpoint_stats_t *stats, size_t max)
+{
+    return gemini_http_get_endpoint_stats(stats, max);
+}
+
+// In the order the turn needs them
+static const struct {
+    gemini_service_t service;
+    const char *url;
+} PREWARM_HOSTS[] = {
+    { GEMINI_SERVICE_STT, "https://speech.googleapis.com/" },
+    { GEMINI_SERVICE_LLM, "https://generativelanguage.googleapis.com/" },
+    { GEMINI_SERVICE_TTS, "https://texttospeech.googleapis.com/" },
+};
+
+static void prewarm_task(void *arg)
+{
+    uint32_t services = (uint32_t)(uintptr_t)arg;
+    int64_t start_us = esp_timer_get_time();
+    gemini_http_pool_stats_t before, after;
+    gemini_http_get_pool_stats(&before);
+    for (size_t i = 0; i < sizeof(PREWARM_HOSTS) / sizeof(PREWARM_HOSTS[0]); i++) {
+        if (services & PREWARM_HOSTS[i].service) {
+            gemini_http_prewarm(PREWARM_HOSTS[i].url);
         }
-        
-        *samples_written = decoded_len / sizeof(int16_t);
-        ESP_LOGI(TAG, "✅ [Gemini TTS] Success: %zu bytes audio generated (%zu samples)", 
-                 decoded_len, *samples_written);
+    }
+    gemini_http_get_pool_stats(&after);
+    ESP_LOGI(TAG, "Connections ready for the turn in %" PRId64 " ms (%" PRIu32 " opened)",
+             (esp_timer_get_time() - start_us) / 1000, after.prewarmed - before.prewarmed);
+    __atomic_store_n(&s_prewarm_running, false, __ATOMIC_RELEASE);
+    vTaskDelete(NULL);
+}
+
+esp_err_t gemini_api_prewarm(uint32_t services)
+{
+    if (!s_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (__atomic_exchange_n(&s_prewarm_running, true, __ATOMIC_ACQ_REL)) {
         return ESP_OK;
     }
-    
-    cJSON_Delete(response_json);
-    ESP_LOGE(TAG, "❌ [Gemini TTS] Failed to extract audioContent from response");
-    return ESP_FAIL;
+    if (xTaskCreate(prewarm_task, "gemini_prewarm", CONFIG_GEMINI_HTTP_PREWARM_STACK_SIZE,
+                    (void *)(uintptr_t)services, PREWARM_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGW(TAG, "No memory for the warm-up task");
+        __atomic_store_n(&s_prewarm_running, false, __ATOMIC_RELEASE);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void gemini_api_metrics_turn_begin(void)
+{
+    s_turn_seq = gemini_http_timing_seq();
+    s_turn_deadline_us = esp_timer_get_time() + (int64_t)CONFIG_GEMINI_TURN_BUDGET_MS * 1000;
+}
+
+void gemini_api_metrics_turn_end(void)
+{
+    s_turn_deadline_us = 0;
+}
+
+// First sequence number of the current turn still in the timing history
+static uint32_t turn_first_seq(uint32_t end)
+{
+    uint32_t first = s_turn_seq;
+    if (end - first > GEMINI_HTTP_TIMING_HISTORY) {
+        first = end - GEMINI_HTTP_TIMING_HISTORY;
+    }
+    return first;
+}
+
+size_t gemini_api_get_turn_metrics(gemini_http_timing_t *timings, size_t max, gemini_turn_metrics_t *totals)
+{
+    if (totals) {
+        memset(totals, 0, sizeof(*totals));
+    }
+    uint32_t end = gemini_http_timing_seq();
+    size_t n = 0;
+    gemini_http_timing_t t;
+    for (uint32_t seq = turn_first_seq(end); seq != end; seq++) {
+        if (!gemini_http_get_timing(seq, &t)) {
+            continue;
+        }
+        if (timings && n < max) {
+            timings[n] = t;
+        }
+        n++;
+        if (totals) {
+            totals->requests++;
+            totals->new_connections += t.reused ? 0 : 1;
+            totals->failed += (t.err != ESP_OK || t.status / 100 != 2) ? 1 : 0;
+            totals->dns_us += t.dns_us;
+            totals->connect_us += t.connect_us;
+            totals->upload_us += t.upload_us;
+            totals->ttfb_us += t.ttfb_us;
+            totals->transfer_us += t.transfer_us;
+            totals->bytes_up += t.bytes_up;
+            totals->bytes_down += t.bytes_down;
+        }
+    }
+    return n;
+}
+
+void gemini_api_log_turn_metrics(void)
+{
+    uint32_t end = gemini_http_timing_seq();
+    int64_t turn_start_us = 0;
+    gemini_http_timing_t t;
+    for (uint32_t seq = turn_first_seq(end); seq != end; seq++) {
+        if (!gemini_http_get_timing(seq, &t)) {
+            continue;
+        }
+        if (turn_start_us == 0) {
+            turn_start_us = t.start_us;
+        }
+        ESP_LOGI(TAG, "  +%5" PRId64 " ms %-28.28s %3d %5" PRId64 " ms | dns %4" PRId64 " conn %4" PRId64
+                 " up %4" PRId64 " ttfb %5" PRId64 " xfer %5" PRId64 " | %6zu B up %7zu B down",
+                 (t.start_us - turn_start_us) / 1000, t.host, t.status, t.total_us / 1000,
+                 t.dns_us / 1000, t.connect_us / 1000, t.upload_us / 1000, t.ttfb_us / 1000,
+                 t.transfer_us / 1000, t.bytes_up, t.bytes_down);
+    }
+
+    gemini_turn_metrics_t totals;
+    if (gemini_api_get_turn_metrics(NULL, 0, &totals) == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "📊 Turn network: %" PRIu32 " request(s), %" PRIu32 " new connection(s), %" PRIu32 " failed; "
+             "dns %" PRId64 ", connect %" PRId64 ", upload %" PRId64 ", ttfb %" PRId64 ", transfer %" PRId64
+             " ms (summed over overlapping requests); %zu B up, %zu B down",
+             totals.requests, totals.new_connections, totals.failed,
+             totals.dns_us / 1000, totals.connect_us / 1000, totals.upload_us / 1000,
+             totals.ttfb_us / 1000, totals.transfer_us / 1000, totals.bytes_up, totals.bytes_down);
+
+    gemini_http_endpoint_stats_t endpoints[6];
+    size_t n = gemini_http_get_endpoint_stats(endpoints, sizeof(endpoints) / sizeof(endpoints[0]));
+    for (size_t i = 0; i < n; i++) {
+        const gemini_http_endpoint_stats_t *ep = &endpoints[i];
+        ESP_LOGI(TAG, "  %-40.40s first byte p50 %5" PRIu32 " p95 %5" PRIu32 " p99 %5" PRIu32
+                 " ms (%" PRIu32 " samples) | %" PRIu32 " req, %" PRIu32 " hedged (%" PRIu32 " won), %" PRIu32
+                 " past deadline",
+                 ep->endpoint, ep->p50_ms, ep->p95_ms, ep->p99_ms, ep->samples, ep->requests,
+                 ep->hedged, ep->hedge_wins, ep->deadline_misses);
+    }
+}
+
+const gemini_config_t *gemini_api_get_config(void)
+{
+    return s_initialized ? &s_config : NULL;
 }
 
 void gemini_api_deinit(void)
 {
+    // A warm-up still handshaking holds a pool slot
+    while (__atomic_load_n(&s_prewarm_running, __ATOMIC_ACQUIRE)) {
+        vTaskDelay(pdMS_TO_TICKS(PREWARM_POLL_MS));
+    }
+    gemini_tts_cache_deinit();
+    gemini_http_deinit();
     memset(&s_config, 0, sizeof(s_config));
     s_initialized = false;
     ESP_LOGI(TAG, "Gemini API deinitialized");
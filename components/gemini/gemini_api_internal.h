@@ -0,0 +1,10 @@
+#pragma once
+
+#include "gemini_api.h"
+
+/**
+ * Configuration passed to gemini_api_init(), for other parts of the
+ * component that talk to Gemini outside gemini_api.c (Live sessions)
+ * @return Configuration, or NULL before gemini_api_init()
+ */
+const gemini_config_t *gemini_api_get_config(void);
@@ -0,0 +1,1379 @@
+#include "gemini_http.h"
+#include "gemini_api.h"
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "esp_timer.h"
+#include "esp_crt_bundle.h"
+#include "span_trace.h"
+#include "turn_arena.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/netdb.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+static const char *TAG = "gemini_http";
+
+#define POOL_HOST_MAX_LEN 64
+
+// Per-endpoint latency history: first-byte times of the last ENDPOINT_SAMPLES
+// requests to each of up to ENDPOINT_SLOTS endpoints
+#define ENDPOINT_SLOTS      6
+#define ENDPOINT_SAMPLES    32
+
+// A socket error this close to the deadline is reported as the deadline
+#define DEADLINE_SLACK_US   20000
+
+// Hedging: below HEDGE_MIN_SAMPLES the configured delay is used instead of
+// the endpoint's p95; the delay never goes below HEDGE_MIN_DELAY_MS so a fast
+// endpoint is not hit twice for every request
+#define HEDGE_MIN_SAMPLES   8
+#define HEDGE_MIN_DELAY_MS  200
+#define HEDGE_POLL_US       50000   // Caller's cancel token is checked this often
+#define HEDGE_EXIT_POLL_MS  10      // Deinit waits for abandoned attempts this often
+
+// A request for a host whose connection is being warmed up polls for it
+// this often rather than starting a second handshake
+#define WARMING_POLL_MS     10
+
+// One persistent connection. The esp_http_client handle keeps its socket and
+// TLS session open between requests as long as the server allows keep-alive.
+typedef struct {
+    esp_http_client_handle_t client;
+    char host[POOL_HOST_MAX_LEN];
+    bool in_use;
+    int64_t last_used_us;
+    int64_t handshake_us;   // Cost of the handshake that opened this connection
+    bool warming;           // Held by gemini_http_prewarm(): requests to the host wait for it
+} pool_slot_t;
+
+// Where a response body goes: a segmented buffer (gemini_http_post_json)
+// or a caller's streaming consumer (gemini_http_post_json_cb). Either way the
+// event handler hands over the de-chunked bytes in place.
+typedef struct {
+    gemini_http_data_cb_t write;
+    void *ctx;
+} response_sink_t;
+
+// Per-request state handed to the event handler via user_data
+typedef struct {
+    response_sink_t sink;
+    const gemini_cancel_t *cancel;    // Optional caller cancellation token
+    bool probe;                       // Warm-up exchange: any status will do
+    esp_err_t abort_err;              // Set when on_data asks to stop or on cancel
+    size_t bytes_down;                // Response body bytes delivered
+    size_t bytes_up;                  // Request body bytes sent
+    int64_t start_us;
+    int64_t connected_us;   // Set on HTTP_EVENT_ON_CONNECTED (new connection only)
+    int64_t sent_us;        // Request body fully written
+    int64_t headers_us;     // Response headers received
+    int64_t done_us;        // Response body complete
+} request_ctx_t;
+
+#define REQUEST_CANCELLED(ctx) ((ctx)->cancel && (ctx)->cancel->cancelled)
+
+typedef struct {
+    char name[GEMINI_HTTP_ENDPOINT_NAME_LEN];
+    uint32_t requests;
+    uint32_t hedged;
+    uint32_t hedge_wins;
+    uint32_t deadline_misses;
+    uint32_t samples;                       // Total ever; ring slot = samples % ENDPOINT_SAMPLES
+    uint32_t first_byte_ms[ENDPOINT_SAMPLES];
+} endpoint_t;
+
+static pool_slot_t s_slots[CONFIG_GEMINI_HTTP_POOL_SIZE];
+static SemaphoreHandle_t s_pool_lock = NULL;
+static gemini_http_pool_stats_t s_stats = {0};
+
+// Ring of the most recent request timings; s_timing_seq counts every
+// request ever recorded, so slot = seq % GEMINI_HTTP_TIMING_HISTORY
+static gemini_http_timing_t s_timings[GEMINI_HTTP_TIMING_HISTORY];
+static uint32_t s_timing_seq = 0;
+
+static endpoint_t s_endpoints[ENDPOINT_SLOTS];
+
+static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+{
+    request_ctx_t *ctx = (request_ctx_t *)evt->user_data;
+    if (!ctx) {
+        return ESP_OK;
+    }
+
+    switch (evt->event_id) {
+        case HTTP_EVENT_ERROR:
+            ESP_LOGD(TAG, "HTTP_EVENT_ERROR");
+            break;
+        case HTTP_EVENT_ON_CONNECTED:
+            // Only fires when a new TCP+TLS connection was established
+            ctx->connected_us = esp_timer_get_time();
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
+            break;
+        case HTTP_EVENT_HEADER_SENT:
+            ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
+            break;
+        case HTTP_EVENT_ON_HEADER:
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+            break;
+        case HTTP_EVENT_ON_DATA:
+            if (REQUEST_CANCELLED(ctx)) {
+                ctx->abort_err = ESP_ERR_NOT_FINISHED;
+                break;
+            }
+            // esp_http_client has already stripped any chunk framing here, so
+            // chunked and Content-Length bodies are delivered the same way
+            int status = esp_http_client_get_status_code(evt->client);
+            if (status / 100 != 2) {
+                if (ctx->probe) {
+                    break;
+                }
+                ESP_LOGW(TAG, "HTTP %d body: %.*s", status, evt->data_len > 200 ? 200 : evt->data_len,
+                         (const char *)evt->data);
+                break;
+            }
+            ctx->bytes_down += evt->data_len;
+            if (ctx->abort_err == ESP_OK) {
+                ctx->abort_err = ctx->sink.write((const uint8_t *)evt->data, evt->data_len, ctx->sink.ctx);
+            }
+            break;
+        case HTTP_EVENT_ON_FINISH:
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_FINISH");
+            break;
+        case HTTP_EVENT_DISCONNECTED:
+            ESP_LOGD(TAG, "HTTP_EVENT_DISCONNECTED");
+            break;
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+// Extract "host" from "https://host[:port]/path?query"
+static void url_get_host(const char *url, char *host, size_t host_len)
+{
+    const char *start = strstr(url, "://");
+    start = start ? start + 3 : url;
+    size_t n = strcspn(start, ":/?");
+    if (n >= host_len) {
+        n = host_len - 1;
+    }
+    memcpy(host, start, n);
+    host[n] = '\0';
+}
+
+static esp_http_client_handle_t create_client(const char *url)
+{
+    esp_http_client_config_t config = {
+        .url = url,
+        .event_handler = http_event_handler,
+        .timeout_ms = CONFIG_GEMINI_HTTP_TIMEOUT_MS,
+        .skip_cert_common_name_check = false,  // Enable certificate verification
+        .crt_bundle_attach = esp_crt_bundle_attach,  // Use certificate bundle for TLS verification
+        .keep_alive_enable = true,  // TCP keep-alive so dead idle connections are detected
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .save_client_session = true,  // Resume TLS when a pooled connection must be re-opened
+#endif
+    };
+    return esp_http_client_init(&config);
+}
+
+static void slot_close(pool_slot_t *slot)
+{
+    if (slot->client) {
+        esp_http_client_cleanup(slot->client);
+    }
+    memset(slot, 0, sizeof(*slot));
+}
+
+// Take a connection for `host`, preferring an idle one that is already open.
+// While a warm-up is opening one for the host, waits for it to finish.
+// Returns NULL when every slot is busy, or when the only way to get one is to
+// close another host's idle connection and `evict` is false; the caller then
+// uses a one-off client. With `warm_up` the slot is marked as warming in the
+// same critical section that takes it, so no request to the host can slip in
+// between and open a second connection.
+static pool_slot_t *pool_acquire(const char *host, const char *url, bool evict, bool warm_up, bool *reused)
+{
+    const int64_t idle_timeout_us = (int64_t)CONFIG_GEMINI_HTTP_POOL_IDLE_TIMEOUT_MS * 1000;
+    pool_slot_t *match;
+    pool_slot_t *empty;
+    pool_slot_t *lru;
+    bool warming;
+
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    do {
+        int64_t now = esp_timer_get_time();
+        match = NULL;
+        empty = NULL;
+        lru = NULL;
+        warming = false;
+        for (int i = 0; i < CONFIG_GEMINI_HTTP_POOL_SIZE; i++) {
+            pool_slot_t *slot = &s_slots[i];
+            if (slot->in_use) {
+                warming |= slot->warming && strcmp(slot->host, host) == 0;
+                continue;
+            }
+            // Drop connections the server has most likely timed out already
+            if (slot->client && now - slot->last_used_us > idle_timeout_us) {
+                ESP_LOGD(TAG, "Closing idle connection to %s", slot->host);
+                slot_close(slot);
+            }
+            if (!slot->client) {
+                if (!empty) {
+                    empty = slot;
+                }
+            } else if (strcmp(slot->host, host) == 0) {
+                if (!match || slot->last_used_us > match->last_used_us) {
+                    match = slot;
+                }
+            } else if (!lru || slot->last_used_us < lru->last_used_us) {
+                lru = slot;
+            }
+        }
+        if (!match && warming) {
+            xSemaphoreGive(s_pool_lock);
+            vTaskDelay(pdMS_TO_TICKS(WARMING_POLL_MS));
+            xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+        }
+    } while (!match && warming);
+
+    pool_slot_t *slot = match;
+    *reused = (match != NULL);
+    if (!slot) {
+        slot = empty ? empty : (evict ? lru : NULL);
+        if (slot) {
+            slot_close(slot);
+            snprintf(slot->host, sizeof(slot->host), "%s", host);
+        }
+    }
+    if (slot) {
+        slot->in_use = true;
+        slot->warming = warm_up;
+    }
+    xSemaphoreGive(s_pool_lock);
+
+    if (slot && !slot->client) {
+        slot->client = create_client(url);
+        if (!slot->client) {
+            xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+            slot_close(slot);
+            xSemaphoreGive(s_pool_lock);
+            return NULL;
+        }
+    }
+    return slot;
+}
+
+static void pool_release(pool_slot_t *slot, bool keep)
+{
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    if (keep) {
+        slot->in_use = false;
+        slot->warming = false;
+        slot->last_used_us = esp_timer_get_time();
+    } else {
+        slot_close(slot);
+    }
+    xSemaphoreGive(s_pool_lock);
+}
+
+// Chunk framing: "<hex size>\r\n" + payload + "\r\n". The size line is
+// written into reserved headroom in front of the payload so each chunk goes
+// out in a single TLS record.
+#define CHUNK_HEADROOM 8
+
+struct gemini_http_writer {
+    esp_http_client_handle_t client;
+    uint8_t *buf;       // CHUNK_HEADROOM + cap + 2 bytes
+    size_t len;         // Payload bytes currently buffered
+    size_t cap;         // Payload capacity per chunk
+    size_t total;       // Payload bytes sent so far
+};
+
+typedef struct {
+    const char *data;           // Static body, or NULL when streamed
+    size_t len;
+    gemini_http_body_cb_t cb;   // Streamed body producer
+    void *cb_ctx;
+} request_body_t;
+
+static esp_err_t send_all(esp_http_client_handle_t client, const char *data, size_t len)
+{
+    size_t sent = 0;
+    while (sent < len) {
+        int n = esp_http_client_write(client, data + sent, (int)(len - sent));
+        if (n <= 0) {
+            return ESP_ERR_HTTP_WRITE_DATA;
+        }
+        sent += n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t writer_flush(gemini_http_writer_t *w)
+{
+    if (w->len == 0) {
+        return ESP_OK;
+    }
+    char size_line[CHUNK_HEADROOM + 1];
+    int n = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)w->len);
+    uint8_t *frame = w->buf + CHUNK_HEADROOM - n;
+    memcpy(frame, size_line, n);
+    memcpy(w->buf + CHUNK_HEADROOM + w->len, "\r\n", 2);
+    esp_err_t err = send_all(w->client, (const char *)frame, n + w->len + 2);
+    w->total += w->len;
+    w->len = 0;
+    return err;
+}
+
+esp_err_t gemini_http_writer_write(gemini_http_writer_t *w, const void *data, size_t len)
+{
+    if (!w || (!data && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *src = (const uint8_t *)data;
+    while (len > 0) {
+        size_t n = w->cap - w->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(w->buf + CHUNK_HEADROOM + w->len, src, n);
+        w->len += n;
+        src += n;
+        len -= n;
+        if (w->len == w->cap) {
+            esp_err_t err = writer_flush(w);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t send_streamed_body(esp_http_client_handle_t client, const request_body_t *body,
+                                    size_t *bytes_sent)
+{
+    gemini_http_writer_t w = {
+        .client = client,
+        .cap = CONFIG_GEMINI_HTTP_UPLOAD_CHUNK_SIZE,
+    };
+    w.buf = turn_arena_malloc(CHUNK_HEADROOM + w.cap + 2);
+    if (!w.buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = body->cb(&w, body->cb_ctx);
+    if (err == ESP_OK) {
+        err = writer_flush(&w);
+    }
+    if (err == ESP_OK) {
+        err = send_all(client, "0\r\n\r\n", 5);  // Last chunk
+    }
+    turn_arena_free(w.buf);
+    *bytes_sent = w.total;
+    if (err == ESP_OK) {
+        ESP_LOGD(TAG, "Streamed %zu byte request body", w.total);
+    }
+    return err;
+}
+
+// Socket timeout for the next network operation: what is left until the
+// deadline, but never more than the stall timeout
+static int stage_timeout_ms(int64_t deadline_us)
+{
+    if (deadline_us == 0) {
+        return CONFIG_GEMINI_HTTP_TIMEOUT_MS;
+    }
+    int64_t left_ms = (deadline_us - esp_timer_get_time()) / 1000;
+    return left_ms > CONFIG_GEMINI_HTTP_TIMEOUT_MS ? CONFIG_GEMINI_HTTP_TIMEOUT_MS : (int)left_ms;
+}
+
+// A network error at (or within a few ms of) the deadline is the deadline
+static esp_err_t stage_err(esp_err_t err, int64_t deadline_us)
+{
+    if (deadline_us && esp_timer_get_time() + DEADLINE_SLACK_US >= deadline_us) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return err;
+}
+
+// Send the request on `client` and wait for the response headers, both
+// bounded by the deadline. Body bytes that arrive with the headers already
+// go through the event handler into ctx->sink.
+static esp_err_t exchange_begin(esp_http_client_handle_t client, const char *url, const char *auth_header,
+                                const request_body_t *body, request_ctx_t *ctx, int64_t deadline_us,
+                                int *status_code)
+{
+    esp_http_client_set_url(client, url);
+    esp_http_client_set_user_data(client, ctx);
+    esp_http_client_set_method(client, HTTP_METHOD_POST);
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    if (auth_header) {
+        esp_http_client_set_header(client, "Authorization", auth_header);
+    } else {
+        esp_http_client_delete_header(client, "Authorization");
+    }
+    // Framing headers are re-added by esp_http_client_open() for this request
+    esp_http_client_delete_header(client, "Content-Length");
+    esp_http_client_delete_header(client, "Transfer-Encoding");
+
+    ctx->start_us = esp_timer_get_time();
+    ctx->connected_us = 0;
+    ctx->sent_us = 0;
+    ctx->headers_us = 0;
+    ctx->done_us = 0;
+    ctx->bytes_up = 0;
+    *status_code = 0;
+
+    if (REQUEST_CANCELLED(ctx)) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    int timeout_ms = stage_timeout_ms(deadline_us);
+    if (timeout_ms <= 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_http_client_set_timeout_ms(client, timeout_ms);
+    bool chunked = (body->cb != NULL);
+    esp_err_t err = esp_http_client_open(client, chunked ? -1 : (int)body->len);
+    if (err != ESP_OK) {
+        return stage_err(err, deadline_us);
+    }
+
+    if (chunked) {
+        err = send_streamed_body(client, body, &ctx->bytes_up);
+    } else {
+        err = send_all(client, body->data, body->len);
+        ctx->bytes_up = body->len;
+    }
+    if (err != ESP_OK) {
+        return stage_err(err, deadline_us);
+    }
+    ctx->sent_us = esp_timer_get_time();
+    if (REQUEST_CANCELLED(ctx)) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    timeout_ms = stage_timeout_ms(deadline_us);
+    if (timeout_ms <= 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_http_client_set_timeout_ms(client, timeout_ms);
+    if (esp_http_client_fetch_headers(client) < 0) {
+        return stage_err(ESP_ERR_HTTP_FETCH_HEADER, deadline_us);
+    }
+    ctx->headers_us = esp_timer_get_time();
+    *status_code = esp_http_client_get_status_code(client);
+    // Once the response has started, only a stall ends it
+    esp_http_client_set_timeout_ms(client, CONFIG_GEMINI_HTTP_TIMEOUT_MS);
+    return ESP_OK;
+}
+
+// Read the rest of the response. The body is delivered through
+// HTTP_EVENT_ON_DATA into ctx->sink; reading here only drives the parser
+// until the body is complete.
+static esp_err_t exchange_body(esp_http_client_handle_t client, request_ctx_t *ctx)
+{
+    char scratch[256];
+    int n = 0;
+    while (ctx->abort_err == ESP_OK && (n = esp_http_client_read(client, scratch, sizeof(scratch))) > 0) {
+        if (REQUEST_CANCELLED(ctx)) {
+            ctx->abort_err = ESP_ERR_NOT_FINISHED;
+        }
+    }
+    ctx->done_us = esp_timer_get_time();
+    if (ctx->abort_err != ESP_OK) {
+        return ctx->abort_err;
+    }
+    if (n < 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// Resolve `host` ahead of a new connection and return how long it took.
+// lwIP caches the answer, so the lookup esp_http_client does itself right
+// after is a table hit and the connect phase no longer includes DNS.
+static int64_t resolve_host(const char *host)
+{
+    int64_t start_us = esp_timer_get_time();
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo *res = NULL;
+    int ret = getaddrinfo(host, NULL, &hints, &res);
+    if (ret != 0 || !res) {
+        ESP_LOGW(TAG, "DNS lookup for %s failed (%d)", host, ret);
+    }
+    if (res) {
+        freeaddrinfo(res);
+    }
+    return esp_timer_get_time() - start_us;
+}
+
+static void record_timing(const gemini_http_timing_t *timing)
+{
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    s_timings[s_timing_seq % GEMINI_HTTP_TIMING_HISTORY] = *timing;
+    s_timing_seq++;
+    xSemaphoreGive(s_pool_lock);
+}
+
+uint32_t gemini_http_timing_seq(void)
+{
+    if (!s_pool_lock) {
+        return 0;
+    }
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    uint32_t seq = s_timing_seq;
+    xSemaphoreGive(s_pool_lock);
+    return seq;
+}
+
+bool gemini_http_get_timing(uint32_t seq, gemini_http_timing_t *timing)
+{
+    if (!s_pool_lock || !timing) {
+        return false;
+    }
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    // Unsigned distance also rejects seq values from the future
+    bool found = (uint32_t)(s_timing_seq - seq - 1) < GEMINI_HTTP_TIMING_HISTORY;
+    if (found) {
+        *timing = s_timings[seq % GEMINI_HTTP_TIMING_HISTORY];
+    }
+    xSemaphoreGive(s_pool_lock);
+    return found;
+}
+
+// Endpoint name: the last path segment, e.g. "text:synthesize" or
+// "gemini-2.0-flash:streamGenerateContent"
+static void url_get_endpoint(const char *url, char *name, size_t name_len)
+{
+    size_t path_len = strcspn(url, "?");
+    const char *start = url;
+    for (size_t i = 0; i < path_len; i++) {
+        if (url[i] == '/') {
+            start = url + i + 1;
+        }
+    }
+    size_t n = (size_t)(url + path_len - start);
+    if (n >= name_len) {
+        n = name_len - 1;
+    }
+    memcpy(name, start, n);
+    name[n] = '\0';
+}
+
+// Find or claim the statistics entry for an endpoint (s_pool_lock held).
+// When the table is full the least used entry is recycled.
+static endpoint_t *endpoint_get(const char *name)
+{
+    endpoint_t *victim = &s_endpoints[0];
+    for (int i = 0; i < ENDPOINT_SLOTS; i++) {
+        endpoint_t *ep = &s_endpoints[i];
+        if (strcmp(ep->name, name) == 0) {
+            return ep;
+        }
+        if (ep->requests < victim->requests) {
+            victim = ep;
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    snprintf(victim->name, sizeof(victim->name), "%s", name);
+    return victim;
+}
+
+// Nearest-rank percentile over the recent first-byte samples (s_pool_lock held)
+static uint32_t endpoint_percentile(const endpoint_t *ep, int pct)
+{
+    uint32_t sorted[ENDPOINT_SAMPLES];
+    size_t n = ep->samples < ENDPOINT_SAMPLES ? ep->samples : ENDPOINT_SAMPLES;
+    if (n == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = ep->first_byte_ms[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    size_t rank = (n * pct + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// One try of a request on one connection
+typedef struct {
+    const char *url;
+    const char *auth_header;
+    const request_body_t *body;
+    int64_t deadline_us;                // Response headers due by then (0: stall timeout only)
+    char host[POOL_HOST_MAX_LEN];
+    char endpoint[GEMINI_HTTP_ENDPOINT_NAME_LEN];
+    pool_slot_t *slot;                  // NULL for a one-off client
+    esp_http_client_handle_t client;
+    bool reused;
+    int64_t start_us;
+    int64_t dns_us;
+    int status;
+    bool evict;                         // May close another host's idle connection
+    bool abandoned;                     // Lost a hedge race: leaves the latency history alone
+    request_ctx_t ctx;
+} attempt_t;
+
+static void attempt_init(attempt_t *a, const char *url, const char *auth_header, const request_body_t *body,
+                         int64_t deadline_us)
+{
+    memset(a, 0, sizeof(*a));
+    a->url = url;
+    a->auth_header = auth_header;
+    a->body = body;
+    a->deadline_us = deadline_us;
+    a->evict = true;
+    url_get_host(url, a->host, sizeof(a->host));
+    url_get_endpoint(url, a->endpoint, sizeof(a->endpoint));
+}
+
+// Take a pooled connection (or a one-off client) and resolve the host if
+// a new connection will be needed
+static esp_err_t attempt_acquire(attempt_t *a)
+{
+    a->start_us = esp_timer_get_time();
+    a->slot = pool_acquire(a->host, a->url, a->evict, false, &a->reused);
+    a->client = a->slot ? a->slot->client : create_client(a->url);
+    if (!a->client) {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client");
+        return ESP_FAIL;
+    }
+    a->dns_us = a->reused ? 0 : resolve_host(a->host);
+    return ESP_OK;
+}
+
+static esp_err_t attempt_headers(attempt_t *a)
+{
+    request_ctx_t *ctx = &a->ctx;
+    esp_err_t err = exchange_begin(a->client, a->url, a->auth_header, a->body, ctx, a->deadline_us, &a->status);
+
+    // A reused connection may have been closed by the server while idle.
+    // That surfaces as a failed write/read with no new connection made; retry
+    // once after forcing a reconnect if the deadline leaves time for it.
+    // Never retry once response data has been handed to the sink.
+    if (err != ESP_OK && err != ESP_ERR_TIMEOUT && a->reused && ctx->connected_us == 0 &&
+        ctx->bytes_down == 0 && ctx->abort_err == ESP_OK && !REQUEST_CANCELLED(ctx)) {
+        ESP_LOGW(TAG, "Pooled connection to %s went stale (%s), reconnecting", a->host, esp_err_to_name(err));
+        esp_http_client_close(a->client);
+        a->reused = false;
+        a->dns_us += resolve_host(a->host);
+        err = exchange_begin(a->client, a->url, a->auth_header, a->body, ctx, a->deadline_us, &a->status);
+        xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+        s_stats.retries++;
+        xSemaphoreGive(s_pool_lock);
+    }
+    return err;
+}
+
+// The attempt's phases as spans on the task that ran it (a hedge has its own)
+static void trace_attempt(const attempt_t *a, const char *endpoint_name)
+{
+    const request_ctx_t *ctx = &a->ctx;
+    int64_t end_us = ctx->done_us ? ctx->done_us : esp_timer_get_time();
+    span_trace_add("http", endpoint_name, a->start_us, end_us);
+    if (a->dns_us) {
+        span_trace_add("dns", NULL, a->start_us, a->start_us + a->dns_us);
+    }
+    if (ctx->connected_us) {
+        span_trace_add("connect", NULL, ctx->start_us, ctx->connected_us);
+    }
+    if (ctx->sent_us) {
+        span_trace_add("upload", NULL, ctx->connected_us ? ctx->connected_us : ctx->start_us, ctx->sent_us);
+    }
+    if (ctx->headers_us) {
+        span_trace_add("wait", NULL, ctx->sent_us, ctx->headers_us);
+    }
+    if (ctx->done_us && ctx->headers_us) {
+        span_trace_add("download", NULL, ctx->headers_us, ctx->done_us);
+    }
+}
+
+// Account for a finished attempt and give its connection back; `keep` only
+// if the exchange completed cleanly
+static void attempt_end(attempt_t *a, esp_err_t err, bool keep)
+{
+    request_ctx_t *ctx = &a->ctx;
+    int64_t elapsed_us = esp_timer_get_time() - a->start_us;
+
+    // Handshake accounting: a new connection reports ON_CONNECTED, so its
+    // handshake cost is (connected - start). A reused one saves roughly what
+    // the original handshake on that slot cost.
+    int64_t handshake_us = ctx->connected_us ? ctx->connected_us - ctx->start_us : 0;
+    int64_t saved_us = 0;
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    s_stats.requests++;
+    if (ctx->connected_us) {
+        s_stats.handshakes++;
+        s_stats.handshake_us_total += handshake_us;
+        if (a->slot) {
+            a->slot->handshake_us = handshake_us;
+        }
+    } else if (a->slot) {
+        s_stats.reused++;
+        saved_us = a->slot->handshake_us;
+        s_stats.saved_us_total += saved_us;
+    }
+    endpoint_t *ep = endpoint_get(a->endpoint);
+    const char *endpoint_name = ep->name;   // Table storage, kept for the trace
+    ep->requests++;
+    if (a->abandoned) {
+        // Its latency is not what the caller saw
+    } else if (ctx->headers_us) {
+        ep->first_byte_ms[ep->samples % ENDPOINT_SAMPLES] = (uint32_t)((ctx->headers_us - a->start_us) / 1000);
+        ep->samples++;
+    } else if (err == ESP_ERR_TIMEOUT) {
+        ep->deadline_misses++;
+    }
+    xSemaphoreGive(s_pool_lock);
+
+    gemini_http_timing_t timing = {
+        .status = a->status,
+        .err = err,
+        .reused = a->reused && ctx->connected_us == 0,
+        .start_us = a->start_us,
+        .dns_us = a->dns_us,
+        .connect_us = handshake_us,
+        .total_us = elapsed_us,
+        .bytes_up = ctx->bytes_up,
+        .bytes_down = ctx->bytes_down,
+    };
+    // Truncated to the public field
+    snprintf(timing.host, sizeof(timing.host), "%.*s", (int)sizeof(timing.host) - 1, a->host);
+    if (ctx->sent_us) {
+        timing.upload_us = ctx->sent_us - (ctx->connected_us ? ctx->connected_us : ctx->start_us);
+    }
+    if (ctx->headers_us) {
+        timing.ttfb_us = ctx->headers_us - ctx->sent_us;
+    }
+    if (ctx->done_us && ctx->headers_us) {
+        timing.transfer_us = ctx->done_us - ctx->headers_us;
+    }
+    record_timing(&timing);
+    trace_attempt(a, endpoint_name);
+
+    if (ctx->connected_us) {
+        ESP_LOGI(TAG, "HTTP response: %d (took %" PRId64 " ms, new connection to %s: dns %" PRId64
+                 ", connect %" PRId64 ", upload %" PRId64 ", ttfb %" PRId64 ", transfer %" PRId64 " ms; %zu B up, %zu B down)",
+                 a->status, elapsed_us / 1000, a->host, a->dns_us / 1000, handshake_us / 1000,
+                 timing.upload_us / 1000, timing.ttfb_us / 1000, timing.transfer_us / 1000,
+                 timing.bytes_up, timing.bytes_down);
+    } else {
+        ESP_LOGI(TAG, "HTTP response: %d (took %" PRId64 " ms, reused connection to %s, saved ~%" PRId64
+                 " ms: upload %" PRId64 ", ttfb %" PRId64 ", transfer %" PRId64 " ms; %zu B up, %zu B down)",
+                 a->status, elapsed_us / 1000, a->host, saved_us / 1000,
+                 timing.upload_us / 1000, timing.ttfb_us / 1000, timing.transfer_us / 1000,
+                 timing.bytes_up, timing.bytes_down);
+    }
+
+    if (a->slot) {
+        pool_release(a->slot, keep);
+    } else {
+        esp_http_client_cleanup(a->client);
+    }
+}
+
+// What the caller gets back for a finished attempt
+static esp_err_t attempt_result(const attempt_t *a, esp_err_t err, const gemini_cancel_t *cancel)
+{
+    if (err == ESP_ERR_NOT_FINISHED && cancel && cancel->cancelled) {
+        ESP_LOGI(TAG, "Request to %s cancelled", a->host);
+        return err;
+    }
+    if (err == ESP_ERR_TIMEOUT) {
+        ESP_LOGE(TAG, "No response from %s within the request deadline", a->endpoint);
+        return err;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP POST failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (a->status / 100 != 2) {
+        ESP_LOGE(TAG, "HTTP request failed with status %d", a->status);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_http_init(void)
+{
+    if (s_pool_lock) {
+        return ESP_OK;
+    }
+    if (gemini_segbuf_pool_init() != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_pool_lock = xSemaphoreCreateMutex();
+    if (!s_pool_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(s_slots, 0, sizeof(s_slots));
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(s_endpoints, 0, sizeof(s_endpoints));
+    ESP_LOGI(TAG, "HTTPS connection pool ready (%d slots, idle timeout %d ms)",
+             CONFIG_GEMINI_HTTP_POOL_SIZE, CONFIG_GEMINI_HTTP_POOL_IDLE_TIMEOUT_MS);
+    return ESP_OK;
+}
+
+static esp_err_t segbuf_sink_write(const uint8_t *data, size_t len, void *ctx)
+{
+    return gemini_segbuf_append((gemini_segbuf_t *)ctx, data, len);
+}
+
+static esp_err_t run_direct(const char *url, const char *auth_header, const request_body_t *body,
+                            const response_sink_t *sink, const gemini_cancel_t *cancel, int64_t deadline_us)
+{
+    attempt_t a;
+    attempt_init(&a, url, auth_header, body, deadline_us);
+    a.ctx.sink = *sink;
+    a.ctx.cancel = cancel;
+    esp_err_t err = attempt_acquire(&a);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = attempt_headers(&a);
+    if (err == ESP_OK) {
+        err = exchange_body(a.client, &a.ctx);
+    }
+    attempt_end(&a, err, err == ESP_OK);
+    return attempt_result(&a, err, cancel);
+}
+
+#if CONFIG_GEMINI_HTTP_HEDGE
+// A hedged request: the same small body sent on up to two connections, each
+// driven to its response headers by a task of its own. The first 2xx
+// response wins and its body is read on the caller's task; the other attempt
+// is abandoned and cleans up after itself when its socket gives up (by the
+// deadline at the latest), so everything it touches lives in here.
+typedef struct hedge hedge_t;
+
+typedef struct {
+    hedge_t *hedge;
+    int index;
+    attempt_t attempt;
+    gemini_segbuf_t early;      // Body bytes that arrived along with the headers
+    esp_err_t err;
+    bool done;                  // Reached its headers or failed (s_pool_lock)
+} hedge_attempt_t;
+
+struct hedge {
+    hedge_t *next;              // In s_hedges while referenced (s_pool_lock)
+    SemaphoreHandle_t event;    // Given by each attempt when it is done
+    gemini_cancel_t abandon;    // Attempts still running are no longer wanted
+    int refs;                   // Caller + running attempts (s_pool_lock)
+    int winner;                 // Attempt index, -1 until one succeeds (s_pool_lock)
+    request_body_t body;
+    hedge_attempt_t attempts[2];
+    char strings[];             // Copies of the URL, auth header and body
+};
+
+// Hedges still referenced, so deinit can abandon their attempts, and the
+// attempt tasks still running, which deinit waits for before the pool goes
+static hedge_t *s_hedges = NULL;
+static int s_hedge_tasks = 0;
+
+static void hedge_unref(hedge_t *h)
+{
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    bool last = (--h->refs == 0);
+    if (last) {
+        for (hedge_t **p = &s_hedges; *p; p = &(*p)->next) {
+            if (*p == h) {
+                *p = h->next;
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(s_pool_lock);
+    if (last) {
+        vSemaphoreDelete(h->event);
+        free(h);
+    }
+}
+
+static void hedge_attempt_task(void *arg)
+{
+    hedge_attempt_t *ha = (hedge_attempt_t *)arg;
+    hedge_t *h = ha->hedge;
+    attempt_t *a = &ha->attempt;
+
+    esp_err_t err = attempt_acquire(a);
+    if (err == ESP_OK) {
+        err = attempt_headers(a);
+    }
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    bool won = (err == ESP_OK && a->status / 100 == 2 && h->winner < 0 && !h->abandon.cancelled);
+    if (won) {
+        h->winner = ha->index;
+    }
+    a->abandoned = !won && (h->winner >= 0 || h->abandon.cancelled);
+    ha->err = err;
+    ha->done = true;
+    xSemaphoreGive(s_pool_lock);
+    xSemaphoreGive(h->event);
+
+    // The winner is finished by the caller; anything else ends here, and its
+    // connection is dropped since the response was not read
+    if (!won) {
+        if (a->client) {
+            attempt_end(a, a->abandoned ? ESP_ERR_NOT_FINISHED : err, false);
+        }
+        gemini_segbuf_release(&ha->early);
+    }
+    hedge_unref(h);
+    // Last touch of shared state: deinit may tear the pool down after this
+    __atomic_fetch_sub(&s_hedge_tasks, 1, __ATOMIC_ACQ_REL);
+    vTaskDelete(NULL);
+}
+
+static bool hedge_launch(hedge_t *h, int index)
+{
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    h->refs++;
+    xSemaphoreGive(s_pool_lock);
+    __atomic_fetch_add(&s_hedge_tasks, 1, __ATOMIC_ACQ_REL);
+    if (xTaskCreate(hedge_attempt_task, "gemini_hedge", CONFIG_GEMINI_HTTP_HEDGE_STACK_SIZE,
+                    &h->attempts[index], uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+        ESP_LOGW(TAG, "No memory for a request task");
+        __atomic_fetch_sub(&s_hedge_tasks, 1, __ATOMIC_ACQ_REL);
+        xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+        h->refs--;
+        xSemaphoreGive(s_pool_lock);
+        return false;
+    }
+    return true;
+}
+
+// How long the first attempt gets before the duplicate is sent: the
+// endpoint's p95 time to first byte once there is enough history
+static int64_t hedge_delay_us(const char *endpoint)
+{
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    endpoint_t *ep = endpoint_get(endpoint);
+    uint32_t ms = ep->samples >= HEDGE_MIN_SAMPLES ? endpoint_percentile(ep, 95) : CONFIG_GEMINI_HTTP_HEDGE_DELAY_MS;
+    xSemaphoreGive(s_pool_lock);
+    if (ms < HEDGE_MIN_DELAY_MS) {
+        ms = HEDGE_MIN_DELAY_MS;
+    }
+    return (int64_t)ms * 1000;
+}
+
+// Worth sending the duplicate right away: the first attempt failed in a way
+// a second connection might not (network error, 5xx)
+static bool hedge_retryable(const hedge_attempt_t *ha)
+{
+    if (ha->err == ESP_ERR_TIMEOUT || ha->err == ESP_ERR_NOT_FINISHED) {
+        return false;
+    }
+    return ha->err != ESP_OK || ha->attempt.status >= 500;
+}
+
+static esp_err_t run_hedged(const char *url, const char *auth_header, const request_body_t *body,
+                            const response_sink_t *sink, const gemini_cancel_t *cancel, int64_t deadline_us)
+{
+    size_t url_len = strlen(url) + 1;
+    size_t auth_len = auth_header ? strlen(auth_header) + 1 : 0;
+    // Heap, not the turn arena: an abandoned attempt holds this until its
+    // socket gives up, often after the turn has ended, and a live block
+    // would keep the arena from being emptied for the next turn
+    hedge_t *h = calloc(1, sizeof(*h) + url_len + auth_len + body->len);
+    if (!h) {
+        return ESP_ERR_NO_MEM;
+    }
+    h->event = xSemaphoreCreateCounting(2, 0);
+    if (!h->event) {
+        free(h);
+        return ESP_ERR_NO_MEM;
+    }
+    char *url_copy = h->strings;
+    memcpy(url_copy, url, url_len);
+    char *auth_copy = auth_header ? url_copy + url_len : NULL;
+    if (auth_copy) {
+        memcpy(auth_copy, auth_header, auth_len);
+    }
+    char *body_copy = url_copy + url_len + auth_len;
+    memcpy(body_copy, body->data, body->len);
+    h->body.data = body_copy;
+    h->body.len = body->len;
+    h->refs = 1;
+    h->winner = -1;
+    for (int i = 0; i < 2; i++) {
+        hedge_attempt_t *ha = &h->attempts[i];
+        ha->hedge = h;
+        ha->index = i;
+        attempt_init(&ha->attempt, url_copy, auth_copy, &h->body, deadline_us);
+        ha->attempt.ctx.sink = (response_sink_t){ .write = segbuf_sink_write, .ctx = &ha->early };
+        ha->attempt.ctx.cancel = &h->abandon;
+    }
+    // The duplicate must not cost the next stage of the turn its open
+    // connection while the first attempt still holds one
+    h->attempts[1].attempt.evict = false;
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    h->next = s_hedges;
+    s_hedges = h;
+    xSemaphoreGive(s_pool_lock);
+
+    const char *endpoint = h->attempts[0].attempt.endpoint;
+    int64_t start_us = esp_timer_get_time();
+    int64_t hedge_at = start_us + hedge_delay_us(endpoint);
+    if (!hedge_launch(h, 0)) {
+        hedge_unref(h);
+        return run_direct(url, auth_header, body, sink, cancel, deadline_us);
+    }
+    int launched = 1;
+
+    esp_err_t err = ESP_FAIL;
+    int winner = -1;
+    for (;;) {
+        int done = 0;
+        xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+        winner = h->winner;
+        for (int i = 0; i < launched; i++) {
+            done += h->attempts[i].done ? 1 : 0;
+        }
+        xSemaphoreGive(s_pool_lock);
+        if (winner >= 0) {
+            break;
+        }
+        int64_t now = esp_timer_get_time();
+        if (cancel && cancel->cancelled) {
+            err = ESP_ERR_NOT_FINISHED;
+            break;
+        }
+        if (deadline_us && now >= deadline_us) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        bool primary_failed = (done == 1 && hedge_retryable(&h->attempts[0]));
+        if (launched == 1 && (now >= hedge_at || primary_failed)) {
+            ESP_LOGW(TAG, "%s: %s after %" PRId64 " ms, sending a duplicate request",
+                     endpoint, primary_failed ? "first attempt failed" : "no response yet",
+                     (now - start_us) / 1000);
+            if (hedge_launch(h, 1)) {
+                launched = 2;
+                xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+                endpoint_get(endpoint)->hedged++;
+                xSemaphoreGive(s_pool_lock);
+                continue;
+            }
+            hedge_at = INT64_MAX;
+        }
+        if (done == launched) {
+            break;
+        }
+        int64_t wake_us = now + HEDGE_POLL_US;
+        if (launched == 1 && hedge_at < wake_us) {
+            wake_us = hedge_at;
+        }
+        if (deadline_us && deadline_us < wake_us) {
+            wake_us = deadline_us;
+        }
+        xSemaphoreTake(h->event, pdMS_TO_TICKS((wake_us - now + 999) / 1000) + 1);
+    }
+
+    // From here on no attempt can win; the winner's task has already exited
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    h->abandon.cancelled = true;
+    winner = h->winner;
+    if (winner == 1) {
+        endpoint_get(endpoint)->hedge_wins++;
+    } else if (err == ESP_ERR_TIMEOUT) {
+        endpoint_get(endpoint)->deadline_misses++;
+    }
+    xSemaphoreGive(s_pool_lock);
+
+    if (winner >= 0) {
+        hedge_attempt_t *ha = &h->attempts[winner];
+        attempt_t *a = &ha->attempt;
+        if (winner == 1) {
+            ESP_LOGI(TAG, "%s: duplicate request answered first", endpoint);
+        }
+        a->ctx.sink = *sink;
+        a->ctx.cancel = cancel;
+        err = ESP_OK;
+        if (ha->early.len > 0) {
+            const char *early = gemini_segbuf_str(&ha->early);
+            err = early ? sink->write((const uint8_t *)early, ha->early.len, sink->ctx) : ESP_ERR_NO_MEM;
+            a->ctx.abort_err = err;
+        }
+        gemini_segbuf_release(&ha->early);
+        if (err == ESP_OK) {
+            err = exchange_body(a->client, &a->ctx);
+        }
+        attempt_end(a, err, err == ESP_OK);
+        err = attempt_result(a, err, cancel);
+    } else if (err == ESP_FAIL) {
+        // Every attempt failed; report the first one
+        const hedge_attempt_t *ha = &h->attempts[0];
+        err = attempt_result(&ha->attempt, ha->err, cancel);
+    } else {
+        attempt_result(&h->attempts[0].attempt, err, cancel);
+    }
+    hedge_unref(h);
+    return err;
+}
+#endif
+
+static esp_err_t run_request(const char *url, const char *auth_header, const request_body_t *body,
+                             const response_sink_t *sink, const gemini_http_opts_t *opts)
+{
+    if (!s_pool_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const gemini_cancel_t *cancel = opts ? opts->cancel : NULL;
+    int64_t deadline_us = opts ? opts->deadline_us : 0;
+#if CONFIG_GEMINI_HTTP_HEDGE
+    // Only small static bodies are duplicated; a streamed upload would
+    // compete with itself for the same airtime
+    if (opts && opts->hedge && !body->cb) {
+        return run_hedged(url, auth_header, body, sink, cancel, deadline_us);
+    }
+#endif
+    return run_direct(url, auth_header, body, sink, cancel, deadline_us);
+}
+
+esp_err_t gemini_http_post_json(const char *url, const char *json_data, const char *auth_header,
+                                gemini_segbuf_t *response, const gemini_http_opts_t *opts)
+{
+    if (!url || !json_data || !response) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    request_body_t body = {
+        .data = json_data,
+        .len = strlen(json_data),
+    };
+    response_sink_t sink = { .write = segbuf_sink_write, .ctx = response };
+    return run_request(url, auth_header, &body, &sink, opts);
+}
+
+esp_err_t gemini_http_post_json_cb(const char *url, const char *json_data, const char *auth_header,
+                                   gemini_http_data_cb_t on_data, void *ctx, const gemini_http_opts_t *opts)
+{
+    if (!url || !json_data || !on_data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    request_body_t body = {
+        .data = json_data,
+        .len = strlen(json_data),
+    };
+    response_sink_t sink = { .write = on_data, .ctx = ctx };
+    return run_request(url, auth_header, &body, &sink, opts);
+}
+
+esp_err_t gemini_http_post_stream(const char *url, const char *auth_header,
+                                  gemini_http_body_cb_t body_cb, void *body_ctx,
+                                  gemini_segbuf_t *response, const gemini_http_opts_t *opts)
+{
+    if (!url || !body_cb || !response) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    request_body_t body = {
+        .cb = body_cb,
+        .cb_ctx = body_ctx,
+    };
+    response_sink_t sink = { .write = segbuf_sink_write, .ctx = response };
+    return run_request(url, auth_header, &body, &sink, opts);
+}
+
+esp_err_t gemini_http_post_stream_cb(const char *url, const char *auth_header,
+                                     gemini_http_body_cb_t body_cb, void *body_ctx,
+                                     gemini_http_data_cb_t on_data, void *ctx,
+                                     const gemini_http_opts_t *opts)
+{
+    if (!url || !body_cb || !on_data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    request_body_t body = {
+        .cb = body_cb,
+        .cb_ctx = body_ctx,
+    };
+    response_sink_t sink = { .write = on_data, .ctx = ctx };
+    return run_request(url, auth_header, &body, &sink, opts);
+}
+
+// The warm-up GET's response (an error page for "/") is read and dropped
+static esp_err_t discard_sink_write(const uint8_t *data, size_t len, void *ctx)
+{
+    return ESP_OK;
+}
+
+static esp_err_t prewarm_exchange(esp_http_client_handle_t client, const char *url, request_ctx_t *ctx)
+{
+    esp_http_client_set_url(client, url);
+    esp_http_client_set_user_data(client, ctx);
+    esp_http_client_set_method(client, HTTP_METHOD_GET);
+    esp_http_client_delete_header(client, "Authorization");
+    esp_http_client_delete_header(client, "Content-Type");
+    esp_http_client_delete_header(client, "Content-Length");
+    esp_http_client_delete_header(client, "Transfer-Encoding");
+    // Requests to the host wait for this, so it gets no longer than they would
+    esp_http_client_set_timeout_ms(client, CONFIG_GEMINI_HTTP_FIRST_BYTE_TIMEOUT_MS);
+
+    ctx->start_us = esp_timer_get_time();
+    ctx->connected_us = 0;
+    ctx->headers_us = 0;
+    ctx->done_us = 0;
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (esp_http_client_fetch_headers(client) < 0) {
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    ctx->headers_us = esp_timer_get_time();
+    return exchange_body(client, ctx);
+}
+
+esp_err_t gemini_http_prewarm(const char *url)
+{
+    if (!s_pool_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!url) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    char host[POOL_HOST_MAX_LEN];
+    url_get_host(url, host, sizeof(host));
+    char root[POOL_HOST_MAX_LEN + 16];
+    snprintf(root, sizeof(root), "https://%s/", host);
+
+    bool reused = false;
+    pool_slot_t *slot = pool_acquire(host, root, false, true, &reused);
+    if (!slot) {
+        ESP_LOGW(TAG, "No free connection to warm up for %s", host);
+        return ESP_ERR_NOT_FOUND;
+    }
+    request_ctx_t ctx = {
+        .sink = { .write = discard_sink_write },
+        .probe = true,
+    };
+    int64_t start_us = esp_timer_get_time();
+    int64_t dns_us = reused ? 0 : resolve_host(host);
+    esp_err_t err = prewarm_exchange(slot->client, root, &ctx);
+    if (err != ESP_OK && reused && ctx.connected_us == 0) {
+        // Closed by the server while idle: better found out now than by
+        // the request
+        esp_http_client_close(slot->client);
+        dns_us += resolve_host(host);
+        err = prewarm_exchange(slot->client, root, &ctx);
+    }
+    int64_t end_us = esp_timer_get_time();
+    int64_t handshake_us = ctx.connected_us ? ctx.connected_us - ctx.start_us : 0;
+
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    if (ctx.connected_us) {
+        s_stats.handshakes++;
+        s_stats.handshake_us_total += handshake_us;
+        s_stats.prewarmed++;
+        slot->handshake_us = handshake_us;
+    }
+    xSemaphoreGive(s_pool_lock);
+
+    span_trace_add("prewarm", host, start_us, end_us);
+    if (dns_us) {
+        span_trace_add("dns", NULL, start_us, start_us + dns_us);
+    }
+    if (ctx.connected_us) {
+        span_trace_add("connect", NULL, ctx.start_us, ctx.connected_us);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Warm-up of %s failed: %s", host, esp_err_to_name(err));
+    } else if (ctx.connected_us) {
+        ESP_LOGI(TAG, "Opened connection to %s ahead of use (dns %" PRId64 ", connect %" PRId64 " ms)",
+                 host, dns_us / 1000, handshake_us / 1000);
+    } else {
+        ESP_LOGD(TAG, "Connection to %s still open (%" PRId64 " ms round trip)", host,
+                 (end_us - start_us) / 1000);
+    }
+    pool_release(slot, err == ESP_OK);
+    return err;
+}
+
+size_t gemini_http_get_endpoint_stats(gemini_http_endpoint_stats_t *stats, size_t max)
+{
+    if (!s_pool_lock || !stats) {
+        return 0;
+    }
+    size_t n = 0;
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    for (int i = 0; i < ENDPOINT_SLOTS && n < max; i++) {
+        const endpoint_t *ep = &s_endpoints[i];
+        if (ep->name[0] == '\0') {
+            continue;
+        }
+        gemini_http_endpoint_stats_t *out = &stats[n++];
+        memset(out, 0, sizeof(*out));
+        memcpy(out->endpoint, ep->name, sizeof(out->endpoint));   // Same length, terminated
+        out->requests = ep->requests;
+        out->hedged = ep->hedged;
+        out->hedge_wins = ep->hedge_wins;
+        out->deadline_misses = ep->deadline_misses;
+        out->samples = ep->samples < ENDPOINT_SAMPLES ? ep->samples : ENDPOINT_SAMPLES;
+        out->p50_ms = endpoint_percentile(ep, 50);
+        out->p95_ms = endpoint_percentile(ep, 95);
+        out->p99_ms = endpoint_percentile(ep, 99);
+    }
+    xSemaphoreGive(s_pool_lock);
+    return n;
+}
+
+void gemini_http_get_pool_stats(gemini_http_pool_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!s_pool_lock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_pool_lock);
+}
+
+void gemini_http_deinit(void)
+{
+    if (!s_pool_lock) {
+        return;
+    }
+#if CONFIG_GEMINI_HTTP_HEDGE
+    // Attempts that lost a race may still be waiting for headers on a pooled
+    // connection; they give up at their next check, or when the socket times
+    // out at the latest, and use the pool lock until they exit
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    for (hedge_t *h = s_hedges; h; h = h->next) {
+        h->abandon.cancelled = true;
+    }
+    xSemaphoreGive(s_pool_lock);
+    if (__atomic_load_n(&s_hedge_tasks, __ATOMIC_ACQUIRE) > 0) {
+        ESP_LOGI(TAG, "Waiting for %d abandoned request(s) to finish",
+                 __atomic_load_n(&s_hedge_tasks, __ATOMIC_ACQUIRE));
+        while (__atomic_load_n(&s_hedge_tasks, __ATOMIC_ACQUIRE) > 0) {
+            vTaskDelay(pdMS_TO_TICKS(HEDGE_EXIT_POLL_MS));
+        }
+    }
+#endif
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    for (int i = 0; i < CONFIG_GEMINI_HTTP_POOL_SIZE; i++) {
+        if (s_slots[i].in_use) {
+            ESP_LOGW(TAG, "Closing connection to %s while still in use", s_slots[i].host);
+        }
+        slot_close(&s_slots[i]);
+    }
+    xSemaphoreGive(s_pool_lock);
+    vSemaphoreDelete(s_pool_lock);
+    s_pool_lock = NULL;
+    ESP_LOGI(TAG, "HTTPS connection pool closed");
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "esp_err.h"
+#include "gemini_api.h"
+#include "gemini_segbuf.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Internal HTTP layer shared by the Gemini STT / LLM / TTS calls.
+ *
+ * Requests go through a small pool of persistent esp_http_client handles keyed
+ * by host, so consecutive calls to the same endpoint reuse the open TLS
+ * session instead of paying DNS + TCP + TLS (and certificate bundle setup)
+ * every time.
+ *
+ * Every request can carry a deadline for its response headers. With hedging
+ * enabled a small request that has not seen its first byte by the endpoint's
+ * p95 is sent again on a second connection and the first answer wins.
+ */
+
+/**
+ * Per-request options (all fields optional; NULL options mean none)
+ */
+typedef struct {
+    const gemini_cancel_t *cancel;  // Cancellation token (NULL for none)
+    int64_t deadline_us;            // esp_timer time by which the response must start (0: stall timeout only)
+    bool hedge;                     // Duplicate the request on a second connection when it is slow to answer
+} gemini_http_opts_t;
+
+/**
+ * Streamed response consumer
+ * Called from the HTTP event handler with de-chunked body bytes as they
+ * arrive, whether the server framed the body with Content-Length or chunked
+ * transfer encoding (only for 2xx responses). The bytes point into the
+ * client's receive buffer and are valid only during the call.
+ * @param data: Body bytes
+ * @param len: Number of bytes
+ * @param ctx: User context
+ * @return ESP_OK to continue; any error aborts the request and is returned
+ */
+typedef esp_err_t (*gemini_http_data_cb_t)(const uint8_t *data, size_t len, void *ctx);
+
+/**
+ * Streaming request body writer
+ * Bytes written are framed as HTTP/1.1 chunks of a fixed size, so the body
+ * never has to exist in memory as a whole.
+ */
+typedef struct gemini_http_writer gemini_http_writer_t;
+
+/**
+ * Body producer for gemini_http_post_stream()
+ * May be called more than once per request (retry on a stale pooled
+ * connection), so it must regenerate the body from its source every time.
+ * @param writer: Writer to emit the body into
+ * @param ctx: User context
+ * @return ESP_OK on success
+ */
+typedef esp_err_t (*gemini_http_body_cb_t)(gemini_http_writer_t *writer, void *ctx);
+
+/**
+ * Append bytes to a streamed request body
+ * @param writer: Writer passed to the body callback
+ * @param data: Bytes to send
+ * @param len: Number of bytes
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_http_writer_write(gemini_http_writer_t *writer, const void *data, size_t len);
+
+/**
+ * Initialize the connection pool (idempotent)
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_http_init(void);
+
+/**
+ * POST a JSON body and collect the response
+ * Reuses a pooled connection to the URL's host when one is idle, and retries
+ * once on a fresh connection if the server closed a reused one.
+ * @param url: Full request URL (https://host/path?query)
+ * @param json_data: NUL-terminated JSON body
+ * @param auth_header: Optional Authorization header value (NULL for none)
+ * @param response: Zero-initialized response buffer (caller releases it with
+ *                  gemini_segbuf_release(), also on failure)
+ * @param opts: Request options (NULL for none)
+ * @return ESP_OK on 2xx response, ESP_ERR_NOT_FINISHED if cancelled,
+ *         ESP_ERR_TIMEOUT if the response did not start by the deadline
+ */
+esp_err_t gemini_http_post_json(const char *url, const char *json_data, const char *auth_header,
+                                gemini_segbuf_t *response, const gemini_http_opts_t *opts);
+
+/**
+ * POST a JSON body and hand the response to a consumer as it arrives
+ * Used for server-sent events, where the body must be processed before the
+ * server finishes sending it.
+ * @param url: Full request URL
+ * @param json_data: NUL-terminated JSON body
+ * @param auth_header: Optional Authorization header value (NULL for none)
+ * @param on_data: Response consumer
+ * @param ctx: Context for on_data
+ * @param opts: Request options (NULL for none). A hedged request only
+ *              calls on_data from the connection that answered first.
+ * @return ESP_OK on 2xx response fully consumed, ESP_ERR_NOT_FINISHED if cancelled,
+ *         ESP_ERR_TIMEOUT if the response did not start by the deadline
+ */
+esp_err_t gemini_http_post_json_cb(const char *url, const char *json_data, const char *auth_header,
+                                   gemini_http_data_cb_t on_data, void *ctx, const gemini_http_opts_t *opts);
+
+/**
+ * POST a JSON body produced incrementally, using chunked transfer encoding
+ * Peak memory is one chunk buffer regardless of body size.
+ * @param url: Full request URL
+ * @param auth_header: Optional Authorization header value (NULL for none)
+ * @param body_cb: Body producer
+ * @param body_ctx: Context for body_cb
+ * @param response: Zero-initialized response buffer (caller releases it with
+ *                  gemini_segbuf_release(), also on failure)
+ * @param opts: Request options (NULL for none; streamed bodies are never hedged)
+ * @return ESP_OK on 2xx response, ESP_ERR_TIMEOUT if the response did not
+ *         start by the deadline
+ */
+esp_err_t gemini_http_post_stream(const char *url, const char *auth_header,
+                                  gemini_http_body_cb_t body_cb, void *body_ctx,
+                                  gemini_segbuf_t *response, const gemini_http_opts_t *opts);
+
+/**
+ * POST a streamed JSON body and hand the response to a consumer as it arrives
+ * Combines gemini_http_post_stream() and gemini_http_post_json_cb(): used
+ * when a large upload (audio) gets a streamed answer (server-sent events).
+ * @param url: Full request URL
+ * @param auth_header: Optional Authorization header value (NULL for none)
+ * @param body_cb: Body producer
+ * @param body_ctx: Context for body_cb
+ * @param on_data: Response consumer
+ * @param ctx: Context for on_data
+ * @param opts: Request options (NULL for none; streamed bodies are never hedged)
+ * @return ESP_OK on 2xx response fully consumed, ESP_ERR_NOT_FINISHED if cancelled,
+ *         ESP_ERR_TIMEOUT if the response did not start by the deadline
+ */
+esp_err_t gemini_http_post_stream_cb(const char *url, const char *auth_header,
+                                     gemini_http_body_cb_t body_cb, void *body_ctx,
+                                     gemini_http_data_cb_t on_data, void *ctx,
+                                     const gemini_http_opts_t *opts);
+
+/**
+ * Open a pooled connection to the host of `url` ahead of a request
+ * Resolves the host and completes the TCP connect and TLS handshake with a
+ * GET of "/" (any status will do; the body is dropped), then leaves the
+ * connection idle in the pool for the next request to that host. An idle
+ * connection the host already has gets the same GET instead, which finds
+ * out whether the server has closed it and restarts its keep-alive timer.
+ * Blocks for the exchange; never closes another host's idle connection.
+ * @param url: Any URL on the host
+ * @return ESP_OK when an open connection to the host is idle in the pool,
+ *         ESP_ERR_NOT_FOUND when no pool slot is free for it
+ */
+esp_err_t gemini_http_prewarm(const char *url);
+
+/**
+ * Snapshot connection reuse statistics
+ * @param stats: Output statistics
+ */
+void gemini_http_get_pool_stats(gemini_http_pool_stats_t *stats);
+
+/**
+ * Snapshot per-endpoint latency statistics
+ * @param stats: Output array
+ * @param max: Capacity of stats
+ * @return Number of endpoints written
+ */
+size_t gemini_http_get_endpoint_stats(gemini_http_endpoint_stats_t *stats, size_t max);
+
+/**
+ * Sequence number the next completed request will get
+ * @return Sequence number
+ */
+uint32_t gemini_http_timing_seq(void);
+
+/**
+ * Copy the timing of one completed request
+ * @param seq: Sequence number of the request
+ * @param timing: Output timing
+ * @return false if the request has not completed yet or fell out of the
+ *         last GEMINI_HTTP_TIMING_HISTORY requests
+ */
+bool gemini_http_get_timing(uint32_t seq, gemini_http_timing_t *timing);
+
+/**
+ * Close all pooled connections and free the pool
+ */
+void gemini_http_deinit(void);
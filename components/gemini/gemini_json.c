@@ -0,0 +1,213 @@
+#include "gemini_json.h"
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+// Nothing is output after an error, but len keeps counting so a caller whose
+// buffer was too small learns the size it needs
+static void emit(gemini_json_writer_t *w, const char *data, size_t len)
+{
+    if (w->err == ESP_OK && len > 0) {
+        if (w->sink) {
+            w->err = w->sink(data, len, w->sink_ctx);
+        } else if (w->buf && w->len + len < w->cap) {
+            memcpy(w->buf + w->len, data, len);
+        } else if (w->buf) {
+            w->err = ESP_ERR_INVALID_SIZE;
+        }
+    }
+    w->len += len;
+}
+
+// Comma before every value but the first at this level; a value right after
+// its key needs none
+static void value_prefix(gemini_json_writer_t *w)
+{
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    uint32_t bit = 1u << w->depth;
+    if (w->has_items & bit) {
+        emit(w, ",", 1);
+    }
+    w->has_items |= bit;
+}
+
+static void push(gemini_json_writer_t *w, bool object)
+{
+    value_prefix(w);
+    emit(w, object ? "{" : "[", 1);
+    if (w->depth + 1 >= GEMINI_JSON_MAX_DEPTH) {
+        if (w->err == ESP_OK) {
+            w->err = ESP_ERR_INVALID_STATE;
+        }
+        return;
+    }
+    w->depth++;
+    uint32_t bit = 1u << w->depth;
+    w->has_items &= ~bit;
+    w->is_object = object ? (w->is_object | bit) : (w->is_object & ~bit);
+}
+
+static void pop(gemini_json_writer_t *w, bool object)
+{
+    uint32_t bit = 1u << w->depth;
+    if (w->depth == 0 || ((w->is_object & bit) != 0) != object || w->after_key) {
+        if (w->err == ESP_OK) {
+            w->err = ESP_ERR_INVALID_STATE;
+        }
+        return;
+    }
+    w->depth--;
+    emit(w, object ? "}" : "]", 1);
+}
+
+// Escape in runs: everything up to the next character that needs escaping
+// goes out in one piece
+static void emit_escaped(gemini_json_writer_t *w, const char *str)
+{
+    const char *run = str;
+    for (const char *p = str; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        emit(w, run, (size_t)(p - run));
+        run = p + 1;
+        char esc[8];
+        switch (c) {
+        case '"':  emit(w, "\\\"", 2); break;
+        case '\\': emit(w, "\\\\", 2); break;
+        case '\n': emit(w, "\\n", 2); break;
+        case '\r': emit(w, "\\r", 2); break;
+        case '\t': emit(w, "\\t", 2); break;
+        case '\b': emit(w, "\\b", 2); break;
+        case '\f': emit(w, "\\f", 2); break;
+        default:
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            emit(w, esc, 6);
+            break;
+        }
+    }
+    emit(w, run, strlen(run));
+}
+
+void gemini_json_init_buffer(gemini_json_writer_t *w, char *buf, size_t cap)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = cap > 0 ? buf : NULL;
+    w->cap = cap;
+}
+
+void gemini_json_init_sink(gemini_json_writer_t *w, gemini_json_sink_t sink, void *ctx)
+{
+    memset(w, 0, sizeof(*w));
+    w->sink = sink;
+    w->sink_ctx = ctx;
+}
+
+void gemini_json_object_begin(gemini_json_writer_t *w)
+{
+    push(w, true);
+}
+
+void gemini_json_object_end(gemini_json_writer_t *w)
+{
+    pop(w, true);
+}
+
+void gemini_json_array_begin(gemini_json_writer_t *w)
+{
+    push(w, false);
+}
+
+void gemini_json_array_end(gemini_json_writer_t *w)
+{
+    pop(w, false);
+}
+
+void gemini_json_key(gemini_json_writer_t *w, const char *key)
+{
+    if (!(w->is_object & (1u << w->depth)) || w->after_key) {
+        if (w->err == ESP_OK) {
+            w->err = ESP_ERR_INVALID_STATE;
+        }
+        return;
+    }
+    value_prefix(w);
+    emit(w, "\"", 1);
+    emit_escaped(w, key);
+    emit(w, "\":", 2);
+    w->after_key = true;
+}
+
+void gemini_json_string(gemini_json_writer_t *w, const char *str)
+{
+    value_prefix(w);
+    emit(w, "\"", 1);
+    emit_escaped(w, str ? str : "");
+    emit(w, "\"", 1);
+}
+
+void gemini_json_int(gemini_json_writer_t *w, int64_t value)
+{
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%" PRId64, value);
+    value_prefix(w);
+    emit(w, num, (size_t)n);
+}
+
+void gemini_json_bool(gemini_json_writer_t *w, bool value)
+{
+    value_prefix(w);
+    emit(w, value ? "true" : "false", value ? 4 : 5);
+}
+
+void gemini_json_string_begin(gemini_json_writer_t *w)
+{
+    value_prefix(w);
+    emit(w, "\"", 1);
+}
+
+void gemini_json_string_raw(gemini_json_writer_t *w, const char *data, size_t len)
+{
+    emit(w, data, len);
+}
+
+void gemini_json_string_end(gemini_json_writer_t *w)
+{
+    emit(w, "\"", 1);
+}
+
+void gemini_json_kv_string(gemini_json_writer_t *w, const char *key, const char *str)
+{
+    gemini_json_key(w, key);
+    gemini_json_string(w, str);
+}
+
+void gemini_json_kv_int(gemini_json_writer_t *w, const char *key, int64_t value)
+{
+    gemini_json_key(w, key);
+    gemini_json_int(w, value);
+}
+
+void gemini_json_kv_bool(gemini_json_writer_t *w, const char *key, bool value)
+{
+    gemini_json_key(w, key);
+    gemini_json_bool(w, value);
+}
+
+esp_err_t gemini_json_finish(gemini_json_writer_t *w, size_t *len)
+{
+    if (w->err == ESP_OK && (w->depth != 0 || w->after_key)) {
+        w->err = ESP_ERR_INVALID_STATE;
+    }
+    if (w->err == ESP_OK && !w->sink && w->buf) {
+        w->buf[w->len] = '\0';
+    }
+    if (len) {
+        *len = w->len;
+    }
+    return w->err;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Streaming JSON writer for request bodies
+ *
+ * Emits JSON token by token, either into a caller-provided buffer or
+ * straight into a sink (the chunked HTTP body writer, a WebSocket frame),
+ * so building a request allocates nothing and embedded payloads such as
+ * base64 audio are never copied into an intermediate document. Commas and
+ * nesting are tracked by the writer; strings are escaped as they are
+ * written.
+ *
+ * Errors are sticky: after the first failure (sink error, buffer overflow,
+ * unbalanced or too deep nesting) nothing more is output and
+ * gemini_json_finish() reports it, so builders can write a whole document
+ * without checking each call. `len` keeps counting regardless, which makes
+ * a writer with no buffer a cheap way to measure a document.
+ */
+
+#define GEMINI_JSON_MAX_DEPTH 32
+
+/**
+ * Output sink
+ * @param data: Bytes to write
+ * @param len: Number of bytes
+ * @param ctx: User context
+ * @return ESP_OK on success; an error stops the writer
+ */
+typedef esp_err_t (*gemini_json_sink_t)(const char *data, size_t len, void *ctx);
+
+typedef struct {
+    gemini_json_sink_t sink;    // NULL in buffer mode
+    void *sink_ctx;
+    char *buf;                  // Buffer mode output (may be NULL to only measure)
+    size_t cap;
+    size_t len;                 // Bytes produced so far
+    uint32_t has_items;         // Bit n: level n already holds a value (comma needed)
+    uint32_t is_object;         // Bit n: level n is an object
+    uint8_t depth;
+    bool after_key;             // A key was written; its value comes next
+    esp_err_t err;              // First error, ESP_OK if none
+} gemini_json_writer_t;
+
+/**
+ * Start a document in a buffer
+ * @param w: Writer
+ * @param buf: Output buffer, NUL-terminated by gemini_json_finish() (NULL to only measure)
+ * @param cap: Buffer size in bytes, including the terminator
+ */
+void gemini_json_init_buffer(gemini_json_writer_t *w, char *buf, size_t cap);
+
+/**
+ * Start a document written to a sink
+ * @param w: Writer
+ * @param sink: Output sink
+ * @param ctx: Context for sink
+ */
+void gemini_json_init_sink(gemini_json_writer_t *w, gemini_json_sink_t sink, void *ctx);
+
+void gemini_json_object_begin(gemini_json_writer_t *w);
+void gemini_json_object_end(gemini_json_writer_t *w);
+void gemini_json_array_begin(gemini_json_writer_t *w);
+void gemini_json_array_end(gemini_json_writer_t *w);
+
+/**
+ * Write an object key (the next call writes its value)
+ * @param w: Writer
+ * @param key: Key, escaped like any string
+ */
+void gemini_json_key(gemini_json_writer_t *w, const char *key);
+
+/**
+ * Write a string value
+ * @param w: Writer
+ * @param str: UTF-8 text; quotes, backslashes and control characters are escaped
+ */
+void gemini_json_string(gemini_json_writer_t *w, const char *str);
+
+void gemini_json_int(gemini_json_writer_t *w, int64_t value);
+void gemini_json_bool(gemini_json_writer_t *w, bool value);
+
+/**
+ * Open a string value whose contents are written separately
+ * Everything written until gemini_json_string_end() must already be valid
+ * inside a JSON string (base64, or text passed through gemini_json_string_raw()).
+ * @param w: Writer
+ */
+void gemini_json_string_begin(gemini_json_writer_t *w);
+
+/**
+ * Append unescaped bytes inside an open string (e.g. base64)
+ * @param w: Writer
+ * @param data: Bytes that need no escaping
+ * @param len: Number of bytes
+ */
+void gemini_json_string_raw(gemini_json_writer_t *w, const char *data, size_t len);
+
+void gemini_json_string_end(gemini_json_writer_t *w);
+
+// Key and value in one call
+void gemini_json_kv_string(gemini_json_writer_t *w, const char *key, const char *str);
+void gemini_json_kv_int(gemini_json_writer_t *w, const char *key, int64_t value);
+void gemini_json_kv_bool(gemini_json_writer_t *w, const char *key, bool value);
+
+/**
+ * Finish the document
+ * @param w: Writer
+ * @param len: Out: document length without terminator (may be NULL); in
+ *             buffer mode also set on ESP_ERR_INVALID_SIZE, to the size needed
+ * @return ESP_OK, the sink's error, ESP_ERR_INVALID_SIZE if the buffer was
+ *         too small, or ESP_ERR_INVALID_STATE if objects/arrays are unbalanced
+ */
+esp_err_t gemini_json_finish(gemini_json_writer_t *w, size_t *len);
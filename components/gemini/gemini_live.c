@@ -0,0 +1,691 @@
+#include "gemini_live.h"
+#include "gemini_api.h"
+#include "gemini_api_internal.h"
+#include "gemini_json.h"
+#include "gemini_segbuf.h"
+#include "gemini_ws.h"
+#include "streaming_base64.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "cJSON.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+static const char *TAG = "gemini_live";
+
+#define LIVE_URL_FMT "wss://generativelanguage.googleapis.com/ws/" \
+                     "google.ai.generativelanguage.v1beta.GenerativeService.BidiGenerateContent?key=%s"
+#define LIVE_INPUT_RATE_HZ 16000
+#define LIVE_OUTPUT_RATE_HZ 24000
+#define LIVE_QUEUE_SAMPLES (CONFIG_GEMINI_LIVE_UPLOAD_BUFFER_MS * LIVE_INPUT_RATE_HZ / 1000)
+#define LIVE_CHUNK_SAMPLES (CONFIG_GEMINI_LIVE_UPLOAD_CHUNK_MS * LIVE_INPUT_RATE_HZ / 1000)
+#define LIVE_MAX_BATCH_SAMPLES (LIVE_CHUNK_SAMPLES * 4)    // Bound on one message when catching up
+#define LIVE_MAX_MESSAGE (256 * 1024)                     // Larger server messages are a protocol error
+#define LIVE_SETUP_TIMEOUT_MS 10000
+#define LIVE_POLL_MS 100
+#define LIVE_B64_BLOCK 384                                 // Upload bytes encoded per step (multiple of 3)
+#define LIVE_PLAY_SAMPLES 384                              // Model audio samples per on_audio call
+#define LIVE_RECV_STACK_SIZE 6144
+#define LIVE_SEND_STACK_SIZE 4096
+#define LIVE_EXIT_TIMEOUT_MS (CONFIG_GEMINI_HTTP_TIMEOUT_MS + 1000)
+
+static const char AUDIO_PREFIX[] = "{\"realtimeInput\":{\"audio\":{\"mimeType\":\"audio/pcm;rate=16000\",\"data\":\"";
+static const char AUDIO_SUFFIX[] = "\"}}}";
+static const char ACTIVITY_START[] = "{\"realtimeInput\":{\"activityStart\":{}}}";
+static const char ACTIVITY_END[] = "{\"realtimeInput\":{\"activityEnd\":{}}}";
+
+struct gemini_live_session {
+    gemini_live_config_t cfg;
+    gemini_ws_t *ws;
+    SemaphoreHandle_t lock;         // Queue, flags and stats
+    SemaphoreHandle_t wake;         // Sender wake-up
+    SemaphoreHandle_t exited;       // Given by each task on its way out
+    int tasks;
+    volatile bool running;          // Cleared by gemini_live_stop()
+    volatile bool open;             // Cleared when the connection fails or closes
+
+    // Upload queue: the producer appends after head+len, only the sender
+    // advances head, so the sender reads its span without holding the lock
+    int16_t *queue;
+    size_t q_head;
+    size_t q_len;
+    bool pending_start;
+    bool pending_end;
+
+    // Model turn state (receive task, except discard which the app may set)
+    bool setup_done;
+    bool in_turn;
+    volatile bool discard;
+    int64_t speech_end_us;
+
+    gemini_live_stats_t stats;
+};
+
+// PSRAM when present: the upload queue holds seconds of audio
+static void *alloc_prefer_psram(size_t size)
+{
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!p) {
+        p = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    return p;
+}
+
+static void emit(gemini_live_session_t *s, gemini_live_event_t event, const char *text)
+{
+    if (s->cfg.on_event) {
+        s->cfg.on_event(event, text, s->cfg.user_ctx);
+    }
+}
+
+static esp_err_t send_text(gemini_live_session_t *s, const char *json)
+{
+    size_t len = strlen(json);
+    esp_err_t ret = gemini_ws_send(s->ws, GEMINI_WS_OP_TEXT, json, len);
+    if (ret == ESP_OK) {
+        xSemaphoreTake(s->lock, portMAX_DELAY);
+        s->stats.bytes_up += len;
+        xSemaphoreGive(s->lock);
+    }
+    return ret;
+}
+
+static void build_setup(gemini_json_writer_t *json, const gemini_live_session_t *s)
+{
+    char model[96];
+    snprintf(model, sizeof(model), "models/%s", s->cfg.model ? s->cfg.model : CONFIG_GEMINI_LIVE_MODEL);
+
+    gemini_json_object_begin(json);
+    gemini_json_key(json, "setup");
+    gemini_json_object_begin(json);
+    gemini_json_kv_string(json, "model", model);
+    gemini_json_key(json, "generationConfig");
+    gemini_json_object_begin(json);
+    gemini_json_key(json, "responseModalities");
+    gemini_json_array_begin(json);
+    gemini_json_string(json, "AUDIO");
+    gemini_json_array_end(json);
+    if (s->cfg.voice) {
+        gemini_json_key(json, "speechConfig");
+        gemini_json_object_begin(json);
+        gemini_json_key(json, "voiceConfig");
+        gemini_json_object_begin(json);
+        gemini_json_key(json, "prebuiltVoiceConfig");
+        gemini_json_object_begin(json);
+        gemini_json_kv_string(json, "voiceName", s->cfg.voice);
+        gemini_json_object_end(json);
+        gemini_json_object_end(json);
+        gemini_json_object_end(json);
+    }
+    gemini_json_object_end(json);
+    if (s->cfg.system_instruction) {
+        gemini_json_key(json, "systemInstruction");
+        gemini_json_object_begin(json);
+        gemini_json_key(json, "parts");
+        gemini_json_array_begin(json);
+        gemini_json_object_begin(json);
+        gemini_json_kv_string(json, "text", s->cfg.system_instruction);
+        gemini_json_object_end(json);
+        gemini_json_array_end(json);
+        gemini_json_object_end(json);
+    }
+    if (s->cfg.client_activity) {
+        gemini_json_key(json, "realtimeInputConfig");
+        gemini_json_object_begin(json);
+        gemini_json_key(json, "automaticActivityDetection");
+        gemini_json_object_begin(json);
+        gemini_json_kv_bool(json, "disabled", true);
+        gemini_json_object_end(json);
+        gemini_json_object_end(json);
+    }
+    if (s->cfg.transcripts) {
+        gemini_json_key(json, "inputAudioTranscription");
+        gemini_json_object_begin(json);
+        gemini_json_object_end(json);
+        gemini_json_key(json, "outputAudioTranscription");
+        gemini_json_object_begin(json);
+        gemini_json_object_end(json);
+    }
+    gemini_json_object_end(json);
+    gemini_json_object_end(json);
+}
+
+static esp_err_t ws_json_sink(const char *data, size_t len, void *ctx)
+{
+    return gemini_ws_send_data((gemini_ws_t *)ctx, data, len);
+}
+
+// The frame header needs the length up front, so the setup message is
+// written twice: once to measure it, once straight into the frame
+static esp_err_t send_setup(gemini_live_session_t *s)
+{
+    gemini_json_writer_t json;
+    gemini_json_init_buffer(&json, NULL, 0);
+    build_setup(&json, s);
+    size_t len = 0;
+    esp_err_t ret = gemini_json_finish(&json, &len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = gemini_ws_send_begin(s->ws, GEMINI_WS_OP_TEXT, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    gemini_json_init_sink(&json, ws_json_sink, s->ws);
+    build_setup(&json, s);
+    ret = gemini_json_finish(&json, NULL);
+    esp_err_t end_ret = gemini_ws_send_end(s->ws);
+    if (ret == ESP_OK) {
+        ret = end_ret;
+    }
+    if (ret == ESP_OK) {
+        xSemaphoreTake(s->lock, portMAX_DELAY);
+        s->stats.bytes_up += len;
+        xSemaphoreGive(s->lock);
+    }
+    return ret;
+}
+
+// Base64 of one span of the queue, continuing the encoder state across spans
+static esp_err_t send_pcm_base64(gemini_live_session_t *s, streaming_base64_encoder_t *enc,
+                                 const int16_t *pcm, size_t samples)
+{
+    const uint8_t *data = (const uint8_t *)pcm;
+    size_t len = samples * sizeof(int16_t);
+    char encoded[(LIVE_B64_BLOCK / 3) * 4 + 8];
+    while (len > 0) {
+        size_t n = len > LIVE_B64_BLOCK ? LIVE_B64_BLOCK : len;
+        size_t encoded_len = sizeof(encoded);
+        esp_err_t ret = streaming_base64_encode(enc, data, n, encoded, &encoded_len);
+        if (ret == ESP_OK) {
+            ret = gemini_ws_send_data(s->ws, encoded, encoded_len);
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+// One realtimeInput message with the oldest `samples` of the queue, framed
+// and encoded on the fly straight from the queue memory
+static esp_err_t send_audio(gemini_live_session_t *s, size_t samples)
+{
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    size_t head = s->q_head;
+    xSemaphoreGive(s->lock);
+
+    size_t first = LIVE_QUEUE_SAMPLES - head;
+    if (first > samples) {
+        first = samples;
+    }
+    size_t bytes = samples * sizeof(int16_t);
+    size_t total = sizeof(AUDIO_PREFIX) - 1 + ((bytes + 2) / 3) * 4 + sizeof(AUDIO_SUFFIX) - 1;
+
+    esp_err_t ret = gemini_ws_send_begin(s->ws, GEMINI_WS_OP_TEXT, total);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    streaming_base64_encoder_t enc;
+    streaming_base64_encoder_init(&enc);
+    ret = gemini_ws_send_data(s->ws, AUDIO_PREFIX, sizeof(AUDIO_PREFIX) - 1);
+    if (ret == ESP_OK) {
+        ret = send_pcm_base64(s, &enc, s->queue + head, first);
+    }
+    if (ret == ESP_OK && samples > first) {
+        ret = send_pcm_base64(s, &enc, s->queue, samples - first);
+    }
+    if (ret == ESP_OK) {
+        char tail[8];
+        size_t tail_len = sizeof(tail);
+        ret = streaming_base64_encode_finish(&enc, tail, &tail_len);
+        if (ret == ESP_OK) {
+            ret = gemini_ws_send_data(s->ws, tail, tail_len);
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = gemini_ws_send_data(s->ws, AUDIO_SUFFIX, sizeof(AUDIO_SUFFIX) - 1);
+    }
+    esp_err_t end = gemini_ws_send_end(s->ws);
+    if (ret == ESP_OK) {
+        ret = end;
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    s->q_head = (head + samples) % LIVE_QUEUE_SAMPLES;
+    s->q_len -= samples;
+    s->stats.messages_sent++;
+    s->stats.samples_sent += samples;
+    s->stats.bytes_up += total;
+    xSemaphoreGive(s->lock);
+    return ESP_OK;
+}
+
+static void send_task(void *arg)
+{
+    gemini_live_session_t *s = (gemini_live_session_t *)arg;
+    esp_err_t ret = ESP_OK;
+
+    while (s->running && s->open && ret == ESP_OK) {
+        xSemaphoreTake(s->wake, pdMS_TO_TICKS(LIVE_POLL_MS));
+
+        xSemaphoreTake(s->lock, portMAX_DELAY);
+        bool start = s->pending_start;
+        s->pending_start = false;
+        bool end = s->pending_end;
+        size_t queued = s->q_len;
+        xSemaphoreGive(s->lock);
+
+        if (start) {
+            ret = send_text(s, ACTIVITY_START);
+        }
+        // Batch whatever has accumulated, a full chunk at a time, except at
+        // end of speech when the tail goes out immediately
+        while (ret == ESP_OK && s->open && (queued >= LIVE_CHUNK_SAMPLES || (end && queued > 0))) {
+            ret = send_audio(s, queued > LIVE_MAX_BATCH_SAMPLES ? LIVE_MAX_BATCH_SAMPLES : queued);
+            xSemaphoreTake(s->lock, portMAX_DELAY);
+            queued = s->q_len;
+            xSemaphoreGive(s->lock);
+        }
+        if (ret == ESP_OK && end) {
+            xSemaphoreTake(s->lock, portMAX_DELAY);
+            s->pending_end = false;
+            xSemaphoreGive(s->lock);
+            if (s->cfg.client_activity) {
+                ret = send_text(s, ACTIVITY_END);
+            }
+        }
+    }
+
+    if (ret != ESP_OK && s->running) {
+        ESP_LOGE(TAG, "❌ [Gemini Live] Upload failed: %s", esp_err_to_name(ret));
+        s->open = false;
+    }
+    xSemaphoreGive(s->exited);
+    vTaskDelete(NULL);
+}
+
+static int mime_rate(const char *mime)
+{
+    const char *rate = mime ? strstr(mime, "rate=") : NULL;
+    return rate ? atoi(rate + 5) : LIVE_OUTPUT_RATE_HZ;
+}
+
+// Decode an inlineData payload in place and hand it to the app in slices
+static void play_audio(gemini_live_session_t *s, char *b64, int rate)
+{
+    streaming_base64_decoder_t dec;
+    streaming_base64_decoder_init(&dec);
+    size_t len = strlen(b64);
+    size_t out = len;
+    size_t tail = 0;
+    if (streaming_base64_decode(&dec, (const uint8_t *)b64, len, (uint8_t *)b64, &out) != ESP_OK ||
+        streaming_base64_decode_finish(&dec, NULL, &tail) != ESP_OK) {
+        ESP_LOGW(TAG, "Invalid base64 in model audio");
+        return;
+    }
+    // The string is a heap block of its own, so suitably aligned for samples
+    const int16_t *pcm = (const int16_t *)(void *)b64;
+    size_t total = out / sizeof(int16_t);
+    for (size_t off = 0; off < total; off += LIVE_PLAY_SAMPLES) {
+        size_t samples = total - off > LIVE_PLAY_SAMPLES ? LIVE_PLAY_SAMPLES : total - off;
+        if (s->discard || !s->running) {
+            xSemaphoreTake(s->lock, portMAX_DELAY);
+            s->stats.samples_discarded += samples;
+            xSemaphoreGive(s->lock);
+            continue;
+        }
+        if (s->speech_end_us) {
+            int64_t latency = esp_timer_get_time() - s->speech_end_us;
+            s->speech_end_us = 0;
+            s->stats.last_latency_us = latency;
+            ESP_LOGI(TAG, "⚡ [Gemini Live] First audio %lld ms after end of speech", (long long)(latency / 1000));
+        }
+        s->cfg.on_audio(pcm + off, samples, rate, s->cfg.user_ctx);
+        xSemaphoreTake(s->lock, portMAX_DELAY);
+        s->stats.samples_received += samples;
+        xSemaphoreGive(s->lock);
+    }
+}
+
+static void handle_server_content(gemini_live_session_t *s, cJSON *content)
+{
+    cJSON *turn = cJSON_GetObjectItem(content, "modelTurn");
+    cJSON *parts = turn ? cJSON_GetObjectItem(turn, "parts") : NULL;
+    cJSON *part = NULL;
+    cJSON_ArrayForEach(part, parts) {
+        cJSON *inline_data = cJSON_GetObjectItem(part, "inlineData");
+        cJSON *data = inline_data ? cJSON_GetObjectItem(inline_data, "data") : NULL;
+        if (cJSON_IsString(data)) {
+            cJSON *mime = cJSON_GetObjectItem(inline_data, "mimeType");
+            s->in_turn = true;
+            play_audio(s, data->valuestring, mime_rate(cJSON_IsString(mime) ? mime->valuestring : NULL));
+        }
+    }
+
+    const char *transcripts[] = { "inputTranscription", "outputTranscription" };
+    for (int i = 0; i < 2; i++) {
+        cJSON *t = cJSON_GetObjectItem(content, transcripts[i]);
+        cJSON *text = t ? cJSON_GetObjectItem(t, "text") : NULL;
+        if (cJSON_IsString(text) && !(i == 1 && s->discard)) {
+            emit(s, i == 0 ? GEMINI_LIVE_EVENT_INPUT_TRANSCRIPT : GEMINI_LIVE_EVENT_OUTPUT_TRANSCRIPT,
+                 text->valuestring);
+        }
+    }
+
+    if (cJSON_IsTrue(cJSON_GetObjectItem(content, "interrupted"))) {
+        ESP_LOGI(TAG, "✋ [Gemini Live] Answer interrupted");
+        s->in_turn = false;
+        s->discard = false;
+        xSemaphoreTake(s->lock, portMAX_DELAY);
+        s->stats.interruptions++;
+        xSemaphoreGive(s->lock);
+        emit(s, GEMINI_LIVE_EVENT_INTERRUPTED, NULL);
+    }
+    if (cJSON_IsTrue(cJSON_GetObjectItem(content, "turnComplete"))) {
+        s->in_turn = false;
+        s->discard = false;
+        xSemaphoreTake(s->lock, portMAX_DELAY);
+        s->stats.turns++;
+        xSemaphoreGive(s->lock);
+        emit(s, GEMINI_LIVE_EVENT_TURN_COMPLETE, NULL);
+    }
+}
+
+static void handle_message(gemini_live_session_t *s, const char *json)
+{
+    cJSON *root = json ? cJSON_Parse(json) : NULL;
+    if (!root) {
+        ESP_LOGW(TAG, "Unparseable server message");
+        return;
+    }
+    cJSON *content = cJSON_GetObjectItem(root, "serverContent");
+    if (content) {
+        handle_server_content(s, content);
+    } else if (cJSON_GetObjectItem(root, "setupComplete")) {
+        s->setup_done = true;
+    } else if (cJSON_GetObjectItem(root, "goAway")) {
+        ESP_LOGW(TAG, "Server is ending the session soon");
+        emit(s, GEMINI_LIVE_EVENT_GO_AWAY, NULL);
+    }
+    cJSON_Delete(root);
+}
+
+static esp_err_t collect(const uint8_t *data, size_t len, void *ctx)
+{
+    gemini_segbuf_t *buf = (gemini_segbuf_t *)ctx;
+    if (buf->len + len > LIVE_MAX_MESSAGE) {
+        ESP_LOGE(TAG, "Server message larger than %d bytes", LIVE_MAX_MESSAGE);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return gemini_segbuf_append(buf, data, len);
+}
+
+// Receive one server message and act on it
+static esp_err_t receive_one(gemini_live_session_t *s, int wait_ms)
+{
+    gemini_segbuf_t msg = {0};
+    esp_err_t ret = gemini_ws_recv(s->ws, collect, &msg, wait_ms, NULL);
+    if (ret == ESP_OK) {
+        xSemaphoreTake(s->lock, portMAX_DELAY);
+        s->stats.bytes_down += msg.len;
+        xSemaphoreGive(s->lock);
+        handle_message(s, gemini_segbuf_str(&msg));
+    }
+    gemini_segbuf_release(&msg);
+    return ret;
+}
+
+static void recv_task(void *arg)
+{
+    gemini_live_session_t *s = (gemini_live_session_t *)arg;
+
+    while (s->running) {
+        esp_err_t ret = receive_one(s, LIVE_POLL_MS);
+        if (ret == ESP_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret != ESP_OK || !s->open) {
+            if (s->running) {
+                ESP_LOGW(TAG, "Session closed (%s, close code %u)", esp_err_to_name(ret),
+                         gemini_ws_close_code(s->ws));
+                s->open = false;
+                xSemaphoreGive(s->wake);
+                emit(s, GEMINI_LIVE_EVENT_CLOSED, NULL);
+            }
+            break;
+        }
+    }
+
+    xSemaphoreGive(s->exited);
+    vTaskDelete(NULL);
+}
+
+static void free_session(gemini_live_session_t *s)
+{
+    gemini_ws_close(s->ws);
+    SemaphoreHandle_t sems[] = { s->lock, s->wake, s->exited };
+    for (size_t i = 0; i < sizeof(sems) / sizeof(sems[0]); i++) {
+        if (sems[i]) {
+            vSemaphoreDelete(sems[i]);
+        }
+    }
+    free(s->queue);
+    free(s);
+}
+
+// Ask the tasks to leave and wait for them; false if one is stuck
+static bool stop_tasks(gemini_live_session_t *s)
+{
+    s->running = false;
+    xSemaphoreGive(s->wake);
+    for (int i = 0; i < s->tasks; i++) {
+        if (xSemaphoreTake(s->exited, pdMS_TO_TICKS(LIVE_EXIT_TIMEOUT_MS)) != pdTRUE) {
+            return false;
+        }
+    }
+    s->tasks = 0;
+    return true;
+}
+
+esp_err_t gemini_live_start(const gemini_live_config_t *config, gemini_live_session_t **out)
+{
+    if (!config || !config->on_audio || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+    const gemini_config_t *api = gemini_api_get_config();
+    if (!api) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    gemini_live_session_t *s = calloc(1, sizeof(gemini_live_session_t));
+    if (!s) {
+        return ESP_ERR_NO_MEM;
+    }
+    s->cfg = *config;
+    s->stats.last_latency_us = -1;
+    s->queue = alloc_prefer_psram(LIVE_QUEUE_SAMPLES * sizeof(int16_t));
+    s->lock = xSemaphoreCreateMutex();
+    s->wake = xSemaphoreCreateBinary();
+    s->exited = xSemaphoreCreateCounting(2, 0);
+    if (!s->queue || !s->lock || !s->wake || !s->exited) {
+        free_session(s);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret;
+    if (config->url) {
+        ret = gemini_ws_connect(config->url, CONFIG_GEMINI_HTTP_TIMEOUT_MS, &s->ws);
+    } else {
+        char url[320];
+        snprintf(url, sizeof(url), LIVE_URL_FMT, api->api_key);
+        ret = gemini_ws_connect(url, CONFIG_GEMINI_HTTP_TIMEOUT_MS, &s->ws);
+    }
+    if (ret == ESP_OK) {
+        ret = send_setup(s);
+    }
+    // Nothing else is sent before setupComplete
+    s->running = true;
+    s->open = true;
+    int64_t deadline = esp_timer_get_time() + (int64_t)LIVE_SETUP_TIMEOUT_MS * 1000;
+    while (ret == ESP_OK && !s->setup_done) {
+        ret = receive_one(s, LIVE_POLL_MS);
+        if (ret == ESP_ERR_TIMEOUT) {
+            ret = esp_timer_get_time() < deadline ? ESP_OK : ESP_ERR_TIMEOUT;
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ [Gemini Live] Session setup failed: %s (close code %u)", esp_err_to_name(ret),
+                 gemini_ws_close_code(s->ws));
+        free_session(s);
+        return ret;
+    }
+
+    if (xTaskCreate(recv_task, "live_recv", LIVE_RECV_STACK_SIZE, s, 6, NULL) == pdPASS) {
+        s->tasks++;
+    }
+    if (s->tasks == 1 && xTaskCreate(send_task, "live_send", LIVE_SEND_STACK_SIZE, s, 5, NULL) == pdPASS) {
+        s->tasks++;
+    }
+    if (s->tasks != 2) {
+        ESP_LOGE(TAG, "Failed to create session tasks");
+        if (stop_tasks(s)) {
+            free_session(s);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "✅ [Gemini Live] Session open in %lld ms (%s activity detection)",
+             (long long)((esp_timer_get_time() - start_us) / 1000), config->client_activity ? "client" : "server");
+    *out = s;
+    return ESP_OK;
+}
+
+esp_err_t gemini_live_send_audio(gemini_live_session_t *s, const int16_t *pcm, size_t samples)
+{
+    if (!s || (!pcm && samples > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s->open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    if (LIVE_QUEUE_SAMPLES - s->q_len < samples) {
+        // Link slower than real time for longer than the queue covers
+        s->stats.samples_dropped += samples;
+        xSemaphoreGive(s->lock);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t tail = (s->q_head + s->q_len) % LIVE_QUEUE_SAMPLES;
+    size_t first = LIVE_QUEUE_SAMPLES - tail;
+    if (first > samples) {
+        first = samples;
+    }
+    memcpy(s->queue + tail, pcm, first * sizeof(int16_t));
+    memcpy(s->queue, pcm + first, (samples - first) * sizeof(int16_t));
+    s->q_len += samples;
+    if (s->q_len > s->stats.queue_peak_samples) {
+        s->stats.queue_peak_samples = s->q_len;
+    }
+    bool wake = s->q_len >= LIVE_CHUNK_SAMPLES;
+    xSemaphoreGive(s->lock);
+
+    if (wake) {
+        xSemaphoreGive(s->wake);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_live_activity_start(gemini_live_session_t *s)
+{
+    if (!s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s->open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gemini_live_interrupt(s);
+    if (s->cfg.client_activity) {
+        xSemaphoreTake(s->lock, portMAX_DELAY);
+        s->pending_start = true;
+        xSemaphoreGive(s->lock);
+        xSemaphoreGive(s->wake);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_live_activity_end(gemini_live_session_t *s)
+{
+    if (!s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s->open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    s->pending_end = true;
+    xSemaphoreGive(s->lock);
+    s->speech_end_us = esp_timer_get_time();
+    xSemaphoreGive(s->wake);
+    return ESP_OK;
+}
+
+void gemini_live_interrupt(gemini_live_session_t *s)
+{
+    // Only an answer in progress can be cut; otherwise the next one would be lost
+    if (s && s->in_turn && !s->discard) {
+        ESP_LOGI(TAG, "✋ [Gemini Live] Discarding the rest of the answer");
+        s->discard = true;
+    }
+}
+
+bool gemini_live_is_open(const gemini_live_session_t *s)
+{
+    return s && s->open;
+}
+
+void gemini_live_get_stats(gemini_live_session_t *s, gemini_live_stats_t *stats)
+{
+    if (!s || !stats) {
+        return;
+    }
+    xSemaphoreTake(s->lock, portMAX_DELAY);
+    *stats = s->stats;
+    xSemaphoreGive(s->lock);
+}
+
+void gemini_live_stop(gemini_live_session_t *s)
+{
+    if (!s) {
+        return;
+    }
+    if (!stop_tasks(s)) {
+        // A task is stuck in a callback or on the network; leak rather than free under it
+        ESP_LOGE(TAG, "Session tasks did not exit");
+        return;
+    }
+    gemini_live_stats_t st = s->stats;
+    ESP_LOGI(TAG, "Session closed: %" PRIu32 " turn(s), %" PRIu32 " interruption(s), %llu ms up "
+             "(%llu ms dropped), %llu ms down, %zu B up, %zu B down",
+             st.turns, st.interruptions,
+             (unsigned long long)(st.samples_sent * 1000 / LIVE_INPUT_RATE_HZ),
+             (unsigned long long)(st.samples_dropped * 1000 / LIVE_INPUT_RATE_HZ),
+             (unsigned long long)(st.samples_received * 1000 / LIVE_OUTPUT_RATE_HZ),
+             st.bytes_up, st.bytes_down);
+    free_session(s);
+}
@@ -0,0 +1,176 @@
+#include "gemini_segbuf.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "gemini_segbuf";
+
+#define SEG_SIZE CONFIG_GEMINI_HTTP_RESPONSE_SEGMENT_SIZE
+
+struct gemini_seg {
+    gemini_seg_t *next;
+    size_t len;
+    uint8_t data[SEG_SIZE];
+};
+
+static gemini_seg_t *s_free = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+static gemini_segbuf_stats_t s_stats = {0};
+
+// PSRAM when present, so response bodies stay out of internal RAM
+static void *alloc_prefer_psram(size_t size)
+{
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!p) {
+        p = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    return p;
+}
+
+esp_err_t gemini_segbuf_pool_init(void)
+{
+    if (s_lock) {
+        return ESP_OK;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    return s_lock ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static gemini_seg_t *seg_get(void)
+{
+    gemini_seg_t *seg = NULL;
+    if (s_lock) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        seg = s_free;
+        if (seg) {
+            s_free = seg->next;
+            s_stats.free_now--;
+            s_stats.reused++;
+        }
+        xSemaphoreGive(s_lock);
+    }
+    if (!seg) {
+        seg = alloc_prefer_psram(sizeof(gemini_seg_t));
+        if (!seg) {
+            ESP_LOGE(TAG, "Failed to allocate %d byte response segment", SEG_SIZE);
+            return NULL;
+        }
+        if (s_lock) {
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            s_stats.allocated++;
+            xSemaphoreGive(s_lock);
+        }
+    }
+    seg->next = NULL;
+    seg->len = 0;
+    return seg;
+}
+
+esp_err_t gemini_segbuf_append(gemini_segbuf_t *buf, const uint8_t *data, size_t len)
+{
+    if (!buf || (!data && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while (len > 0) {
+        gemini_seg_t *seg = buf->tail;
+        if (!seg || seg->len == SEG_SIZE) {
+            seg = seg_get();
+            if (!seg) {
+                return ESP_ERR_NO_MEM;
+            }
+            if (buf->tail) {
+                buf->tail->next = seg;
+            } else {
+                buf->head = seg;
+            }
+            buf->tail = seg;
+        }
+        size_t n = SEG_SIZE - seg->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(seg->data + seg->len, data, n);
+        seg->len += n;
+        buf->len += n;
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+const char *gemini_segbuf_str(gemini_segbuf_t *buf)
+{
+    if (!buf || buf->len == 0) {
+        return NULL;
+    }
+    if (buf->flat) {
+        return buf->flat;
+    }
+    if (buf->head == buf->tail && buf->head->len < SEG_SIZE) {
+        buf->head->data[buf->head->len] = '\0';
+        return (const char *)buf->head->data;
+    }
+
+    buf->flat = alloc_prefer_psram(buf->len + 1);
+    if (!buf->flat) {
+        ESP_LOGE(TAG, "Failed to allocate %zu bytes for response", buf->len + 1);
+        return NULL;
+    }
+    size_t off = 0;
+    for (gemini_seg_t *seg = buf->head; seg; seg = seg->next) {
+        memcpy(buf->flat + off, seg->data, seg->len);
+        off += seg->len;
+    }
+    buf->flat[off] = '\0';
+    if (s_lock) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_stats.flattened++;
+        xSemaphoreGive(s_lock);
+    }
+    return buf->flat;
+}
+
+void gemini_segbuf_release(gemini_segbuf_t *buf)
+{
+    if (!buf) {
+        return;
+    }
+    free(buf->flat);
+    if (buf->head) {
+        if (s_lock) {
+            // Keep at most CONFIG_GEMINI_HTTP_RESPONSE_POOL_SEGMENTS spare
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            while (buf->head && s_stats.free_now < CONFIG_GEMINI_HTTP_RESPONSE_POOL_SEGMENTS) {
+                gemini_seg_t *seg = buf->head;
+                buf->head = seg->next;
+                seg->next = s_free;
+                s_free = seg;
+                s_stats.free_now++;
+            }
+            xSemaphoreGive(s_lock);
+        }
+        while (buf->head) {
+            gemini_seg_t *seg = buf->head;
+            buf->head = seg->next;
+            free(seg);
+        }
+    }
+    memset(buf, 0, sizeof(*buf));
+}
+
+void gemini_segbuf_get_stats(gemini_segbuf_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!s_lock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Segmented response buffers
+ *
+ * Buffered HTTP responses are collected in a chain of fixed-size segments
+ * instead of one buffer grown by realloc. Segments come from a shared free
+ * list, allocated from PSRAM when available, and go back to it when the
+ * response is released, so steady-state requests allocate nothing and no
+ * allocation is ever larger than one segment (CONFIG_GEMINI_HTTP_RESPONSE_SEGMENT_SIZE).
+ */
+
+typedef struct gemini_seg gemini_seg_t;
+
+typedef struct {
+    gemini_seg_t *head;
+    gemini_seg_t *tail;
+    size_t len;             // Total bytes across all segments
+    char *flat;             // Contiguous copy made by gemini_segbuf_str(), if any
+} gemini_segbuf_t;
+
+typedef struct {
+    uint32_t allocated;     // Segments allocated from the heap
+    uint32_t reused;        // Segments taken from the free list
+    uint32_t free_now;      // Segments currently on the free list
+    uint32_t flattened;     // Responses that needed a contiguous copy
+} gemini_segbuf_stats_t;
+
+/**
+ * Initialize the segment free list (idempotent)
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_segbuf_pool_init(void);
+
+/**
+ * Append bytes to a buffer, taking segments from the pool as needed
+ * @param buf: Buffer (zero-initialized before first use)
+ * @param data: Bytes to append
+ * @param len: Number of bytes
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if a segment cannot be allocated
+ */
+esp_err_t gemini_segbuf_append(gemini_segbuf_t *buf, const uint8_t *data, size_t len);
+
+/**
+ * Get the contents as one NUL-terminated string
+ * A response that fits in one segment is terminated in place; longer ones
+ * are copied once into an exactly sized block owned by the buffer.
+ * @param buf: Buffer
+ * @return String valid until gemini_segbuf_release(), or NULL if the buffer
+ *         is empty or the copy cannot be allocated
+ */
+const char *gemini_segbuf_str(gemini_segbuf_t *buf);
+
+/**
+ * Return all segments to the pool and reset the buffer
+ * @param buf: Buffer
+ */
+void gemini_segbuf_release(gemini_segbuf_t *buf);
+
+/**
+ * Snapshot pool statistics
+ * @param stats: Output statistics
+ */
+void gemini_segbuf_get_stats(gemini_segbuf_stats_t *stats);
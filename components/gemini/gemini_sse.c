@@ -0,0 +1,118 @@
+#include "gemini_sse.h"
+#include "turn_arena.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+esp_err_t gemini_sse_parser_init(gemini_sse_parser_t *parser, size_t max_event_len,
+                                 gemini_sse_event_cb_t cb, void *ctx)
+{
+    if (!parser || !cb || max_event_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(parser, 0, sizeof(*parser));
+    parser->buf = turn_arena_malloc(max_event_len + 1);
+    if (!parser->buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    parser->cap = max_event_len;
+    parser->cb = cb;
+    parser->ctx = ctx;
+    return ESP_OK;
+}
+
+static esp_err_t dispatch_event(gemini_sse_parser_t *parser)
+{
+    if (parser->event_len == 0) {
+        return ESP_OK;
+    }
+    size_t len = parser->event_len;
+    parser->buf[len] = '\0';
+    parser->event_len = 0;
+    return parser->cb(parser->buf, len, parser->ctx);
+}
+
+// Handle one complete line sitting at buf[event_len .. event_len + line_len)
+static esp_err_t process_line(gemini_sse_parser_t *parser)
+{
+    char *line = parser->buf + parser->event_len;
+    size_t len = parser->line_len;
+    parser->line_len = 0;
+
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    if (len == 0) {
+        // Blank line terminates the event
+        return dispatch_event(parser);
+    }
+    if (len < 5 || memcmp(line, "data:", 5) != 0) {
+        return ESP_OK;  // event:, id:, retry: and ": comments" are not used
+    }
+
+    const char *value = line + 5;
+    size_t value_len = len - 5;
+    if (value_len > 0 && *value == ' ') {
+        value++;
+        value_len--;
+    }
+
+    // Multiple data lines in one event are joined with '\n'
+    bool has_data = parser->event_len > 0;
+    size_t dst = parser->event_len + (has_data ? 1 : 0);
+    memmove(parser->buf + dst, value, value_len);
+    if (has_data) {
+        parser->buf[parser->event_len] = '\n';
+    }
+    parser->event_len = dst + value_len;
+    return ESP_OK;
+}
+
+esp_err_t gemini_sse_parser_feed(gemini_sse_parser_t *parser, const uint8_t *data, size_t len)
+{
+    if (!parser || !parser->buf || (!data && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while (len > 0) {
+        const uint8_t *nl = memchr(data, '\n', len);
+        size_t take = nl ? (size_t)(nl - data) : len;
+        if (parser->event_len + parser->line_len + take + 1 > parser->cap) {
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(parser->buf + parser->event_len + parser->line_len, data, take);
+        parser->line_len += take;
+        if (!nl) {
+            break;
+        }
+        esp_err_t err = process_line(parser);
+        if (err != ESP_OK) {
+            return err;
+        }
+        data += take + 1;
+        len -= take + 1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_sse_parser_finish(gemini_sse_parser_t *parser)
+{
+    if (!parser || !parser->buf) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    if (parser->line_len > 0) {
+        err = process_line(parser);
+    }
+    if (err == ESP_OK) {
+        err = dispatch_event(parser);
+    }
+    return err;
+}
+
+void gemini_sse_parser_deinit(gemini_sse_parser_t *parser)
+{
+    if (parser) {
+        turn_arena_free(parser->buf);
+        memset(parser, 0, sizeof(*parser));
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Incremental server-sent events parser
+ * Feed it response bytes in arbitrary pieces; it calls back once per complete
+ * event with the concatenated "data:" lines. Other fields and comments are
+ * ignored. Event and line storage share one fixed buffer.
+ */
+
+/**
+ * Event callback
+ * @param data: NUL-terminated event data (valid only during the call)
+ * @param len: Length of data
+ * @param ctx: User context
+ * @return ESP_OK to continue; an error stops parsing and is returned from feed
+ */
+typedef esp_err_t (*gemini_sse_event_cb_t)(const char *data, size_t len, void *ctx);
+
+typedef struct {
+    char *buf;              // Event data, followed by the line being assembled
+    size_t cap;
+    size_t event_len;       // Bytes of event data at the start of buf
+    size_t line_len;        // Bytes of the current line after the event data
+    gemini_sse_event_cb_t cb;
+    void *ctx;
+} gemini_sse_parser_t;
+
+/**
+ * Initialize a parser
+ * @param parser: Parser state
+ * @param max_event_len: Largest event (plus one line) the parser can hold
+ * @param cb: Event callback
+ * @param ctx: Context for cb
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the buffer cannot be allocated
+ */
+esp_err_t gemini_sse_parser_init(gemini_sse_parser_t *parser, size_t max_event_len,
+                                 gemini_sse_event_cb_t cb, void *ctx);
+
+/**
+ * Feed response bytes
+ * @return ESP_OK, ESP_ERR_NO_MEM if an event exceeds the buffer, or the
+ *         callback's error
+ */
+esp_err_t gemini_sse_parser_feed(gemini_sse_parser_t *parser, const uint8_t *data, size_t len);
+
+/**
+ * Dispatch an event left unterminated when the stream ended
+ */
+esp_err_t gemini_sse_parser_finish(gemini_sse_parser_t *parser);
+
+/**
+ * Free parser storage
+ */
+void gemini_sse_parser_deinit(gemini_sse_parser_t *parser);
@@ -0,0 +1,535 @@
+#include "gemini_tts_cache.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "mbedtls/sha256.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+static const char *TAG = "gemini_tts_cache";
+
+#define FLASH_SECTOR_SIZE    4096
+#define FLASH_ENTRY_MAGIC    0x43535454  // "TTSC"
+#define PERSIST_QUEUE_DEPTH  4
+#define WRITER_STACK_SIZE    3072
+#define WRITER_EXIT_TIMEOUT_MS 5000
+
+// RAM tier entry; the list is kept most-recently-used first
+typedef struct ram_entry {
+    struct ram_entry *next;
+    uint8_t key[GEMINI_TTS_CACHE_KEY_LEN];
+    int16_t *pcm;
+    size_t samples;
+    int refs;           // Held by the writer task while copying to flash
+    bool in_flash;
+    bool evicted;       // Unlinked while referenced; freed on last unref
+} ram_entry_t;
+
+// On-flash entry header, followed by the PCM payload. Entries start on a
+// sector boundary and the header is written last, so a torn write leaves no
+// valid header behind.
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;           // Write order, used to find the ring head at boot
+    uint8_t key[GEMINI_TTS_CACHE_KEY_LEN];
+    uint32_t pcm_bytes;
+    uint32_t payload_crc;
+    uint32_t header_crc;    // Over all preceding fields
+} flash_header_t;
+
+typedef struct {
+    uint8_t key[GEMINI_TTS_CACHE_KEY_LEN];
+    uint32_t offset;
+    uint32_t pcm_bytes;
+} flash_index_t;
+
+static struct {
+    bool initialized;
+    volatile bool exiting;
+    SemaphoreHandle_t lock;         // RAM tier, flash index, ring head and stats
+    ram_entry_t *ram_head;
+    size_t ram_bytes;
+    size_t ram_budget;
+    const esp_partition_t *part;
+    flash_index_t *index;
+    size_t index_count;
+    size_t index_cap;
+    uint32_t head;                  // Next write offset in the partition
+    uint32_t next_seq;
+    QueueHandle_t persist_queue;    // Keys waiting to be written to flash
+    SemaphoreHandle_t writer_exited;
+    gemini_tts_cache_stats_t stats;
+} s_cache = {0};
+
+static uint32_t entry_span(uint32_t pcm_bytes)
+{
+    uint32_t total = sizeof(flash_header_t) + pcm_bytes;
+    return (total + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+}
+
+void gemini_tts_cache_key(const char *voice, int sample_rate_hz, const char *text,
+                          uint8_t key[GEMINI_TTS_CACHE_KEY_LEN])
+{
+    uint8_t digest[32];
+    uint8_t rate[4] = {
+        (uint8_t)sample_rate_hz, (uint8_t)(sample_rate_hz >> 8),
+        (uint8_t)(sample_rate_hz >> 16), (uint8_t)(sample_rate_hz >> 24),
+    };
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, (const unsigned char *)voice, strlen(voice) + 1);
+    mbedtls_sha256_update(&ctx, rate, sizeof(rate));
+    mbedtls_sha256_update(&ctx, (const unsigned char *)text, strlen(text));
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    memcpy(key, digest, GEMINI_TTS_CACHE_KEY_LEN);
+}
+
+// ---- RAM tier (all callers hold s_cache.lock) ----
+
+static ram_entry_t *ram_find_locked(const uint8_t *key, ram_entry_t **prev_out)
+{
+    ram_entry_t *prev = NULL;
+    for (ram_entry_t *e = s_cache.ram_head; e; prev = e, e = e->next) {
+        if (memcmp(e->key, key, GEMINI_TTS_CACHE_KEY_LEN) == 0) {
+            if (prev_out) {
+                *prev_out = prev;
+            }
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void ram_entry_free(ram_entry_t *e)
+{
+    heap_caps_free(e->pcm);
+    free(e);
+}
+
+static void ram_evict_lru_locked(void)
+{
+    ram_entry_t *prev = NULL;
+    ram_entry_t *e = s_cache.ram_head;
+    if (!e) {
+        return;
+    }
+    while (e->next) {
+        prev = e;
+        e = e->next;
+    }
+    if (prev) {
+        prev->next = NULL;
+    } else {
+        s_cache.ram_head = NULL;
+    }
+    s_cache.ram_bytes -= e->samples * sizeof(int16_t);
+    s_cache.stats.ram_entries--;
+    s_cache.stats.evictions++;
+    if (e->refs > 0) {
+        e->evicted = true;
+    } else {
+        ram_entry_free(e);
+    }
+}
+
+// ---- Flash tier index (all callers hold s_cache.lock) ----
+
+static int flash_find_locked(const uint8_t *key)
+{
+    for (size_t i = 0; i < s_cache.index_count; i++) {
+        if (memcmp(s_cache.index[i].key, key, GEMINI_TTS_CACHE_KEY_LEN) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static void flash_index_remove_locked(size_t i)
+{
+    s_cache.index[i] = s_cache.index[--s_cache.index_count];
+}
+
+// Drop every indexed entry that overlaps [offset, offset + span)
+static void flash_drop_range_locked(uint32_t offset, uint32_t span)
+{
+    for (size_t i = 0; i < s_cache.index_count;) {
+        const flash_index_t *e = &s_cache.index[i];
+        if (e->offset < offset + span && offset < e->offset + entry_span(e->pcm_bytes)) {
+            flash_index_remove_locked(i);
+        } else {
+            i++;
+        }
+    }
+}
+
+static bool header_valid(const flash_header_t *hdr, uint32_t offset, uint32_t part_size)
+{
+    if (hdr->magic != FLASH_ENTRY_MAGIC) {
+        return false;
+    }
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(flash_header_t, header_crc));
+    if (crc != hdr->header_crc) {
+        return false;
+    }
+    return hdr->pcm_bytes > 0 && hdr->pcm_bytes <= part_size &&
+           offset + entry_span(hdr->pcm_bytes) <= part_size;
+}
+
+// Rebuild the index and find the ring head by walking entry headers
+static void flash_scan(void)
+{
+    const uint32_t size = s_cache.part->size;
+    uint32_t max_seq = 0;
+    bool any = false;
+    uint32_t offset = 0;
+
+    while (offset + sizeof(flash_header_t) <= size) {
+        flash_header_t hdr;
+        if (esp_partition_read(s_cache.part, offset, &hdr, sizeof(hdr)) != ESP_OK ||
+            !header_valid(&hdr, offset, size)) {
+            offset += FLASH_SECTOR_SIZE;
+            continue;
+        }
+        uint32_t span = entry_span(hdr.pcm_bytes);
+        if (s_cache.index_count < s_cache.index_cap && flash_find_locked(hdr.key) < 0) {
+            flash_index_t *e = &s_cache.index[s_cache.index_count++];
+            memcpy(e->key, hdr.key, GEMINI_TTS_CACHE_KEY_LEN);
+            e->offset = offset;
+            e->pcm_bytes = hdr.pcm_bytes;
+        }
+        if (!any || hdr.seq > max_seq) {
+            any = true;
+            max_seq = hdr.seq;
+            s_cache.head = offset + span;
+        }
+        offset += span;
+    }
+    s_cache.next_seq = any ? max_seq + 1 : 0;
+}
+
+// Append one entry at the ring head. Runs on the writer task only.
+static esp_err_t flash_append(const uint8_t *key, const int16_t *pcm, uint32_t pcm_bytes)
+{
+    const uint32_t size = s_cache.part->size;
+    const uint32_t span = entry_span(pcm_bytes);
+    if (span > size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Reserve the region: evict whatever lives there so lookups stop reading it
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    if (s_cache.head + span > size) {
+        s_cache.head = 0;
+    }
+    uint32_t offset = s_cache.head;
+    flash_drop_range_locked(offset, span);
+    s_cache.head += span;
+    uint32_t seq = s_cache.next_seq++;
+    xSemaphoreGive(s_cache.lock);
+
+    flash_header_t hdr = {
+        .magic = FLASH_ENTRY_MAGIC,
+        .seq = seq,
+        .pcm_bytes = pcm_bytes,
+        .payload_crc = esp_rom_crc32_le(0, (const uint8_t *)pcm, pcm_bytes),
+    };
+    memcpy(hdr.key, key, GEMINI_TTS_CACHE_KEY_LEN);
+    hdr.header_crc = esp_rom_crc32_le(0, (const uint8_t *)&hdr, offsetof(flash_header_t, header_crc));
+
+    esp_err_t err = esp_partition_erase_range(s_cache.part, offset, span);
+    if (err == ESP_OK) {
+        err = esp_partition_write(s_cache.part, offset + sizeof(hdr), pcm, pcm_bytes);
+    }
+    if (err == ESP_OK) {
+        err = esp_partition_write(s_cache.part, offset, &hdr, sizeof(hdr));
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Flash write at 0x%lx failed: %s", (unsigned long)offset, esp_err_to_name(err));
+        return err;
+    }
+
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    if (s_cache.index_count < s_cache.index_cap) {
+        flash_index_t *e = &s_cache.index[s_cache.index_count++];
+        memcpy(e->key, key, GEMINI_TTS_CACHE_KEY_LEN);
+        e->offset = offset;
+        e->pcm_bytes = pcm_bytes;
+    }
+    s_cache.stats.flash_writes++;
+    xSemaphoreGive(s_cache.lock);
+
+    ESP_LOGI(TAG, "Persisted %lu bytes at 0x%lx", (unsigned long)pcm_bytes, (unsigned long)offset);
+    return ESP_OK;
+}
+
+static void writer_task(void *arg)
+{
+    uint8_t key[GEMINI_TTS_CACHE_KEY_LEN];
+    while (xQueueReceive(s_cache.persist_queue, key, portMAX_DELAY) == pdTRUE && !s_cache.exiting) {
+        xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+        ram_entry_t *e = ram_find_locked(key, NULL);
+        if (!e || e->in_flash || flash_find_locked(key) >= 0) {
+            if (e) {
+                e->in_flash = true;
+            }
+            xSemaphoreGive(s_cache.lock);
+            continue;
+        }
+        e->refs++;
+        xSemaphoreGive(s_cache.lock);
+
+        esp_err_t err = flash_append(key, e->pcm, e->samples * sizeof(int16_t));
+
+        xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+        e->refs--;
+        e->in_flash = (err == ESP_OK);
+        if (e->evicted && e->refs == 0) {
+            ram_entry_free(e);
+        }
+        xSemaphoreGive(s_cache.lock);
+    }
+
+    xSemaphoreGive(s_cache.writer_exited);
+    vTaskDelete(NULL);
+}
+
+static void queue_persist(const uint8_t *key)
+{
+    // Best effort: if the writer is backed up, the next hit will try again
+    if (s_cache.persist_queue) {
+        xQueueSend(s_cache.persist_queue, key, 0);
+    }
+}
+
+// Copy PCM into the RAM tier; false if it does not fit the budget
+static bool ram_insert(const uint8_t *key, const int16_t *pcm, size_t samples, bool in_flash)
+{
+    size_t bytes = samples * sizeof(int16_t);
+    if (bytes == 0 || bytes > s_cache.ram_budget) {
+        return false;
+    }
+
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    bool exists = ram_find_locked(key, NULL) != NULL;
+    xSemaphoreGive(s_cache.lock);
+    if (exists) {
+        return true;
+    }
+
+    ram_entry_t *e = calloc(1, sizeof(ram_entry_t));
+    int16_t *copy = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!e || !copy) {
+        free(e);
+        heap_caps_free(copy);
+        return false;
+    }
+    memcpy(copy, pcm, bytes);
+    memcpy(e->key, key, GEMINI_TTS_CACHE_KEY_LEN);
+    e->pcm = copy;
+    e->samples = samples;
+    e->in_flash = in_flash;
+
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    if (ram_find_locked(key, NULL)) {
+        // Another task inserted the same phrase meanwhile
+        xSemaphoreGive(s_cache.lock);
+        ram_entry_free(e);
+        return true;
+    }
+    while (s_cache.ram_head && s_cache.ram_bytes + bytes > s_cache.ram_budget) {
+        ram_evict_lru_locked();
+    }
+    e->next = s_cache.ram_head;
+    s_cache.ram_head = e;
+    s_cache.ram_bytes += bytes;
+    s_cache.stats.ram_entries++;
+    xSemaphoreGive(s_cache.lock);
+    return true;
+}
+
+esp_err_t gemini_tts_cache_init(void)
+{
+    if (s_cache.initialized) {
+        return ESP_OK;
+    }
+
+    memset(&s_cache, 0, sizeof(s_cache));
+    s_cache.ram_budget = (size_t)CONFIG_GEMINI_TTS_CACHE_RAM_KB * 1024;
+    s_cache.lock = xSemaphoreCreateMutex();
+    if (!s_cache.lock) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_cache.part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                            CONFIG_GEMINI_TTS_CACHE_PARTITION);
+    if (s_cache.part) {
+        s_cache.index_cap = s_cache.part->size / FLASH_SECTOR_SIZE;
+        s_cache.index = heap_caps_calloc(s_cache.index_cap, sizeof(flash_index_t),
+                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!s_cache.index) {
+            s_cache.index = calloc(s_cache.index_cap, sizeof(flash_index_t));
+        }
+        s_cache.persist_queue = xQueueCreate(PERSIST_QUEUE_DEPTH, GEMINI_TTS_CACHE_KEY_LEN);
+        s_cache.writer_exited = xSemaphoreCreateBinary();
+        if (!s_cache.index || !s_cache.persist_queue || !s_cache.writer_exited ||
+            xTaskCreate(writer_task, "tts_cache_wr", WRITER_STACK_SIZE, NULL, 2, NULL) != pdPASS) {
+            ESP_LOGW(TAG, "Flash tier disabled (out of memory)");
+            heap_caps_free(s_cache.index);
+            s_cache.index = NULL;
+            if (s_cache.persist_queue) {
+                vQueueDelete(s_cache.persist_queue);
+                s_cache.persist_queue = NULL;
+            }
+            if (s_cache.writer_exited) {
+                vSemaphoreDelete(s_cache.writer_exited);
+                s_cache.writer_exited = NULL;
+            }
+            s_cache.part = NULL;
+        } else {
+            flash_scan();
+        }
+    } else {
+        ESP_LOGW(TAG, "No '%s' partition, flash tier disabled", CONFIG_GEMINI_TTS_CACHE_PARTITION);
+    }
+
+    s_cache.initialized = true;
+    ESP_LOGI(TAG, "TTS cache ready: RAM budget %d KB, flash %lu KB with %u cached phrase(s)",
+             CONFIG_GEMINI_TTS_CACHE_RAM_KB, s_cache.part ? (unsigned long)(s_cache.part->size / 1024) : 0UL,
+             (unsigned)s_cache.index_count);
+    return ESP_OK;
+}
+
+bool gemini_tts_cache_lookup(const uint8_t key[GEMINI_TTS_CACHE_KEY_LEN], int16_t *out,
+                             size_t max_samples, size_t *samples)
+{
+    if (!s_cache.initialized) {
+        return false;
+    }
+
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    ram_entry_t *prev = NULL;
+    ram_entry_t *e = ram_find_locked(key, &prev);
+    if (e) {
+        if (prev) {
+            prev->next = e->next;
+            e->next = s_cache.ram_head;
+            s_cache.ram_head = e;
+        }
+        *samples = e->samples < max_samples ? e->samples : max_samples;
+        memcpy(out, e->pcm, *samples * sizeof(int16_t));
+        // A repeat proves the phrase is worth keeping across reboots
+        bool persist = s_cache.part && !e->in_flash;
+        s_cache.stats.ram_hits++;
+        xSemaphoreGive(s_cache.lock);
+        if (persist) {
+            queue_persist(key);
+        }
+        return true;
+    }
+
+    // The lock is held across the read so the writer cannot reclaim the region
+    int i = s_cache.part ? flash_find_locked(key) : -1;
+    if (i >= 0) {
+        flash_index_t entry = s_cache.index[i];
+        size_t bytes = entry.pcm_bytes;
+        if (bytes > max_samples * sizeof(int16_t)) {
+            bytes = max_samples * sizeof(int16_t);
+        }
+        bool ok = esp_partition_read(s_cache.part, entry.offset + sizeof(flash_header_t), out, bytes) == ESP_OK;
+        if (ok && bytes == entry.pcm_bytes) {
+            flash_header_t hdr;
+            ok = esp_partition_read(s_cache.part, entry.offset, &hdr, sizeof(hdr)) == ESP_OK &&
+                 hdr.payload_crc == esp_rom_crc32_le(0, (const uint8_t *)out, bytes);
+        }
+        if (ok) {
+            s_cache.stats.flash_hits++;
+            xSemaphoreGive(s_cache.lock);
+            *samples = bytes / sizeof(int16_t);
+            ram_insert(key, out, *samples, true);
+            return true;
+        }
+        ESP_LOGW(TAG, "Dropping corrupt flash entry at 0x%lx", (unsigned long)entry.offset);
+        flash_index_remove_locked(i);
+    }
+
+    s_cache.stats.misses++;
+    xSemaphoreGive(s_cache.lock);
+    return false;
+}
+
+void gemini_tts_cache_store(const uint8_t key[GEMINI_TTS_CACHE_KEY_LEN], const int16_t *pcm,
+                            size_t samples, bool persist)
+{
+    if (!s_cache.initialized) {
+        return;
+    }
+
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    bool in_flash = s_cache.part && flash_find_locked(key) >= 0;
+    xSemaphoreGive(s_cache.lock);
+
+    // The writer copies from the RAM tier, so persisting needs a RAM entry
+    if (ram_insert(key, pcm, samples, in_flash) && persist && s_cache.part && !in_flash) {
+        queue_persist(key);
+    }
+}
+
+void gemini_tts_cache_get_stats(gemini_tts_cache_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!s_cache.initialized) {
+        return;
+    }
+
+    xSemaphoreTake(s_cache.lock, portMAX_DELAY);
+    *stats = s_cache.stats;
+    stats->ram_bytes = s_cache.ram_bytes;
+    stats->ram_budget = s_cache.ram_budget;
+    stats->flash_entries = s_cache.index_count;
+    for (size_t i = 0; i < s_cache.index_count; i++) {
+        stats->flash_bytes += entry_span(s_cache.index[i].pcm_bytes);
+    }
+    stats->flash_capacity = s_cache.part ? s_cache.part->size : 0;
+    xSemaphoreGive(s_cache.lock);
+}
+
+void gemini_tts_cache_deinit(void)
+{
+    if (!s_cache.initialized) {
+        return;
+    }
+
+    if (s_cache.persist_queue) {
+        uint8_t wake[GEMINI_TTS_CACHE_KEY_LEN] = {0};
+        s_cache.exiting = true;
+        xQueueSend(s_cache.persist_queue, wake, portMAX_DELAY);
+        if (xSemaphoreTake(s_cache.writer_exited, pdMS_TO_TICKS(WRITER_EXIT_TIMEOUT_MS)) != pdTRUE) {
+            // The writer still references RAM entries; keep everything alive
+            ESP_LOGE(TAG, "Cache writer did not exit, leaking cache state");
+            return;
+        }
+        vQueueDelete(s_cache.persist_queue);
+        vSemaphoreDelete(s_cache.writer_exited);
+    }
+
+    while (s_cache.ram_head) {
+        ram_entry_t *e = s_cache.ram_head;
+        s_cache.ram_head = e->next;
+        ram_entry_free(e);
+    }
+    heap_caps_free(s_cache.index);
+    vSemaphoreDelete(s_cache.lock);
+    memset(&s_cache, 0, sizeof(s_cache));
+    ESP_LOGI(TAG, "TTS cache deinitialized");
+}
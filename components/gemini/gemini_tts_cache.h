@@ -0,0 +1,73 @@
+#pragma once
+
+#include "esp_err.h"
+#include "gemini_api.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Content-addressed TTS cache
+ *
+ * Synthesized PCM is keyed by a hash of (voice, sample rate, text) and kept
+ * in two tiers:
+ *  - RAM: LRU list in PSRAM, bounded by CONFIG_GEMINI_TTS_CACHE_RAM_KB
+ *  - Flash: append-only ring log in the CONFIG_GEMINI_TTS_CACHE_PARTITION
+ *    data partition, surviving reboots; the oldest entries are overwritten
+ *    when the partition wraps
+ *
+ * Entries reach flash only when they proved worth it (explicit prompt, or a
+ * RAM hit), and are written by a background task so no flash erase ever sits
+ * on the playback path.
+ */
+
+#define GEMINI_TTS_CACHE_KEY_LEN 16
+
+/**
+ * Compute the cache key for a TTS request
+ * @param voice: Voice name
+ * @param sample_rate_hz: Output sample rate
+ * @param text: Text to synthesize
+ * @param key: Output key
+ */
+void gemini_tts_cache_key(const char *voice, int sample_rate_hz, const char *text,
+                          uint8_t key[GEMINI_TTS_CACHE_KEY_LEN]);
+
+/**
+ * Set up the RAM tier, mount the flash partition and start the writer task
+ * A missing partition leaves only the RAM tier active.
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_tts_cache_init(void);
+
+/**
+ * Look up PCM by key (RAM first, then flash)
+ * @param key: Cache key
+ * @param out: Output PCM buffer
+ * @param max_samples: Capacity of out (in samples)
+ * @param samples: Number of samples copied
+ * @return true on hit
+ */
+bool gemini_tts_cache_lookup(const uint8_t key[GEMINI_TTS_CACHE_KEY_LEN], int16_t *out,
+                             size_t max_samples, size_t *samples);
+
+/**
+ * Insert freshly synthesized PCM
+ * @param key: Cache key
+ * @param pcm: PCM samples (copied)
+ * @param samples: Number of samples
+ * @param persist: Also write the entry to flash
+ */
+void gemini_tts_cache_store(const uint8_t key[GEMINI_TTS_CACHE_KEY_LEN], const int16_t *pcm,
+                            size_t samples, bool persist);
+
+/**
+ * Snapshot cache statistics
+ * @param stats: Output statistics
+ */
+void gemini_tts_cache_get_stats(gemini_tts_cache_stats_t *stats);
+
+/**
+ * Stop the writer task and free the RAM tier (flash contents are kept)
+ */
+void gemini_tts_cache_deinit(void);
@@ -0,0 +1,343 @@
+#include "gemini_tts_stream.h"
+#include "minimp3.h"
+#include "turn_arena.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "gemini_tts_stream";
+
+// Compressed bytes held while waiting for whole frames. A 24 kHz MPEG-2
+// layer III frame is at most 480 bytes at 160 kbps; MPEG-1 at most 1441.
+#define MP3_BUF_SIZE        4096
+// Buffered before the first decode attempt, enough for the decoder to lock
+// onto two consecutive frame headers
+#define MP3_SYNC_BYTES      1024
+// Opus is decoded directly at the TTS output rate
+#define TTS_STREAM_OPUS_RATE_HZ 24000
+// Decoded audio handed to the decoders per step
+#define TTS_STREAM_DECODE_BYTES 192
+
+enum {
+    SCAN_KEY,
+    SCAN_COLON,
+    SCAN_QUOTE,
+    SCAN_VALUE,
+    SCAN_DONE,
+};
+
+static const char AUDIO_KEY[] = "\"audioContent\"";
+
+static void append_pcm(gemini_tts_stream_t *s, const int16_t *pcm, size_t samples)
+{
+    size_t room = s->out_cap - s->samples;
+    if (samples > room) {
+        if (!s->truncated) {
+            ESP_LOGW(TAG, "Audio exceeds output buffer (%zu samples), truncating", s->out_cap);
+        }
+        s->truncated = true;
+        samples = room;
+    }
+    memcpy(s->out + s->samples, pcm, samples * sizeof(int16_t));
+    s->samples += samples;
+}
+
+// LINEAR16 audioContent is a WAV file: drop the RIFF header, keep the PCM
+static void linear16_write(gemini_tts_stream_t *s, const uint8_t *data, size_t len)
+{
+    if (!s->head_done) {
+        size_t n = sizeof(s->head) - s->head_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(s->head + s->head_len, data, n);
+        s->head_len += n;
+        data += n;
+        len -= n;
+        if (s->head_len < sizeof(s->head)) {
+            return;
+        }
+        s->head_done = true;
+        if (memcmp(s->head, "RIFF", 4) != 0) {
+            // Raw PCM after all: the held bytes are audio
+            linear16_write(s, s->head, sizeof(s->head));
+        }
+    }
+
+    if (s->has_odd_byte && len > 0) {
+        uint8_t pair[2] = { s->odd_byte, data[0] };
+        int16_t sample;
+        memcpy(&sample, pair, sizeof(sample));
+        append_pcm(s, &sample, 1);
+        s->has_odd_byte = false;
+        data++;
+        len--;
+    }
+    size_t whole = len / sizeof(int16_t);
+    for (size_t i = 0; i < whole && !s->truncated; i++) {
+        int16_t sample;
+        memcpy(&sample, data + i * sizeof(int16_t), sizeof(sample));
+        append_pcm(s, &sample, 1);
+    }
+    if (len % sizeof(int16_t)) {
+        s->odd_byte = data[len - 1];
+        s->has_odd_byte = true;
+    }
+}
+
+// Decode as many complete frames as are buffered
+static void mp3_pump(gemini_tts_stream_t *s, bool final)
+{
+    while (s->mp3_len > 0 && !s->truncated && (final || s->mp3_len >= s->mp3_need)) {
+        size_t samples = 0;
+        size_t used = 0;
+        int hz = 0;
+        int channels = 0;
+        esp_err_t err = mp3_decoder_decode(s->mp3, s->mp3_buf, s->mp3_len, s->frame_pcm,
+                                           MINIMP3_MAX_SAMPLES_PER_FRAME, &samples, &hz, &channels, &used);
+        if (err != ESP_OK || used == 0 || (samples == 0 && used >= s->mp3_len)) {
+            // No complete frame yet: wait for more data, unless there is none
+            // coming or the buffer is full of something that is not MP3
+            if (final || s->mp3_len == MP3_BUF_SIZE) {
+                s->mp3_len = 0;
+            }
+            break;
+        }
+
+        if (samples > 0) {
+            if (s->sample_rate_hz == 0) {
+                s->sample_rate_hz = hz;
+            }
+            if (channels == 2) {
+                // Stereo is never requested; fold it down rather than play it at half speed
+                for (size_t i = 0; i < samples / 2; i++) {
+                    s->frame_pcm[i] = (int16_t)(((int32_t)s->frame_pcm[2 * i] + s->frame_pcm[2 * i + 1]) / 2);
+                }
+                samples /= 2;
+            }
+            append_pcm(s, s->frame_pcm, samples);
+            // Keep a full frame behind the one being decoded so the decoder
+            // can check the next header without losing sync
+            s->mp3_need = 2 * used + 8;
+        }
+
+        memmove(s->mp3_buf, s->mp3_buf + used, s->mp3_len - used);
+        s->mp3_len -= used;
+    }
+}
+
+static void opus_write(gemini_tts_stream_t *s, const uint8_t *data, size_t len)
+{
+    while (len > 0 && !s->truncated) {
+        size_t samples = 0;
+        size_t used = 0;
+        int hz = 0;
+        int channels = 0;
+        esp_err_t err = ogg_opus_decoder_decode(s->opus, data, len, s->frame_pcm,
+                                                OGG_OPUS_MAX_SAMPLES_PER_PACKET(TTS_STREAM_OPUS_RATE_HZ),
+                                                &samples, &hz, &channels, &used);
+        if (err != ESP_OK) {
+            // Not Opus at all: swallow the rest rather than log every chunk
+            s->truncated = true;
+            break;
+        }
+        if (samples > 0) {
+            s->sample_rate_hz = hz;
+            append_pcm(s, s->frame_pcm, samples);
+        }
+        data += used;
+        len -= used;
+    }
+}
+
+static void mp3_write(gemini_tts_stream_t *s, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        size_t n = MP3_BUF_SIZE - s->mp3_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(s->mp3_buf + s->mp3_len, data, n);
+        s->mp3_len += n;
+        data += n;
+        len -= n;
+        mp3_pump(s, false);
+    }
+}
+
+static void audio_write(gemini_tts_stream_t *s, const uint8_t *data, size_t len)
+{
+    switch (s->encoding) {
+        case GEMINI_TTS_STREAM_MP3:
+            mp3_write(s, data, len);
+            break;
+        case GEMINI_TTS_STREAM_OGG_OPUS:
+            opus_write(s, data, len);
+            break;
+        default:
+            linear16_write(s, data, len);
+            break;
+    }
+}
+
+// Decode audioContent characters straight from the response chunk, a
+// stack buffer's worth at a time
+static esp_err_t decode_base64(gemini_tts_stream_t *s, const uint8_t *chars, size_t len)
+{
+    uint8_t bytes[TTS_STREAM_DECODE_BYTES];
+    const size_t slice = sizeof(bytes) / 3 * 4;
+    while (len > 0) {
+        size_t n_chars = len < slice ? len : slice;
+        size_t n = sizeof(bytes);
+        esp_err_t err = streaming_base64_decode(&s->b64_dec, chars, n_chars, bytes, &n);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Invalid base64 in audioContent");
+            return err;
+        }
+        audio_write(s, bytes, n);
+        chars += n_chars;
+        len -= n_chars;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_tts_stream_init(gemini_tts_stream_t *s, gemini_tts_stream_encoding_t encoding,
+                                 int16_t *out, size_t out_cap,
+                                 gemini_tts_stream_progress_cb_t on_progress, void *ctx)
+{
+    memset(s, 0, sizeof(*s));
+    s->encoding = encoding;
+    s->out = out;
+    s->out_cap = out_cap;
+    s->on_progress = on_progress;
+    s->ctx = ctx;
+    streaming_base64_decoder_init(&s->b64_dec);
+
+    if (encoding == GEMINI_TTS_STREAM_MP3) {
+        s->mp3 = mp3_decoder_create();
+        s->mp3_buf = turn_arena_malloc(MP3_BUF_SIZE);
+        s->frame_pcm = turn_arena_malloc(MINIMP3_MAX_SAMPLES_PER_FRAME * sizeof(int16_t));
+        s->mp3_need = MP3_SYNC_BYTES;
+        if (!s->mp3 || !s->mp3_buf || !s->frame_pcm) {
+            gemini_tts_stream_deinit(s);
+            return ESP_ERR_NO_MEM;
+        }
+    } else if (encoding == GEMINI_TTS_STREAM_OGG_OPUS) {
+        if (!ogg_opus_decoder_available()) {
+            ESP_LOGE(TAG, "OGG_OPUS requested but ogg_opus was built without libopus");
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        // Decode straight to the TTS rate and mono; libopus resamples and downmixes internally.
+        // The decoder lives for one response, so its buffers come from the turn arena.
+        static const ogg_opus_allocator_t turn_alloc = { turn_arena_malloc, turn_arena_free };
+        s->opus = ogg_opus_decoder_create(TTS_STREAM_OPUS_RATE_HZ, 1, &turn_alloc);
+        s->frame_pcm = turn_arena_malloc(OGG_OPUS_MAX_SAMPLES_PER_PACKET(TTS_STREAM_OPUS_RATE_HZ) * sizeof(int16_t));
+        if (!s->opus || !s->frame_pcm) {
+            gemini_tts_stream_deinit(s);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_tts_stream_feed(gemini_tts_stream_t *s, const uint8_t *data, size_t len)
+{
+    size_t before = s->samples;
+    s->bytes_in += len;
+
+    for (size_t i = 0; i < len && s->state != SCAN_DONE; i++) {
+        char c = (char)data[i];
+        switch (s->state) {
+            case SCAN_KEY:
+                if (c == AUDIO_KEY[s->match]) {
+                    if (++s->match == sizeof(AUDIO_KEY) - 1) {
+                        s->state = SCAN_COLON;
+                    }
+                } else {
+                    s->match = (c == '"') ? 1 : 0;
+                }
+                break;
+            case SCAN_COLON:
+            case SCAN_QUOTE:
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                    break;
+                }
+                if (s->state == SCAN_COLON && c == ':') {
+                    s->state = SCAN_QUOTE;
+                } else if (s->state == SCAN_QUOTE && c == '"') {
+                    s->state = SCAN_VALUE;
+                } else {
+                    s->state = SCAN_KEY;
+                    s->match = 0;
+                }
+                break;
+            case SCAN_VALUE: {
+                // The run up to the closing quote goes to the decoder as is;
+                // it handles JSON escapes ("\/", "\n") itself
+                size_t start = i;
+                while (i < len && (s->escape || data[i] != '"')) {
+                    s->escape = !s->escape && data[i] == '\\';
+                    i++;
+                }
+                esp_err_t err = decode_base64(s, data + start, i - start);
+                if (err != ESP_OK) {
+                    return err;
+                }
+                if (i < len) {
+                    s->state = SCAN_DONE;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    if (s->samples != before && s->on_progress) {
+        s->on_progress(s->samples, s->ctx);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_tts_stream_finish(gemini_tts_stream_t *s)
+{
+    if (s->state != SCAN_DONE) {
+        ESP_LOGE(TAG, "audioContent missing or incomplete in response");
+        return ESP_FAIL;
+    }
+
+    size_t before = s->samples;
+    uint8_t tail[1];
+    size_t n = sizeof(tail);
+    if (streaming_base64_decode_finish(&s->b64_dec, tail, &n) != ESP_OK) {
+        ESP_LOGW(TAG, "audioContent ends in an incomplete base64 group");
+    }
+    if (s->encoding == GEMINI_TTS_STREAM_MP3) {
+        mp3_pump(s, true);
+    } else if (!s->head_done && s->head_len > 0) {
+        // Shorter than a WAV header: whatever arrived is raw PCM
+        s->head_done = true;
+        linear16_write(s, s->head, s->head_len);
+    }
+
+    if (s->samples != before && s->on_progress) {
+        s->on_progress(s->samples, s->ctx);
+    }
+    return s->samples > 0 ? ESP_OK : ESP_FAIL;
+}
+
+void gemini_tts_stream_deinit(gemini_tts_stream_t *s)
+{
+    if (s->mp3) {
+        mp3_decoder_destroy(s->mp3);
+        s->mp3 = NULL;
+    }
+    if (s->opus) {
+        ogg_opus_decoder_destroy(s->opus);
+        s->opus = NULL;
+    }
+    turn_arena_free(s->mp3_buf);
+    s->mp3_buf = NULL;
+    turn_arena_free(s->frame_pcm);
+    s->frame_pcm = NULL;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "esp_err.h"
+#include "mp3_decoder.h"
+#include "ogg_opus_decoder.h"
+#include "streaming_base64.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Incremental decoder for text:synthesize responses
+ *
+ * The response is `{"audioContent": "<base64>", ...}`. Bytes are fed as they
+ * arrive from the network; the audioContent value is located by a small
+ * scanner, base64-decoded in place and turned into PCM in the caller's
+ * buffer (LINEAR16: WAV header stripped; MP3 / OGG_OPUS: decoded frame by
+ * frame), so playback can start long before the response is complete.
+ */
+
+typedef enum {
+    GEMINI_TTS_STREAM_LINEAR16,
+    GEMINI_TTS_STREAM_MP3,
+    GEMINI_TTS_STREAM_OGG_OPUS,
+} gemini_tts_stream_encoding_t;
+
+/**
+ * PCM progress callback
+ * @param samples_ready: audio_out[0 .. samples_ready) is final
+ * @param ctx: User context
+ */
+typedef void (*gemini_tts_stream_progress_cb_t)(size_t samples_ready, void *ctx);
+
+typedef struct {
+    gemini_tts_stream_encoding_t encoding;
+    int16_t *out;
+    size_t out_cap;             // In samples
+    size_t samples;             // Samples written to out
+    bool truncated;             // out filled up before the audio ended
+    gemini_tts_stream_progress_cb_t on_progress;
+    void *ctx;
+
+    // Response scanner
+    uint8_t state;
+    uint8_t match;
+    bool escape;
+    streaming_base64_decoder_t b64_dec;
+
+    // LINEAR16: WAV header detection and odd-byte carry
+    uint8_t head[44];
+    size_t head_len;
+    bool head_done;
+    uint8_t odd_byte;
+    bool has_odd_byte;
+
+    // MP3: compressed bytes waiting for a complete frame
+    mp3_decoder_t *mp3;
+    uint8_t *mp3_buf;
+    size_t mp3_len;
+    size_t mp3_need;            // Decode once this many bytes are buffered
+    int16_t *frame_pcm;         // One decoded MP3 frame / Opus packet
+    int sample_rate_hz;         // From the first decoded MP3 frame
+
+    // OGG_OPUS: the decoder demuxes pages itself, no buffering needed here
+    ogg_opus_decoder_t *opus;
+
+    size_t bytes_in;            // Response bytes consumed
+} gemini_tts_stream_t;
+
+/**
+ * Prepare a stream decoder
+ * @param s: Decoder state
+ * @param encoding: audioEncoding requested from the API
+ * @param out: PCM output buffer
+ * @param out_cap: Capacity of out (in samples)
+ * @param on_progress: Optional progress callback
+ * @param ctx: Context for on_progress
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if decoder buffers cannot be
+ *         allocated, ESP_ERR_NOT_SUPPORTED for OGG_OPUS without libopus
+ */
+esp_err_t gemini_tts_stream_init(gemini_tts_stream_t *s, gemini_tts_stream_encoding_t encoding,
+                                 int16_t *out, size_t out_cap,
+                                 gemini_tts_stream_progress_cb_t on_progress, void *ctx);
+
+/**
+ * Feed response body bytes
+ * @param s: Decoder state
+ * @param data: Response bytes
+ * @param len: Number of bytes
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_tts_stream_feed(gemini_tts_stream_t *s, const uint8_t *data, size_t len);
+
+/**
+ * Flush buffered audio at the end of the response
+ * @param s: Decoder state
+ * @return ESP_OK if audioContent was found and decoded
+ */
+esp_err_t gemini_tts_stream_finish(gemini_tts_stream_t *s);
+
+/**
+ * Free decoder buffers
+ * @param s: Decoder state
+ */
+void gemini_tts_stream_deinit(gemini_tts_stream_t *s);
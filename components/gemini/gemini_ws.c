@@ -0,0 +1,504 @@
+#include "gemini_ws.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_crt_bundle.h"
+#include "esp_transport.h"
+#include "esp_transport_ssl.h"
+#include "esp_transport_tcp.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "mbedtls/base64.h"
+#include "mbedtls/sha1.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "gemini_ws";
+
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_LEN 24           // Base64 of the 16-byte nonce
+#define WS_RX_BUF_SIZE 1024
+#define WS_TX_BUF_SIZE 512
+#define WS_HANDSHAKE_MAX 1024
+
+struct gemini_ws {
+    esp_transport_handle_t transport;
+    int timeout_ms;
+    SemaphoreHandle_t send_lock;
+    bool broken;                    // I/O failed mid-frame; the stream is unusable
+    bool close_sent;
+    bool close_received;
+    uint16_t close_code;
+
+    // Frame being sent
+    uint8_t mask[4];
+    size_t send_len;
+    size_t send_done;
+
+    // Fragmented message being received
+    bool in_message;
+    gemini_ws_opcode_t msg_opcode;
+
+    uint8_t rx[WS_RX_BUF_SIZE];
+    size_t rx_len;
+    size_t rx_pos;
+    uint8_t tx[WS_TX_BUF_SIZE];
+};
+
+static esp_err_t write_all(gemini_ws_t *ws, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        int n = esp_transport_write(ws->transport, (const char *)data, (int)len, ws->timeout_ms);
+        if (n <= 0) {
+            ws->broken = true;
+            return ESP_FAIL;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return ESP_OK;
+}
+
+// Make at least one unread byte available in rx
+static esp_err_t fill(gemini_ws_t *ws)
+{
+    if (ws->rx_pos < ws->rx_len) {
+        return ESP_OK;
+    }
+    ws->rx_pos = 0;
+    ws->rx_len = 0;
+    int n = esp_transport_read(ws->transport, (char *)ws->rx, sizeof(ws->rx), ws->timeout_ms);
+    if (n > 0) {
+        ws->rx_len = (size_t)n;
+        return ESP_OK;
+    }
+    ws->broken = true;
+    if (n == ERR_TCP_TRANSPORT_CONNECTION_CLOSED_BY_FIN) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return n == ERR_TCP_TRANSPORT_CONNECTION_TIMEOUT ? ESP_ERR_TIMEOUT : ESP_FAIL;
+}
+
+static esp_err_t read_exact(gemini_ws_t *ws, uint8_t *out, size_t len)
+{
+    while (len > 0) {
+        esp_err_t ret = fill(ws);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        size_t n = ws->rx_len - ws->rx_pos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(out, ws->rx + ws->rx_pos, n);
+        ws->rx_pos += n;
+        out += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static bool parse_url(const char *url, bool *tls, char *host, size_t host_len, int *port, const char **path)
+{
+    if (strncmp(url, "wss://", 6) == 0) {
+        *tls = true;
+        url += 6;
+    } else if (strncmp(url, "ws://", 5) == 0) {
+        *tls = false;
+        url += 5;
+    } else {
+        return false;
+    }
+    size_t authority = strcspn(url, "/?");
+    const char *colon = memchr(url, ':', authority);
+    size_t name_len = colon ? (size_t)(colon - url) : authority;
+    if (name_len == 0 || name_len >= host_len) {
+        return false;
+    }
+    memcpy(host, url, name_len);
+    host[name_len] = '\0';
+    *port = colon ? atoi(colon + 1) : (*tls ? 443 : 80);
+    *path = url + authority;
+    return true;
+}
+
+// Read the handshake response headers, leaving anything after them in rx
+static esp_err_t read_handshake(gemini_ws_t *ws, char *buf, size_t cap)
+{
+    size_t len = 0;
+    while (len < 4 || memcmp(buf + len - 4, "\r\n\r\n", 4) != 0) {
+        if (len + 1 >= cap) {
+            ESP_LOGE(TAG, "Handshake response too long");
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        esp_err_t ret = fill(ws);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        buf[len++] = (char)ws->rx[ws->rx_pos++];
+    }
+    buf[len] = '\0';
+    return ESP_OK;
+}
+
+static esp_err_t check_handshake(const char *response, const char *key)
+{
+    int status = 0;
+    if (sscanf(response, "HTTP/1.1 %d", &status) != 1 || status != 101) {
+        ESP_LOGE(TAG, "Upgrade refused: %.*s", (int)strcspn(response, "\r\n"), response);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    char concat[WS_KEY_LEN + sizeof(WS_GUID)];
+    uint8_t digest[20];
+    unsigned char expected[32];
+    size_t expected_len = 0;
+    snprintf(concat, sizeof(concat), "%.*s%s", WS_KEY_LEN, key, WS_GUID);
+    mbedtls_sha1((const unsigned char *)concat, strlen(concat), digest);
+    mbedtls_base64_encode(expected, sizeof(expected), &expected_len, digest, sizeof(digest));
+
+    for (const char *line = strstr(response, "\r\n"); line && line[2]; line = strstr(line + 2, "\r\n")) {
+        const char *name = line + 2;
+        if (strncasecmp(name, "Sec-WebSocket-Accept:", 21) == 0) {
+            const char *value = name + 21;
+            while (*value == ' ') {
+                value++;
+            }
+            if (strncmp(value, (const char *)expected, expected_len) == 0) {
+                return ESP_OK;
+            }
+            break;
+        }
+    }
+    ESP_LOGE(TAG, "Missing or wrong Sec-WebSocket-Accept");
+    return ESP_ERR_INVALID_RESPONSE;
+}
+
+esp_err_t gemini_ws_connect(const char *url, int timeout_ms, gemini_ws_t **out)
+{
+    if (!url || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = NULL;
+
+    bool tls = false;
+    char host[128];
+    int port = 0;
+    const char *path = NULL;
+    if (!parse_url(url, &tls, host, sizeof(host), &port, &path)) {
+        ESP_LOGE(TAG, "Invalid WebSocket URL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gemini_ws_t *ws = calloc(1, sizeof(gemini_ws_t));
+    if (!ws) {
+        return ESP_ERR_NO_MEM;
+    }
+    ws->timeout_ms = timeout_ms;
+    ws->send_lock = xSemaphoreCreateMutex();
+    ws->transport = tls ? esp_transport_ssl_init() : esp_transport_tcp_init();
+    if (!ws->send_lock || !ws->transport) {
+        gemini_ws_close(ws);
+        return ESP_ERR_NO_MEM;
+    }
+    if (tls) {
+        esp_transport_ssl_crt_bundle_attach(ws->transport, esp_crt_bundle_attach);
+    }
+
+    if (esp_transport_connect(ws->transport, host, port, timeout_ms) < 0) {
+        ESP_LOGE(TAG, "Failed to connect to %s:%d", host, port);
+        ws->broken = true;
+        gemini_ws_close(ws);
+        return ESP_FAIL;
+    }
+
+    uint8_t nonce[16];
+    char key[WS_KEY_LEN + 1];
+    size_t key_len = 0;
+    esp_fill_random(nonce, sizeof(nonce));
+    mbedtls_base64_encode((unsigned char *)key, sizeof(key), &key_len, nonce, sizeof(nonce));
+    key[key_len] = '\0';
+
+    // The handshake buffer is reused for the response, so keep it off the stack
+    char *buf = malloc(WS_HANDSHAKE_MAX);
+    if (!buf) {
+        gemini_ws_close(ws);
+        return ESP_ERR_NO_MEM;
+    }
+    int n = snprintf(buf, WS_HANDSHAKE_MAX,
+                     "GET %s%s HTTP/1.1\r\n"
+                     "Host: %s\r\n"
+                     "Upgrade: websocket\r\n"
+                     "Connection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: %s\r\n"
+                     "Sec-WebSocket-Version: 13\r\n"
+                     "\r\n",
+                     *path == '/' ? "" : "/", path, host, key);
+    esp_err_t ret = n < WS_HANDSHAKE_MAX ? write_all(ws, (const uint8_t *)buf, (size_t)n) : ESP_ERR_INVALID_SIZE;
+    if (ret == ESP_OK) {
+        ret = read_handshake(ws, buf, WS_HANDSHAKE_MAX);
+    }
+    if (ret == ESP_OK) {
+        ret = check_handshake(buf, key);
+    }
+    free(buf);
+    if (ret != ESP_OK) {
+        ws->broken = true;
+        gemini_ws_close(ws);
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Connected to %s://%s:%d", tls ? "wss" : "ws", host, port);
+    *out = ws;
+    return ESP_OK;
+}
+
+esp_err_t gemini_ws_send_begin(gemini_ws_t *ws, gemini_ws_opcode_t opcode, size_t len)
+{
+    if (!ws) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(ws->send_lock, portMAX_DELAY);
+    if (ws->broken || ws->close_sent) {
+        xSemaphoreGive(ws->send_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t header[14];
+    size_t n = 0;
+    header[n++] = 0x80 | (uint8_t)opcode;
+    if (len < 126) {
+        header[n++] = 0x80 | (uint8_t)len;
+    } else if (len <= 0xFFFF) {
+        header[n++] = 0x80 | 126;
+        header[n++] = (uint8_t)(len >> 8);
+        header[n++] = (uint8_t)len;
+    } else {
+        header[n++] = 0x80 | 127;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            header[n++] = (uint8_t)((uint64_t)len >> shift);
+        }
+    }
+    // Clients must mask every frame with a fresh key
+    uint32_t key = esp_random();
+    memcpy(ws->mask, &key, sizeof(ws->mask));
+    memcpy(header + n, ws->mask, sizeof(ws->mask));
+    n += sizeof(ws->mask);
+
+    ws->send_len = len;
+    ws->send_done = 0;
+    esp_err_t ret = write_all(ws, header, n);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(ws->send_lock);
+    }
+    return ret;
+}
+
+esp_err_t gemini_ws_send_data(gemini_ws_t *ws, const void *data, size_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    if (ws->send_done + len > ws->send_len) {
+        ws->broken = true;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    while (len > 0) {
+        size_t n = len > sizeof(ws->tx) ? sizeof(ws->tx) : len;
+        for (size_t i = 0; i < n; i++) {
+            ws->tx[i] = src[i] ^ ws->mask[(ws->send_done + i) & 3];
+        }
+        esp_err_t ret = write_all(ws, ws->tx, n);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        ws->send_done += n;
+        src += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gemini_ws_send_end(gemini_ws_t *ws)
+{
+    esp_err_t ret = ESP_OK;
+    if (ws->send_done != ws->send_len) {
+        // A short frame would desynchronize the stream for good
+        ws->broken = true;
+        ret = ESP_ERR_INVALID_SIZE;
+    } else if (ws->broken) {
+        ret = ESP_FAIL;
+    }
+    xSemaphoreGive(ws->send_lock);
+    return ret;
+}
+
+esp_err_t gemini_ws_send(gemini_ws_t *ws, gemini_ws_opcode_t opcode, const void *data, size_t len)
+{
+    esp_err_t ret = gemini_ws_send_begin(ws, opcode, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = gemini_ws_send_data(ws, data, len);
+    esp_err_t end = gemini_ws_send_end(ws);
+    return ret != ESP_OK ? ret : end;
+}
+
+static esp_err_t handle_control(gemini_ws_t *ws, gemini_ws_opcode_t opcode, const uint8_t *payload, size_t len)
+{
+    switch (opcode) {
+    case GEMINI_WS_OP_PING:
+        return gemini_ws_send(ws, GEMINI_WS_OP_PONG, payload, len);
+    case GEMINI_WS_OP_CLOSE:
+        ws->close_received = true;
+        ws->close_code = len >= 2 ? (uint16_t)((payload[0] << 8) | payload[1]) : 1005;
+        ESP_LOGI(TAG, "Server closed the connection (%u%s%.*s)", ws->close_code,
+                 len > 2 ? ": " : "", len > 2 ? (int)(len - 2) : 0, (const char *)payload + 2);
+        // Echo the close, then the connection is done
+        if (gemini_ws_send(ws, GEMINI_WS_OP_CLOSE, payload, len >= 2 ? 2 : 0) == ESP_OK) {
+            ws->close_sent = true;
+        }
+        return ESP_ERR_INVALID_STATE;
+    default:
+        return ESP_OK;  // Unsolicited pong
+    }
+}
+
+esp_err_t gemini_ws_recv(gemini_ws_t *ws, gemini_ws_sink_t sink, void *ctx, int wait_ms,
+                         gemini_ws_opcode_t *opcode)
+{
+    if (!ws || !sink) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ws->close_received) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (ws->broken) {
+        return ESP_FAIL;
+    }
+    if (ws->rx_pos == ws->rx_len && !ws->in_message) {
+        int ready = esp_transport_poll_read(ws->transport, wait_ms);
+        if (ready == 0) {
+            return ESP_ERR_TIMEOUT;
+        }
+        if (ready < 0) {
+            ws->broken = true;
+            return ESP_FAIL;
+        }
+    }
+
+    for (;;) {
+        uint8_t head[2];
+        esp_err_t ret = read_exact(ws, head, sizeof(head));
+        if (ret != ESP_OK) {
+            return ret == ESP_ERR_TIMEOUT ? ESP_FAIL : ret;
+        }
+        bool fin = head[0] & 0x80;
+        gemini_ws_opcode_t op = (gemini_ws_opcode_t)(head[0] & 0x0F);
+        bool masked = head[1] & 0x80;
+        uint64_t len = head[1] & 0x7F;
+        if (head[0] & 0x70) {
+            ESP_LOGE(TAG, "Frame uses an extension that was not negotiated");
+            ws->broken = true;
+            return ESP_FAIL;
+        }
+        if (len >= 126) {
+            uint8_t ext[8];
+            size_t ext_len = len == 126 ? 2 : 8;
+            ret = read_exact(ws, ext, ext_len);
+            if (ret != ESP_OK) {
+                return ESP_FAIL;
+            }
+            len = 0;
+            for (size_t i = 0; i < ext_len; i++) {
+                len = (len << 8) | ext[i];
+            }
+        }
+        uint8_t mask[4] = {0};
+        if (masked && read_exact(ws, mask, sizeof(mask)) != ESP_OK) {
+            return ESP_FAIL;
+        }
+
+        if (op & 0x8) {
+            uint8_t payload[125];
+            if (!fin || len > sizeof(payload) || read_exact(ws, payload, (size_t)len) != ESP_OK) {
+                ws->broken = true;
+                return ESP_FAIL;
+            }
+            for (size_t i = 0; masked && i < len; i++) {
+                payload[i] ^= mask[i & 3];
+            }
+            ret = handle_control(ws, op, payload, (size_t)len);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            continue;
+        }
+
+        if ((op == GEMINI_WS_OP_CONTINUATION) != ws->in_message) {
+            ESP_LOGE(TAG, "Unexpected %s frame", op == GEMINI_WS_OP_CONTINUATION ? "continuation" : "data");
+            ws->broken = true;
+            return ESP_FAIL;
+        }
+        if (op != GEMINI_WS_OP_CONTINUATION) {
+            ws->in_message = true;
+            ws->msg_opcode = op;
+        }
+
+        // Hand the payload over straight from the receive buffer
+        uint64_t off = 0;
+        while (off < len) {
+            ret = fill(ws);
+            if (ret != ESP_OK) {
+                return ESP_FAIL;
+            }
+            size_t n = ws->rx_len - ws->rx_pos;
+            if ((uint64_t)n > len - off) {
+                n = (size_t)(len - off);
+            }
+            uint8_t *data = ws->rx + ws->rx_pos;
+            for (size_t i = 0; masked && i < n; i++) {
+                data[i] ^= mask[(off + i) & 3];
+            }
+            ws->rx_pos += n;
+            off += n;
+            ret = sink(data, n, ctx);
+            if (ret != ESP_OK) {
+                // The rest of the message is still on the wire
+                ws->broken = true;
+                return ret;
+            }
+        }
+
+        if (fin) {
+            ws->in_message = false;
+            if (opcode) {
+                *opcode = ws->msg_opcode;
+            }
+            return ESP_OK;
+        }
+    }
+}
+
+uint16_t gemini_ws_close_code(const gemini_ws_t *ws)
+{
+    return ws ? ws->close_code : 0;
+}
+
+void gemini_ws_close(gemini_ws_t *ws)
+{
+    if (!ws) {
+        return;
+    }
+    if (ws->transport) {
+        if (!ws->broken && !ws->close_sent && ws->send_lock) {
+            const uint8_t normal[2] = { 1000 >> 8, 1000 & 0xFF };
+            gemini_ws_send(ws, GEMINI_WS_OP_CLOSE, normal, sizeof(normal));
+        }
+        esp_transport_close(ws->transport);
+        esp_transport_destroy(ws->transport);
+    }
+    if (ws->send_lock) {
+        vSemaphoreDelete(ws->send_lock);
+    }
+    free(ws);
+}
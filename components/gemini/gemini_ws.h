@@ -0,0 +1,116 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Minimal WebSocket client (RFC 6455) for the Live session
+ *
+ * Runs over esp_transport: TLS for wss:// URLs (certificate bundle), plain
+ * TCP for ws:// (local stand-in servers). Messages are streamed in both
+ * directions: a frame is written as header + payload pieces, masked on the
+ * fly through a small buffer, and received payloads are handed to a sink
+ * as they are read, so neither side ever holds a whole message unless the
+ * caller wants it to. Pings are answered and fragmented messages are
+ * reassembled transparently.
+ *
+ * One task may receive while another sends; sends are serialized internally.
+ */
+
+typedef struct gemini_ws gemini_ws_t;
+
+typedef enum {
+    GEMINI_WS_OP_CONTINUATION = 0x0,
+    GEMINI_WS_OP_TEXT = 0x1,
+    GEMINI_WS_OP_BINARY = 0x2,
+    GEMINI_WS_OP_CLOSE = 0x8,
+    GEMINI_WS_OP_PING = 0x9,
+    GEMINI_WS_OP_PONG = 0xA,
+} gemini_ws_opcode_t;
+
+/**
+ * Received payload consumer
+ * @param data: Payload bytes (valid only during the call)
+ * @param len: Number of bytes
+ * @param ctx: User context
+ * @return ESP_OK to continue; an error fails the receive
+ */
+typedef esp_err_t (*gemini_ws_sink_t)(const uint8_t *data, size_t len, void *ctx);
+
+/**
+ * Connect and perform the opening handshake
+ * @param url: ws://host[:port]/path?query or wss://host[:port]/path?query
+ * @param timeout_ms: Network timeout for connect and every later read/write
+ * @param out: New connection
+ * @return ESP_OK on success, ESP_ERR_INVALID_RESPONSE if the server refused the upgrade
+ */
+esp_err_t gemini_ws_connect(const char *url, int timeout_ms, gemini_ws_t **out);
+
+/**
+ * Start a frame of known length (takes the send lock)
+ * Must be followed by gemini_ws_send_data() calls totalling `len` bytes and
+ * gemini_ws_send_end().
+ * @param ws: Connection
+ * @param opcode: GEMINI_WS_OP_TEXT or GEMINI_WS_OP_BINARY
+ * @param len: Payload length
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_ws_send_begin(gemini_ws_t *ws, gemini_ws_opcode_t opcode, size_t len);
+
+/**
+ * Write part of the payload of the current frame
+ * @param ws: Connection
+ * @param data: Payload bytes (not modified; masking uses an internal buffer)
+ * @param len: Number of bytes
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_ws_send_data(gemini_ws_t *ws, const void *data, size_t len);
+
+/**
+ * Finish the current frame (releases the send lock)
+ * @param ws: Connection
+ * @return ESP_OK if the whole announced payload was written
+ */
+esp_err_t gemini_ws_send_end(gemini_ws_t *ws);
+
+/**
+ * Send a complete message in one frame
+ * @param ws: Connection
+ * @param opcode: Frame opcode
+ * @param data: Payload
+ * @param len: Payload length
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_ws_send(gemini_ws_t *ws, gemini_ws_opcode_t opcode, const void *data, size_t len);
+
+/**
+ * Receive one complete data message
+ * Control frames arriving before or between its fragments are handled
+ * here. Only the wait for the first frame is bounded by wait_ms; once a
+ * frame has started the connection timeout applies.
+ * @param ws: Connection
+ * @param sink: Called with the payload as it is read
+ * @param ctx: Context for sink
+ * @param wait_ms: How long to wait for a message to start
+ * @param opcode: Out: GEMINI_WS_OP_TEXT or GEMINI_WS_OP_BINARY (may be NULL)
+ * @return ESP_OK when a message was delivered, ESP_ERR_TIMEOUT if none
+ *         started, ESP_ERR_INVALID_STATE once the peer closed the connection,
+ *         ESP_FAIL on a network or protocol error
+ */
+esp_err_t gemini_ws_recv(gemini_ws_t *ws, gemini_ws_sink_t sink, void *ctx, int wait_ms,
+                         gemini_ws_opcode_t *opcode);
+
+/**
+ * Close code sent by the peer, 0 if none was received
+ * @param ws: Connection
+ * @return Close status code
+ */
+uint16_t gemini_ws_close_code(const gemini_ws_t *ws);
+
+/**
+ * Send a close frame (best effort), close the socket and free the connection
+ * @param ws: Connection (may be NULL)
+ */
+void gemini_ws_close(gemini_ws_t *ws);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "esp_err.h"
+#include "sdkconfig.h"
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -16,6 +18,153 @@ typedef struct {
     char model[64];     // Model name (e.g., "gemini-1.5-flash" or "gemini-1.5-pro")
 } gemini_config_t;
 
+/**
+ * HTTPS connection pool statistics
+ */
+typedef struct {
+    uint32_t requests;           // Total HTTP requests issued
+    uint32_t reused;             // Requests served on an already-open connection
+    uint32_t handshakes;         // New TCP+TLS connections established
+    uint32_t retries;            // Reused connections found closed by the server and re-opened
+    int64_t handshake_us_total;  // Time spent establishing new connections
+    int64_t saved_us_total;      // Estimated handshake time avoided by reuse
+    uint32_t prewarmed;          // Connections opened ahead of their request (gemini_api_prewarm)
+} gemini_http_pool_stats_t;
+
+/**
+ * Network timing of one HTTP request
+ * Phases are measured on the calling task with esp_timer. dns_us and
+ * connect_us are zero when the request ran on an already-open pooled
+ * connection. esp_http_client performs the TCP connect and the TLS handshake
+ * in one call, so connect_us covers both.
+ */
+typedef struct {
+    char host[48];              // Endpoint host (truncated)
+    int status;                 // HTTP status, 0 if no response was received
+    esp_err_t err;              // Result of the request
+    bool reused;                // Ran on a pooled, already-open connection
+    int64_t start_us;           // esp_timer_get_time() when the request started
+    int64_t dns_us;             // Host name resolution
+    int64_t connect_us;         // TCP connect + TLS handshake
+    int64_t upload_us;          // Request headers and body written
+    int64_t ttfb_us;            // Body written -> response headers received
+    int64_t transfer_us;        // Response headers -> body complete
+    int64_t total_us;           // Whole request, retries included
+    size_t bytes_up;            // Request body bytes
+    size_t bytes_down;          // Response body bytes (after de-chunking)
+} gemini_http_timing_t;
+
+/**
+ * Network totals over the requests of one voice turn
+ * Requests may overlap (concurrent TTS), so phase sums can exceed the turn's
+ * wall-clock time.
+ */
+typedef struct {
+    uint32_t requests;
+    uint32_t new_connections;
+    uint32_t failed;
+    int64_t dns_us;
+    int64_t connect_us;
+    int64_t upload_us;
+    int64_t ttfb_us;
+    int64_t transfer_us;
+    size_t bytes_up;
+    size_t bytes_down;
+} gemini_turn_metrics_t;
+
+#define GEMINI_HTTP_ENDPOINT_NAME_LEN 48
+
+/**
+ * Latency statistics of one API endpoint
+ * First byte is request start -> response headers, connection setup
+ * included. Percentiles cover the last `samples` requests that got an
+ * answer; requests that missed their deadline count in deadline_misses.
+ */
+typedef struct {
+    char endpoint[GEMINI_HTTP_ENDPOINT_NAME_LEN]; // Last URL path segment, e.g. "text:synthesize"
+    uint32_t requests;          // Attempts, duplicates included
+    uint32_t hedged;            // Requests that sent a duplicate
+    uint32_t hedge_wins;        // Duplicates that answered first
+    uint32_t deadline_misses;   // Attempts with no response by their deadline
+    uint32_t samples;
+    uint32_t p50_ms;
+    uint32_t p95_ms;
+    uint32_t p99_ms;
+} gemini_http_endpoint_stats_t;
+
+/**
+ * TTS cache statistics
+ */
+typedef struct {
+    uint32_t ram_hits;           // Served from the PSRAM LRU tier
+    uint32_t flash_hits;         // Served from the flash tier
+    uint32_t misses;             // Synthesized over the network
+    uint32_t evictions;          // RAM entries dropped to stay within budget
+    uint32_t flash_writes;       // Entries persisted to flash
+    uint32_t ram_entries;
+    size_t ram_bytes;
+    size_t ram_budget;
+    uint32_t flash_entries;
+    size_t flash_bytes;          // Flash used by live entries (sector-rounded)
+    size_t flash_capacity;       // Size of the cache partition (0 if absent)
+} gemini_tts_cache_stats_t;
+
+/**
+ * Cancellation token for an in-flight request
+ * Set `cancelled` from any task; the request notices between network reads,
+ * drops its connection and returns ESP_ERR_NOT_FINISHED. Connect and the
+ * wait for response headers are only interruptible for hedged requests
+ * (LLM and TTS), which wait on their own tasks.
+ */
+typedef struct {
+    volatile bool cancelled;
+} gemini_cancel_t;
+
+/**
+ * Number of most recent request timings kept for gemini_api_get_turn_metrics()
+ */
+#define GEMINI_HTTP_TIMING_HISTORY 16
+
+/**
+ * Stack needed by a task that calls the TTS functions
+ * Compressed transports decode on the caller's task: minimp3 keeps about
+ * 16 KB of scratch on the stack per frame, and libopus allocates its
+ * per-frame scratch with alloca.
+ */
+#if CONFIG_GEMINI_TTS_ENCODING_MP3 || CONFIG_GEMINI_TTS_ENCODING_OGG_OPUS
+#define GEMINI_TTS_MIN_STACK_SIZE (24 * 1024)
+#else
+#define GEMINI_TTS_MIN_STACK_SIZE 8192
+#endif
+
+/**
+ * TTS progress callback
+ * Called on the synthesizing task whenever more PCM has been decoded.
+ * @param samples_ready: audio_out[0 .. samples_ready) is final and may be played
+ * @param user_ctx: User context
+ */
+typedef void (*gemini_tts_progress_cb_t)(size_t samples_ready, void *user_ctx);
+
+/**
+ * Options for gemini_tts_ex()
+ */
+typedef struct {
+    const gemini_cancel_t *cancel;      // Cancellation token (NULL for none)
+    gemini_tts_progress_cb_t on_progress; // Optional, for playback during download
+    void *user_ctx;                     // Context for on_progress
+    bool persist;                       // Also write the result to the flash cache
+} gemini_tts_opts_t;
+
+/**
+ * A recording held in up to two pieces that play back to back, such as a
+ * range of a ring buffer that wraps; uploaded as one recording without
+ * joining the pieces first
+ */
+typedef struct {
+    const int16_t *pcm[2];  // Pieces in order (pcm[1] NULL when there is one)
+    size_t samples[2];      // Their lengths
+} gemini_pcm_parts_t;
+
 /**
  * Initialize Gemini API client
  * @param config: API configuration
@@ -33,6 +182,15 @@ esp_err_t gemini_api_init(const gemini_config_t *config);
  */
 esp_err_t gemini_stt(const int16_t *audio_data, size_t audio_len, char *text_out, size_t text_len);
 
+/**
+ * Speech-to-Text for a recording in pieces (see gemini_pcm_parts_t)
+ * @param audio: PCM pieces (16-bit, 16kHz mono)
+ * @param text_out: Buffer to store transcribed text
+ * @param text_len: Size of text buffer
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_stt_parts(const gemini_pcm_parts_t *audio, char *text_out, size_t text_len);
+
 /**
  * LLM: Send text prompt and get response
  * @param prompt: Input text prompt
@@ -42,6 +200,54 @@ esp_err_t gemini_stt(const int16_t *audio_data, size_t audio_len, char *text_out
  */
 esp_err_t gemini_llm(const char *prompt, char *response, size_t response_len);
 
+/**
+ * Streaming text callback
+ * @param text: Text delta (valid only during the call)
+ * @param user_ctx: User context
+ * @return true to keep streaming, false to stop the request
+ */
+typedef bool (*gemini_text_cb_t)(const char *text, void *user_ctx);
+
+/**
+ * LLM (streaming): Send text prompt and receive the response incrementally
+ * Uses streamGenerateContent over server-sent events; on_text is called on
+ * the caller's task with each text delta as soon as it arrives.
+ * @param prompt: Input text prompt
+ * @param on_text: Called for each text delta
+ * @param user_ctx: Context passed to on_text
+ * @return ESP_OK when the stream completed or was stopped by on_text
+ */
+esp_err_t gemini_llm_stream(const char *prompt, gemini_text_cb_t on_text, void *user_ctx);
+
+/**
+ * Spoken query in one request: audio in, streamed text out
+ * Sends the utterance as an inline audio part of streamGenerateContent
+ * (FLAC or WAV, following GEMINI_STT_ENCODING) together with an
+ * instruction, instead of a Speech-to-Text request followed by
+ * gemini_llm_stream(). Saves one round trip; the model's own audio
+ * understanding replaces the transcript, so none is returned.
+ * @param audio_data: PCM audio samples (16-bit, 16kHz mono)
+ * @param audio_len: Number of samples
+ * @param prompt: Instruction sent with the audio (NULL for a default that
+ *                asks for a spoken-style answer)
+ * @param on_text: Called for every text delta, in order
+ * @param user_ctx: User context for on_text
+ * @return ESP_OK when the answer completed (or the callback stopped it)
+ */
+esp_err_t gemini_audio_query(const int16_t *audio_data, size_t audio_len, const char *prompt,
+                             gemini_text_cb_t on_text, void *user_ctx);
+
+/**
+ * gemini_audio_query() for a recording in pieces (see gemini_pcm_parts_t)
+ * @param audio: PCM pieces (16-bit, 16kHz mono)
+ * @param prompt: Instruction sent with the audio (NULL for the default)
+ * @param on_text: Called for every text delta, in order
+ * @param user_ctx: User context for on_text
+ * @return ESP_OK when the answer completed (or the callback stopped it)
+ */
+esp_err_t gemini_audio_query_parts(const gemini_pcm_parts_t *audio, const char *prompt,
+                                   gemini_text_cb_t on_text, void *user_ctx);
+
 /**
  * Text-to-Speech: Convert text to audio using Gemini
  * @param text: Text to synthesize
@@ -52,6 +258,122 @@ esp_err_t gemini_llm(const char *prompt, char *response, size_t response_len);
  */
 esp_err_t gemini_tts(const char *text, int16_t *audio_out, size_t audio_len, size_t *samples_written);
 
+/**
+ * Text-to-Speech with cancellation
+ * Same as gemini_tts(), but safe to call from several tasks at once and
+ * abandoned early when cancel->cancelled is set.
+ * @param text: Text to synthesize
+ * @param audio_out: Buffer to store PCM audio samples
+ * @param audio_len: Size of audio buffer (in samples)
+ * @param samples_written: Number of samples actually written
+ * @param cancel: Cancellation token (NULL for none)
+ * @return ESP_OK on success, ESP_ERR_NOT_FINISHED if cancelled
+ */
+esp_err_t gemini_tts_cancellable(const char *text, int16_t *audio_out, size_t audio_len,
+                                 size_t *samples_written, const gemini_cancel_t *cancel);
+
+/**
+ * Text-to-Speech for fixed prompts (greetings, errors, confirmations)
+ * Same as gemini_tts(), but the result is also persisted to the flash cache
+ * so the phrase plays without any network round trip after a reboot.
+ * @param text: Text to synthesize
+ * @param audio_out: Buffer to store PCM audio samples
+ * @param audio_len: Size of audio buffer (in samples)
+ * @param samples_written: Number of samples actually written
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_tts_prompt(const char *text, int16_t *audio_out, size_t audio_len, size_t *samples_written);
+
+/**
+ * Text-to-Speech with progressive output
+ * The response is decoded as it downloads (MP3 or LINEAR16, see
+ * CONFIG_GEMINI_TTS_ENCODING) and on_progress reports how much of audio_out
+ * is ready, so playback can begin before the request completes.
+ * Needs GEMINI_TTS_MIN_STACK_SIZE of stack on the calling task.
+ * @param text: Text to synthesize
+ * @param audio_out: Buffer to store PCM audio samples
+ * @param audio_len: Size of audio buffer (in samples)
+ * @param samples_written: Number of samples actually written
+ * @param opts: Options (NULL for defaults)
+ * @return ESP_OK on success, ESP_ERR_NOT_FINISHED if cancelled
+ */
+esp_err_t gemini_tts_ex(const char *text, int16_t *audio_out, size_t audio_len,
+                        size_t *samples_written, const gemini_tts_opts_t *opts);
+
+/**
+ * Get TTS cache statistics
+ * @param stats: Output statistics
+ */
+void gemini_api_get_tts_cache_stats(gemini_tts_cache_stats_t *stats);
+
+/**
+ * Get HTTPS connection pool statistics
+ * @param stats: Output statistics
+ */
+void gemini_api_get_pool_stats(gemini_http_pool_stats_t *stats);
+
+/**
+ * Get per-endpoint latency statistics (p50/p95/p99 time to first byte)
+ * @param stats: Output array
+ * @param max: Capacity of stats
+ * @return Number of endpoints written
+ */
+size_t gemini_api_get_endpoint_stats(gemini_http_endpoint_stats_t *stats, size_t max);
+
+/**
+ * Services a turn will call, for gemini_api_prewarm()
+ */
+typedef enum {
+    GEMINI_SERVICE_STT = 1 << 0,    // speech.googleapis.com
+    GEMINI_SERVICE_LLM = 1 << 1,    // generativelanguage.googleapis.com
+    GEMINI_SERVICE_TTS = 1 << 2,    // texttospeech.googleapis.com
+} gemini_service_t;
+
+/**
+ * Start opening connections for an upcoming turn (call on wake)
+ * A background task resolves each service's host and TLS-handshakes a
+ * pooled connection to it, in STT, LLM, TTS order, while the user is still
+ * speaking, so the turn's requests start on open connections. Hosts with
+ * an idle pooled connection get it checked and kept alive instead.
+ * Returns at once; does nothing while an earlier warm-up is still running.
+ * @param services: GEMINI_SERVICE_* bits
+ * @return ESP_OK when a warm-up is running, ESP_ERR_NO_MEM if its task
+ *         could not be created
+ */
+esp_err_t gemini_api_prewarm(uint32_t services);
+
+/**
+ * Mark the start of a voice turn (call at end of speech)
+ * Requests issued from now on (on any task) belong to the turn for the
+ * network metrics, and the turn budget (CONFIG_GEMINI_TURN_BUDGET_MS until
+ * the first answer audio) starts: STT, LLM and TTS requests each get a
+ * share of what is left as their deadline.
+ */
+void gemini_api_metrics_turn_begin(void);
+
+/**
+ * Mark the end of a voice turn
+ * Drops the turn budget, so requests outside a turn only have the stall
+ * timeout. The metrics of the turn stay readable.
+ */
+void gemini_api_metrics_turn_end(void);
+
+/**
+ * Get per-request timings of the current turn
+ * Only the most recent GEMINI_HTTP_TIMING_HISTORY requests are kept.
+ * @param timings: Output array (may be NULL to only fill totals)
+ * @param max: Capacity of timings
+ * @param totals: Optional output totals (NULL to skip)
+ * @return Number of requests in the turn that are still in the history
+ */
+size_t gemini_api_get_turn_metrics(gemini_http_timing_t *timings, size_t max, gemini_turn_metrics_t *totals);
+
+/**
+ * Log one line per request of the current turn, a totals line and the
+ * per-endpoint latency percentiles
+ */
+void gemini_api_log_turn_metrics(void);
+
 /**
  * Deinitialize Gemini API client
  */
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Gemini Live voice session
+ *
+ * One WebSocket (BidiGenerateContent) carries the whole conversation:
+ * microphone audio is streamed up while the user speaks and the model's
+ * spoken answer streams back as PCM chunks, so there is no separate STT,
+ * LLM and TTS round trip after end of speech.
+ *
+ * Upload: gemini_live_send_audio() only copies into a bounded queue
+ * (CONFIG_GEMINI_LIVE_UPLOAD_BUFFER_MS); a sender task batches whatever is
+ * queued into realtimeInput messages of at least
+ * CONFIG_GEMINI_LIVE_UPLOAD_CHUNK_MS. When the link is slower than real
+ * time, messages grow instead of multiplying, and once the queue is full
+ * new audio is dropped and counted rather than blocking the microphone.
+ *
+ * Download: audio is delivered to on_audio on the session's receive task.
+ * on_audio may block (e.g. while the I2S DMA buffers are full); the socket
+ * is not read meanwhile, so TCP flow control holds the server back instead
+ * of audio piling up in RAM.
+ *
+ * Interruption: when the user talks over the answer, the server sends
+ * `interrupted` (server-side activity detection) or the app calls
+ * gemini_live_activity_start() / gemini_live_interrupt(). Audio still
+ * arriving for the interrupted turn is discarded and
+ * GEMINI_LIVE_EVENT_INTERRUPTED tells the app to flush what it has queued
+ * for playback.
+ */
+
+typedef struct gemini_live_session gemini_live_session_t;
+
+typedef enum {
+    GEMINI_LIVE_EVENT_TURN_COMPLETE,    // The model finished its answer
+    GEMINI_LIVE_EVENT_INTERRUPTED,      // Answer cut short: flush queued playback
+    GEMINI_LIVE_EVENT_INPUT_TRANSCRIPT, // Text of what the user said (text set)
+    GEMINI_LIVE_EVENT_OUTPUT_TRANSCRIPT,// Text of what the model says (text set)
+    GEMINI_LIVE_EVENT_GO_AWAY,          // Server will close the session soon
+    GEMINI_LIVE_EVENT_CLOSED,           // Connection lost or closed by the server
+} gemini_live_event_t;
+
+/**
+ * Model audio callback (runs on the session's receive task)
+ * @param pcm: 16-bit mono samples (valid only during the call)
+ * @param samples: Number of samples
+ * @param sample_rate_hz: Sample rate of this chunk (24000 for Gemini Live)
+ * @param user_ctx: User context
+ */
+typedef void (*gemini_live_audio_cb_t)(const int16_t *pcm, size_t samples, int sample_rate_hz, void *user_ctx);
+
+/**
+ * Session event callback (runs on the session's receive task)
+ * @param event: What happened
+ * @param text: Transcript text for the *_TRANSCRIPT events, otherwise NULL
+ * @param user_ctx: User context
+ */
+typedef void (*gemini_live_event_cb_t)(gemini_live_event_t event, const char *text, void *user_ctx);
+
+/**
+ * Session configuration
+ */
+typedef struct {
+    const char *url;                // NULL for the Gemini Live endpoint; ws://host:port/path for a local stand-in
+    const char *model;              // NULL for CONFIG_GEMINI_LIVE_MODEL
+    const char *voice;              // Prebuilt voice name, NULL for the server default
+    const char *system_instruction; // Optional
+    bool client_activity;           // App marks speech with activity_start/end instead of server-side detection
+    bool transcripts;               // Request input and output transcriptions
+    gemini_live_audio_cb_t on_audio;
+    gemini_live_event_cb_t on_event; // Optional
+    void *user_ctx;
+} gemini_live_config_t;
+
+/**
+ * Session statistics
+ */
+typedef struct {
+    uint32_t messages_sent;         // realtimeInput audio messages
+    uint64_t samples_sent;          // Microphone samples uploaded
+    uint64_t samples_dropped;       // Microphone samples dropped on a full queue
+    size_t queue_peak_samples;      // Highest upload queue fill
+    uint64_t samples_received;      // Model audio samples delivered to on_audio
+    uint64_t samples_discarded;     // Model audio dropped after an interruption
+    size_t bytes_up;                // WebSocket payload bytes sent
+    size_t bytes_down;              // WebSocket payload bytes received
+    uint32_t turns;                 // Completed model turns
+    uint32_t interruptions;
+    int64_t last_latency_us;        // End of speech -> first model audio, latest turn (-1 if none)
+} gemini_live_stats_t;
+
+/**
+ * Open a session
+ * Connects, sends the setup message and waits for setupComplete before
+ * starting the sender and receive tasks. gemini_api_init() must have been
+ * called (the API key is taken from there).
+ * @param config: Session configuration
+ * @param out: New session
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_live_start(const gemini_live_config_t *config, gemini_live_session_t **out);
+
+/**
+ * Queue microphone audio for upload (never blocks on the network)
+ * @param session: Session
+ * @param pcm: 16 kHz 16-bit mono samples
+ * @param samples: Number of samples
+ * @return ESP_OK if queued, ESP_ERR_NO_MEM if the queue was full and the
+ *         audio was dropped, ESP_ERR_INVALID_STATE if the session has closed
+ */
+esp_err_t gemini_live_send_audio(gemini_live_session_t *session, const int16_t *pcm, size_t samples);
+
+/**
+ * The user started speaking
+ * Discards the rest of any answer in progress. With client_activity the
+ * server is told too (which also stops generation).
+ * @param session: Session
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_live_activity_start(gemini_live_session_t *session);
+
+/**
+ * The user stopped speaking (starts the response latency measurement)
+ * With client_activity the queued audio is flushed and the server is told
+ * the utterance is complete; otherwise only the time is recorded.
+ * @param session: Session
+ * @return ESP_OK on success
+ */
+esp_err_t gemini_live_activity_end(gemini_live_session_t *session);
+
+/**
+ * Stop playing the current answer (local barge-in, e.g. a button)
+ * Audio for the current model turn is discarded until the next turn starts.
+ * @param session: Session
+ */
+void gemini_live_interrupt(gemini_live_session_t *session);
+
+/**
+ * Whether the session is still connected
+ * @param session: Session
+ * @return true while connected
+ */
+bool gemini_live_is_open(const gemini_live_session_t *session);
+
+/**
+ * Snapshot session statistics
+ * @param session: Session
+ * @param stats: Output statistics
+ */
+void gemini_live_get_stats(gemini_live_session_t *session, gemini_live_stats_t *stats);
+
+/**
+ * Close the session, stop its tasks and free it
+ * Must not be called from the session's callbacks.
+ * @param session: Session (may be NULL)
+ */
+void gemini_live_stop(gemini_live_session_t *session);
+
+#ifdef __cplusplus
+}
+#endif
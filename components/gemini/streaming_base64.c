@@ -0,0 +1,206 @@
+#include "streaming_base64.h"
+#include <string.h>
+
+static const char ENCODE[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Character classes beyond the 64 sextet values
+#define B64_SKIP    0x40    // Whitespace
+#define B64_PAD     0x41    // '='
+#define B64_ESC     0x42    // '\\' (JSON escape)
+#define B64_BAD     0xff
+#define B64_SPECIAL 0xc0    // Any of the above has one of these bits set
+
+static const uint8_t DECODE[256] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x40, 0x40, 0xff, 0xff, 0x40, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0x40, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff, 0xff, 0x41, 0xff, 0xff,
+    0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xff, 0x42, 0xff, 0xff, 0xff,
+    0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+void streaming_base64_decoder_init(streaming_base64_decoder_t *dec)
+{
+    memset(dec, 0, sizeof(*dec));
+}
+
+esp_err_t streaming_base64_decode(streaming_base64_decoder_t *dec, const uint8_t *input, size_t input_len,
+                                  uint8_t *output, size_t *output_len)
+{
+    if (!dec || (!input && input_len > 0) || !output || !output_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (*output_len < streaming_base64_decode_bound(input_len)) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t bits = dec->bits;
+    unsigned nbits = dec->nbits;
+    size_t i = 0;
+    size_t o = 0;
+    while (i < input_len) {
+        // On a byte boundary whole groups go 4 -> 3 at a time. Each group is
+        // read before its output is written, and output trails input, which
+        // is what makes decoding in place safe.
+        if (nbits == 0 && !dec->escape && !dec->padded) {
+            while (i + 4 <= input_len) {
+                uint8_t a = DECODE[input[i]];
+                uint8_t b = DECODE[input[i + 1]];
+                uint8_t c = DECODE[input[i + 2]];
+                uint8_t d = DECODE[input[i + 3]];
+                if ((a | b | c | d) & B64_SPECIAL) {
+                    break;
+                }
+                uint32_t v = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | d;
+                output[o] = (uint8_t)(v >> 16);
+                output[o + 1] = (uint8_t)(v >> 8);
+                output[o + 2] = (uint8_t)v;
+                o += 3;
+                i += 4;
+            }
+            if (i == input_len) {
+                break;
+            }
+        }
+
+        // One character at a time around whitespace, escapes, padding and
+        // group boundaries split across pieces; at most one byte out per
+        // character, so output still trails input
+        uint8_t ch = input[i++];
+        uint8_t v = DECODE[ch];
+        if (dec->escape) {
+            dec->escape = false;
+            if (ch == 'n' || ch == 'r' || ch == 't') {
+                continue;
+            }
+            if (ch != '/') {
+                return ESP_FAIL;
+            }
+            v = DECODE['/'];
+        }
+        if (v < 64) {
+            if (dec->padded) {
+                return ESP_FAIL;
+            }
+            bits = (bits << 6) | v;
+            nbits += 6;
+            if (nbits >= 8) {
+                nbits -= 8;
+                output[o++] = (uint8_t)(bits >> nbits);
+                bits &= (1u << nbits) - 1;
+            }
+        } else if (v == B64_ESC) {
+            dec->escape = true;
+        } else if (v == B64_PAD) {
+            dec->padded = true;
+        } else if (v != B64_SKIP) {
+            return ESP_FAIL;
+        }
+    }
+
+    dec->bits = bits;
+    dec->nbits = (uint8_t)nbits;
+    *output_len = o;
+    return ESP_OK;
+}
+
+esp_err_t streaming_base64_decode_finish(streaming_base64_decoder_t *dec, uint8_t *output, size_t *output_len)
+{
+    if (!dec || !output_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *output_len = 0;
+    // Six bits left means a group of one character, which cannot encode a
+    // byte; fewer are the zero fill of the last group
+    bool truncated = dec->nbits == 6 || dec->escape;
+    streaming_base64_decoder_init(dec);
+    return truncated ? ESP_FAIL : ESP_OK;
+}
+
+void streaming_base64_encoder_init(streaming_base64_encoder_t *enc)
+{
+    enc->pending_len = 0;
+}
+
+static inline void encode_group(const uint8_t *in, char *out)
+{
+    uint32_t v = (uint32_t)in[0] << 16 | (uint32_t)in[1] << 8 | in[2];
+    out[0] = ENCODE[v >> 18];
+    out[1] = ENCODE[(v >> 12) & 63];
+    out[2] = ENCODE[(v >> 6) & 63];
+    out[3] = ENCODE[v & 63];
+}
+
+esp_err_t streaming_base64_encode(streaming_base64_encoder_t *enc, const uint8_t *input, size_t input_len,
+                                  char *output, size_t *output_len)
+{
+    if (!enc || (!input && input_len > 0) || !output || !output_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (*output_len < (enc->pending_len + input_len) / 3 * 4) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t o = 0;
+    // Complete the pending group first
+    if (enc->pending_len > 0) {
+        while (enc->pending_len < 3 && input_len > 0) {
+            enc->pending[enc->pending_len++] = *input++;
+            input_len--;
+        }
+        if (enc->pending_len < 3) {
+            *output_len = 0;
+            return ESP_OK;
+        }
+        encode_group(enc->pending, output);
+        o = 4;
+        enc->pending_len = 0;
+    }
+
+    size_t whole = input_len / 3 * 3;
+    for (size_t i = 0; i < whole; i += 3) {
+        encode_group(input + i, output + o);
+        o += 4;
+    }
+
+    enc->pending_len = input_len - whole;
+    memcpy(enc->pending, input + whole, enc->pending_len);
+
+    *output_len = o;
+    return ESP_OK;
+}
+
+esp_err_t streaming_base64_encode_finish(streaming_base64_encoder_t *enc, char *output, size_t *output_len)
+{
+    if (!enc || !output || !output_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (enc->pending_len == 0) {
+        *output_len = 0;
+        return ESP_OK;
+    }
+    if (*output_len < 4) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t last[3] = {0};
+    memcpy(last, enc->pending, enc->pending_len);
+    encode_group(last, output);
+    output[3] = '=';
+    if (enc->pending_len == 1) {
+        output[2] = '=';
+    }
+    enc->pending_len = 0;
+    *output_len = 4;
+    return ESP_OK;
+}
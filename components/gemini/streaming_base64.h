@@ -1,141 +1,98 @@
 #pragma once
 
 #include "esp_err.h"
-#include "mbedtls/base64.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
-#include <string.h>
 
 /**
  * Streaming Base64 Decoder
- * Handles incomplete base64 chunks by buffering incomplete groups (4 bytes -> 3 bytes)
+ * Accepts the encoded text in pieces of any size. Whitespace and the JSON
+ * escapes "\n", "\r", "\t" and "\/" are accepted anywhere, also split across
+ * pieces. Between calls only the bits of an incomplete byte (at most six) are
+ * carried, so every byte a piece completes is returned with that piece.
  */
 typedef struct {
-    uint8_t pending[4];      // Buffer for incomplete base64 group (0-3 bytes)
-    size_t pending_len;      // Number of pending bytes (0-3)
-    bool started;            // True after first data received
+    uint32_t bits;          // Decoded bits not yet forming a byte (low nbits)
+    uint8_t nbits;          // 0, 2, 4 or 6
+    bool escape;            // Piece ended on a backslash
+    bool padded;            // '=' seen: only padding and whitespace may follow
 } streaming_base64_decoder_t;
 
-static inline void streaming_base64_decoder_init(streaming_base64_decoder_t *dec) {
-    dec->pending_len = 0;
-    dec->started = false;
+void streaming_base64_decoder_init(streaming_base64_decoder_t *dec);
+
+/**
+ * Output capacity that always suffices for decoding input_len more characters
+ */
+static inline size_t streaming_base64_decode_bound(size_t input_len) {
+    return (input_len * 3 + 3) / 4;
 }
 
 /**
  * Decode base64 data incrementally
+ * Groups of four characters are decoded with a lookup table; output never
+ * runs ahead of input, so output may be the same buffer as input (decoding
+ * in place).
  * @param dec: decoder state
- * @param input: base64 input data
+ * @param input: base64 characters
  * @param input_len: length of input
- * @param output: decoded PCM data output buffer
+ * @param output: decoded bytes (may equal input)
  * @param output_len: IN: capacity, OUT: bytes written
- * @return ESP_OK on success, ESP_ERR_NO_MEM if output buffer too small
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if capacity is below
+ *         streaming_base64_decode_bound(input_len), ESP_FAIL on a character
+ *         outside the alphabet or data after padding
  */
-static inline esp_err_t streaming_base64_decode(
-    streaming_base64_decoder_t *dec,
-    const uint8_t *input,
-    size_t input_len,
-    uint8_t *output,
-    size_t *output_len)
-{
-    if (!dec || !input || !output || !output_len) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    size_t out_pos = 0;
-    size_t out_cap = *output_len;
-
-    // Combine pending bytes with new input for processing
-    size_t to_process = input_len + dec->pending_len;
-
-    // Process complete 4-byte base64 groups (decode to 3 bytes)
-    size_t complete_groups = to_process / 4;
-    size_t remainder = to_process % 4;
-
-    // Create a temporary buffer if we have pending bytes
-    uint8_t temp_input[256];
-    size_t temp_len = 0;
-
-    if (dec->pending_len > 0) {
-        // Copy pending bytes to temp buffer
-        memcpy(temp_input, dec->pending, dec->pending_len);
-        temp_len = dec->pending_len;
-
-        // Copy new input bytes
-        memcpy(temp_input + temp_len, input, input_len);
-        temp_len += input_len;
-    } else {
-        memcpy(temp_input, input, input_len);
-        temp_len = input_len;
-    }
-
-    // Decode complete 4-byte groups
-    if (complete_groups > 0) {
-        size_t decoded_len = 0;
-        int ret = mbedtls_base64_decode(
-            output,
-            out_cap,
-            &decoded_len,
-            temp_input,
-            complete_groups * 4);
-
-        if (ret != 0) {
-            return ESP_FAIL;
-        }
-
-        out_pos = decoded_len;
-        if (out_pos > out_cap) {
-            return ESP_ERR_NO_MEM;
-        }
-    }
-
-    // Save remainder for next call
-    if (remainder > 0) {
-        memcpy(dec->pending, temp_input + (complete_groups * 4), remainder);
-        dec->pending_len = remainder;
-    } else {
-        dec->pending_len = 0;
-    }
-
-    *output_len = out_pos;
-    return ESP_OK;
-}
+esp_err_t streaming_base64_decode(streaming_base64_decoder_t *dec, const uint8_t *input, size_t input_len,
+                                  uint8_t *output, size_t *output_len);
 
 /**
- * Finalize decoding (decode any remaining pending bytes)
- * Call this after all base64 data has been received
+ * Finalize decoding
+ * Checks that the input did not end in the middle of a group or an escape.
+ * Every complete byte has already been returned by streaming_base64_decode(),
+ * so nothing is ever written here.
  * @param dec: decoder state
- * @param output: output buffer for final decoded bytes
- * @param output_len: IN: capacity, OUT: bytes written
- * @return ESP_OK on success
+ * @param output: unused (kept for symmetry with the encoder)
+ * @param output_len: OUT: 0
+ * @return ESP_OK on success, ESP_FAIL if the input was truncated
  */
-static inline esp_err_t streaming_base64_decode_finish(
-    streaming_base64_decoder_t *dec,
-    uint8_t *output,
-    size_t *output_len)
-{
-    if (!dec || !output || !output_len) {
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    if (dec->pending_len == 0) {
-        *output_len = 0;
-        return ESP_OK;
-    }
+esp_err_t streaming_base64_decode_finish(streaming_base64_decoder_t *dec, uint8_t *output, size_t *output_len);
 
-    // Pad incomplete group with '=' for proper base64 decoding
-    uint8_t padded[4];
-    memcpy(padded, dec->pending, dec->pending_len);
-    memset(padded + dec->pending_len, '=', 4 - dec->pending_len);
+/**
+ * Streaming Base64 Encoder
+ * Carries up to 2 input bytes between calls so a byte stream can be encoded
+ * in arbitrary pieces; output of the pieces concatenates to the one-shot encoding.
+ */
+typedef struct {
+    uint8_t pending[3];      // Input bytes not yet forming a full 3-byte group
+    size_t pending_len;      // Number of pending bytes (0-2)
+} streaming_base64_encoder_t;
 
-    size_t decoded_len = 0;
-    int ret = mbedtls_base64_decode(output, *output_len, &decoded_len, padded, 4);
+void streaming_base64_encoder_init(streaming_base64_encoder_t *enc);
 
-    dec->pending_len = 0;
+/**
+ * Output capacity needed to encode input_len more bytes
+ */
+static inline size_t streaming_base64_encode_bound(size_t input_len) {
+    return ((input_len + 2) / 3) * 4 + 4;
+}
 
-    if (ret != 0) {
-        return ESP_FAIL;
-    }
+/**
+ * Encode data incrementally
+ * @param enc: encoder state
+ * @param input: raw input bytes
+ * @param input_len: length of input
+ * @param output: base64 output (not NUL-terminated)
+ * @param output_len: IN: capacity, OUT: characters written
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if output buffer too small
+ */
+esp_err_t streaming_base64_encode(streaming_base64_encoder_t *enc, const uint8_t *input, size_t input_len,
+                                  char *output, size_t *output_len);
 
-    *output_len = decoded_len;
-    return ESP_OK;
-}
+/**
+ * Finalize encoding (emit the last group with '=' padding)
+ * @param enc: encoder state
+ * @param output: output buffer (at least 4 bytes)
+ * @param output_len: IN: capacity, OUT: characters written
+ * @return ESP_OK on success
+ */
+esp_err_t streaming_base64_encode_finish(streaming_base64_encoder_t *enc, char *output, size_t *output_len);
@@ -73,11 +73,13 @@ esp_err_t mp3_decoder_decode(mp3_decoder_t *decoder,
     }
     
     if (samples == 0) {
-        // No samples decoded (might need more data or invalid frame)
-        decoder->bytes_consumed = 0;
+        // No samples decoded (might need more data or invalid frame).
+        // frame_bytes still counts the bytes skipped while searching for sync,
+        // so streaming callers can drop them instead of retrying forever.
+        decoder->bytes_consumed = decoder->info.frame_bytes;
         *samples_decoded = 0;
         if (bytes_consumed) {
-            *bytes_consumed = 0;
+            *bytes_consumed = decoder->bytes_consumed;
         }
         return ESP_OK;
     }
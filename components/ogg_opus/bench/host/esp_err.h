@@ -0,0 +1,11 @@
+// Host shim: the subset of esp_err.h used by the ogg_opus component
+#pragma once
+
+typedef int esp_err_t;
+
+#define ESP_OK                      0
+#define ESP_FAIL                    -1
+#define ESP_ERR_NO_MEM              0x101
+#define ESP_ERR_INVALID_ARG         0x102
+#define ESP_ERR_INVALID_RESPONSE    0x108
+#define ESP_ERR_NOT_SUPPORTED       0x106
@@ -0,0 +1,93 @@
+// Host benchmark: decode cost of ogg_opus per 20 ms of audio
+//
+// Usage: ogg_opus_bench <file.opus> [rate_hz] [chunk_bytes] [repeat]
+//   rate_hz      output rate (default 24000, what the TTS path uses)
+//   chunk_bytes  input is fed in pieces of this size, like network reads (default 1460)
+//   repeat       decode the file this many times (default 20)
+
+#include "ogg_opus_decoder.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file.opus> [rate_hz] [chunk_bytes] [repeat]\n", argv[0]);
+        return 2;
+    }
+    int rate = argc > 2 ? atoi(argv[2]) : 24000;
+    size_t chunk = argc > 3 ? (size_t)atoi(argv[3]) : 1460;
+    int repeat = argc > 4 ? atoi(argv[4]) : 20;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long file_len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *file = malloc(file_len);
+    if (!file || fread(file, 1, file_len, f) != (size_t)file_len) {
+        fprintf(stderr, "failed to read %s\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    size_t pcm_cap = OGG_OPUS_MAX_SAMPLES_PER_PACKET(rate);
+    int16_t *pcm = malloc(pcm_cap * sizeof(int16_t));
+
+    ogg_opus_decoder_stats_t total = {0};
+    int64_t wall_us = 0;
+    for (int r = 0; r < repeat; r++) {
+        ogg_opus_decoder_t *dec = ogg_opus_decoder_create(rate, 1, NULL);
+        if (!dec) {
+            return 1;
+        }
+        int64_t start = esp_timer_get_time();
+        for (size_t off = 0; off < (size_t)file_len; off += chunk) {
+            size_t n = (size_t)file_len - off < chunk ? (size_t)file_len - off : chunk;
+            size_t pos = 0;
+            while (pos < n) {
+                size_t samples = 0;
+                size_t used = 0;
+                int hz = 0;
+                int ch = 0;
+                esp_err_t err = ogg_opus_decoder_decode(dec, file + off + pos, n - pos, pcm, pcm_cap,
+                                                        &samples, &hz, &ch, &used);
+                if (err != ESP_OK) {
+                    fprintf(stderr, "decode failed: %d\n", err);
+                    return 1;
+                }
+                pos += used;
+            }
+        }
+        wall_us += esp_timer_get_time() - start;
+
+        ogg_opus_decoder_stats_t stats;
+        ogg_opus_decoder_get_stats(dec, &stats);
+        total.packets += stats.packets;
+        total.errors += stats.errors;
+        total.samples += stats.samples;
+        total.decode_us += stats.decode_us;
+        ogg_opus_decoder_destroy(dec);
+    }
+
+    if (total.samples == 0) {
+        fprintf(stderr, "no audio decoded\n");
+        return 1;
+    }
+    double audio_s = (double)total.samples / rate;
+    double frames_20ms = audio_s / 0.020;
+    printf("%s: %ld bytes, %.2f s of audio, %.1f kbps\n", argv[1], file_len,
+           audio_s / repeat, file_len * 8.0 / (audio_s / repeat) / 1000.0);
+    printf("%u packets (%u errors) over %d runs, %d Hz mono out, %zu-byte reads\n",
+           total.packets, total.errors, repeat, rate, chunk);
+    printf("opus_decode: %.1f us per 20 ms frame (%.4fx real time)\n",
+           total.decode_us / frames_20ms, total.decode_us / 1e6 / audio_s);
+    printf("demux + decode: %.1f us per 20 ms frame\n", wall_us / frames_20ms);
+    free(pcm);
+    free(file);
+    return 0;
+}
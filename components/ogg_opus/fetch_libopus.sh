@@ -0,0 +1,21 @@
+#!/bin/bash
+
+# Check out libopus next to this component so CMakeLists.txt builds it
+# (fixed point) into the ogg_opus component
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+LIBOPUS_DIR="$SCRIPT_DIR/libopus"
+OPUS_VERSION="v1.5.2"
+
+if [ -f "$LIBOPUS_DIR/include/opus.h" ]; then
+    echo "libopus already present in $LIBOPUS_DIR"
+    exit 0
+fi
+
+echo "Fetching libopus ${OPUS_VERSION}..."
+git clone --depth 1 --branch "$OPUS_VERSION" https://github.com/xiph/opus.git "$LIBOPUS_DIR"
+
+echo "libopus checked out to $LIBOPUS_DIR"
+echo "Re-run idf.py reconfigure to pick it up"
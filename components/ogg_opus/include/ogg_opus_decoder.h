@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Largest PCM output of one Opus packet (120 ms), per channel
+ */
+#define OGG_OPUS_MAX_SAMPLES_PER_PACKET(sample_rate_hz) ((sample_rate_hz) * 120 / 1000)
+
+typedef struct ogg_opus_decoder ogg_opus_decoder_t;
+
+/**
+ * @brief Memory source for a decoder
+ * The decoder struct, the 16 KB Ogg packet buffer and the libopus state
+ * come from `malloc_fn` and go back through `free_fn`.
+ */
+typedef struct {
+    void *(*malloc_fn)(size_t size);
+    void (*free_fn)(void *ptr);
+} ogg_opus_allocator_t;
+
+/**
+ * @brief Decoder statistics
+ */
+typedef struct {
+    uint32_t packets;       // Audio packets decoded
+    uint32_t errors;        // Packets the decoder rejected
+    uint64_t samples;       // PCM samples produced (per channel)
+    int64_t decode_us;      // Time spent in opus_decode
+    uint32_t resyncs;       // Times the demuxer lost and regained page sync
+} ogg_opus_decoder_stats_t;
+
+/**
+ * @brief Create an Ogg/Opus decoder instance
+ * @param sample_rate_hz Output sample rate (8000, 12000, 16000, 24000 or 48000)
+ * @param channels Output channels (1 or 2); the stream is mixed or split to match
+ * @param allocator Memory source, copied; NULL for malloc/free
+ * @return Decoder handle or NULL on failure
+ */
+ogg_opus_decoder_t *ogg_opus_decoder_create(int sample_rate_hz, int channels,
+                                            const ogg_opus_allocator_t *allocator);
+
+/**
+ * @brief Destroy an Ogg/Opus decoder instance
+ * @param decoder Decoder handle
+ */
+void ogg_opus_decoder_destroy(ogg_opus_decoder_t *decoder);
+
+/**
+ * @brief Decode Ogg/Opus data to PCM
+ *
+ * Input may be split anywhere. Each call consumes bytes until one audio
+ * packet has been decoded or the input is exhausted; call again with the
+ * remaining input (data + bytes_consumed) until it is all consumed.
+ * Header packets (OpusHead, OpusTags) and the encoder pre-skip are handled
+ * internally and produce no samples.
+ *
+ * @param decoder Decoder handle
+ * @param data Input Ogg bytes
+ * @param len Length of input in bytes
+ * @param pcm_out Output buffer for PCM samples (16-bit signed, interleaved)
+ * @param pcm_out_size Size of output buffer in samples; at least
+ *        OGG_OPUS_MAX_SAMPLES_PER_PACKET(sample_rate_hz) * channels
+ * @param samples_decoded Output: number of samples decoded (all channels)
+ * @param sample_rate Output: sample rate in Hz
+ * @param channels Output: number of channels
+ * @param bytes_consumed Output: number of bytes consumed from input
+ * @return ESP_OK on success, ESP_ERR_INVALID_RESPONSE if the stream is not
+ *         Opus, ESP_ERR_NOT_SUPPORTED if built without libopus
+ */
+esp_err_t ogg_opus_decoder_decode(ogg_opus_decoder_t *decoder,
+                                  const uint8_t *data,
+                                  size_t len,
+                                  int16_t *pcm_out,
+                                  size_t pcm_out_size,
+                                  size_t *samples_decoded,
+                                  int *sample_rate,
+                                  int *channels,
+                                  size_t *bytes_consumed);
+
+/**
+ * @brief Get decoder statistics
+ * @param decoder Decoder handle
+ * @param stats Output statistics
+ */
+void ogg_opus_decoder_get_stats(const ogg_opus_decoder_t *decoder, ogg_opus_decoder_stats_t *stats);
+
+/**
+ * @brief Whether the component was built with libopus
+ * @return true if Opus packets can be decoded
+ */
+bool ogg_opus_decoder_available(void);
+
+#ifdef __cplusplus
+}
+#endif
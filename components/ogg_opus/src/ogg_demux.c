@@ -0,0 +1,141 @@
+#include "ogg_demux.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define OGG_HEADER_SIZE     27
+#define OGG_FLAG_CONTINUED  0x01
+
+static const uint8_t CAPTURE[4] = { 'O', 'g', 'g', 'S' };
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void ogg_demux_init(ogg_demux_t *d, uint8_t *packet)
+{
+    memset(d, 0, sizeof(*d));
+    d->header_need = OGG_HEADER_SIZE;
+    d->packet = packet;
+}
+
+// Called once the fixed header and lacing table are complete
+static void start_page(ogg_demux_t *d)
+{
+    const uint8_t *h = d->header;
+    uint32_t serial = read_le32(h + 14);
+    if (!d->have_serial) {
+        d->serial = serial;
+        d->have_serial = true;
+    }
+    d->skip_page = serial != d->serial;
+    d->pages++;
+
+    if (!d->skip_page) {
+        bool continued = (h[5] & OGG_FLAG_CONTINUED) != 0;
+        if (continued && d->packet_len == 0 && !d->packet_overflow) {
+            // The start of this packet was lost (resync): drop the rest of it
+            d->packet_overflow = true;
+        } else if (!continued && (d->packet_len > 0 || d->packet_overflow)) {
+            // The previous page promised a continuation that never came
+            d->packet_len = 0;
+            d->packet_overflow = false;
+        }
+    }
+
+    d->segments = h[26];
+    d->segment = 0;
+    d->segment_left = d->segments > 0 ? h[OGG_HEADER_SIZE] : 0;
+}
+
+static void end_page(ogg_demux_t *d)
+{
+    d->header_len = 0;
+    d->header_need = OGG_HEADER_SIZE;
+    d->segments = 0;
+    d->segment = 0;
+}
+
+bool ogg_demux_push(ogg_demux_t *d, const uint8_t *data, size_t len, size_t *consumed,
+                    const uint8_t **packet, size_t *packet_len)
+{
+    size_t pos = 0;
+
+    for (;;) {
+        if (d->header_len < d->header_need) {
+            // Collecting a page header
+            if (pos == len) {
+                break;
+            }
+            uint8_t b = data[pos++];
+            if (d->header_len < sizeof(CAPTURE) && b != CAPTURE[d->header_len]) {
+                if (d->header_len > 0 || d->pages > 0) {
+                    d->resyncs++;
+                }
+                d->header_len = (b == CAPTURE[0]) ? 1 : 0;
+                continue;
+            }
+            d->header[d->header_len++] = b;
+            if (d->header_len == OGG_HEADER_SIZE) {
+                if (d->header[4] != 0) {
+                    // Unknown stream structure version: not a page after all
+                    d->resyncs++;
+                    d->header_len = 0;
+                    continue;
+                }
+                d->header_need = OGG_HEADER_SIZE + d->header[26];
+            }
+            if (d->header_len == d->header_need) {
+                start_page(d);
+                if (d->segments == 0) {
+                    end_page(d);
+                }
+            }
+            continue;
+        }
+
+        if (d->segment_left > 0) {
+            // Inside a segment: copy what is available
+            if (pos == len) {
+                break;
+            }
+            size_t n = len - pos < d->segment_left ? len - pos : d->segment_left;
+            if (!d->skip_page && !d->packet_overflow) {
+                if (d->packet_len + n > OGG_DEMUX_MAX_PACKET) {
+                    d->packet_overflow = true;
+                    d->packet_len = 0;
+                } else {
+                    memcpy(d->packet + d->packet_len, data + pos, n);
+                    d->packet_len += n;
+                }
+            }
+            pos += n;
+            d->segment_left -= n;
+            continue;
+        }
+
+        // Segment complete; a lacing value below 255 ends the packet
+        bool packet_end = d->header[OGG_HEADER_SIZE + d->segment] < 255;
+        if (++d->segment < d->segments) {
+            d->segment_left = d->header[OGG_HEADER_SIZE + d->segment];
+        } else {
+            end_page(d);
+        }
+
+        if (packet_end && !d->skip_page) {
+            bool emit = !d->packet_overflow && d->packet_len > 0;
+            size_t n = d->packet_len;
+            d->packet_len = 0;
+            d->packet_overflow = false;
+            if (emit) {
+                *consumed = pos;
+                *packet = d->packet;
+                *packet_len = n;
+                return true;
+            }
+        }
+    }
+
+    *consumed = pos;
+    return false;
+}
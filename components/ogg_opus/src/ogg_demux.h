@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * Incremental Ogg page demuxer
+ *
+ * Bytes are pushed in arbitrary pieces; complete packets of the first
+ * logical stream come out one at a time. Packets that continue across pages
+ * are reassembled. Page CRCs are not checked (the transport is TLS), but a
+ * broken capture pattern makes the demuxer scan forward for the next page.
+ */
+
+#define OGG_DEMUX_MAX_PACKET (16 * 1024)
+
+typedef struct {
+    // Page header being collected (27 fixed bytes + up to 255 lacing values)
+    uint8_t header[27 + 255];
+    size_t header_len;
+    size_t header_need;
+    bool have_serial;
+    uint32_t serial;
+    bool skip_page;             // Page of another logical stream
+
+    // Position inside the current page body
+    int segment;
+    int segments;
+    size_t segment_left;
+
+    // Packet being assembled
+    uint8_t *packet;
+    size_t packet_len;
+    bool packet_overflow;       // Larger than OGG_DEMUX_MAX_PACKET: dropped
+
+    uint32_t pages;
+    uint32_t resyncs;
+} ogg_demux_t;
+
+/**
+ * Prepare a demuxer
+ * @param d: Demuxer state
+ * @param packet: Buffer of OGG_DEMUX_MAX_PACKET bytes for packet assembly,
+ *                owned by the caller
+ */
+void ogg_demux_init(ogg_demux_t *d, uint8_t *packet);
+
+/**
+ * Consume bytes until a packet is complete or the input runs out
+ * @param d: Demuxer state
+ * @param data: Input bytes
+ * @param len: Number of bytes
+ * @param consumed: Number of input bytes used
+ * @param packet: Set to the completed packet (valid until the next call)
+ * @param packet_len: Packet length
+ * @return true if a packet was completed
+ */
+bool ogg_demux_push(ogg_demux_t *d, const uint8_t *data, size_t len, size_t *consumed,
+                    const uint8_t **packet, size_t *packet_len);
+
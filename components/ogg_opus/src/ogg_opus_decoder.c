@@ -0,0 +1,229 @@
+#include "ogg_opus_decoder.h"
+#include "ogg_demux.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include <string.h>
+#include <stdlib.h>
+
+// Set by CMakeLists.txt when libopus/ has been fetched
+#ifndef OGG_OPUS_HAVE_LIBOPUS
+#define OGG_OPUS_HAVE_LIBOPUS 0
+#endif
+
+#if OGG_OPUS_HAVE_LIBOPUS
+#include "opus.h"
+#endif
+
+static const char *TAG = "ogg_opus";
+
+// Opus timestamps (pre-skip) are always in 48 kHz samples
+#define OPUS_CLOCK_HZ 48000
+
+struct ogg_opus_decoder {
+    ogg_opus_allocator_t alloc;
+    ogg_demux_t demux;
+    uint8_t *packet;            // Demuxer's packet buffer
+#if OGG_OPUS_HAVE_LIBOPUS
+    OpusDecoder *opus;
+#endif
+    int sample_rate_hz;
+    int channels;
+    int header_packets;         // OpusHead and OpusTags seen so far
+    size_t preskip_left;        // Output samples (per channel) still to drop
+    ogg_opus_decoder_stats_t stats;
+};
+
+static uint16_t read_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+bool ogg_opus_decoder_available(void)
+{
+    return OGG_OPUS_HAVE_LIBOPUS;
+}
+
+static const ogg_opus_allocator_t HEAP_ALLOCATOR = { malloc, free };
+
+ogg_opus_decoder_t *ogg_opus_decoder_create(int sample_rate_hz, int channels,
+                                            const ogg_opus_allocator_t *allocator)
+{
+    if (channels < 1 || channels > 2) {
+        ESP_LOGE(TAG, "Unsupported channel count %d", channels);
+        return NULL;
+    }
+    if (sample_rate_hz != 8000 && sample_rate_hz != 12000 && sample_rate_hz != 16000 &&
+        sample_rate_hz != 24000 && sample_rate_hz != 48000) {
+        ESP_LOGE(TAG, "Unsupported output rate %d Hz", sample_rate_hz);
+        return NULL;
+    }
+
+    const ogg_opus_allocator_t *alloc = allocator ? allocator : &HEAP_ALLOCATOR;
+    ogg_opus_decoder_t *decoder = alloc->malloc_fn(sizeof(ogg_opus_decoder_t));
+    if (!decoder) {
+        ESP_LOGE(TAG, "Failed to allocate decoder");
+        return NULL;
+    }
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->alloc = *alloc;
+    decoder->packet = alloc->malloc_fn(OGG_DEMUX_MAX_PACKET);
+    if (!decoder->packet) {
+        ESP_LOGE(TAG, "Failed to allocate packet buffer");
+        alloc->free_fn(decoder);
+        return NULL;
+    }
+    ogg_demux_init(&decoder->demux, decoder->packet);
+    decoder->sample_rate_hz = sample_rate_hz;
+    decoder->channels = channels;
+    ESP_LOGI(TAG, "Ogg/Opus decoder created (%d Hz, %d ch)", sample_rate_hz, channels);
+    return decoder;
+}
+
+void ogg_opus_decoder_destroy(ogg_opus_decoder_t *decoder)
+{
+    if (decoder) {
+#if OGG_OPUS_HAVE_LIBOPUS
+        if (decoder->opus) {
+            decoder->alloc.free_fn(decoder->opus);
+        }
+#endif
+        decoder->alloc.free_fn(decoder->packet);
+        decoder->alloc.free_fn(decoder);
+    }
+}
+
+// OpusHead: magic, version, channels, pre-skip, input rate, gain, mapping family
+static esp_err_t parse_opus_head(ogg_opus_decoder_t *decoder, const uint8_t *packet, size_t len)
+{
+    if (len < 19 || memcmp(packet, "OpusHead", 8) != 0 || (packet[8] & 0xF0) != 0) {
+        ESP_LOGE(TAG, "Not an Ogg/Opus stream");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    int stream_channels = packet[9];
+    uint16_t preskip = read_le16(packet + 10);
+    int16_t gain_q8 = (int16_t)read_le16(packet + 16);
+    if (packet[18] != 0 && stream_channels > 2) {
+        ESP_LOGE(TAG, "Multistream Opus (%d channels) is not supported", stream_channels);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    decoder->preskip_left = (size_t)preskip * decoder->sample_rate_hz / OPUS_CLOCK_HZ;
+    ESP_LOGI(TAG, "OpusHead: %d ch, pre-skip %u, gain %d/256 dB", stream_channels, preskip, gain_q8);
+
+#if OGG_OPUS_HAVE_LIBOPUS
+    // libopus mixes or duplicates to the requested channel count itself
+    if (!decoder->opus) {
+        decoder->opus = decoder->alloc.malloc_fn(opus_decoder_get_size(decoder->channels));
+        if (!decoder->opus) {
+            ESP_LOGE(TAG, "Failed to allocate Opus decoder state");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    int err = opus_decoder_init(decoder->opus, decoder->sample_rate_hz, decoder->channels);
+    if (err != OPUS_OK) {
+        ESP_LOGE(TAG, "opus_decoder_init failed: %s", opus_strerror(err));
+        decoder->alloc.free_fn(decoder->opus);
+        decoder->opus = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    if (gain_q8 != 0) {
+        opus_decoder_ctl(decoder->opus, OPUS_SET_GAIN(gain_q8));
+    }
+#endif
+    return ESP_OK;
+}
+
+esp_err_t ogg_opus_decoder_decode(ogg_opus_decoder_t *decoder,
+                                  const uint8_t *data,
+                                  size_t len,
+                                  int16_t *pcm_out,
+                                  size_t pcm_out_size,
+                                  size_t *samples_decoded,
+                                  int *sample_rate,
+                                  int *channels,
+                                  size_t *bytes_consumed)
+{
+    if (!decoder || !data || !pcm_out || !samples_decoded || !sample_rate || !channels || !bytes_consumed) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *samples_decoded = 0;
+    *sample_rate = decoder->sample_rate_hz;
+    *channels = decoder->channels;
+    *bytes_consumed = 0;
+
+    while (*bytes_consumed < len) {
+        size_t used = 0;
+        const uint8_t *packet = NULL;
+        size_t packet_len = 0;
+        bool got = ogg_demux_push(&decoder->demux, data + *bytes_consumed, len - *bytes_consumed,
+                                  &used, &packet, &packet_len);
+        *bytes_consumed += used;
+        decoder->stats.resyncs = decoder->demux.resyncs;
+        if (!got) {
+            break;
+        }
+
+        if (decoder->header_packets == 0) {
+            esp_err_t err = parse_opus_head(decoder, packet, packet_len);
+            if (err != ESP_OK) {
+                return err;
+            }
+            decoder->header_packets++;
+            continue;
+        }
+        if (decoder->header_packets == 1) {
+            decoder->header_packets++;
+            if (packet_len >= 8 && memcmp(packet, "OpusTags", 8) == 0) {
+                continue;
+            }
+            ESP_LOGW(TAG, "OpusTags missing, treating packet as audio");
+        }
+
+#if OGG_OPUS_HAVE_LIBOPUS
+        int frame_size = (int)(pcm_out_size / decoder->channels);
+        int64_t start_us = esp_timer_get_time();
+        int n = opus_decode(decoder->opus, packet, (opus_int32)packet_len, pcm_out, frame_size, 0);
+        decoder->stats.decode_us += esp_timer_get_time() - start_us;
+        if (n < 0) {
+            // Skip the damaged packet; the next one decodes independently
+            decoder->stats.errors++;
+            ESP_LOGW(TAG, "opus_decode failed: %s", opus_strerror(n));
+            continue;
+        }
+        decoder->stats.packets++;
+
+        size_t samples = (size_t)n;
+        if (decoder->preskip_left > 0) {
+            size_t drop = samples < decoder->preskip_left ? samples : decoder->preskip_left;
+            memmove(pcm_out, pcm_out + drop * decoder->channels,
+                    (samples - drop) * decoder->channels * sizeof(int16_t));
+            decoder->preskip_left -= drop;
+            samples -= drop;
+        }
+        if (samples == 0) {
+            continue;
+        }
+        decoder->stats.samples += samples;
+        *samples_decoded = samples * decoder->channels;
+        return ESP_OK;
+#else
+        ESP_LOGE(TAG, "Built without libopus (run components/ogg_opus/fetch_libopus.sh)");
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
+    }
+
+    return ESP_OK;
+}
+
+void ogg_opus_decoder_get_stats(const ogg_opus_decoder_t *decoder, ogg_opus_decoder_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!decoder) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = decoder->stats;
+}
@@ -66,8 +66,9 @@ static void wake_word_task(void *pvParameters)
             //     ctx->callback("hey_jarvis"); // or detected wake word
             // }
             
+#if CONFIG_OPENWAKEWORD_SIMULATE_DETECTION
             // Placeholder: simulate wake word detection (remove in real implementation)
-            static int sample_count = 0;
+            static uint32_t sample_count = 0;
             sample_count += 512;
             if (sample_count > ctx->sample_rate * 3) { // Simulate detection every 3 seconds
                 ESP_LOGI(TAG, "Wake word detected (simulated)");
@@ -76,6 +77,7 @@ static void wake_word_task(void *pvParameters)
                 }
                 sample_count = 0;
             }
+#endif
         }
     }
     
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Latency spans
+ *
+ * Records named intervals (esp_timer microseconds) into a fixed ring that
+ * writers claim slots of with one atomic increment, so any task can record
+ * without a lock and the oldest spans are overwritten when it is full.
+ * Spans begun with span_trace_begin() nest: each remembers the span that
+ * was open on the same task, and must be ended on that task. Spans whose
+ * times were measured elsewhere are added complete with span_trace_add().
+ * Every span carries the current turn number (span_trace_new_turn()), so
+ * one voice turn can be dumped on its own as Chrome trace-event JSON and
+ * opened in chrome://tracing or Perfetto.
+ *
+ * Names and details are stored as pointers: pass string literals or other
+ * storage that outlives the ring. With CONFIG_SPAN_TRACE off every call
+ * compiles to nothing.
+ */
+
+typedef uint32_t span_trace_id_t;   // 0 for none
+
+/**
+ * Output for span_trace_dump()
+ * @param data: JSON text (not terminated)
+ * @param len: Length
+ * @param ctx: User context
+ * @return ESP_OK to continue
+ */
+typedef esp_err_t (*span_trace_write_cb_t)(const char *data, size_t len, void *ctx);
+
+/**
+ * Recorder statistics
+ */
+typedef struct {
+    uint32_t recorded;      // Spans and marks since boot
+    uint32_t capacity;      // Ring size (CONFIG_SPAN_TRACE_RECORDS)
+    uint32_t turn;          // Current turn number
+} span_trace_stats_t;
+
+#if CONFIG_SPAN_TRACE
+
+/**
+ * Open a span on the calling task, nested in the task's open span
+ * @param name: Span name (static storage)
+ * @param detail: Extra label shown with it, or NULL (static storage)
+ * @return Id for span_trace_end()
+ */
+span_trace_id_t span_trace_begin(const char *name, const char *detail);
+
+/**
+ * Close a span on the task that opened it
+ * Ignored when the span was overwritten meanwhile.
+ * @param id: From span_trace_begin() (0 is ignored)
+ */
+void span_trace_end(span_trace_id_t id);
+
+/**
+ * Record a finished span with known times on the calling task's track
+ * @param name: Span name (static storage)
+ * @param detail: Extra label, or NULL (static storage)
+ * @param start_us: esp_timer start
+ * @param end_us: esp_timer end
+ */
+void span_trace_add(const char *name, const char *detail, int64_t start_us, int64_t end_us);
+
+/**
+ * Record a point in time on the calling task's track
+ * @param name: Mark name (static storage)
+ * @param at_us: esp_timer time
+ */
+void span_trace_mark(const char *name, int64_t at_us);
+
+/**
+ * Start the next turn; spans recorded from now on belong to it
+ * @return New turn number
+ */
+uint32_t span_trace_new_turn(void);
+
+/**
+ * Write the spans of one turn as Chrome trace-event JSON
+ * Spans still open are written as begin events.
+ * @param turn: Turn number, 0 for everything in the ring
+ * @param write: Output
+ * @param ctx: User context for write
+ * @return ESP_OK, or the first error from write
+ */
+esp_err_t span_trace_dump(uint32_t turn, span_trace_write_cb_t write, void *ctx);
+
+/**
+ * span_trace_dump() to stdout between marker lines
+ * scripts/span_trace_extract.py cuts the JSON out of a monitor log.
+ * @param turn: Turn number, 0 for everything in the ring
+ */
+void span_trace_dump_console(uint32_t turn);
+
+/**
+ * Snapshot statistics
+ * @param stats: Output
+ */
+void span_trace_get_stats(span_trace_stats_t *stats);
+
+#else
+
+static inline span_trace_id_t span_trace_begin(const char *name, const char *detail) { return 0; }
+static inline void span_trace_end(span_trace_id_t id) {}
+static inline void span_trace_add(const char *name, const char *detail, int64_t start_us, int64_t end_us) {}
+static inline void span_trace_mark(const char *name, int64_t at_us) {}
+static inline uint32_t span_trace_new_turn(void) { return 0; }
+static inline esp_err_t span_trace_dump(uint32_t turn, span_trace_write_cb_t write, void *ctx)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+static inline void span_trace_dump_console(uint32_t turn) {}
+static inline void span_trace_get_stats(span_trace_stats_t *stats)
+{
+    stats->recorded = 0;
+    stats->capacity = 0;
+    stats->turn = 0;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
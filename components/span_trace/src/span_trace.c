@@ -0,0 +1,276 @@
+#include "span_trace.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#if CONFIG_SPAN_TRACE
+
+#define RECORDS         CONFIG_SPAN_TRACE_RECORDS
+#define TRACKS          24              // Tasks with a track of their own
+#define OTHER_TRACK     TRACKS          // Shared by any task after that (no nesting)
+#define TRACK_NAME_LEN  16
+#define DUR_OPEN        (-1)
+#define DUR_MARK        (-2)
+#define SEQ_WRITING     UINT32_MAX
+#define LINE_LEN        320
+
+// 32 bytes. `seq` says which claim the slot holds and is written last, so a
+// dump can tell a finished record from one being overwritten
+typedef struct {
+    const char *name;
+    const char *detail;
+    int64_t start_us;
+    int32_t dur_us;         // DUR_OPEN while running, DUR_MARK for a mark
+    uint32_t seq;
+    span_trace_id_t parent; // Span open on the same task when this one began
+    uint16_t turn;
+    uint8_t track;
+} record_t;
+
+// One per recording task. `task` is claimed with a compare-and-swap; `open`
+// is only written by the task itself
+typedef struct {
+    TaskHandle_t task;
+    char name[TRACK_NAME_LEN];
+    bool named;
+    span_trace_id_t open;
+} track_t;
+
+static record_t s_records[RECORDS];
+static track_t s_tracks[TRACKS];
+static uint32_t s_next = 0;         // Claims since boot; slot = seq % RECORDS
+static uint32_t s_turn = 0;
+
+// The calling task's track. A handle is matched together with the task
+// name, so a task created in a deleted task's memory gets a new track
+static uint8_t current_track(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    const char *name = pcTaskGetName(NULL);
+    for (int i = 0; i < TRACKS; i++) {
+        track_t *t = &s_tracks[i];
+        TaskHandle_t owner = __atomic_load_n(&t->task, __ATOMIC_ACQUIRE);
+        if (owner == self && __atomic_load_n(&t->named, __ATOMIC_ACQUIRE) &&
+            strncmp(t->name, name, TRACK_NAME_LEN - 1) == 0) {
+            return (uint8_t)i;
+        }
+        if (owner == NULL) {
+            TaskHandle_t expected = NULL;
+            if (__atomic_compare_exchange_n(&t->task, &expected, self, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                strncpy(t->name, name, TRACK_NAME_LEN - 1);
+                t->open = 0;
+                __atomic_store_n(&t->named, true, __ATOMIC_RELEASE);
+                return (uint8_t)i;
+            }
+        }
+    }
+    return OTHER_TRACK;
+}
+
+static record_t *claim(uint32_t *seq)
+{
+    *seq = __atomic_fetch_add(&s_next, 1, __ATOMIC_RELAXED);
+    record_t *rec = &s_records[*seq % RECORDS];
+    __atomic_store_n(&rec->seq, SEQ_WRITING, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return rec;
+}
+
+static void publish(record_t *rec, uint32_t seq)
+{
+    __atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+}
+
+static int32_t clamp_dur(int64_t dur_us)
+{
+    if (dur_us < 0) {
+        return 0;
+    }
+    return dur_us > INT32_MAX ? INT32_MAX : (int32_t)dur_us;
+}
+
+static uint32_t record(const char *name, const char *detail, int64_t start_us, int32_t dur_us, uint8_t track)
+{
+    uint32_t seq;
+    record_t *rec = claim(&seq);
+    rec->name = name;
+    rec->detail = detail;
+    rec->start_us = start_us;
+    rec->dur_us = dur_us;
+    rec->parent = track < TRACKS ? s_tracks[track].open : 0;
+    rec->turn = (uint16_t)__atomic_load_n(&s_turn, __ATOMIC_RELAXED);
+    rec->track = track;
+    publish(rec, seq);
+    return seq;
+}
+
+span_trace_id_t span_trace_begin(const char *name, const char *detail)
+{
+    int64_t now_us = esp_timer_get_time();
+    uint8_t track = current_track();
+    span_trace_id_t id = record(name, detail, now_us, DUR_OPEN, track) + 1;
+    if (track < TRACKS) {
+        s_tracks[track].open = id;
+    }
+    return id;
+}
+
+void span_trace_end(span_trace_id_t id)
+{
+    if (id == 0) {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    record_t *rec = &s_records[(id - 1) % RECORDS];
+    span_trace_id_t parent = 0;
+    uint8_t track;
+    if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) == id - 1) {
+        parent = rec->parent;
+        track = rec->track;
+        __atomic_store_n(&rec->dur_us, clamp_dur(now_us - rec->start_us), __ATOMIC_RELEASE);
+    } else {
+        // Overwritten: its parent is lost, so the next span on this task
+        // starts at the top level
+        track = current_track();
+    }
+    if (track < TRACKS && s_tracks[track].open == id) {
+        s_tracks[track].open = parent;
+    }
+}
+
+void span_trace_add(const char *name, const char *detail, int64_t start_us, int64_t end_us)
+{
+    record(name, detail, start_us, clamp_dur(end_us - start_us), current_track());
+}
+
+void span_trace_mark(const char *name, int64_t at_us)
+{
+    record(name, NULL, at_us, DUR_MARK, current_track());
+}
+
+uint32_t span_trace_new_turn(void)
+{
+    // Turn numbers are stored in 16 bits; 0 means "no turn" in a dump
+    uint32_t turn = __atomic_add_fetch(&s_turn, 1, __ATOMIC_RELAXED) & 0xFFFF;
+    if (turn == 0) {
+        turn = __atomic_add_fetch(&s_turn, 1, __ATOMIC_RELAXED) & 0xFFFF;
+    }
+    return turn;
+}
+
+void span_trace_get_stats(span_trace_stats_t *stats)
+{
+    stats->recorded = __atomic_load_n(&s_next, __ATOMIC_RELAXED);
+    stats->capacity = RECORDS;
+    stats->turn = __atomic_load_n(&s_turn, __ATOMIC_RELAXED) & 0xFFFF;
+}
+
+// Copy a string into JSON, replacing what would need escaping
+static void json_text(char *out, size_t size, const char *text)
+{
+    size_t n = 0;
+    for (; text && *text && n + 1 < size; text++) {
+        char c = *text;
+        out[n++] = (c == '"' || c == '\\' || (unsigned char)c < 0x20) ? '_' : c;
+    }
+    out[n] = '\0';
+}
+
+// Read a record that may be overwritten meanwhile; false if it was
+static bool snapshot(uint32_t seq, record_t *out)
+{
+    const record_t *rec = &s_records[seq % RECORDS];
+    if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq) {
+        return false;
+    }
+    memcpy(out, rec, sizeof(*out));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&rec->seq, __ATOMIC_RELAXED) == seq;
+}
+
+// Events go one per line with the separating comma in front, so the JSON
+// survives being cut out of a console log line by line
+static int format_event(char *line, const record_t *r, uint32_t seq)
+{
+    char name[48];
+    char detail[64];
+    json_text(name, sizeof(name), r->name);
+    json_text(detail, sizeof(detail), r->detail);
+    char phase[40];
+    if (r->dur_us == DUR_MARK) {
+        snprintf(phase, sizeof(phase), "\"ph\":\"i\",\"s\":\"t\"");
+    } else if (r->dur_us == DUR_OPEN) {
+        snprintf(phase, sizeof(phase), "\"ph\":\"B\"");
+    } else {
+        snprintf(phase, sizeof(phase), "\"ph\":\"X\",\"dur\":%" PRId32, r->dur_us);
+    }
+    return snprintf(line, LINE_LEN,
+                    ",{\"name\":\"%s\",%s,\"ts\":%" PRId64 ",\"pid\":1,\"tid\":%u,"
+                    "\"args\":{\"turn\":%u,\"id\":%" PRIu32 ",\"parent\":%" PRIu32 "%s%s%s}}\n",
+                    name, phase, r->start_us, (unsigned)r->track + 1, (unsigned)r->turn,
+                    seq + 1, r->parent, r->detail ? ",\"detail\":\"" : "", r->detail ? detail : "",
+                    r->detail ? "\"" : "");
+}
+
+esp_err_t span_trace_dump(uint32_t turn, span_trace_write_cb_t write, void *ctx)
+{
+    if (!write) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    char line[LINE_LEN];
+    int len = snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                       "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"voice assistant\"}}\n");
+    esp_err_t ret = write(line, len, ctx);
+
+    for (int i = 0; i <= TRACKS && ret == ESP_OK; i++) {
+        char name[TRACK_NAME_LEN];
+        if (i == OTHER_TRACK) {
+            strcpy(name, "other");
+        } else if (__atomic_load_n(&s_tracks[i].named, __ATOMIC_ACQUIRE)) {
+            json_text(name, sizeof(name), s_tracks[i].name);
+        } else {
+            continue;
+        }
+        len = snprintf(line, sizeof(line), ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                       "\"args\":{\"name\":\"%s\"}}\n", i + 1, name);
+        ret = write(line, len, ctx);
+    }
+
+    uint32_t next = __atomic_load_n(&s_next, __ATOMIC_ACQUIRE);
+    uint32_t first = next > RECORDS ? next - RECORDS : 0;
+    for (uint32_t seq = first; seq != next && ret == ESP_OK; seq++) {
+        record_t r;
+        if (!snapshot(seq, &r) || (turn != 0 && r.turn != turn)) {
+            continue;
+        }
+        len = format_event(line, &r, seq);
+        if (len >= LINE_LEN) {
+            continue;
+        }
+        ret = write(line, len, ctx);
+    }
+    if (ret == ESP_OK) {
+        ret = write("]}\n", 3, ctx);
+    }
+    return ret;
+}
+
+static esp_err_t console_write(const char *data, size_t len, void *ctx)
+{
+    return fwrite(data, 1, len, stdout) == len ? ESP_OK : ESP_FAIL;
+}
+
+void span_trace_dump_console(uint32_t turn)
+{
+    printf("=== span_trace begin turn=%" PRIu32 " ===\n", turn);
+    span_trace_dump(turn, console_write, NULL);
+    printf("=== span_trace end ===\n");
+    fflush(stdout);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Per-turn memory arena
+ *
+ * One block reserved at boot (PSRAM when available) that the scratch
+ * buffers of a voice turn are carved from with a bump pointer, and that is
+ * emptied in one step when the turn ends, so turns leave no holes in the
+ * heap however long the device runs. Allocation is one atomic
+ * compare-and-swap and safe from any task. Freeing the newest block gives
+ * its space back at once (a stage that finishes before the next starts
+ * leaves room for it); any other block is reclaimed by the reset.
+ *
+ * The arena is only handed out between turn_arena_begin() and
+ * turn_arena_reset(). Outside a turn, when it is full or before
+ * turn_arena_init(), turn_arena_malloc() falls back to the heap, so code
+ * that uses it also runs where no turn is open. Always release with
+ * turn_arena_free(), which tells the two apart.
+ */
+
+/**
+ * Arena statistics
+ */
+typedef struct {
+    size_t capacity;        // Bytes reserved (0 before turn_arena_init())
+    size_t used;            // Bytes handed out in the current turn
+    size_t turn_peak;       // Most bytes in use during the last finished turn
+    size_t high_water;      // Most bytes in use in any turn since boot
+    uint32_t live;          // Arena blocks not freed yet
+    uint32_t overflows;     // Requests sent to the heap because the arena was full (since boot)
+    uint32_t turns;         // Turns reset so far
+    bool psram;             // Reserved in PSRAM
+} turn_arena_stats_t;
+
+/**
+ * Reserve the arena; later calls do nothing
+ * @param capacity: Bytes to reserve
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM
+ */
+esp_err_t turn_arena_init(size_t capacity);
+
+/**
+ * Open the arena for a turn
+ */
+void turn_arena_begin(void);
+
+/**
+ * Allocate from the arena, or from the heap when it cannot serve
+ * @param size: Bytes (8-byte aligned result)
+ * @return Memory for turn_arena_free(), NULL when the heap fallback failed
+ */
+void *turn_arena_malloc(size_t size);
+
+/**
+ * Zeroed turn_arena_malloc()
+ * @param n: Elements
+ * @param size: Element size
+ * @return Memory for turn_arena_free(), or NULL
+ */
+void *turn_arena_calloc(size_t n, size_t size);
+
+/**
+ * Copy a string into the arena
+ * @param s: String
+ * @return Copy for turn_arena_free(), or NULL
+ */
+char *turn_arena_strdup(const char *s);
+
+/**
+ * Release memory from turn_arena_malloc()
+ * @param p: Memory (may be NULL)
+ */
+void turn_arena_free(void *p);
+
+/**
+ * End the turn: close the arena and empty it
+ * Blocks not freed yet are reported and the arena is not emptied under
+ * them: the next turn carries on after them, and a later reset that finds
+ * nothing held empties it.
+ */
+void turn_arena_reset(void);
+
+/**
+ * Snapshot arena statistics
+ * @param stats: Output statistics
+ */
+void turn_arena_get_stats(turn_arena_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
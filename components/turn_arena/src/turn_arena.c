@@ -0,0 +1,188 @@
+#include "turn_arena.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "turn_arena";
+
+#define ALIGN               8
+#define ALIGN_UP(n)         (((n) + ALIGN - 1) & ~(size_t)(ALIGN - 1))
+#define HEADER_SIZE         ALIGN
+// Top bit of the state word: the arena is handed out. The rest is the bump
+// offset, so opening, closing and allocating are single compare-and-swaps
+// on one word and a reset cannot race an allocation in progress.
+#define STATE_OPEN          ((size_t)1 << (sizeof(size_t) * 8 - 1))
+#define STATE_OFFSET(s)     ((s) & ~STATE_OPEN)
+
+typedef struct {
+    uint32_t size;          // Whole block: header and payload, aligned
+    uint32_t reserved;
+} block_header_t;
+
+static struct {
+    void *raw;              // As allocated
+    uint8_t *base;          // Aligned start
+    size_t capacity;
+    bool psram;
+    size_t state;           // STATE_OPEN | bump offset
+    uint32_t live;
+    size_t peak;            // Highest offset in the current turn
+    size_t turn_peak;
+    size_t high_water;
+    uint32_t overflows;
+    uint32_t turns;
+} s_arena;
+
+esp_err_t turn_arena_init(size_t capacity)
+{
+    if (capacity == 0 || capacity >= STATE_OPEN || capacity > UINT32_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_arena.base) {
+        return ESP_OK;
+    }
+    capacity = ALIGN_UP(capacity);
+    s_arena.raw = heap_caps_malloc(capacity + ALIGN, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_arena.psram = s_arena.raw != NULL;
+    if (!s_arena.raw) {
+        s_arena.raw = heap_caps_malloc(capacity + ALIGN, MALLOC_CAP_8BIT);
+    }
+    if (!s_arena.raw) {
+        ESP_LOGE(TAG, "Failed to reserve %zu byte arena", capacity);
+        return ESP_ERR_NO_MEM;
+    }
+    s_arena.base = (uint8_t *)ALIGN_UP((uintptr_t)s_arena.raw);
+    s_arena.capacity = capacity;
+    ESP_LOGI(TAG, "Reserved %zu KB per-turn arena in %s", capacity / 1024,
+             s_arena.psram ? "PSRAM" : "internal RAM");
+    return ESP_OK;
+}
+
+void turn_arena_begin(void)
+{
+    if (s_arena.base) {
+        __atomic_fetch_or(&s_arena.state, STATE_OPEN, __ATOMIC_ACQ_REL);
+    }
+}
+
+static void raise_peak(size_t offset)
+{
+    size_t peak = __atomic_load_n(&s_arena.peak, __ATOMIC_RELAXED);
+    while (offset > peak &&
+           !__atomic_compare_exchange_n(&s_arena.peak, &peak, offset, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void *turn_arena_malloc(size_t size)
+{
+    size_t state = __atomic_load_n(&s_arena.state, __ATOMIC_ACQUIRE);
+    if (!(state & STATE_OPEN)) {
+        return malloc(size);
+    }
+    if (size > s_arena.capacity) {
+        __atomic_fetch_add(&s_arena.overflows, 1, __ATOMIC_RELAXED);
+        return malloc(size);
+    }
+    size_t need = ALIGN_UP(size) + HEADER_SIZE;
+    // Counted before the offset moves, so a reset that sees no live blocks
+    // cannot have an allocation in flight
+    __atomic_fetch_add(&s_arena.live, 1, __ATOMIC_ACQ_REL);
+    size_t offset;
+    do {
+        offset = STATE_OFFSET(state);
+        if (!(state & STATE_OPEN) || need > s_arena.capacity - offset) {
+            __atomic_fetch_sub(&s_arena.live, 1, __ATOMIC_ACQ_REL);
+            if (state & STATE_OPEN) {
+                __atomic_fetch_add(&s_arena.overflows, 1, __ATOMIC_RELAXED);
+            }
+            return malloc(size);
+        }
+    } while (!__atomic_compare_exchange_n(&s_arena.state, &state, (state & STATE_OPEN) | (offset + need),
+                                          true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    raise_peak(offset + need);
+
+    block_header_t *hdr = (block_header_t *)(s_arena.base + offset);
+    hdr->size = (uint32_t)need;
+    return (uint8_t *)hdr + HEADER_SIZE;
+}
+
+void *turn_arena_calloc(size_t n, size_t size)
+{
+    if (size != 0 && n > SIZE_MAX / size) {
+        return NULL;
+    }
+    void *p = turn_arena_malloc(n * size);
+    if (p) {
+        memset(p, 0, n * size);
+    }
+    return p;
+}
+
+char *turn_arena_strdup(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *copy = turn_arena_malloc(len);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+void turn_arena_free(void *p)
+{
+    uint8_t *q = p;
+    if (!s_arena.base || q < s_arena.base || q >= s_arena.base + s_arena.capacity) {
+        free(p);
+        return;
+    }
+    // The newest block goes back at once; any other waits for the reset
+    block_header_t *hdr = (block_header_t *)(q - HEADER_SIZE);
+    size_t start = (size_t)((uint8_t *)hdr - s_arena.base);
+    size_t state = __atomic_load_n(&s_arena.state, __ATOMIC_ACQUIRE);
+    if (STATE_OFFSET(state) == start + hdr->size) {
+        __atomic_compare_exchange_n(&s_arena.state, &state, (state & STATE_OPEN) | start,
+                                    false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_sub(&s_arena.live, 1, __ATOMIC_ACQ_REL);
+}
+
+void turn_arena_reset(void)
+{
+    if (!s_arena.base) {
+        return;
+    }
+    // Closed first: from here on nothing new is carved out
+    size_t state = __atomic_fetch_and(&s_arena.state, ~STATE_OPEN, __ATOMIC_ACQ_REL);
+    size_t peak = __atomic_exchange_n(&s_arena.peak, STATE_OFFSET(state), __ATOMIC_RELAXED);
+    s_arena.turn_peak = peak;
+    if (peak > s_arena.high_water) {
+        s_arena.high_water = peak;
+    }
+    s_arena.turns++;
+
+    uint32_t live = __atomic_load_n(&s_arena.live, __ATOMIC_ACQUIRE);
+    if (live != 0) {
+        ESP_LOGW(TAG, "%lu block(s) still held at end of turn; %zu bytes stay reserved",
+                 (unsigned long)live, STATE_OFFSET(state));
+        return;
+    }
+    __atomic_store_n(&s_arena.state, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&s_arena.peak, 0, __ATOMIC_RELAXED);
+}
+
+void turn_arena_get_stats(turn_arena_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    stats->capacity = s_arena.capacity;
+    stats->used = STATE_OFFSET(__atomic_load_n(&s_arena.state, __ATOMIC_ACQUIRE));
+    stats->turn_peak = s_arena.turn_peak;
+    stats->high_water = s_arena.high_water;
+    stats->live = __atomic_load_n(&s_arena.live, __ATOMIC_ACQUIRE);
+    stats->overflows = __atomic_load_n(&s_arena.overflows, __ATOMIC_RELAXED);
+    stats->turns = s_arena.turns;
+    stats->psram = s_arena.psram;
+}
@@ -30,7 +30,7 @@ static led_strip_handle_t s_strip = NULL;
 // Audio config uses board-specific pins
 // These are selected at build-time based on CONFIG_BOARD_* settings from board headers
 static audio_player_config_t s_audio_config = {
-    .i2s_port = I2S_NUM_0,
+    .i2s_port = AUDIO_I2S_NUM,        // I2S1 on Korvo1: I2S0 takes the PDM mic
     .bclk_gpio = GPIO_I2S0_BCLK,      // Board-specific via board headers
     .lrclk_gpio = GPIO_I2S0_LRCLK,    // Board-specific via board headers
     .data_gpio = GPIO_I2S0_DOUT,      // Board-specific via board headers
@@ -391,12 +391,10 @@ void app_main(void)
     ESP_LOGW(TAG, "⚠️  Gemini API key configuration not available - rebuild with menuconfig");
     #endif
     
-    // Initialize wake word detection
-    // NOTE: PDM mode only works on I2S0, but I2S0 is used for speaker output
-    // Wake word detection is temporarily disabled until we can resolve the I2S port conflict
-    // TODO: Investigate sharing I2S0 or using alternative microphone input method
-    ESP_LOGW(TAG, "Wake word detection temporarily disabled - I2S PDM requires I2S0 (used by speaker)");
-    /*
+    // Initialize wake word detection and microphone capture
+    // PDM RX only works on I2S0, so on Korvo1 the mic takes I2S0 and the
+    // speaker I2S1 (see boards/korvo1.h)
+#if CONFIG_BOARD_KORVO1
     esp_err_t wake_err = wake_word_manager_init();
     if (wake_err != ESP_OK) {
         ESP_LOGW(TAG, "Failed to initialize wake word manager: %s", esp_err_to_name(wake_err));
@@ -411,7 +409,9 @@ void app_main(void)
             ESP_LOGI(TAG, "Wake word detection active - listening for wake words");
         }
     }
-    */
+#else
+    ESP_LOGW(TAG, "No microphone capture on this board - voice assistant cannot be woken");
+#endif
     
     // Startup animation: brief rainbow sweep
     ESP_LOGI(TAG, "Starting LED animation...");
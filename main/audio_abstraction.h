@@ -14,8 +14,8 @@
  * KEY DIFFERENCES HANDLED:
  *
  * KORVO1 (ESP32-S3):
- * - I2S0: Speaker output (I2S_NUM_0)
- * - I2S1: PDM microphone input (separate I2S port)
+ * - I2S0: PDM microphone input (the only ESP32-S3 port with PDM RX)
+ * - I2S1: Speaker output (I2S_NUM_1)
  * - Independent I2S ports allow simultaneous record+playback
  * - 12x WS2812 RGB LED ring
  * - Full I2C control of ES8311 codec
@@ -54,7 +54,7 @@ extern "C" {
 /**
  * Audio system initialization
  *
- * Initializes I2C, I2S0 (speaker), and ES8311 codec with board-specific pins.
+ * Initializes I2C, the speaker I2S port (AUDIO_I2S_NUM), and ES8311 codec with board-specific pins.
  * Must be called before any audio operations.
  *
  * @param sample_rate Sample rate in Hz (e.g., 16000, 48000)
@@ -50,6 +50,28 @@ void biquad_hpf_coeffs(float fc, float fs, float q, float *b0, float *b1, float
     *a2 = a2_calc / a0;
 }
 
+void biquad_lpf_coeffs(float fc, float fs, float q, float *b0, float *b1, float *b2, float *a1, float *a2)
+{
+    float w = 2.0f * M_PI * fc / fs;
+    float cos_w = cosf(w);
+    float sin_w = sinf(w);
+    float alpha = sin_w / (2.0f * q);
+    
+    float b0_calc = (1.0f - cos_w) / 2.0f;
+    float b1_calc = 1.0f - cos_w;
+    float b2_calc = (1.0f - cos_w) / 2.0f;
+    float a0 = 1.0f + alpha;
+    float a1_calc = -2.0f * cos_w;
+    float a2_calc = 1.0f - alpha;
+    
+    // Normalize by a0
+    *b0 = b0_calc / a0;
+    *b1 = b1_calc / a0;
+    *b2 = b2_calc / a0;
+    *a1 = a1_calc / a0;
+    *a2 = a2_calc / a0;
+}
+
 void biquad_peak_coeffs(float fc, float fs, float gain_db, float q, float *b0, float *b1, float *b2, float *a1, float *a2)
 {
     float w = 2.0f * M_PI * fc / fs;
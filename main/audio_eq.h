@@ -53,6 +53,14 @@ static inline float biquad_process(biquad_filter_t *f, float x)
  */
 void biquad_hpf_coeffs(float fc, float fs, float q, float *b0, float *b1, float *b2, float *a1, float *a2);
 
+/**
+ * Calculate biquad coefficients for a 2nd-order low-pass filter
+ * @param fc: Cutoff frequency in Hz
+ * @param fs: Sample rate in Hz
+ * @param q: Q factor (0.707 for Butterworth; 0.541/1.307 cascaded for 4th order)
+ */
+void biquad_lpf_coeffs(float fc, float fs, float q, float *b0, float *b1, float *b2, float *a1, float *a2);
+
 /**
  * Calculate biquad coefficients for a peaking EQ filter
  * @param fc: Center frequency in Hz
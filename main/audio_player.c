@@ -1,7 +1,10 @@
 #include "audio_player.h"
 #include "audio_eq.h"
+#include "echo_reference.h"
+#include "span_trace.h"
 
 #include <inttypes.h>
+#include <math.h>
 #include <string.h>
 
 #include "driver/i2c.h"
@@ -11,8 +14,15 @@
 #define i2c_master_dev_handle_t i2c_cmd_handle_t
 #include "esp_check.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 #define AUDIO_PLAYER_I2C_FREQ_HZ 100000
+#define I2S_DMA_BUF_COUNT 12
+#define I2S_DMA_BUF_LEN 128     // Frames per DMA buffer: the longest a clip waits for room
+#define I2S_TX_EVENTS I2S_DMA_BUF_COUNT
+#define CLIP_CHUNK_FRAMES 256
 #define ES8311_ADDR_7BIT 0x18  // 7-bit I2C address (becomes 0x30 when shifted for 8-bit)
 
 // ES8311 register definitions (from es8311_reg.h)
@@ -56,11 +66,27 @@ typedef struct {
     i2c_master_dev_handle_t i2c_dev;
     audio_eq_t eq_left;   // EQ for left channel
     audio_eq_t eq_right;  // EQ for right channel
+    int64_t out_end_us;   // When the last frame queued to I2S will have played
 } audio_player_state_t;
 
 static audio_player_state_t s_audio;
 static const char *TAG = "audio_player";
 
+// Output volume: read by the writer for every chunk
+#define VOLUME_UNITY_Q15   32768
+#define VOLUME_DB_PER_STEP 0.4f
+static volatile int s_volume_percent = 100;
+static volatile int32_t s_volume_gain_q15 = VOLUME_UNITY_Q15;
+
+// Output lock: writers take it only to copy what fits into the DMA ring
+// and wait for room (s_tx_events) without it, so a clip
+// (audio_player_play_clip) gets the output at once and holds it until the
+// clip is queued. Recursive, since the clip is written through the same
+// loop.
+static SemaphoreHandle_t s_out_lock = NULL;
+// I2S driver events: one I2S_EVENT_TX_DONE per DMA buffer played
+static QueueHandle_t s_tx_events = NULL;
+
 static esp_err_t es8311_write_reg(uint8_t reg, uint8_t value)
 {
     if (s_audio.i2c_bus == I2C_NUM_MAX) {
@@ -445,8 +471,8 @@ static esp_err_t configure_i2s(const audio_player_config_t *cfg)
         .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
         .communication_format = I2S_COMM_FORMAT_STAND_I2S,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 6,
-        .dma_buf_len = 256,
+        .dma_buf_count = I2S_DMA_BUF_COUNT,
+        .dma_buf_len = I2S_DMA_BUF_LEN,
         .use_apll = false,  // Don't use APLL when codec generates MCLK from BCLK
         .tx_desc_auto_clear = true,
         .fixed_mclk = 0,  // No fixed MCLK - codec generates it from BCLK (use_mclk=false)
@@ -460,7 +486,8 @@ static esp_err_t configure_i2s(const audio_player_config_t *cfg)
         .data_in_num = I2S_PIN_NO_CHANGE,
     };
 
-    ESP_RETURN_ON_ERROR(i2s_driver_install(cfg->i2s_port, &i2s_conf, 0, NULL), TAG, "i2s install");
+    ESP_RETURN_ON_ERROR(i2s_driver_install(cfg->i2s_port, &i2s_conf, I2S_TX_EVENTS, &s_tx_events),
+                        TAG, "i2s install");
     ESP_RETURN_ON_ERROR(i2s_set_pin(cfg->i2s_port, &pin_conf), TAG, "i2s pins");
     ESP_RETURN_ON_ERROR(i2s_zero_dma_buffer(cfg->i2s_port), TAG, "i2s zero");
     ESP_RETURN_ON_ERROR(i2s_start(cfg->i2s_port), TAG, "i2s start"); // Start I2S driver
@@ -481,6 +508,10 @@ esp_err_t audio_player_init(const audio_player_config_t *cfg)
     s_audio.cfg = *cfg;
     s_audio.current_sample_rate = cfg->default_sample_rate > 0 ? cfg->default_sample_rate : 44100;
 
+    if (!s_out_lock) {
+        s_out_lock = xSemaphoreCreateRecursiveMutex();
+        ESP_RETURN_ON_FALSE(s_out_lock, ESP_ERR_NO_MEM, TAG, "output lock");
+    }
     ESP_RETURN_ON_ERROR(configure_i2c(cfg), TAG, "i2c setup");
     vTaskDelay(pdMS_TO_TICKS(50)); // Give I2C bus more time to stabilize
     ESP_RETURN_ON_ERROR(configure_i2s(cfg), TAG, "i2s setup");
@@ -516,7 +547,33 @@ static esp_err_t ensure_sample_rate(int sample_rate_hz)
     return ESP_OK;
 }
 
-static esp_err_t write_pcm_frames(const int16_t *samples, size_t sample_count, int num_channels)
+// When the chunk just queued to I2S starts to play: right after what was
+// queued before it, unless the DMA ring drained in between (then within a
+// buffer, auto-clear is playing silence). i2s_write() blocks while the ring
+// is full, so the estimate never runs further ahead than the ring holds
+static int64_t queued_chunk_start_us(size_t frames)
+{
+    int rate = s_audio.current_sample_rate;
+    int64_t now = esp_timer_get_time();
+    int64_t buf_us = (int64_t)I2S_DMA_BUF_LEN * 1000000 / rate;
+    int64_t chunk_us = (int64_t)frames * 1000000 / rate;
+    int64_t earliest = now + buf_us / 2;
+    int64_t latest = now + buf_us * I2S_DMA_BUF_COUNT - chunk_us;
+    int64_t start = s_audio.out_end_us;
+    if (start < earliest) {
+        // Output starts again from silence: this is its first DAC sample
+        start = earliest;
+        span_trace_mark("dac start", start);
+    } else if (start > latest) {
+        start = latest;
+    }
+    s_audio.out_end_us = start + chunk_us;
+    return start;
+}
+
+// `first_us` (optional): set to when the first frames were in the DMA ring
+static esp_err_t write_pcm_frames(const int16_t *samples, size_t sample_count, int num_channels,
+                                  int64_t *first_us)
 {
     ESP_RETURN_ON_FALSE(samples && sample_count > 0, ESP_ERR_INVALID_ARG, TAG, "bad pcm args");
     ESP_RETURN_ON_FALSE(num_channels == 1 || num_channels == 2, ESP_ERR_INVALID_ARG, TAG, "channels");
@@ -543,10 +600,13 @@ static esp_err_t write_pcm_frames(const int16_t *samples, size_t sample_count, i
                    &samples[(frames_written)*2],
                    frames_this * sizeof(int16_t) * 2);
         }
+        int32_t gain = s_volume_gain_q15;
+        if (gain != VOLUME_UNITY_Q15) {
+            for (size_t i = 0; i < frames_this * 2; ++i) {
+                stereo_buffer[i] = (int16_t)((stereo_buffer[i] * gain) >> 15);
+            }
+        }
 
-        size_t bytes_to_write = frames_this * sizeof(int16_t) * 2;
-        size_t total_written = 0;
-        
         // Log first chunk and every second to verify audio data
         static bool first_write_logged = false;
         static size_t write_count = 0;
@@ -564,23 +624,38 @@ static esp_err_t write_pcm_frames(const int16_t *samples, size_t sample_count, i
                      write_count, frames_this, (int)((stereo_buffer[0] + stereo_buffer[2]) / 2));
         }
         
-        while (total_written < bytes_to_write) {
+        size_t queued = 0;
+        while (queued < frames_this) {
+            xSemaphoreTakeRecursive(s_out_lock, portMAX_DELAY);
             size_t bytes_written = 0;
             esp_err_t err = i2s_write(s_audio.cfg.i2s_port,
-                                      (uint8_t *)stereo_buffer + total_written,
-                                      bytes_to_write - total_written,
+                                      &stereo_buffer[queued * 2],
+                                      (frames_this - queued) * sizeof(int16_t) * 2,
                                       &bytes_written,
-                                      portMAX_DELAY);
+                                      0);
             if (err != ESP_OK) {
+                xSemaphoreGiveRecursive(s_out_lock);
                 ESP_LOGE(TAG, "I2S write failed: %s", esp_err_to_name(err));
                 return err;
             }
-            if (bytes_written == 0) {
-                ESP_LOGW(TAG, "I2S write returned 0 bytes");
-                vTaskDelay(pdMS_TO_TICKS(1));
-                continue;
+            // Whole frames: the ring's buffers hold whole frames
+            size_t frames_in = bytes_written / (sizeof(int16_t) * 2);
+            if (frames_in > 0) {
+                if (first_us && frames_written == 0 && queued == 0) {
+                    *first_us = esp_timer_get_time();
+                }
+                // The echo canceller subtracts exactly what went to the DAC
+                echo_reference_write(&stereo_buffer[queued * 2], frames_in, 2, s_audio.current_sample_rate,
+                                     queued_chunk_start_us(frames_in));
+                queued += frames_in;
+            }
+            xSemaphoreGiveRecursive(s_out_lock);
+            if (queued < frames_this) {
+                // Ring full: wait for the DMA to free a buffer. A clip holding
+                // the lock keeps it; anyone else waits without it.
+                i2s_event_t event;
+                xQueueReceive(s_tx_events, &event, portMAX_DELAY);
             }
-            total_written += bytes_written;
         }
         frames_written += frames_this;
         total_frames_written += frames_this;
@@ -894,7 +969,7 @@ esp_err_t audio_player_play_wav(const uint8_t *wav_data, size_t wav_len, audio_p
             }
             
             // Write PCM frames
-            err = write_pcm_frames(pcm_buffer, frames_this_chunk, fmt.num_channels);
+            err = write_pcm_frames(pcm_buffer, frames_this_chunk, fmt.num_channels, NULL);
             
             frames_processed += frames_this_chunk;
             
@@ -951,7 +1026,7 @@ esp_err_t audio_player_play_wav(const uint8_t *wav_data, size_t wav_len, audio_p
                 }
                 
                 esp_err_t err = write_pcm_frames(samples + (frames_written * fmt.num_channels), 
-                                                 frames_this_batch, fmt.num_channels);
+                                                 frames_this_batch, fmt.num_channels, NULL);
                 if (err != ESP_OK) {
                     return err;
                 }
@@ -966,7 +1041,7 @@ esp_err_t audio_player_play_wav(const uint8_t *wav_data, size_t wav_len, audio_p
             progress_cb(0.0f, false);
             return ESP_OK;
         } else {
-            return write_pcm_frames(samples, frame_count, fmt.num_channels);
+            return write_pcm_frames(samples, frame_count, fmt.num_channels, NULL);
         }
     }
 }
@@ -978,7 +1053,63 @@ esp_err_t audio_player_submit_pcm(const int16_t *samples,
 {
     ESP_RETURN_ON_FALSE(s_audio.initialized, ESP_ERR_INVALID_STATE, TAG, "not init");
     ESP_RETURN_ON_ERROR(ensure_sample_rate(sample_rate_hz), TAG, "sr");
-    return write_pcm_frames(samples, sample_count, num_channels);
+    span_trace_id_t span = span_trace_begin("i2s write", NULL);
+    esp_err_t ret = write_pcm_frames(samples, sample_count, num_channels, NULL);
+    span_trace_end(span);
+    return ret;
+}
+
+esp_err_t audio_player_play_clip(const int16_t *samples, size_t sample_count, int sample_rate_hz,
+                                 int64_t *first_dma_us)
+{
+    ESP_RETURN_ON_FALSE(s_audio.initialized, ESP_ERR_INVALID_STATE, TAG, "not init");
+    ESP_RETURN_ON_FALSE(samples && sample_count > 0 && sample_rate_hz > 0, ESP_ERR_INVALID_ARG, TAG, "bad clip");
+    xSemaphoreTakeRecursive(s_out_lock, portMAX_DELAY);
+    // The clip plays at the output's rate: switching would restart I2S and
+    // leave whatever plays after the clip at the clip's rate
+    int out_rate = s_audio.current_sample_rate;
+    esp_err_t ret = ESP_OK;
+    if (out_rate == sample_rate_hz) {
+        ret = write_pcm_frames(samples, sample_count, 1, first_dma_us);
+    } else {
+        // Linear interpolation, a chunk at a time; `step` is Q16 clip
+        // samples per output sample
+        int16_t chunk[CLIP_CHUNK_FRAMES];
+        size_t out_count = (size_t)((uint64_t)sample_count * out_rate / sample_rate_hz);
+        uint64_t step = ((uint64_t)sample_rate_hz << 16) / out_rate;
+        for (size_t done = 0; done < out_count && ret == ESP_OK;) {
+            size_t n = out_count - done < CLIP_CHUNK_FRAMES ? out_count - done : CLIP_CHUNK_FRAMES;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t pos = (uint64_t)(done + i) * step;
+                size_t k = (size_t)(pos >> 16);
+                int32_t a = samples[k];
+                int32_t b = k + 1 < sample_count ? samples[k + 1] : a;
+                chunk[i] = (int16_t)(a + (int32_t)(((int64_t)(b - a) * (int64_t)(pos & 0xFFFF)) >> 16));
+            }
+            ret = write_pcm_frames(chunk, n, 1, done == 0 ? first_dma_us : NULL);
+            done += n;
+        }
+    }
+    xSemaphoreGiveRecursive(s_out_lock);
+    return ret;
+}
+
+void audio_player_set_volume(int percent)
+{
+    if (percent < 0) {
+        percent = 0;
+    } else if (percent > 100) {
+        percent = 100;
+    }
+    float gain = percent == 0 ? 0.0f : powf(10.0f, -(100 - percent) * VOLUME_DB_PER_STEP / 20.0f);
+    s_volume_gain_q15 = (int32_t)(gain * VOLUME_UNITY_Q15 + 0.5f);
+    s_volume_percent = percent;
+    ESP_LOGI(TAG, "Volume %d%%", percent);
+}
+
+int audio_player_get_volume(void)
+{
+    return s_volume_percent;
 }
 
 void audio_player_shutdown(void)
@@ -987,6 +1118,10 @@ void audio_player_shutdown(void)
         return;
     }
     i2s_driver_uninstall(s_audio.cfg.i2s_port);
+    if (s_out_lock) {
+        vSemaphoreDelete(s_out_lock);
+        s_out_lock = NULL;
+    }
     
     // Clean up I2C
     if (s_audio.i2c_bus != I2C_NUM_MAX) {
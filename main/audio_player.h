@@ -31,6 +31,39 @@ esp_err_t audio_player_submit_pcm(const int16_t *samples,
                                   size_t sample_count,
                                   int sample_rate_hz,
                                   int num_channels);
+
+/**
+ * Play a short mono clip ahead of other output
+ * For prompts that must start at once (earcons): other writers only hold
+ * the output while they copy into the DMA ring, so the clip's first frames
+ * go in at once, or when the DMA next frees a buffer if the ring is full.
+ * It holds the output until the whole clip is queued, so the two never
+ * interleave; the other writer carries on after it. The clip is resampled
+ * to the current output rate, which stays as it is. Blocks until the clip
+ * is queued; the volume and the echo reference apply as for any output.
+ * @param samples: Mono PCM
+ * @param sample_count: Number of samples
+ * @param sample_rate_hz: Sample rate of the clip
+ * @param first_dma_us: OUT (optional): esp_timer time the first frames were
+ *                      in the DMA ring
+ */
+esp_err_t audio_player_play_clip(const int16_t *samples, size_t sample_count, int sample_rate_hz,
+                                 int64_t *first_dma_us);
+
+/**
+ * Set the output volume
+ * Scales the samples on their way to I2S, so the echo canceller's reference
+ * follows it: 100 plays as decoded, each step below takes 0.4 dB off, 0
+ * mutes.
+ * @param percent: Volume (clamped to 0-100)
+ */
+void audio_player_set_volume(int percent);
+
+/**
+ * Current output volume in percent
+ */
+int audio_player_get_volume(void);
+
 void audio_player_shutdown(void);
 
 #ifdef __cplusplus
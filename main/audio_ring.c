@@ -0,0 +1,161 @@
+#include "audio_ring.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct audio_ring {
+    int16_t *buf;
+    size_t capacity;
+    int rate;
+    // Published under `lock`: 64-bit values are not read atomically
+    portMUX_TYPE lock;
+    uint64_t head;              // Samples written since creation
+    uint64_t continuous_from;   // First position after the last dropped input
+    int64_t head_us;            // Capture time of the sample before `head`
+    uint64_t dropped;
+    bool held;
+    uint64_t hold_pos;
+};
+
+esp_err_t audio_ring_create(size_t capacity, int sample_rate_hz, audio_ring_t **out)
+{
+    if (capacity == 0 || sample_rate_hz <= 0 || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    audio_ring_t *ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        return ESP_ERR_NO_MEM;
+    }
+    ring->buf = heap_caps_malloc(capacity * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring->buf) {
+        ring->buf = heap_caps_malloc(capacity * sizeof(int16_t), MALLOC_CAP_8BIT);
+    }
+    if (!ring->buf) {
+        free(ring);
+        return ESP_ERR_NO_MEM;
+    }
+    ring->capacity = capacity;
+    ring->rate = sample_rate_hz;
+    ring->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    *out = ring;
+    return ESP_OK;
+}
+
+void audio_ring_destroy(audio_ring_t *ring)
+{
+    if (!ring) {
+        return;
+    }
+    heap_caps_free(ring->buf);
+    free(ring);
+}
+
+size_t audio_ring_write(audio_ring_t *ring, const int16_t *pcm, size_t samples, int64_t end_us)
+{
+    portENTER_CRITICAL(&ring->lock);
+    uint64_t head = ring->head;
+    uint64_t limit = ring->held ? ring->hold_pos + ring->capacity : UINT64_MAX;
+    portEXIT_CRITICAL(&ring->lock);
+
+    // More than the ring holds in one write keeps the oldest part; the rest
+    // is dropped like input blocked by a hold
+    size_t n = samples < ring->capacity ? samples : ring->capacity;
+    if (head + n > limit) {
+        n = limit > head ? (size_t)(limit - head) : 0;
+    }
+    // Only the write position moves under the lock; the samples are copied
+    // into space no reader can be looking at
+    size_t at = (size_t)(head % ring->capacity);
+    size_t first = n < ring->capacity - at ? n : ring->capacity - at;
+    memcpy(ring->buf + at, pcm, first * sizeof(int16_t));
+    memcpy(ring->buf, pcm + first, (n - first) * sizeof(int16_t));
+
+    portENTER_CRITICAL(&ring->lock);
+    ring->head = head + n;
+    ring->head_us = end_us - (int64_t)(samples - n) * 1000000 / ring->rate;
+    if (n < samples) {
+        // The samples after the gap are timed from here on
+        ring->dropped += samples - n;
+        ring->continuous_from = ring->head;
+    }
+    portEXIT_CRITICAL(&ring->lock);
+    return n;
+}
+
+uint64_t audio_ring_head(const audio_ring_t *ring)
+{
+    portENTER_CRITICAL((portMUX_TYPE *)&ring->lock);
+    uint64_t head = ring->head;
+    portEXIT_CRITICAL((portMUX_TYPE *)&ring->lock);
+    return head;
+}
+
+uint64_t audio_ring_pos_at(const audio_ring_t *ring, int64_t t_us)
+{
+    portENTER_CRITICAL((portMUX_TYPE *)&ring->lock);
+    uint64_t head = ring->head;
+    uint64_t oldest = ring->continuous_from;
+    int64_t head_us = ring->head_us;
+    portEXIT_CRITICAL((portMUX_TYPE *)&ring->lock);
+
+    if (head > ring->capacity && head - ring->capacity > oldest) {
+        oldest = head - ring->capacity;
+    }
+    if (t_us >= head_us) {
+        return head;
+    }
+    uint64_t back = (uint64_t)((head_us - t_us) * ring->rate / 1000000);
+    return back < head - oldest ? head - back : oldest;
+}
+
+int64_t audio_ring_time_at(const audio_ring_t *ring, uint64_t pos)
+{
+    portENTER_CRITICAL((portMUX_TYPE *)&ring->lock);
+    uint64_t head = ring->head;
+    int64_t head_us = ring->head_us;
+    portEXIT_CRITICAL((portMUX_TYPE *)&ring->lock);
+    return head_us - ((int64_t)head - (int64_t)pos) * 1000000 / ring->rate;
+}
+
+esp_err_t audio_ring_peek(const audio_ring_t *ring, uint64_t from, uint64_t to,
+                          const int16_t **first, size_t *first_len,
+                          const int16_t **second, size_t *second_len)
+{
+    uint64_t head = audio_ring_head(ring);
+    if (to < from || to > head || head - from > ring->capacity) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t n = (size_t)(to - from);
+    size_t at = (size_t)(from % ring->capacity);
+    size_t a = n < ring->capacity - at ? n : ring->capacity - at;
+    *first = ring->buf + at;
+    *first_len = a;
+    *second = n > a ? ring->buf : NULL;
+    *second_len = n - a;
+    return ESP_OK;
+}
+
+void audio_ring_hold(audio_ring_t *ring, uint64_t pos)
+{
+    portENTER_CRITICAL(&ring->lock);
+    ring->held = true;
+    ring->hold_pos = pos;
+    portEXIT_CRITICAL(&ring->lock);
+}
+
+void audio_ring_release(audio_ring_t *ring)
+{
+    portENTER_CRITICAL(&ring->lock);
+    ring->held = false;
+    portEXIT_CRITICAL(&ring->lock);
+}
+
+uint64_t audio_ring_dropped(const audio_ring_t *ring)
+{
+    portENTER_CRITICAL((portMUX_TYPE *)&ring->lock);
+    uint64_t dropped = ring->dropped;
+    portEXIT_CRITICAL((portMUX_TYPE *)&ring->lock);
+    return dropped;
+}
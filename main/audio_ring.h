@@ -0,0 +1,109 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Capture ring
+ *
+ * A continuously written ring of 16-bit mono samples that remembers when
+ * they were captured, so a reader can start in the past: positions count
+ * samples since the ring was created, audio_ring_pos_at() turns a
+ * timestamp into a position and audio_ring_peek() hands out pointers into
+ * the ring (two spans when the range wraps) rather than copying. A reader
+ * may hold a position to keep the writer from overwriting it; the writer
+ * then drops input instead. One writer; any number of readers.
+ */
+
+typedef struct audio_ring audio_ring_t;
+
+/**
+ * Allocate a ring (PSRAM when available)
+ * @param capacity: Samples held
+ * @param sample_rate_hz: Rate of the samples written
+ * @param out: New ring
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM
+ */
+esp_err_t audio_ring_create(size_t capacity, int sample_rate_hz, audio_ring_t **out);
+
+/**
+ * Free a ring
+ * @param ring: Ring (may be NULL)
+ */
+void audio_ring_destroy(audio_ring_t *ring);
+
+/**
+ * Append samples
+ * @param ring: Ring
+ * @param pcm: Samples
+ * @param samples: Number of samples
+ * @param end_us: esp_timer time at which the last sample was captured
+ * @return Samples written (fewer when a hold is in the way or `samples`
+ *         exceeds the capacity)
+ */
+size_t audio_ring_write(audio_ring_t *ring, const int16_t *pcm, size_t samples, int64_t end_us);
+
+/**
+ * Position one past the newest sample
+ */
+uint64_t audio_ring_head(const audio_ring_t *ring);
+
+/**
+ * Position of the sample captured at a given time
+ * Clamped to the oldest sample still held (and not older than the last
+ * gap in the input) and to the head.
+ * @param ring: Ring
+ * @param t_us: esp_timer time
+ * @return Position
+ */
+uint64_t audio_ring_pos_at(const audio_ring_t *ring, int64_t t_us);
+
+/**
+ * Capture time of a position
+ * @param ring: Ring
+ * @param pos: Position
+ * @return esp_timer time
+ */
+int64_t audio_ring_time_at(const audio_ring_t *ring, uint64_t pos);
+
+/**
+ * Point at the samples in [from, to) without copying
+ * @param ring: Ring
+ * @param from: First position
+ * @param to: One past the last position (at most the head)
+ * @param first: OUT: first span
+ * @param first_len: OUT: its length
+ * @param second: OUT: continuation after the wrap, or NULL
+ * @param second_len: OUT: its length (0 when the range does not wrap)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG when part of the range was overwritten or not written yet
+ */
+esp_err_t audio_ring_peek(const audio_ring_t *ring, uint64_t from, uint64_t to,
+                          const int16_t **first, size_t *first_len,
+                          const int16_t **second, size_t *second_len);
+
+/**
+ * Keep samples from `pos` on from being overwritten until released
+ * @param ring: Ring
+ * @param pos: First protected position
+ */
+void audio_ring_hold(audio_ring_t *ring, uint64_t pos);
+
+/**
+ * Drop the hold
+ * @param ring: Ring
+ */
+void audio_ring_release(audio_ring_t *ring);
+
+/**
+ * Samples dropped because of a hold or an oversized write since creation
+ */
+uint64_t audio_ring_dropped(const audio_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,296 @@
+// Host benchmark: echo_canceller against synthesized echo paths
+//
+// Plays a speech-like far-end signal through synthetic room responses
+// (bulk delay plus an exponentially decaying tail), adds microphone noise
+// and, in one stretch, a near-end talker, and runs the canceller on the
+// sum. Reports echo attenuation, convergence and reconvergence times,
+// near-end distortion during double talk, tolerance to reference
+// misalignment and the cost per block. Exits with status 1 when the
+// attenuation after convergence is below 20 dB.
+//
+// Usage: aec_bench [tail_ms]
+//   tail_ms  filter length (default 64)
+
+#include "echo_canceller.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RATE        16000
+#define BLOCK       ECHO_CANCELLER_BLOCK
+#define MS(x)       ((x) * RATE / 1000)
+#define MIN_ERLE_DB 20.0
+
+typedef struct {
+    int delay_ms;           // Bulk delay (includes any reference misalignment)
+    int decay_ms;           // Time for the tail to fall by 60 dB
+    float gain;             // Echo level relative to the far end
+    uint32_t seed;
+} echo_path_t;
+
+static uint32_t s_rng = 1;
+
+static float noise(void)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (float)(int32_t)s_rng / 2147483648.0f;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Voiced syllables (harmonics of a gliding pitch under a syllable-rate envelope),
+// a fricative after every third one and short pauses: close enough to
+// speech in spectrum and level changes to exercise the step control
+static void speech_like(float *out, size_t n, float pitch_hz, float syllable_hz, float level, uint32_t seed)
+{
+    s_rng = seed;
+    double phase = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double t = (double)i / RATE;
+        int syllable = (int)(t * syllable_hz);
+        double in_syl = t * syllable_hz - syllable;
+        double f0 = pitch_hz * (1.0 + 0.15 * sin(2.0 * M_PI * 0.7 * t + seed));
+        phase += 2.0 * M_PI * f0 / RATE;
+        float v = 0.0f;
+        if (syllable % 7 != 6) {
+            double env = sin(M_PI * in_syl);
+            for (int h = 1; h <= 20 && h * f0 < RATE / 2; h++) {
+                v += (float)(env * sin(h * phase) / h);
+            }
+        }
+        if (syllable % 3 == 2 && in_syl > 0.6) {
+            v += 0.4f * noise();
+        }
+        out[i] = level * v;
+    }
+}
+
+static float *make_rir(const echo_path_t *path, size_t *len)
+{
+    size_t d = MS(path->delay_ms);
+    size_t tail = MS(path->decay_ms);
+    *len = d + tail;
+    float *h = calloc(*len, sizeof(float));
+    s_rng = path->seed;
+    double energy = 0.0;
+    for (size_t i = 0; i < tail; i++) {
+        float v = noise() * powf(10.0f, -3.0f * (float)i / (float)tail);
+        if (i == 0) {
+            v = 1.0f;   // Direct path
+        }
+        h[d + i] = v;
+        energy += v * v;
+    }
+    float g = path->gain / sqrtf((float)energy);
+    for (size_t i = 0; i < *len; i++) {
+        h[i] *= g;
+    }
+    return h;
+}
+
+// echo[from..to) = far convolved with the path
+static void add_echo(float *mic, const float *far, size_t from, size_t to, const echo_path_t *path)
+{
+    size_t len;
+    float *h = make_rir(path, &len);
+    for (size_t i = from; i < to; i++) {
+        float s = 0.0f;
+        for (size_t j = 0; j < len && j <= i; j++) {
+            s += h[j] * far[i - j];
+        }
+        mic[i] += s;
+    }
+    free(h);
+}
+
+static double energy(const float *a, size_t from, size_t to)
+{
+    double s = 0.0;
+    for (size_t i = from; i < to; i++) {
+        s += (double)a[i] * a[i];
+    }
+    return s;
+}
+
+static double db(double num, double den)
+{
+    return 10.0 * log10((num + 1e-9) / (den + 1e-9));
+}
+
+typedef struct {
+    float *far;
+    float *mic;             // Echo + noise (+ near end)
+    float *echo;            // Echo alone
+    float *near;            // Near end alone
+    float *out;             // Canceller output, realigned (one block earlier)
+    size_t n;
+    double us_per_block;
+    double max_us;
+    echo_canceller_stats_t stats;
+} run_t;
+
+static void run_alloc(run_t *r, size_t n)
+{
+    memset(r, 0, sizeof(*r));
+    r->n = n;
+    r->far = calloc(n, sizeof(float));
+    r->mic = calloc(n, sizeof(float));
+    r->echo = calloc(n, sizeof(float));
+    r->near = calloc(n, sizeof(float));
+    r->out = calloc(n, sizeof(float));
+}
+
+static void run_free(run_t *r)
+{
+    free(r->far);
+    free(r->mic);
+    free(r->echo);
+    free(r->near);
+    free(r->out);
+}
+
+static int run_canceller(run_t *r, int tail_ms)
+{
+    echo_canceller_config_t cfg = {
+        .sample_rate_hz = RATE,
+        .tail_ms = tail_ms,
+        .suppress_residual = true,
+    };
+    echo_canceller_t *ec;
+    if (echo_canceller_create(&cfg, &ec) != ESP_OK) {
+        return -1;
+    }
+    s_rng = 99;
+    for (size_t i = 0; i < r->n; i++) {
+        r->mic[i] = r->echo[i] + r->near[i] + 10.0f * noise();
+    }
+    int16_t mic[BLOCK];
+    int16_t ref[BLOCK];
+    int16_t out[BLOCK];
+    double total = 0.0;
+    size_t blocks = 0;
+    r->max_us = 0.0;
+    for (size_t b = 0; b + BLOCK <= r->n; b += BLOCK) {
+        for (int i = 0; i < BLOCK; i++) {
+            mic[i] = (int16_t)lrintf(r->mic[b + i]);
+            ref[i] = (int16_t)lrintf(r->far[b + i]);
+        }
+        double t = now_s();
+        echo_canceller_process(ec, mic, ref, out);
+        double us = (now_s() - t) * 1e6;
+        total += us;
+        blocks++;
+        if (us > r->max_us) {
+            r->max_us = us;
+        }
+        if (b >= BLOCK) {
+            for (int i = 0; i < BLOCK; i++) {
+                r->out[b - BLOCK + i] = out[i];
+            }
+        }
+    }
+    r->us_per_block = total / blocks;
+    echo_canceller_get_stats(ec, &r->stats);
+    echo_canceller_destroy(ec);
+    return 0;
+}
+
+// First time after `from` at which 100 ms windows stay attenuated by
+// `target` dB for half a second
+static double settle_s(const run_t *r, size_t from, size_t to, double target)
+{
+    const size_t win = MS(100);
+    size_t good = 0;
+    for (size_t i = from; i + win <= to; i += win) {
+        double e = energy(r->echo, i, i + win);
+        double o = energy(r->out, i, i + win);
+        good = db(e, o) >= target ? good + 1 : 0;
+        if (good == 5) {
+            return (double)(i + win - 5 * win - from) / RATE;
+        }
+    }
+    return -1.0;
+}
+
+int main(int argc, char **argv)
+{
+    int tail_ms = argc > 1 ? atoi(argv[1]) : 64;
+    int status = 0;
+
+    // 0-6 s far end, path A; 6-10 s path B; 10-14 s double talk; 14-16 s far end
+    run_t r;
+    run_alloc(&r, (size_t)MS(16000));
+    speech_like(r.far, r.n, 120.0f, 4.0f, 3000.0f, 7);
+    echo_path_t a = { .delay_ms = 5, .decay_ms = 30, .gain = 0.7f, .seed = 11 };
+    echo_path_t b = { .delay_ms = 9, .decay_ms = 45, .gain = 0.5f, .seed = 23 };
+    add_echo(r.echo, r.far, 0, MS(6000), &a);
+    add_echo(r.echo, r.far, MS(6000), r.n, &b);
+    float *talker = calloc(r.n, sizeof(float));
+    speech_like(talker, r.n, 210.0f, 3.3f, 1500.0f, 3);
+    memcpy(r.near + MS(10000), talker + MS(10000), sizeof(float) * MS(4000));
+    free(talker);
+    if (run_canceller(&r, tail_ms) != 0) {
+        return 1;
+    }
+
+    printf("tail %d ms, %d-sample blocks at %d Hz\n", tail_ms, BLOCK, RATE);
+    double erle = db(energy(r.echo, MS(3000), MS(6000)), energy(r.out, MS(3000), MS(6000)));
+    printf("%-40s %6.1f dB\n", "attenuation, path A, 3-6 s", erle);
+    printf("%-40s %6.2f s\n", "convergence to 15 dB", settle_s(&r, 0, MS(6000), 15.0));
+    printf("%-40s %6.1f dB\n", "attenuation, path B, 8-10 s",
+           db(energy(r.echo, MS(8000), MS(10000)), energy(r.out, MS(8000), MS(10000))));
+    printf("%-40s %6.2f s\n", "reconvergence after path change", settle_s(&r, MS(6000), MS(10000), 15.0));
+
+    // Double talk: how far the output is from the near end alone, and how
+    // much echo is left once the near end stops again
+    double dist = 0.0;
+    double raw = 0.0;
+    for (size_t i = MS(10000); i < MS(14000); i++) {
+        double d = r.out[i] - r.near[i];
+        dist += d * d;
+        d = r.mic[i] - r.near[i];
+        raw += d * d;
+    }
+    printf("%-40s %6.1f dB (microphone %.1f dB)\n", "near end to distortion, double talk",
+           db(energy(r.near, MS(10000), MS(14000)), dist), db(energy(r.near, MS(10000), MS(14000)), raw));
+    printf("%-40s %6.1f dB\n", "near end level change, double talk",
+           db(energy(r.out, MS(10000), MS(14000)), energy(r.mic, MS(10000), MS(14000)) -
+              energy(r.echo, MS(10000), MS(14000))));
+    printf("%-40s %6.1f dB\n", "attenuation after double talk, 14-16 s",
+           db(energy(r.echo, MS(14000), MS(16000)), energy(r.out, MS(14000), MS(16000))));
+    printf("%-40s %6.1f dB (filter only), leak %.3f, %u resets\n", "canceller estimate",
+           r.stats.erle_db, r.stats.leak, r.stats.resets);
+    printf("%-40s %6.1f us/block avg, %.1f max (%.2f%% of a block)\n", "cost",
+           r.us_per_block, r.max_us, r.us_per_block / (BLOCK * 1e6 / RATE) * 100.0);
+    if (erle < MIN_ERLE_DB) {
+        fprintf(stderr, "attenuation %.1f dB below %.0f dB\n", erle, MIN_ERLE_DB);
+        status = 1;
+    }
+    run_free(&r);
+
+    // Reference misalignment: the bulk delay stands in for a reference
+    // that is early by that much
+    static const int delays[] = { 0, 8, 16, 32, 48 };
+    for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        run_alloc(&r, (size_t)MS(5000));
+        speech_like(r.far, r.n, 140.0f, 4.5f, 3000.0f, 5);
+        echo_path_t p = { .delay_ms = delays[i], .decay_ms = 20, .gain = 0.7f, .seed = 31 };
+        add_echo(r.echo, r.far, 0, r.n, &p);
+        if (run_canceller(&r, tail_ms) != 0) {
+            return 1;
+        }
+        char name[48];
+        snprintf(name, sizeof(name), "attenuation, reference %d ms early", delays[i]);
+        printf("%-40s %6.1f dB\n", name,
+               db(energy(r.echo, MS(3000), MS(5000)), energy(r.out, MS(3000), MS(5000))));
+        run_free(&r);
+    }
+    return status;
+}
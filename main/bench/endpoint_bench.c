@@ -0,0 +1,319 @@
+// Host benchmark: capture and endpointing through voice_assistant_feed_audio
+//
+// Runs voice_assistant.c unchanged on top of host shims and feeds it
+// microphone audio in 32 ms buffers, the size the Korvo1 microphone task
+// delivers, on a clock that advances 32 ms per buffer. The Gemini client,
+// the TTS scheduler and the player are fakes; STT records what was
+// uploaded and fails, which ends the turn.
+//
+// Without arguments, two synthesized recordings (speech-like signal over
+// room noise and mains hum) are checked:
+//   phrase     two phrases with a 250 ms pause between them; the wake
+//              arrives about 250 ms into the speech. The pause must not end
+//              the utterance, endpointing must start where the speech
+//              stopped, capture must close one hangover later and the
+//              upload must hold the speech from the pre-roll on, plus the
+//              pads.
+//   silence    a wake and nothing said: capture closes at the no-speech
+//              timeout and nothing is uploaded.
+// Exits with status 1 when any check fails.
+//
+// Usage: endpoint_bench [file.wav [wake_s]]
+//   file.wav  16 kHz mono 16-bit recording to feed instead; the timeline is
+//             printed and not checked
+//   wake_s    when the wake fires (default 0.5)
+
+#include "voice_assistant.h"
+#include "audio_player.h"
+#include "gemini_api.h"
+#include "gemini_live.h"
+#include "tts_scheduler.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RATE            16000
+#define BUFFER          512             // 32 ms, as wake_word_manager.c reads it
+#define BUFFER_US       (BUFFER * 1000000LL / RATE)
+#define MS(x)           ((size_t)(x) * RATE / 1000)
+#define SETTLE_US       2000            // Real time for the pipeline tasks per buffer
+#define TURN_WAIT_MS    2000
+// Tolerances: the detector works in 20 ms frames and the controller reacts
+// to the buffer that completed one
+#define EDGE_TOL_MS     60
+#define CLOSE_TOL_MS    (60 + 32)
+#define UPLOAD_TOL_MS   100
+
+// The faked STT fails every turn on purpose; keep its error out of the report
+int esp_log_host_level = 0;
+
+static uint32_t s_rng = 1;
+
+static float noise(void)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (float)(int32_t)s_rng / 2147483648.0f;
+}
+
+// Voiced syllables over a gliding pitch with a fricative after every third
+// one, as in aec_bench: speech in level and spectrum, without a recording
+static void add_speech(float *out, size_t from, size_t to, float level, uint32_t seed)
+{
+    s_rng = seed;
+    double phase = 0.0;
+    for (size_t i = from; i < to; i++) {
+        double t = (double)(i - from) / RATE;
+        int syllable = (int)(t * 4.0);
+        double in_syl = t * 4.0 - syllable;
+        double f0 = 140.0 * (1.0 + 0.15 * sin(2.0 * M_PI * 0.7 * t + seed));
+        phase += 2.0 * M_PI * f0 / RATE;
+        double env = sin(M_PI * in_syl);
+        float v = 0.0f;
+        for (int h = 1; h <= 20 && h * f0 < RATE / 2; h++) {
+            v += (float)(env * sin(h * phase) / h);
+        }
+        if (syllable % 3 == 2 && in_syl > 0.6) {
+            v += 0.4f * noise();
+        }
+        out[i] += level * v;
+    }
+}
+
+// Room noise and 120 Hz hum under everything
+static void add_room(float *out, size_t n)
+{
+    s_rng = 7;
+    for (size_t i = 0; i < n; i++) {
+        out[i] += 0.002f * noise() + 0.003f * (float)sin(2.0 * M_PI * 120.0 * i / RATE);
+    }
+}
+
+static int16_t *to_pcm(const float *x, size_t n)
+{
+    int16_t *pcm = malloc(n * sizeof(int16_t));
+    for (size_t i = 0; i < n; i++) {
+        float v = x[i] * 32767.0f;
+        pcm[i] = (int16_t)(v > 32767.0f ? 32767.0f : v < -32768.0f ? -32768.0f : v);
+    }
+    return pcm;
+}
+
+// ---------------------------------------------------------------------------
+// Services the assistant calls, faked
+
+static size_t s_uploaded;               // Samples in the last STT upload
+static int s_uploads;
+
+esp_err_t gemini_api_init(const gemini_config_t *config) { return ESP_OK; }
+void gemini_api_deinit(void) { }
+void gemini_api_metrics_turn_begin(void) { }
+void gemini_api_metrics_turn_end(void) { }
+void gemini_api_log_turn_metrics(void) { }
+esp_err_t gemini_api_prewarm(uint32_t services) { return ESP_OK; }
+void gemini_api_get_tts_cache_stats(gemini_tts_cache_stats_t *stats) { memset(stats, 0, sizeof(*stats)); }
+
+esp_err_t gemini_stt_parts(const gemini_pcm_parts_t *audio, char *text_out, size_t text_len)
+{
+    s_uploaded = audio->samples[0] + audio->samples[1];
+    s_uploads++;
+    return ESP_FAIL;
+}
+
+esp_err_t gemini_llm_stream(const char *prompt, gemini_text_cb_t on_text, void *user_ctx) { return ESP_FAIL; }
+
+esp_err_t gemini_audio_query_parts(const gemini_pcm_parts_t *audio, const char *prompt,
+                                   gemini_text_cb_t on_text, void *user_ctx)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t gemini_live_start(const gemini_live_config_t *config, gemini_live_session_t **out) { return ESP_FAIL; }
+esp_err_t gemini_live_send_audio(gemini_live_session_t *session, const int16_t *pcm, size_t samples) { return ESP_FAIL; }
+esp_err_t gemini_live_activity_start(gemini_live_session_t *session) { return ESP_FAIL; }
+esp_err_t gemini_live_activity_end(gemini_live_session_t *session) { return ESP_FAIL; }
+void gemini_live_interrupt(gemini_live_session_t *session) { }
+bool gemini_live_is_open(const gemini_live_session_t *session) { return false; }
+void gemini_live_get_stats(gemini_live_session_t *session, gemini_live_stats_t *stats) { memset(stats, 0, sizeof(*stats)); }
+void gemini_live_stop(gemini_live_session_t *session) { }
+
+esp_err_t tts_scheduler_init(const tts_scheduler_config_t *config) { return ESP_OK; }
+esp_err_t tts_scheduler_submit(const char *text) { return ESP_OK; }
+esp_err_t tts_scheduler_submit_prompt(const char *text) { return ESP_OK; }
+esp_err_t tts_scheduler_wait_idle(TickType_t timeout) { return ESP_OK; }
+void tts_scheduler_cancel(void) { }
+void tts_scheduler_get_stats(tts_scheduler_stats_t *stats) { memset(stats, 0, sizeof(*stats)); }
+void tts_scheduler_deinit(void) { }
+
+esp_err_t audio_player_submit_pcm(const int16_t *samples, size_t sample_count, int sample_rate_hz,
+                                  int num_channels)
+{
+    return ESP_OK;
+}
+
+void audio_player_set_volume(int percent) { }
+int audio_player_get_volume(void) { return 100; }
+
+// ---------------------------------------------------------------------------
+
+static void settle(void)
+{
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = SETTLE_US * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+// Feed a recording from its start; wake before the buffer that starts at
+// or after `wake_at`. Returns the clock at the start of the recording.
+static int64_t feed(const int16_t *pcm, size_t n, size_t wake_at)
+{
+    int64_t t0 = esp_timer_get_time();
+    bool woken = false;
+    for (size_t off = 0; off + BUFFER <= n; off += BUFFER) {
+        if (!woken && off >= wake_at) {
+            voice_assistant_wake();
+            woken = true;
+            settle();
+        }
+        host_clock_advance(BUFFER_US);
+        voice_assistant_feed_audio(pcm + off, BUFFER);
+        settle();
+    }
+    return t0;
+}
+
+// Waits for the turn after `previous` to finish
+static bool wait_turn(uint32_t previous, voice_assistant_timeline_t *t)
+{
+    for (int64_t waited = 0; waited < TURN_WAIT_MS * 1000LL; waited += SETTLE_US) {
+        if (voice_assistant_get_last_turn(t) == ESP_OK && t->turn > previous) {
+            return true;
+        }
+        settle();
+    }
+    return false;
+}
+
+static double rel_s(int64_t at_us, int64_t t0)
+{
+    return at_us ? (double)(at_us - t0) / 1e6 : -1.0;
+}
+
+static void print_turn(const char *name, const voice_assistant_timeline_t *t, int64_t t0)
+{
+    printf("%-9s listening %6.3f s  endpointing %6.3f s  closed %6.3f s  upload %5.3f s (%zu trimmed)\n",
+           name, rel_s(t->enter_us[VOICE_ASSISTANT_STATE_LISTENING], t0),
+           rel_s(t->enter_us[VOICE_ASSISTANT_STATE_ENDPOINTING], t0),
+           rel_s(t->enter_us[VOICE_ASSISTANT_STATE_THINKING] ? t->enter_us[VOICE_ASSISTANT_STATE_THINKING]
+                                                             : t->enter_us[VOICE_ASSISTANT_STATE_IDLE], t0),
+           (double)t->samples / RATE, t->trimmed);
+}
+
+static int s_failures;
+
+static void check(bool ok, const char *what, double got, double want, double tol)
+{
+    printf("  %-40s %7.3f s (want %.3f +- %.3f)  %s\n", what, got, want, tol, ok ? "ok" : "FAIL");
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+static void check_near(const char *what, double got, double want, double tol_ms)
+{
+    check(fabs(got - want) <= tol_ms / 1000.0, what, got, want, tol_ms / 1000.0);
+}
+
+static int run_wav(const char *path, double wake_s)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 44, SEEK_SET);     // Canonical header
+    size_t n = len > 44 ? (size_t)(len - 44) / sizeof(int16_t) : 0;
+    int16_t *pcm = malloc(n * sizeof(int16_t) + 1);
+    n = fread(pcm, sizeof(int16_t), n, f);
+    fclose(f);
+
+    voice_assistant_timeline_t t;
+    int64_t t0 = feed(pcm, n, (size_t)(wake_s * RATE));
+    bool done = wait_turn(0, &t);
+    free(pcm);
+    if (!done) {
+        printf("%s: capture still open at the end of the recording\n", path);
+        return 0;
+    }
+    print_turn("recording", &t, t0);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    voice_assistant_config_t cfg = {0};
+    snprintf(cfg.gemini_api_key, sizeof(cfg.gemini_api_key), "bench");
+    if (voice_assistant_init(&cfg) != ESP_OK || voice_assistant_start() != ESP_OK) {
+        fprintf(stderr, "voice assistant did not start\n");
+        return 1;
+    }
+    if (argc > 1) {
+        return run_wav(argv[1], argc > 2 ? atof(argv[2]) : 0.5);
+    }
+
+    const double hangover = CONFIG_VOICE_ASSISTANT_VAD_HANGOVER_MS / 1000.0;
+    const double pad = CONFIG_VOICE_ASSISTANT_VAD_PAD_MS / 1000.0;
+    const double preroll = CONFIG_VOICE_ASSISTANT_PREROLL_MS / 1000.0;
+    voice_assistant_timeline_t t;
+
+    // Speech 1.00-2.50 s and 2.75-3.70 s, the wake 250 ms in
+    const size_t n = MS(6000);
+    float *x = calloc(n, sizeof(float));
+    add_room(x, n);
+    add_speech(x, MS(1000), MS(2500), 0.25f, 3);
+    add_speech(x, MS(2750), MS(3700), 0.25f, 5);
+    int16_t *pcm = to_pcm(x, n);
+    int64_t t0 = feed(pcm, n, MS(1250));
+    if (!wait_turn(0, &t)) {
+        fprintf(stderr, "phrase: turn did not finish\n");
+        return 1;
+    }
+    print_turn("phrase", &t, t0);
+    check_near("endpointing starts at the end of speech", rel_s(t.enter_us[VOICE_ASSISTANT_STATE_ENDPOINTING], t0),
+               3.70, EDGE_TOL_MS);
+    check_near("capture closes one hangover later", rel_s(t.enter_us[VOICE_ASSISTANT_STATE_THINKING], t0),
+               3.70 + hangover, CLOSE_TOL_MS);
+    // The leading pad reaches back before the speech only as far as the
+    // pre-roll does
+    double wake = rel_s(t.enter_us[VOICE_ASSISTANT_STATE_LISTENING], t0);
+    double from = fmax(1.00 - pad, wake - preroll);
+    check_near("upload: pre-roll, speech and pads", s_uploads == 1 ? (double)s_uploaded / RATE : 0.0,
+               3.70 + pad - from, UPLOAD_TOL_MS);
+    uint32_t turns = t.turn;
+    free(pcm);
+
+    // Room noise only
+    memset(x, 0, n * sizeof(float));
+    add_room(x, n);
+    pcm = to_pcm(x, n);
+    t0 = feed(pcm, n, MS(500));
+    if (!wait_turn(turns, &t)) {
+        fprintf(stderr, "silence: turn did not finish\n");
+        return 1;
+    }
+    print_turn("silence", &t, t0);
+    wake = rel_s(t.enter_us[VOICE_ASSISTANT_STATE_LISTENING], t0);
+    check_near("capture closes at the no-speech timeout", rel_s(t.enter_us[VOICE_ASSISTANT_STATE_IDLE], t0),
+               wake - preroll + CONFIG_VOICE_ASSISTANT_NO_SPEECH_TIMEOUT_MS / 1000.0, CLOSE_TOL_MS);
+    check(t.samples == 0 && s_uploads == 1, "nothing uploaded", (double)t.samples / RATE, 0.0, 0.0);
+    free(pcm);
+    free(x);
+
+    voice_assistant_stop();
+    printf("%s\n", s_failures ? "FAILED" : "all checks passed");
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,351 @@
+// Host shim: what audio_player.c needs beyond va_host.c: recursive
+// mutexes, a codec bus that accepts everything and a simulated I2S TX
+// driver.
+//
+// The simulated ring holds dma_buf_count * dma_buf_len frames. i2s_write()
+// copies what fits and, given ticks, waits for room like the driver does.
+// A DAC thread plays one buffer per buffer period in real time: it moves
+// the oldest frames (silence when there are none, as with auto-clear) to
+// the output log, advances the bench clock by the period and posts an
+// I2S_EVENT_TX_DONE. i2s_set_clk() drops what is queued, as the driver's
+// restart does, and logs the rate.
+#include "audio_host.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "driver/i2s.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_RECURSIVE_MUTEXES 4
+#define DAC_STEP_US 100
+
+static struct {
+    SemaphoreHandle_t mutex;
+    TaskHandle_t owner;
+    int depth;
+} s_recursive[MAX_RECURSIVE_MUTEXES];
+static pthread_mutex_t s_recursive_lock = PTHREAD_MUTEX_INITIALIZER;
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    SemaphoreHandle_t mutex = NULL;
+    pthread_mutex_lock(&s_recursive_lock);
+    for (int i = 0; i < MAX_RECURSIVE_MUTEXES && !mutex; i++) {
+        if (!s_recursive[i].mutex) {
+            s_recursive[i].mutex = xSemaphoreCreateMutex();
+            mutex = s_recursive[i].mutex;
+        }
+    }
+    pthread_mutex_unlock(&s_recursive_lock);
+    return mutex;
+}
+
+static int recursive_slot(SemaphoreHandle_t mutex)
+{
+    for (int i = 0; i < MAX_RECURSIVE_MUTEXES; i++) {
+        if (s_recursive[i].mutex == mutex) {
+            return i;
+        }
+    }
+    abort();
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks)
+{
+    int slot = recursive_slot(mutex);
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    // Only the owner sets the owner to itself, so this read cannot race
+    if (__atomic_load_n(&s_recursive[slot].owner, __ATOMIC_ACQUIRE) == self) {
+        s_recursive[slot].depth++;
+        return pdTRUE;
+    }
+    if (xSemaphoreTake(mutex, ticks) != pdTRUE) {
+        return pdFALSE;
+    }
+    __atomic_store_n(&s_recursive[slot].owner, self, __ATOMIC_RELEASE);
+    s_recursive[slot].depth = 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex)
+{
+    int slot = recursive_slot(mutex);
+    if (__atomic_load_n(&s_recursive[slot].owner, __ATOMIC_ACQUIRE) != xTaskGetCurrentTaskHandle()) {
+        return pdFALSE;
+    }
+    if (--s_recursive[slot].depth == 0) {
+        __atomic_store_n(&s_recursive[slot].owner, NULL, __ATOMIC_RELEASE);
+        xSemaphoreGive(mutex);
+    }
+    return pdTRUE;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, int mode, size_t rx_len, size_t tx_len, int flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t port)
+{
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    static int token;
+    return (i2c_cmd_handle_t)&token;
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd)
+{
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t *data, int ack)
+{
+    *data = 0;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks)
+{
+    return ESP_OK;
+}
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t room;
+    pthread_t dac;
+    volatile bool running;
+    QueueHandle_t events;
+    int rate;
+    size_t buf_frames;
+    size_t ring_frames;
+    int16_t *ring;              // Queued frames, stereo, circular
+    size_t head;
+    size_t queued;
+    host_i2s_frame_t *out;      // What the DAC played
+    size_t out_cap;
+    size_t out_len;
+    int rates[HOST_I2S_MAX_RATES];
+    int rate_count;
+} s_i2s = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .room = PTHREAD_COND_INITIALIZER,
+};
+
+static void play_buffer(void)
+{
+    pthread_mutex_lock(&s_i2s.lock);
+    for (size_t i = 0; i < s_i2s.buf_frames; i++) {
+        host_i2s_frame_t frame = {0, 0};
+        if (s_i2s.queued > 0) {
+            frame.left = s_i2s.ring[s_i2s.head * 2];
+            frame.right = s_i2s.ring[s_i2s.head * 2 + 1];
+            s_i2s.head = (s_i2s.head + 1) % s_i2s.ring_frames;
+            s_i2s.queued--;
+        }
+        if (s_i2s.out_len < s_i2s.out_cap) {
+            s_i2s.out[s_i2s.out_len++] = frame;
+        }
+    }
+    pthread_cond_broadcast(&s_i2s.room);
+    pthread_mutex_unlock(&s_i2s.lock);
+
+    // Like the driver: a full event queue loses its oldest event
+    i2s_event_t event = {.type = I2S_EVENT_TX_DONE, .size = s_i2s.buf_frames * sizeof(int16_t) * 2};
+    if (xQueueSend(s_i2s.events, &event, 0) != pdTRUE) {
+        i2s_event_t stale;
+        xQueueReceive(s_i2s.events, &stale, 0);
+        xQueueSend(s_i2s.events, &event, 0);
+    }
+}
+
+static void *dac_thread(void *arg)
+{
+    int64_t played_us = 0;
+    while (s_i2s.running) {
+        struct timespec step = {0, DAC_STEP_US * 1000L};
+        nanosleep(&step, NULL);
+        host_clock_advance(DAC_STEP_US);
+        played_us += DAC_STEP_US;
+        int64_t buf_us = (int64_t)s_i2s.buf_frames * 1000000 / s_i2s.rate;
+        if (played_us >= buf_us) {
+            played_us -= buf_us;
+            play_buffer();
+        }
+    }
+    return NULL;
+}
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queue_size, QueueHandle_t *queue)
+{
+    s_i2s.rate = config->sample_rate;
+    s_i2s.buf_frames = (size_t)config->dma_buf_len;
+    s_i2s.ring_frames = (size_t)config->dma_buf_count * config->dma_buf_len;
+    s_i2s.ring = calloc(s_i2s.ring_frames * 2, sizeof(int16_t));
+    s_i2s.events = xQueueCreate(queue_size, sizeof(i2s_event_t));
+    if (!s_i2s.ring || !s_i2s.events) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_i2s.head = 0;
+    s_i2s.queued = 0;
+    if (queue) {
+        *queue = s_i2s.events;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port)
+{
+    if (s_i2s.running) {
+        s_i2s.running = false;
+        pthread_join(s_i2s.dac, NULL);
+    }
+    vQueueDelete(s_i2s.events);
+    free(s_i2s.ring);
+    s_i2s.events = NULL;
+    s_i2s.ring = NULL;
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, int bits, int channels)
+{
+    pthread_mutex_lock(&s_i2s.lock);
+    s_i2s.rate = (int)rate;
+    s_i2s.queued = 0;
+    if (s_i2s.rate_count < HOST_I2S_MAX_RATES) {
+        s_i2s.rates[s_i2s.rate_count++] = (int)rate;
+    }
+    pthread_cond_broadcast(&s_i2s.room);
+    pthread_mutex_unlock(&s_i2s.lock);
+    return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port)
+{
+    pthread_mutex_lock(&s_i2s.lock);
+    memset(s_i2s.ring, 0, s_i2s.ring_frames * 2 * sizeof(int16_t));
+    pthread_mutex_unlock(&s_i2s.lock);
+    return ESP_OK;
+}
+
+esp_err_t i2s_start(i2s_port_t port)
+{
+    if (!s_i2s.running) {
+        s_i2s.running = true;
+        if (pthread_create(&s_i2s.dac, NULL, dac_thread, NULL) != 0) {
+            s_i2s.running = false;
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *bytes_written, TickType_t ticks)
+{
+    const int16_t *frames = src;
+    size_t count = size / (sizeof(int16_t) * 2);
+    size_t done = 0;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&s_i2s.lock);
+    while (done < count) {
+        if (s_i2s.queued == s_i2s.ring_frames) {
+            if (ticks == 0) {
+                break;
+            }
+            if (ticks == portMAX_DELAY) {
+                pthread_cond_wait(&s_i2s.room, &s_i2s.lock);
+            } else if (pthread_cond_timedwait(&s_i2s.room, &s_i2s.lock, &deadline) != 0) {
+                break;
+            }
+            continue;
+        }
+        size_t tail = (s_i2s.head + s_i2s.queued) % s_i2s.ring_frames;
+        s_i2s.ring[tail * 2] = frames[done * 2];
+        s_i2s.ring[tail * 2 + 1] = frames[done * 2 + 1];
+        s_i2s.queued++;
+        done++;
+    }
+    pthread_mutex_unlock(&s_i2s.lock);
+    *bytes_written = done * sizeof(int16_t) * 2;
+    return ESP_OK;
+}
+
+void host_i2s_capture(host_i2s_frame_t *out, size_t capacity)
+{
+    pthread_mutex_lock(&s_i2s.lock);
+    s_i2s.out = out;
+    s_i2s.out_cap = capacity;
+    s_i2s.out_len = 0;
+    pthread_mutex_unlock(&s_i2s.lock);
+}
+
+size_t host_i2s_captured(void)
+{
+    pthread_mutex_lock(&s_i2s.lock);
+    size_t len = s_i2s.out_len;
+    pthread_mutex_unlock(&s_i2s.lock);
+    return len;
+}
+
+size_t host_i2s_queued(void)
+{
+    pthread_mutex_lock(&s_i2s.lock);
+    size_t queued = s_i2s.queued;
+    pthread_mutex_unlock(&s_i2s.lock);
+    return queued;
+}
+
+int host_i2s_rates(const int **rates)
+{
+    *rates = s_i2s.rates;
+    return s_i2s.rate_count;
+}
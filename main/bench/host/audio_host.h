@@ -0,0 +1,36 @@
+// Host shim: what the player bench reads back from the simulated I2S TX
+// driver (audio_host.c)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_I2S_MAX_RATES 16
+
+typedef struct {
+    int16_t left;
+    int16_t right;
+} host_i2s_frame_t;
+
+/**
+ * Log what the DAC plays from now on
+ * @param out: Frame log, owned by the caller
+ * @param capacity: Frames it holds; later frames are not logged
+ */
+void host_i2s_capture(host_i2s_frame_t *out, size_t capacity);
+
+/**
+ * @return Frames logged so far
+ */
+size_t host_i2s_captured(void);
+
+/**
+ * @return Frames written and not yet played
+ */
+size_t host_i2s_queued(void);
+
+/**
+ * Rates passed to i2s_set_clk(), oldest first
+ * @param rates: OUT: the log
+ * @return Number of entries
+ */
+int host_i2s_rates(const int **rates);
@@ -0,0 +1,23 @@
+// Host shim: GPIO configuration, accepted and ignored (audio_host.c)
+#pragma once
+#include "esp_err.h"
+#include "hal/gpio_types.h"
+#include <stdint.h>
+
+#define GPIO_NUM_38             38
+#define GPIO_MODE_OUTPUT        2
+#define GPIO_PULLUP_DISABLE     0
+#define GPIO_PULLUP_ENABLE      1
+#define GPIO_PULLDOWN_DISABLE   0
+#define GPIO_INTR_DISABLE       0
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    int mode;
+    int pull_up_en;
+    int pull_down_en;
+    int intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *config);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
@@ -0,0 +1,43 @@
+// Host shim: the legacy I2C master API, with every transfer succeeding
+// and reads returning 0 (audio_host.c). Like the IDF header it brings in
+// the FreeRTOS task API and stdlib.
+#pragma once
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef int i2c_port_t;
+typedef struct host_i2c_cmd *i2c_cmd_handle_t;
+
+#define I2C_NUM_0               0
+#define I2C_NUM_MAX             2
+#define I2C_MODE_MASTER         1
+#define I2C_MASTER_WRITE        0
+#define I2C_MASTER_READ         1
+#define I2C_MASTER_LAST_NACK    2
+
+typedef struct {
+    int mode;
+    int sda_io_num;
+    int scl_io_num;
+    int sda_pullup_en;
+    int scl_pullup_en;
+    struct {
+        uint32_t clk_speed;
+    } master;
+} i2c_config_t;
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *config);
+esp_err_t i2c_driver_install(i2c_port_t port, int mode, size_t rx_len, size_t tx_len, int flags);
+esp_err_t i2c_driver_delete(i2c_port_t port);
+i2c_cmd_handle_t i2c_cmd_link_create(void);
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack);
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd, uint8_t *data, int ack);
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks);
@@ -0,0 +1,61 @@
+// Host shim: the legacy I2S driver API audio_player.c uses. The TX side
+// is simulated in audio_host.c: a ring of DMA buffers drained in real time
+// at the configured rate, with an I2S_EVENT_TX_DONE per buffer played.
+#pragma once
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef int i2s_port_t;
+
+#define I2S_MODE_MASTER             1
+#define I2S_MODE_TX                 4
+#define I2S_BITS_PER_SAMPLE_16BIT   16
+#define I2S_CHANNEL_FMT_RIGHT_LEFT  0
+#define I2S_COMM_FORMAT_STAND_I2S   1
+#define I2S_CHANNEL_STEREO          2
+#define I2S_PIN_NO_CHANGE           (-1)
+#define ESP_INTR_FLAG_LEVEL1        (1 << 1)
+
+typedef struct {
+    int mode;
+    int sample_rate;
+    int bits_per_sample;
+    int channel_format;
+    int communication_format;
+    int intr_alloc_flags;
+    int dma_buf_count;
+    int dma_buf_len;
+    bool use_apll;
+    bool tx_desc_auto_clear;
+    int fixed_mclk;
+} i2s_config_t;
+
+typedef struct {
+    int mck_io_num;
+    int bck_io_num;
+    int ws_io_num;
+    int data_out_num;
+    int data_in_num;
+} i2s_pin_config_t;
+
+typedef enum {
+    I2S_EVENT_DMA_ERROR,
+    I2S_EVENT_TX_DONE,
+    I2S_EVENT_RX_DONE,
+} i2s_event_type_t;
+
+typedef struct {
+    i2s_event_type_t type;
+    size_t size;
+} i2s_event_t;
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queue_size, QueueHandle_t *queue);
+esp_err_t i2s_driver_uninstall(i2s_port_t port);
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins);
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, int bits, int channels);
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port);
+esp_err_t i2s_start(i2s_port_t port);
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *bytes_written, TickType_t ticks);
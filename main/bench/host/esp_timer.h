@@ -0,0 +1,13 @@
+// Host shim: esp_timer_get_time() on a clock the bench moves by hand, so
+// microphone buffers carry the time they would have been captured at
+// however fast they are fed (va_host.c)
+#pragma once
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+/**
+ * Move the clock forward
+ * @param us: Microseconds
+ */
+void host_clock_advance(int64_t us);
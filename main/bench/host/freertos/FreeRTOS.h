@@ -0,0 +1,15 @@
+// Host shim: the gemini bench's FreeRTOS types plus spinlock critical
+// sections, which main/ uses for short shared-state updates
+#pragma once
+#include "../../../../components/gemini/bench/host/freertos/FreeRTOS.h"
+
+#define pdFAIL pdFALSE
+
+typedef struct {
+    volatile int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+#define portENTER_CRITICAL(mux) \
+    do { while (__atomic_test_and_set(&(mux)->locked, __ATOMIC_ACQUIRE)) { } } while (0)
+#define portEXIT_CRITICAL(mux) __atomic_clear(&(mux)->locked, __ATOMIC_RELEASE)
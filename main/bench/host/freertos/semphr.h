@@ -0,0 +1,9 @@
+// Host shim: the gemini bench's semaphores plus recursive mutexes
+// (audio_host.c)
+#pragma once
+#include "../../../../components/gemini/bench/host/freertos/semphr.h"
+#include "freertos/queue.h"
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex);
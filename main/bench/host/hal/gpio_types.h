@@ -0,0 +1,4 @@
+// Host shim: GPIO numbers, for headers that only name pins
+#pragma once
+
+typedef int gpio_num_t;
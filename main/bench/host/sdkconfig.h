@@ -0,0 +1,15 @@
+// Host shim: the gemini bench defaults plus the voice assistant options
+// the endpoint bench builds voice_assistant.c with. Earcons, local intents,
+// the network warm-up and audio query are off: none of them takes part in
+// capture and endpointing.
+#pragma once
+#include "../../../components/gemini/bench/host/sdkconfig.h"
+
+#define CONFIG_BOARD_KORVO1 1
+#define CONFIG_TTS_MAX_IN_FLIGHT 3
+#define CONFIG_VOICE_ASSISTANT_MAX_UTTERANCE_MS 8000
+#define CONFIG_VOICE_ASSISTANT_VAD_HANGOVER_MS 600
+#define CONFIG_VOICE_ASSISTANT_VAD_THRESHOLD_DB 9
+#define CONFIG_VOICE_ASSISTANT_VAD_PAD_MS 150
+#define CONFIG_VOICE_ASSISTANT_NO_SPEECH_TIMEOUT_MS 5000
+#define CONFIG_VOICE_ASSISTANT_PREROLL_MS 300
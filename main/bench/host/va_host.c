@@ -0,0 +1,263 @@
+// Host shim: what voice_assistant.c and earcon.c need beyond the gemini
+// bench's FreeRTOS shim: queues, task notifications and a hand-driven clock
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int64_t s_clock_us = 1000000;
+
+int64_t esp_timer_get_time(void)
+{
+    return __atomic_load_n(&s_clock_us, __ATOMIC_ACQUIRE);
+}
+
+void host_clock_advance(int64_t us)
+{
+    __atomic_add_fetch(&s_clock_us, us, __ATOMIC_ACQ_REL);
+}
+
+struct host_queue {
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t q = calloc(1, sizeof(*q));
+    if (!q) {
+        return NULL;
+    }
+    q->items = malloc((size_t)length * item_size);
+    if (!q->items) {
+        free(q);
+        return NULL;
+    }
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->changed, NULL);
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+// Waits on `changed` until `ready` holds or the ticks (ms) run out
+static bool wait_for(QueueHandle_t q, bool (*ready)(QueueHandle_t), TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (!ready(q)) {
+        if (ticks == 0) {
+            return false;
+        }
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(&q->changed, &q->mutex);
+        } else if (pthread_cond_timedwait(&q->changed, &q->mutex, &deadline) != 0) {
+            return ready(q);
+        }
+    }
+    return true;
+}
+
+static bool has_room(QueueHandle_t q)
+{
+    return q->count < q->length;
+}
+
+static bool has_item(QueueHandle_t q)
+{
+    return q->count > 0;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    pthread_mutex_lock(&q->mutex);
+    bool ok = wait_for(q, has_room, ticks);
+    if (ok) {
+        UBaseType_t tail = (q->head + q->count) % q->length;
+        memcpy(q->items + (size_t)tail * q->item_size, item, q->item_size);
+        q->count++;
+        pthread_cond_broadcast(&q->changed);
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    pthread_mutex_lock(&q->mutex);
+    bool ok = wait_for(q, has_item, ticks);
+    if (ok) {
+        memcpy(item, q->items + (size_t)q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        pthread_cond_broadcast(&q->changed);
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->mutex);
+    q->head = 0;
+    q->count = 0;
+    pthread_cond_broadcast(&q->changed);
+    pthread_mutex_unlock(&q->mutex);
+    return pdPASS;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (q) {
+        pthread_cond_destroy(&q->changed);
+        pthread_mutex_destroy(&q->mutex);
+        free(q->items);
+        free(q);
+    }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)core;
+    return xTaskCreate(fn, name, stack_depth, arg, priority, handle);
+}
+
+// One notification count per task, created by whichever side gets there
+// first. Tasks are never deleted while the bench runs.
+#define MAX_NOTIFIED_TASKS 8
+
+static pthread_mutex_t s_notify_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    TaskHandle_t task;
+    SemaphoreHandle_t count;
+} s_notify[MAX_NOTIFIED_TASKS];
+
+static SemaphoreHandle_t notify_count(TaskHandle_t task)
+{
+    SemaphoreHandle_t count = NULL;
+    pthread_mutex_lock(&s_notify_lock);
+    for (int i = 0; i < MAX_NOTIFIED_TASKS && !count; i++) {
+        if (s_notify[i].count && s_notify[i].task == task) {
+            count = s_notify[i].count;
+        } else if (!s_notify[i].count) {
+            s_notify[i].task = task;
+            s_notify[i].count = xSemaphoreCreateCounting(0xFFFF, 0);
+            count = s_notify[i].count;
+        }
+    }
+    pthread_mutex_unlock(&s_notify_lock);
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    xSemaphoreGive(notify_count(task));
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    SemaphoreHandle_t count = notify_count(xTaskGetCurrentTaskHandle());
+    if (xSemaphoreTake(count, ticks) != pdTRUE) {
+        return 0;
+    }
+    uint32_t taken = 1;
+    while (clear && xSemaphoreTake(count, 0) == pdTRUE) {
+        taken++;
+    }
+    return taken;
+}
+
+// Notification values: one per task, a slot taken like the counts above.
+// Only the eSetValue actions are modelled; the clear masks are ignored.
+static pthread_cond_t s_notify_changed = PTHREAD_COND_INITIALIZER;
+static struct {
+    TaskHandle_t task;
+    bool pending;
+    uint32_t value;
+} s_notify_value[MAX_NOTIFIED_TASKS];
+
+// Under s_notify_lock
+static int notify_value_slot(TaskHandle_t task)
+{
+    for (int i = 0; i < MAX_NOTIFIED_TASKS; i++) {
+        if (s_notify_value[i].task == task) {
+            return i;
+        }
+    }
+    for (int i = 0; i < MAX_NOTIFIED_TASKS; i++) {
+        if (!s_notify_value[i].task) {
+            s_notify_value[i].task = task;
+            return i;
+        }
+    }
+    abort();
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    pthread_mutex_lock(&s_notify_lock);
+    int slot = notify_value_slot(task);
+    BaseType_t ret = pdPASS;
+    if (action == eSetValueWithoutOverwrite && s_notify_value[slot].pending) {
+        ret = pdFAIL;
+    } else {
+        s_notify_value[slot].value = value;
+        s_notify_value[slot].pending = true;
+        pthread_cond_broadcast(&s_notify_changed);
+    }
+    pthread_mutex_unlock(&s_notify_lock);
+    return ret;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&s_notify_lock);
+    int slot = notify_value_slot(xTaskGetCurrentTaskHandle());
+    while (!s_notify_value[slot].pending) {
+        if (ticks == 0) {
+            break;
+        }
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(&s_notify_changed, &s_notify_lock);
+        } else if (pthread_cond_timedwait(&s_notify_changed, &s_notify_lock, &deadline) != 0) {
+            break;
+        }
+    }
+    bool got = s_notify_value[slot].pending;
+    if (got) {
+        s_notify_value[slot].pending = false;
+        if (value) {
+            *value = s_notify_value[slot].value;
+        }
+    }
+    pthread_mutex_unlock(&s_notify_lock);
+    return got ? pdTRUE : pdFALSE;
+}
@@ -0,0 +1,138 @@
+// Host benchmark: local_intent against a corpus of smart-speaker transcripts
+//
+// Runs every transcript in the corpus through local_intent_match and
+// compares the result with its label. Reports, per intent, how many were
+// recognized, the share of all turns answered on the device, transcripts
+// that should have gone to the LLM but were taken locally (false
+// positives, the costly mistake: the user's question is never answered)
+// and the matching cost. Exits with status 1 on any false positive or
+// wrongly classified command.
+//
+// Usage: intent_bench [corpus]
+//   corpus  <intent><TAB><transcript> per line (default intent_corpus.txt
+//           next to this file)
+
+#include "local_intent.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_LINE    256
+#define REPEATS     200
+
+typedef struct {
+    int total;
+    int matched;            // Recognized as this intent
+    int taken;              // Matched as this intent, whatever the label
+} intent_stats_t;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static local_intent_type_t parse_label(const char *label)
+{
+    for (int t = 0; t < LOCAL_INTENT_COUNT; t++) {
+        if (strcmp(label, local_intent_name(t)) == 0) {
+            return t;
+        }
+    }
+    return LOCAL_INTENT_COUNT;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : INTENT_CORPUS;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+
+    intent_stats_t stats[LOCAL_INTENT_COUNT] = {0};
+    char (*lines)[MAX_LINE] = NULL;
+    int n = 0, cap = 0;
+    int false_pos = 0, wrong = 0, local = 0;
+    char line[MAX_LINE];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *text = strchr(line, '\t');
+        if (line[0] == '#' || !text) {
+            continue;
+        }
+        *text++ = '\0';
+        local_intent_type_t expected = parse_label(line);
+        if (expected == LOCAL_INTENT_COUNT) {
+            fprintf(stderr, "unknown intent '%s'\n", line);
+            fclose(f);
+            return 1;
+        }
+
+        local_intent_t got;
+        local_intent_match(text, &got);
+        stats[expected].total++;
+        stats[got.type].taken++;
+        if (got.type == expected) {
+            stats[expected].matched++;
+        }
+        if (got.type != LOCAL_INTENT_NONE) {
+            local++;
+        }
+        if (got.type != expected) {
+            const char *kind = expected == LOCAL_INTENT_NONE ? "FALSE POSITIVE"
+                               : got.type == LOCAL_INTENT_NONE ? "missed"
+                               : "WRONG";
+            printf("  %-14s %-12s -> %-12s \"%s\"\n", kind, local_intent_name(expected),
+                   local_intent_name(got.type), text);
+            if (expected == LOCAL_INTENT_NONE) {
+                false_pos++;
+            } else if (got.type != LOCAL_INTENT_NONE) {
+                wrong++;
+            }
+        } else if (got.value) {
+            printf("  %-14s %-12s value %d \"%s\"\n", "ok", local_intent_name(got.type), got.value, text);
+        }
+
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            lines = realloc(lines, cap * sizeof(*lines));
+        }
+        snprintf(lines[n++], MAX_LINE, "%s", text);
+    }
+    fclose(f);
+    if (n == 0) {
+        fprintf(stderr, "no transcripts in %s\n", path);
+        return 1;
+    }
+
+    int commands = n - stats[LOCAL_INTENT_NONE].total;
+    int recognized = 0;
+    printf("\n%-14s %8s %8s\n", "intent", "labelled", "matched");
+    for (int t = 1; t < LOCAL_INTENT_COUNT; t++) {
+        printf("%-14s %8d %8d\n", local_intent_name(t), stats[t].total, stats[t].matched);
+        recognized += stats[t].matched;
+    }
+    printf("%-14s %8d %8d\n", "none", stats[LOCAL_INTENT_NONE].total, stats[LOCAL_INTENT_NONE].matched);
+
+    double start = now_s();
+    local_intent_t sink;
+    for (int r = 0; r < REPEATS; r++) {
+        for (int i = 0; i < n; i++) {
+            local_intent_match(lines[i], &sink);
+        }
+    }
+    double us = (now_s() - start) * 1e6 / ((double)REPEATS * n);
+    free(lines);
+
+    printf("\n%-34s %d of %d (%.0f%%)\n", "commands recognized", recognized, commands,
+           commands ? 100.0 * recognized / commands : 0.0);
+    printf("%-34s %d of %d (%.0f%%)\n", "turns answered on the device", local, n, 100.0 * local / n);
+    printf("%-34s %d of %d\n", "questions taken locally", false_pos, stats[LOCAL_INTENT_NONE].total);
+    printf("%-34s %d\n", "commands taken as another", wrong);
+    printf("%-34s %.2f us per transcript\n", "cost", us);
+    return false_pos || wrong ? 1 : 0;
+}
@@ -0,0 +1,249 @@
+// Host benchmark: earcons over other output through audio_player.c
+//
+// Runs audio_player.c and earcon.c unchanged on a simulated I2S TX driver
+// (host/audio_host.c): the DMA ring drains in real time on the bench
+// clock, and everything the DAC plays is logged. Earcons are rendered at
+// the TTS rate (24 kHz) as in the firmware.
+//
+// Cases:
+//   idle    an earcon with nothing else playing, at the 44.1 kHz default
+//           output rate
+//   music   a 48 kHz WAV with an earcon fired 400 ms in
+// Each checks that the output rate never left the rate it was at, that the
+// earcon played whole and uninterrupted at its length at that rate, that
+// the music was played in full around it, and that the earcon's first
+// samples were in the DMA ring within the 10 ms target of earcon.c. The
+// time until the earcon was audible (the queued music ahead of it) is
+// printed. Exits with status 1 when any check fails.
+//
+// The bench clock is the simulated DAC's: it only advances as buffers
+// play, so a stalled host does not count as latency, while slow wake-ups
+// of the earcon and writer threads do.
+//
+// Usage: player_bench
+
+#include "audio_player.h"
+#include "audio_host.h"
+#include "earcon.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_RATE    44100
+#define EARCON_RATE     24000
+#define MUSIC_RATE      48000
+#define MUSIC_MS        1200
+#define MUSIC_LEFT      1000            // Constant frames: easy to tell apart
+#define MUSIC_RIGHT     (-1000)
+#define EARCON_AT_MS    400
+#define WAKE_MS         140             // Both tones of EARCON_WAKE
+#define TARGET_US       10000           // EARCON_TARGET_US in earcon.c
+#define LOG_FRAMES      (MUSIC_RATE * 3)
+
+int esp_log_host_level = 0;
+
+static int s_failures;
+static host_i2s_frame_t s_log[LOG_FRAMES];
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+// Waits on the bench clock, which runs as the DAC plays
+static void wait_clock_ms(int ms)
+{
+    int64_t until = esp_timer_get_time() + (int64_t)ms * 1000;
+    while (esp_timer_get_time() < until) {
+        sleep_ms(1);
+    }
+}
+
+static void wait_drained(void)
+{
+    while (host_i2s_queued() > 0) {
+        sleep_ms(1);
+    }
+    wait_clock_ms(20);
+}
+
+static uint8_t *make_music_wav(size_t *len)
+{
+    size_t frames = (size_t)MUSIC_RATE * MUSIC_MS / 1000;
+    uint32_t data_size = (uint32_t)(frames * 4);
+    *len = 44 + data_size;
+    uint8_t *wav = malloc(*len);
+    if (!wav) {
+        return NULL;
+    }
+    uint32_t riff_size = 36 + data_size;
+    uint32_t fmt_size = 16;
+    uint16_t format = 1, channels = 2, block_align = 4, bits = 16;
+    uint32_t rate = MUSIC_RATE, byte_rate = MUSIC_RATE * 4;
+    memcpy(wav, "RIFF", 4);
+    memcpy(wav + 4, &riff_size, 4);
+    memcpy(wav + 8, "WAVEfmt ", 8);
+    memcpy(wav + 16, &fmt_size, 4);
+    memcpy(wav + 20, &format, 2);
+    memcpy(wav + 22, &channels, 2);
+    memcpy(wav + 24, &rate, 4);
+    memcpy(wav + 28, &byte_rate, 4);
+    memcpy(wav + 32, &block_align, 2);
+    memcpy(wav + 34, &bits, 2);
+    memcpy(wav + 36, "data", 4);
+    memcpy(wav + 40, &data_size, 4);
+    int16_t *pcm = (int16_t *)(wav + 44);
+    for (size_t i = 0; i < frames; i++) {
+        pcm[2 * i] = MUSIC_LEFT;
+        pcm[2 * i + 1] = MUSIC_RIGHT;
+    }
+    return wav;
+}
+
+typedef struct {
+    const uint8_t *wav;
+    size_t len;
+    esp_err_t err;
+    SemaphoreHandle_t done;
+} music_t;
+
+static void music_task(void *arg)
+{
+    music_t *music = arg;
+    music->err = audio_player_play_wav(music->wav, music->len, NULL);
+    xSemaphoreGive(music->done);
+    vTaskDelete(NULL);
+}
+
+static bool is_music(host_i2s_frame_t f)
+{
+    return f.left == MUSIC_LEFT && f.right == MUSIC_RIGHT;
+}
+
+static bool is_silence(host_i2s_frame_t f)
+{
+    return f.left == 0 && f.right == 0;
+}
+
+// Checks what the DAC logged and the rates set; `trigger_frame` is where
+// the log was when the earcon was triggered
+static void check_output(const char *name, int rate, size_t trigger_frame, size_t music_frames)
+{
+    size_t logged = host_i2s_captured();
+    size_t first = 0, last = 0, music = 0, music_inside = 0;
+    bool found = false;
+    for (size_t i = 0; i < logged; i++) {
+        host_i2s_frame_t f = s_log[i];
+        if (is_music(f)) {
+            music++;
+        } else if (!is_silence(f)) {
+            if (!found) {
+                first = i;
+                found = true;
+            }
+            last = i;
+        }
+    }
+    for (size_t i = first; found && i <= last; i++) {
+        music_inside += is_music(s_log[i]);
+    }
+
+    const int *rates;
+    int rate_count = host_i2s_rates(&rates);
+    bool rate_kept = true;
+    for (int i = 0; i < rate_count; i++) {
+        rate_kept = rate_kept && rates[i] == rate;
+    }
+    size_t expected = (size_t)rate * WAKE_MS / 1000;
+    size_t span = found ? last - first + 1 : 0;
+    double audible_ms = found ? (double)(first - trigger_frame) * 1000.0 / rate : -1.0;
+
+    earcon_stats_t stats;
+    earcon_get_stats(&stats);
+    printf("%s: output %d Hz, earcon %zu frames (expected %zu), first samples in DMA %lu us "
+           "after the trigger, audible after %.1f ms\n",
+           name, rate, span, expected, (unsigned long)stats.last_latency_us, audible_ms);
+
+    char what[64];
+    snprintf(what, sizeof(what), "output stayed at %d Hz (%d rate change%s)", rate, rate_count,
+             rate_count == 1 ? "" : "s");
+    check(rate_kept, what);
+    check(found && span + rate / 1000 >= expected && span <= expected + rate / 1000,
+          "earcon played whole at the output rate");
+    check(found && music_inside == 0, "earcon not interleaved with other output");
+    check(music == music_frames, "music played in full");
+    check(stats.last_latency_us <= TARGET_US, "earcon in DMA within 10 ms of the trigger");
+}
+
+static void run_idle(void)
+{
+    wait_drained();
+    host_i2s_capture(s_log, LOG_FRAMES);
+    earcon_play(EARCON_WAKE);
+    wait_clock_ms(WAKE_MS + 100);
+    wait_drained();
+    check_output("idle", DEFAULT_RATE, 0, 0);
+}
+
+static void run_music(void)
+{
+    music_t music = {.done = xSemaphoreCreateBinary()};
+    music.wav = make_music_wav(&music.len);
+    if (!music.wav || !music.done) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    wait_drained();
+    host_i2s_capture(s_log, LOG_FRAMES);
+    xTaskCreate(music_task, "music", 8192, &music, 5, NULL);
+    wait_clock_ms(EARCON_AT_MS);
+    size_t trigger_frame = host_i2s_captured();
+    earcon_play(EARCON_WAKE);
+    xSemaphoreTake(music.done, portMAX_DELAY);
+    wait_drained();
+    check(music.err == ESP_OK, "music played without error");
+    check_output("music", MUSIC_RATE, trigger_frame, (size_t)MUSIC_RATE * MUSIC_MS / 1000);
+    vSemaphoreDelete(music.done);
+    free((void *)music.wav);
+}
+
+int main(void)
+{
+    audio_player_config_t cfg = {
+        .i2s_port = 0,
+        .bclk_gpio = 1,
+        .lrclk_gpio = 2,
+        .data_gpio = 3,
+        .mclk_gpio = 4,
+        .i2c_scl_gpio = 5,
+        .i2c_sda_gpio = 6,
+        .default_sample_rate = DEFAULT_RATE,
+    };
+    if (audio_player_init(&cfg) != ESP_OK || earcon_init(EARCON_RATE) != ESP_OK) {
+        fprintf(stderr, "player or earcon init failed\n");
+        return 1;
+    }
+
+    run_idle();
+    run_music();
+
+    earcon_deinit();
+    audio_player_shutdown();
+    printf("%s\n", s_failures ? "FAILED" : "all checks passed");
+    return s_failures ? 1 : 0;
+}
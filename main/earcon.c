@@ -0,0 +1,244 @@
+#include "earcon.h"
+#include "audio_player.h"
+#include "audio_eq.h"
+#include "span_trace.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "earcon";
+
+// Above the microphone task (8) and the TTS player (6): a tone triggered
+// from the wake callback preempts both
+#define EARCON_TASK_PRIORITY    9
+#define EARCON_STACK_SIZE       3072
+#define EARCON_TARGET_US        10000   // Trigger to first sample in DMA
+#define EARCON_STOP             (EARCON_COUNT + 1)
+#define MAX_TONES               2
+#define FADE_MS                 5       // Raised-cosine edges: no clicks
+#define SYNTH_PI                3.14159265f
+
+typedef struct {
+    float freq_hz;
+    uint16_t ms;
+} tone_t;
+
+typedef struct {
+    const char *name;
+    float level;                // Peak before EQ, full scale = 1
+    tone_t tones[MAX_TONES];    // Played back to back; 0 Hz ends the list
+} earcon_def_t;
+
+static const earcon_def_t EARCONS[EARCON_COUNT] = {
+    [EARCON_WAKE]     = {"wake",     0.5f, {{1319.0f, 60}, {1760.0f, 80}}},
+    [EARCON_THINKING] = {"thinking", 0.3f, {{880.0f, 50}}},
+    [EARCON_ERROR]    = {"error",    0.5f, {{660.0f, 90}, {440.0f, 90}}},
+};
+
+typedef struct {
+    const int16_t *pcm;
+    size_t samples;
+} clip_t;
+
+static struct {
+    bool initialized;
+    int rate;
+    int16_t *pcm;                   // All clips, back to back
+    clip_t clips[EARCON_COUNT];
+    TaskHandle_t task;
+    SemaphoreHandle_t exited;
+    // Trigger time of the earcon waiting to play; 64-bit, so under `lock`
+    portMUX_TYPE lock;
+    int64_t trigger_us;
+    uint32_t played;
+    uint32_t dropped;
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+    uint64_t total_latency_us;
+} s_earcon = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static size_t clip_samples(const earcon_def_t *def, int rate)
+{
+    size_t n = 0;
+    for (int i = 0; i < MAX_TONES && def->tones[i].freq_hz > 0; i++) {
+        n += (size_t)rate * def->tones[i].ms / 1000;
+    }
+    return n;
+}
+
+// Sine tones with faded edges, through the same EQ as WAV playback
+static void render(const earcon_def_t *def, int rate, audio_eq_t *eq, int16_t *out)
+{
+    audio_eq_reset(eq);
+    size_t fade = (size_t)rate * FADE_MS / 1000;
+    for (int i = 0; i < MAX_TONES && def->tones[i].freq_hz > 0; i++) {
+        size_t n = (size_t)rate * def->tones[i].ms / 1000;
+        float step = 2.0f * SYNTH_PI * def->tones[i].freq_hz / rate;
+        for (size_t k = 0; k < n; k++) {
+            float gain = def->level;
+            size_t edge = k < n - 1 - k ? k : n - 1 - k;
+            if (edge < fade) {
+                gain *= 0.5f - 0.5f * cosf(SYNTH_PI * edge / fade);
+            }
+            float x = audio_eq_process(eq, 0, gain * sinf(step * k));
+            x = x > 1.0f ? 1.0f : (x < -1.0f ? -1.0f : x);
+            *out++ = (int16_t)lrintf(x * 32767.0f);
+        }
+    }
+}
+
+static void record_latency(earcon_id_t id, int64_t trigger_us, int64_t first_dma_us)
+{
+    uint32_t latency = (uint32_t)(first_dma_us - trigger_us);
+    s_earcon.played++;
+    s_earcon.last_latency_us = latency;
+    s_earcon.total_latency_us += latency;
+    if (latency > s_earcon.max_latency_us) {
+        s_earcon.max_latency_us = latency;
+    }
+    span_trace_add("earcon", EARCONS[id].name, trigger_us, first_dma_us);
+    if (latency > EARCON_TARGET_US) {
+        ESP_LOGW(TAG, "Earcon %s: first sample in DMA %lu us after trigger (target %d us)",
+                 EARCONS[id].name, (unsigned long)latency, EARCON_TARGET_US);
+    } else {
+        ESP_LOGD(TAG, "Earcon %s: first sample in DMA %lu us after trigger",
+                 EARCONS[id].name, (unsigned long)latency);
+    }
+}
+
+static void earcon_task(void *arg)
+{
+    uint32_t value;
+    while (xTaskNotifyWait(0, UINT32_MAX, &value, portMAX_DELAY) == pdTRUE && value != EARCON_STOP) {
+        earcon_id_t id = (earcon_id_t)(value - 1);
+        portENTER_CRITICAL(&s_earcon.lock);
+        int64_t trigger_us = s_earcon.trigger_us;
+        portEXIT_CRITICAL(&s_earcon.lock);
+
+        int64_t first_dma_us = 0;
+        const clip_t *clip = &s_earcon.clips[id];
+        esp_err_t err = audio_player_play_clip(clip->pcm, clip->samples, s_earcon.rate, &first_dma_us);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Earcon %s not played: %s", EARCONS[id].name, esp_err_to_name(err));
+            continue;
+        }
+        record_latency(id, trigger_us, first_dma_us);
+    }
+    xSemaphoreGive(s_earcon.exited);
+    vTaskDelete(NULL);
+}
+
+esp_err_t earcon_init(int sample_rate_hz)
+{
+    if (sample_rate_hz <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_earcon.initialized) {
+        return ESP_OK;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < EARCON_COUNT; i++) {
+        total += clip_samples(&EARCONS[i], sample_rate_hz);
+    }
+    // Clips: PSRAM first, internal RAM as fallback
+    s_earcon.pcm = heap_caps_malloc(total * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_earcon.pcm) {
+        s_earcon.pcm = heap_caps_malloc(total * sizeof(int16_t), MALLOC_CAP_8BIT);
+    }
+    if (!s_earcon.pcm) {
+        ESP_LOGE(TAG, "Failed to allocate earcons (%lu bytes)", (unsigned long)(total * sizeof(int16_t)));
+        return ESP_ERR_NO_MEM;
+    }
+    audio_eq_t eq;
+    audio_eq_init(&eq, sample_rate_hz, true);
+    int16_t *pcm = s_earcon.pcm;
+    for (int i = 0; i < EARCON_COUNT; i++) {
+        render(&EARCONS[i], sample_rate_hz, &eq, pcm);
+        s_earcon.clips[i].pcm = pcm;
+        s_earcon.clips[i].samples = clip_samples(&EARCONS[i], sample_rate_hz);
+        pcm += s_earcon.clips[i].samples;
+    }
+    s_earcon.rate = sample_rate_hz;
+
+    s_earcon.exited = xSemaphoreCreateBinary();
+    if (!s_earcon.exited ||
+        xTaskCreate(earcon_task, "earcon", EARCON_STACK_SIZE, NULL, EARCON_TASK_PRIORITY,
+                    &s_earcon.task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create earcon task");
+        if (s_earcon.exited) {
+            vSemaphoreDelete(s_earcon.exited);
+            s_earcon.exited = NULL;
+        }
+        heap_caps_free(s_earcon.pcm);
+        s_earcon.pcm = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_earcon.initialized = true;
+    ESP_LOGI(TAG, "%d earcons ready (%lu bytes at %d Hz)", EARCON_COUNT,
+             (unsigned long)(total * sizeof(int16_t)), sample_rate_hz);
+    return ESP_OK;
+}
+
+void earcon_deinit(void)
+{
+    if (!s_earcon.initialized) {
+        return;
+    }
+    s_earcon.initialized = false;
+    xTaskNotify(s_earcon.task, EARCON_STOP, eSetValueWithOverwrite);
+    // A clip being played finishes first
+    xSemaphoreTake(s_earcon.exited, portMAX_DELAY);
+    vSemaphoreDelete(s_earcon.exited);
+    s_earcon.exited = NULL;
+    s_earcon.task = NULL;
+    heap_caps_free(s_earcon.pcm);
+    s_earcon.pcm = NULL;
+    memset(s_earcon.clips, 0, sizeof(s_earcon.clips));
+}
+
+esp_err_t earcon_play(earcon_id_t id)
+{
+    if (!s_earcon.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if ((unsigned)id >= EARCON_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_earcon.lock);
+    s_earcon.trigger_us = now;
+    portEXIT_CRITICAL(&s_earcon.lock);
+    // The task has not taken the last one yet: the newer one replaces it
+    if (xTaskNotify(s_earcon.task, id + 1, eSetValueWithoutOverwrite) != pdPASS) {
+        s_earcon.dropped++;
+        xTaskNotify(s_earcon.task, id + 1, eSetValueWithOverwrite);
+    }
+    return ESP_OK;
+}
+
+const char *earcon_name(earcon_id_t id)
+{
+    return (unsigned)id < EARCON_COUNT ? EARCONS[id].name : "?";
+}
+
+void earcon_get_stats(earcon_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    stats->played = s_earcon.played;
+    stats->dropped = s_earcon.dropped;
+    stats->last_latency_us = s_earcon.last_latency_us;
+    stats->max_latency_us = s_earcon.max_latency_us;
+    stats->avg_latency_us = s_earcon.played ? (uint32_t)(s_earcon.total_latency_us / s_earcon.played) : 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Earcons
+ *
+ * Short acknowledgment tones (wake, thinking, error), synthesized and
+ * run through the speaker EQ once at boot and kept in RAM as PCM at the
+ * TTS rate. earcon_play() only hands the ID to a high-priority task,
+ * which writes the clip straight to I2S ahead of any TTS or media
+ * output (audio_player_play_clip), so nothing is decoded or queued behind
+ * other audio when the tone is needed; during media at another rate the
+ * clip is resampled on the way out. Every play measures the time from
+ * earcon_play() to the first samples entering the I2S DMA ring.
+ */
+
+typedef enum {
+    EARCON_WAKE,            // Wake word heard, listening
+    EARCON_THINKING,        // End of speech, request sent
+    EARCON_ERROR,           // The request failed
+    EARCON_COUNT,
+} earcon_id_t;
+
+typedef struct {
+    uint32_t played;
+    uint32_t dropped;               // Replaced by a newer earcon before playing
+    uint32_t last_latency_us;       // earcon_play() to first samples in the DMA ring
+    uint32_t max_latency_us;
+    uint32_t avg_latency_us;
+} earcon_stats_t;
+
+/**
+ * Synthesize the earcons and start the earcon task
+ * Call after audio_player_init.
+ * @param sample_rate_hz: Rate to render at (the TTS rate, the output
+ *                        rate around a turn, so most plays need no
+ *                        resampling)
+ * @return ESP_OK, ESP_ERR_NO_MEM
+ */
+esp_err_t earcon_init(int sample_rate_hz);
+
+/**
+ * Stop the earcon task and free the clips
+ */
+void earcon_deinit(void);
+
+/**
+ * Play an earcon
+ * Does not block: safe from the microphone task and wake-word callbacks.
+ * An earcon triggered while another is still waiting to start replaces it.
+ * @param id: Earcon
+ * @return ESP_OK, ESP_ERR_INVALID_STATE before earcon_init,
+ *         ESP_ERR_INVALID_ARG
+ */
+esp_err_t earcon_play(earcon_id_t id);
+
+/**
+ * Name of an earcon for logs ("wake", ...)
+ */
+const char *earcon_name(earcon_id_t id);
+
+/**
+ * Playback counts and trigger-to-DMA latency
+ * @param stats: OUT
+ */
+void earcon_get_stats(earcon_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,532 @@
+#include "echo_canceller.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N               ECHO_CANCELLER_BLOCK
+#define FRAME           (2 * N)     // Overlap-save frame: previous block + current block
+#define BINS            (N + 1)     // Non-redundant bins of a real FRAME-point FFT
+#define HALF            N           // Complex FFT size behind the real FFT
+
+#define MIN_LEAK        0.005f      // Lower bound of the residual echo estimate
+#define POWER_FLOOR     1.0f        // Regularizes the step of near-silent bins
+#define ACTIVE_SXX      (N * 1000.0f)   // Far-end energy per block worth adapting to (RMS ~32)
+#define SILENT_SXX      (N * 4.0f)      // Far-end energy per block treated as silence
+#define DIVERGED_BLOCKS 10          // Blocks with error above the microphone before a reset
+#define RES_OVERDRIVE   2.0f        // Residual echo overestimate, trades double talk for echo
+#define RES_MIN_GAIN    0.1f        // Suppressor floor (-20 dB)
+#define RES_RELEASE     0.3f        // Share of a gain increase applied per block
+
+typedef struct {
+    float re;
+    float im;
+} cpx_t;
+
+struct echo_canceller {
+    echo_canceller_config_t cfg;
+    int parts;                  // Filter partitions of N taps
+    cpx_t *X;                   // parts x BINS reference spectra, newest at x_head
+    cpx_t *W;                   // parts x BINS filter
+    float *prop;                // Per-partition share of the step
+    int x_head;
+    int constrain_next;         // Round-robin partition for the gradient constraint
+    float x_prev[N];
+    float e_prev[N];            // Last error block (the output, one block late)
+    // Step control
+    float power[BINS];          // Smoothed far-end power per bin
+    float eh[BINS];             // Smoothed error and echo power spectra for the leak estimate
+    float yh[BINS];
+    float pey;
+    float pyy;
+    float leak;
+    float sum_adapt;
+    bool adapted;
+    uint32_t diverged;
+    uint32_t idle_blocks;       // Consecutive blocks with a silent reference
+    // Residual echo suppressor
+    float gain[BINS];
+    float window[FRAME];
+    float ola[N];
+    // Statistics
+    echo_canceller_stats_t stats;
+    float sdd_avg;
+    float see_avg;
+    // FFT tables and scratch
+    cpx_t tw[HALF / 2];         // e^(-2*pi*i*k/HALF)
+    cpx_t rtw[BINS];            // e^(-2*pi*i*k/FRAME)
+    uint8_t rev[HALF];
+    cpx_t z[HALF];
+    float t[FRAME];
+    cpx_t Y[BINS];
+    cpx_t E[BINS];
+    cpx_t S[BINS];
+    float mu[BINS];
+    float Rf[BINS];             // Error, echo estimate and reference power spectra
+    float Yf[BINS];
+    float Xf[BINS];
+    float d[N];                 // Current block: microphone, reference, echo estimate, error, output
+    float x[N];
+    float y[N];
+    float e[N];
+    float o[N];
+};
+
+// In-place radix-2 complex FFT of HALF points, forward, unscaled
+static void cfft(const echo_canceller_t *ec, cpx_t *a)
+{
+    for (int i = 0; i < HALF; i++) {
+        int j = ec->rev[i];
+        if (j > i) {
+            cpx_t tmp = a[i];
+            a[i] = a[j];
+            a[j] = tmp;
+        }
+    }
+    for (int len = 2; len <= HALF; len <<= 1) {
+        int half = len / 2;
+        int step = HALF / len;
+        for (int i = 0; i < HALF; i += len) {
+            for (int k = 0; k < half; k++) {
+                cpx_t w = ec->tw[k * step];
+                cpx_t u = a[i + k];
+                cpx_t v = a[i + k + half];
+                cpx_t vw = { v.re * w.re - v.im * w.im, v.re * w.im + v.im * w.re };
+                a[i + k] = (cpx_t){ u.re + vw.re, u.im + vw.im };
+                a[i + k + half] = (cpx_t){ u.re - vw.re, u.im - vw.im };
+            }
+        }
+    }
+}
+
+// Spectrum of FRAME real samples, scaled by 1/FRAME, through one HALF-point
+// complex FFT of the even/odd samples packed as re/im
+static void rfft(echo_canceller_t *ec, const float *in, cpx_t *out)
+{
+    cpx_t *z = ec->z;
+    for (int n = 0; n < HALF; n++) {
+        z[n] = (cpx_t){ in[2 * n], in[2 * n + 1] };
+    }
+    cfft(ec, z);
+    const float s = 0.5f / FRAME;
+    for (int k = 0; k <= HALF; k++) {
+        cpx_t a = z[k % HALF];
+        cpx_t b = z[(HALF - k) % HALF];     // conj() applied below
+        float fe_re = a.re + b.re;
+        float fe_im = a.im - b.im;
+        float fo_re = a.im + b.im;          // (a - conj(b)) / i
+        float fo_im = b.re - a.re;
+        cpx_t w = ec->rtw[k];
+        out[k].re = s * (fe_re + fo_re * w.re - fo_im * w.im);
+        out[k].im = s * (fe_im + fo_re * w.im + fo_im * w.re);
+    }
+}
+
+// Inverse of rfft(): FRAME real samples from BINS bins
+static void irfft(echo_canceller_t *ec, const cpx_t *in, float *out)
+{
+    cpx_t *z = ec->z;
+    for (int k = 0; k < HALF; k++) {
+        cpx_t a = in[k];
+        cpx_t b = in[HALF - k];
+        float fe_re = a.re + b.re;
+        float fe_im = a.im - b.im;
+        float d_re = a.re - b.re;
+        float d_im = a.im + b.im;
+        cpx_t w = ec->rtw[k];
+        // i * conj(w) * d
+        float fo_re = d_re * w.re + d_im * w.im;
+        float fo_im = d_im * w.re - d_re * w.im;
+        z[k] = (cpx_t){ fe_re - fo_im, -(fe_im + fo_re) };  // conjugated for the forward FFT
+    }
+    cfft(ec, z);
+    for (int n = 0; n < HALF; n++) {
+        out[2 * n] = z[n].re;
+        out[2 * n + 1] = -z[n].im;
+    }
+}
+
+static float power_sum(const float *a, const float *b, int n)
+{
+    float s = 0.0f;
+    for (int i = 0; i < n; i++) {
+        s += a[i] * b[i];
+    }
+    return s;
+}
+
+static void power_spectrum(const cpx_t *a, float *out)
+{
+    for (int k = 0; k < BINS; k++) {
+        out[k] = a[k].re * a[k].re + a[k].im * a[k].im;
+    }
+}
+
+void echo_canceller_reset(echo_canceller_t *ec)
+{
+    memset(ec->X, 0, sizeof(cpx_t) * BINS * ec->parts);
+    memset(ec->W, 0, sizeof(cpx_t) * BINS * ec->parts);
+    memset(ec->x_prev, 0, sizeof(ec->x_prev));
+    memset(ec->power, 0, sizeof(ec->power));
+    memset(ec->eh, 0, sizeof(ec->eh));
+    memset(ec->yh, 0, sizeof(ec->yh));
+    memset(ec->ola, 0, sizeof(ec->ola));
+    for (int k = 0; k < BINS; k++) {
+        ec->gain[k] = 1.0f;
+    }
+    for (int p = 0; p < ec->parts; p++) {
+        ec->prop[p] = 1.0f / ec->parts;
+    }
+    ec->pey = 1.0f;
+    ec->pyy = 1.0f;
+    ec->leak = 1.0f;
+    ec->sum_adapt = 0.0f;
+    ec->adapted = false;
+    ec->diverged = 0;
+    ec->sdd_avg = 0.0f;
+    ec->see_avg = 0.0f;
+}
+
+esp_err_t echo_canceller_create(const echo_canceller_config_t *cfg, echo_canceller_t **out)
+{
+    if (!cfg || !out || cfg->sample_rate_hz <= 0 || cfg->tail_ms <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int tail = (int)((int64_t)cfg->tail_ms * cfg->sample_rate_hz / 1000);
+    int parts = (tail + N - 1) / N;
+    echo_canceller_t *ec = calloc(1, sizeof(*ec));
+    if (!ec) {
+        return ESP_ERR_NO_MEM;
+    }
+    ec->cfg = *cfg;
+    ec->parts = parts;
+    ec->X = calloc((size_t)parts * BINS, sizeof(cpx_t));
+    ec->W = calloc((size_t)parts * BINS, sizeof(cpx_t));
+    ec->prop = calloc((size_t)parts, sizeof(float));
+    if (!ec->X || !ec->W || !ec->prop) {
+        echo_canceller_destroy(ec);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int bits = 0;
+    while ((1 << bits) < HALF) {
+        bits++;
+    }
+    for (int i = 0; i < HALF; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        ec->rev[i] = (uint8_t)r;
+    }
+    for (int k = 0; k < HALF / 2; k++) {
+        double a = -2.0 * M_PI * k / HALF;
+        ec->tw[k] = (cpx_t){ (float)cos(a), (float)sin(a) };
+    }
+    for (int k = 0; k < BINS; k++) {
+        double a = -2.0 * M_PI * k / FRAME;
+        ec->rtw[k] = (cpx_t){ (float)cos(a), (float)sin(a) };
+    }
+    // Periodic Hann: 50% overlapped frames add up to exactly one
+    for (int i = 0; i < FRAME; i++) {
+        ec->window[i] = 0.5f - 0.5f * (float)cos(2.0 * M_PI * i / FRAME);
+    }
+    echo_canceller_reset(ec);
+    *out = ec;
+    return ESP_OK;
+}
+
+void echo_canceller_destroy(echo_canceller_t *ec)
+{
+    if (!ec) {
+        return;
+    }
+    free(ec->X);
+    free(ec->W);
+    free(ec->prop);
+    free(ec);
+}
+
+void echo_canceller_get_stats(const echo_canceller_t *ec, echo_canceller_stats_t *stats)
+{
+    *stats = ec->stats;
+    stats->leak = ec->leak;
+    stats->adapted = ec->adapted;
+}
+
+static void emit(int16_t *out, const float *pcm)
+{
+    for (int i = 0; i < N; i++) {
+        float v = pcm[i];
+        out[i] = v > 32767.0f ? 32767 : v < -32768.0f ? -32768 : (int16_t)lrintf(v);
+    }
+}
+
+// Share of the step per partition: mostly in proportion to each
+// partition's energy, so the taps of the direct path and early reflections
+// converge first
+static void update_prop(echo_canceller_t *ec)
+{
+    float total = 0.0f;
+    for (int p = 0; p < ec->parts; p++) {
+        const cpx_t *w = ec->W + (size_t)p * BINS;
+        float s = 1.0f;
+        for (int k = 0; k < BINS; k++) {
+            s += w[k].re * w[k].re + w[k].im * w[k].im;
+        }
+        ec->prop[p] = sqrtf(s);
+        total += ec->prop[p];
+    }
+    for (int p = 0; p < ec->parts; p++) {
+        ec->prop[p] = 0.99f * (0.1f / ec->parts + 0.9f * ec->prop[p] / total);
+    }
+}
+
+// Keep partition p a linear (not circular) convolution: zero the second
+// half of its impulse response
+static void constrain(echo_canceller_t *ec, int p)
+{
+    cpx_t *w = ec->W + (size_t)p * BINS;
+    irfft(ec, w, ec->t);
+    memset(ec->t + N, 0, sizeof(float) * N);
+    rfft(ec, ec->t, w);
+}
+
+// Per-bin step from the estimated residual echo to error ratio: large while
+// the error is mostly echo, small while the near end talks
+static void compute_step(echo_canceller_t *ec, const float *Rf, const float *Yf, float Sxx, float Syy,
+                         float See, float Sey)
+{
+    const float fs = (float)ec->cfg.sample_rate_hz;
+    const float spec_average = N / fs;
+    const float beta0 = 2.0f * N / fs;
+    const float beta_max = 0.5f * N / fs;
+
+    // Leak: regression of the error spectrum on the echo estimate spectrum
+    float pey = 0.0f;
+    float pyy = 0.0f;
+    for (int k = 0; k < BINS; k++) {
+        float e = Rf[k] - ec->eh[k];
+        float y = Yf[k] - ec->yh[k];
+        pey += e * y;
+        pyy += y * y;
+        ec->eh[k] += spec_average * (Rf[k] - ec->eh[k]);
+        ec->yh[k] += spec_average * (Yf[k] - ec->yh[k]);
+    }
+    pyy = sqrtf(pyy);
+    pey = pyy > 0.0f ? pey / pyy : 0.0f;
+    float rate = beta0 * Syy;
+    if (rate > beta_max * See) {
+        rate = beta_max * See;
+    }
+    float alpha = See > 0.0f ? rate / See : 0.0f;
+    ec->pey += alpha * (pey - ec->pey);
+    ec->pyy += alpha * (pyy - ec->pyy);
+    if (ec->pyy < 1.0f) {
+        ec->pyy = 1.0f;
+    }
+    if (ec->pey < MIN_LEAK * ec->pyy) {
+        ec->pey = MIN_LEAK * ec->pyy;
+    }
+    if (ec->pey > ec->pyy) {
+        ec->pey = ec->pyy;
+    }
+    ec->leak = ec->pey / ec->pyy;
+
+    float rer = (0.0001f * Sxx + 3.0f * ec->leak * Syy) / (See + 1.0f);
+    float coherent = Sey * Sey / (1.0f + See * Syy);
+    if (rer < coherent) {
+        rer = coherent;
+    }
+    if (rer > 0.5f) {
+        rer = 0.5f;
+    }
+
+    if (!ec->adapted && ec->sum_adapt > 4.0f * ec->parts && ec->leak > 0.03f) {
+        ec->adapted = true;
+    }
+    if (ec->adapted) {
+        for (int k = 0; k < BINS; k++) {
+            float e = Rf[k] + 1.0f;
+            float r = ec->leak * Yf[k];
+            if (r > 0.5f * e) {
+                r = 0.5f * e;
+            }
+            r = 0.7f * r + 0.3f * rer * e;
+            ec->mu[k] = r / (e * (ec->power[k] + POWER_FLOOR));
+        }
+    } else {
+        // Before the first convergence there is no echo estimate to go by:
+        // a fixed step, scaled down when the error dwarfs the far end
+        float adapt_rate = 0.0f;
+        if (Sxx > ACTIVE_SXX) {
+            float r = 0.25f * Sxx;
+            if (r > 0.25f * See) {
+                r = 0.25f * See;
+            }
+            adapt_rate = r / (See + 1.0f);
+        }
+        for (int k = 0; k < BINS; k++) {
+            ec->mu[k] = adapt_rate / (ec->power[k] + POWER_FLOOR);
+        }
+        ec->sum_adapt += adapt_rate;
+    }
+}
+
+// Attenuate what is left of the echo by a Wiener-style gain per bin and
+// resynthesize by 50% overlap-add; the output is the previous block
+static void suppress(echo_canceller_t *ec, const float *e, const float *Rf, const float *Yf, float *out)
+{
+    for (int k = 0; k < BINS; k++) {
+        float g = 1.0f - RES_OVERDRIVE * ec->leak * Yf[k] / (Rf[k] + 1.0f);
+        if (g < RES_MIN_GAIN) {
+            g = RES_MIN_GAIN;
+        }
+        // Fast attack, slow release
+        ec->gain[k] = g < ec->gain[k] ? g : ec->gain[k] + RES_RELEASE * (g - ec->gain[k]);
+    }
+    for (int i = 0; i < N; i++) {
+        ec->t[i] = ec->window[i] * ec->e_prev[i];
+        ec->t[N + i] = ec->window[N + i] * e[i];
+    }
+    rfft(ec, ec->t, ec->S);
+    for (int k = 0; k < BINS; k++) {
+        ec->S[k].re *= ec->gain[k];
+        ec->S[k].im *= ec->gain[k];
+    }
+    irfft(ec, ec->S, ec->t);
+    for (int i = 0; i < N; i++) {
+        out[i] = ec->t[i] + ec->ola[i];
+        ec->ola[i] = ec->t[N + i];
+    }
+}
+
+void echo_canceller_process(echo_canceller_t *ec, const int16_t *mic, const int16_t *ref, int16_t *out)
+{
+    // Scratch lives in the canceller: the capture task has a small stack
+    float *d = ec->d;
+    float *x = ec->x;
+    float *y = ec->y;
+    float *e = ec->e;
+    float *o = ec->o;
+    float *Rf = ec->Rf;
+    float *Yf = ec->Yf;
+    float *Xf = ec->Xf;
+    float Sxx = 0.0f;
+    for (int i = 0; i < N; i++) {
+        d[i] = mic[i];
+        x[i] = ref[i];
+        Sxx += x[i] * x[i];
+    }
+    ec->stats.blocks++;
+
+    // Nothing played for longer than the filter reaches: pass through, one
+    // block late like the processed path
+    ec->idle_blocks = Sxx < SILENT_SXX ? ec->idle_blocks + 1 : 0;
+    if (ec->idle_blocks > (uint32_t)ec->parts + 1) {
+        if (ec->idle_blocks == (uint32_t)ec->parts + 2) {
+            memset(ec->X, 0, sizeof(cpx_t) * BINS * ec->parts);
+            memset(ec->ola, 0, sizeof(ec->ola));
+            for (int k = 0; k < BINS; k++) {
+                ec->gain[k] = 1.0f;
+            }
+        }
+        memcpy(ec->x_prev, x, sizeof(float) * N);
+        emit(out, ec->e_prev);
+        memcpy(ec->e_prev, d, sizeof(float) * N);
+        return;
+    }
+    ec->stats.active_blocks++;
+
+    // Spectrum of the newest reference frame goes to the front of the history
+    ec->x_head = (ec->x_head + ec->parts - 1) % ec->parts;
+    cpx_t *X0 = ec->X + (size_t)ec->x_head * BINS;
+    memcpy(ec->t, ec->x_prev, sizeof(ec->x_prev));
+    memcpy(ec->t + N, x, sizeof(float) * N);
+    rfft(ec, ec->t, X0);
+    memcpy(ec->x_prev, x, sizeof(float) * N);
+
+    // Echo estimate: sum over partitions of filter times delayed spectrum
+    memset(ec->Y, 0, sizeof(ec->Y));
+    for (int p = 0; p < ec->parts; p++) {
+        const cpx_t *w = ec->W + (size_t)p * BINS;
+        const cpx_t *xp = ec->X + (size_t)((ec->x_head + p) % ec->parts) * BINS;
+        for (int k = 0; k < BINS; k++) {
+            ec->Y[k].re += w[k].re * xp[k].re - w[k].im * xp[k].im;
+            ec->Y[k].im += w[k].re * xp[k].im + w[k].im * xp[k].re;
+        }
+    }
+    irfft(ec, ec->Y, ec->t);
+    for (int i = 0; i < N; i++) {
+        y[i] = ec->t[N + i];
+        e[i] = d[i] - y[i];
+    }
+    float Syy = power_sum(y, y, N);
+    float See = power_sum(e, e, N);
+    float Sey = power_sum(e, y, N);
+    float Sdd = power_sum(d, d, N);
+
+    // A filter making things worse has diverged (or the path changed
+    // beyond what adaptation recovers quickly): output the microphone
+    // and start over if it persists
+    if (!(See <= 2.0f * Sdd + N * 10000.0f)) {
+        memcpy(e, d, sizeof(float) * N);
+        See = Sdd;
+        if (++ec->diverged >= DIVERGED_BLOCKS) {
+            echo_canceller_reset(ec);
+            ec->stats.resets++;
+            emit(out, ec->e_prev);
+            memcpy(ec->e_prev, d, sizeof(float) * N);
+            return;
+        }
+    } else {
+        ec->diverged = 0;
+    }
+
+    // Error and echo estimate spectra (second half only, as filtered)
+    memset(ec->t, 0, sizeof(float) * N);
+    memcpy(ec->t + N, e, sizeof(float) * N);
+    rfft(ec, ec->t, ec->E);
+    memcpy(ec->t + N, y, sizeof(float) * N);
+    memset(ec->t, 0, sizeof(float) * N);
+    rfft(ec, ec->t, ec->S);
+    power_spectrum(ec->E, Rf);
+    power_spectrum(ec->S, Yf);
+    power_spectrum(X0, Xf);
+    const float ss = 0.35f / ec->parts;
+    for (int k = 0; k < BINS; k++) {
+        ec->power[k] += ss * (Xf[k] - ec->power[k]);
+    }
+
+    compute_step(ec, Rf, Yf, Sxx, Syy, See, Sey);
+    update_prop(ec);
+    for (int p = 0; p < ec->parts; p++) {
+        cpx_t *w = ec->W + (size_t)p * BINS;
+        const cpx_t *xp = ec->X + (size_t)((ec->x_head + p) % ec->parts) * BINS;
+        for (int k = 0; k < BINS; k++) {
+            float m = ec->prop[p] * ec->mu[k];
+            w[k].re += m * (xp[k].re * ec->E[k].re + xp[k].im * ec->E[k].im);
+            w[k].im += m * (xp[k].re * ec->E[k].im - xp[k].im * ec->E[k].re);
+        }
+    }
+    // The first partition holds the direct path and is constrained every
+    // block, the others in turn
+    constrain(ec, 0);
+    if (ec->parts > 1) {
+        ec->constrain_next = ec->constrain_next % (ec->parts - 1) + 1;
+        constrain(ec, ec->constrain_next);
+    }
+
+    if (Sxx > ACTIVE_SXX) {
+        ec->sdd_avg += 0.05f * (Sdd - ec->sdd_avg);
+        ec->see_avg += 0.05f * (See - ec->see_avg);
+        ec->stats.erle_db = 10.0f * log10f((ec->sdd_avg + 1.0f) / (ec->see_avg + 1.0f));
+    }
+
+    if (ec->cfg.suppress_residual) {
+        suppress(ec, e, Rf, Yf, o);
+    } else {
+        memcpy(o, ec->e_prev, sizeof(float) * N);
+    }
+    memcpy(ec->e_prev, e, sizeof(float) * N);
+    emit(out, o);
+}
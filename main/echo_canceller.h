@@ -0,0 +1,96 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Acoustic echo canceller
+ *
+ * Partitioned-block frequency-domain adaptive filter (multidelay filter,
+ * overlap-save, NLMS with a per-bin step) followed by a residual echo
+ * suppressor. The microphone signal and a time-aligned copy of what is
+ * being played are processed in blocks of ECHO_CANCELLER_BLOCK samples;
+ * the filter models `tail_ms` of echo path.
+ *
+ * The step size follows the estimated ratio of residual echo to error, so
+ * adaptation slows down by itself while the near end is talking (no
+ * separate double-talk detector) and speeds up again after the echo path
+ * changes. With no far-end signal for longer than the tail, blocks are
+ * passed through without any FFT work.
+ *
+ * Pure computation: no tasks, no locks, no ESP-IDF calls, so it also builds
+ * for the host (main/bench/aec_bench.c).
+ */
+
+#define ECHO_CANCELLER_BLOCK 128    // Samples per block (8 ms at 16 kHz)
+
+/**
+ * Canceller configuration
+ */
+typedef struct {
+    int sample_rate_hz;     // Microphone and reference rate
+    int tail_ms;            // Echo path covered by the filter (rounded up to whole blocks)
+    bool suppress_residual; // Residual echo suppressor after the filter
+} echo_canceller_config_t;
+
+/**
+ * Running statistics
+ */
+typedef struct {
+    uint32_t blocks;        // Blocks processed
+    uint32_t active_blocks; // Blocks with far-end signal (filter running)
+    uint32_t resets;        // Filter resets after divergence
+    float erle_db;          // Echo return loss enhancement, smoothed over far-end-only blocks
+    float leak;             // Estimated share of echo left in the error (0-1)
+    bool adapted;           // Initial convergence reached
+} echo_canceller_stats_t;
+
+typedef struct echo_canceller echo_canceller_t;
+
+/**
+ * Allocate a canceller
+ * @param cfg: Configuration
+ * @param out: New canceller
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM
+ */
+esp_err_t echo_canceller_create(const echo_canceller_config_t *cfg, echo_canceller_t **out);
+
+/**
+ * Cancel the echo in one block
+ * The output is delayed by one block (the suppressor's overlap-add); the
+ * delay is the same whether or not the far end is active.
+ * @param ec: Canceller
+ * @param mic: ECHO_CANCELLER_BLOCK microphone samples
+ * @param ref: ECHO_CANCELLER_BLOCK reference samples played at the same time
+ * @param out: ECHO_CANCELLER_BLOCK output samples (may equal mic)
+ */
+void echo_canceller_process(echo_canceller_t *ec, const int16_t *mic, const int16_t *ref, int16_t *out);
+
+/**
+ * Forget the echo path (e.g. after the output volume changed a lot)
+ * @param ec: Canceller
+ */
+void echo_canceller_reset(echo_canceller_t *ec);
+
+/**
+ * Snapshot statistics
+ * @param ec: Canceller
+ * @param stats: Output
+ */
+void echo_canceller_get_stats(const echo_canceller_t *ec, echo_canceller_stats_t *stats);
+
+/**
+ * Free a canceller
+ * @param ec: Canceller (may be NULL)
+ */
+void echo_canceller_destroy(echo_canceller_t *ec);
+
+#ifdef __cplusplus
+}
+#endif
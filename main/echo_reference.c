@@ -0,0 +1,155 @@
+#include "echo_reference.h"
+#include "audio_eq.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <string.h>
+
+static const char *TAG = "echo_ref";
+
+#define RING_SAMPLES    16384       // Power of two; ~1 s at 16 kHz
+#define RING_MASK       (RING_SAMPLES - 1)
+#define CONTINUOUS_US   2000        // A chunk starting this close to the last end continues it
+#define LPF_FRACTION    0.45f       // Anti-alias cutoff as a share of the output rate
+
+static struct {
+    int16_t *ring;
+    int rate;                   // Output (microphone) rate
+    int64_t end;                // Sample index (time * rate) one past the newest sample
+    bool written;
+    // Resampler: 4th-order Butterworth low-pass, then linear interpolation
+    int in_rate;
+    float step;                 // Input samples per output sample
+    float frac;                 // Position of the next output between `last` (0) and the next input (1)
+    float last;
+    biquad_filter_t lpf[2];
+    portMUX_TYPE lock;
+} s_ref = {
+    .lock = portMUX_INITIALIZER_UNLOCKED,
+};
+
+static int64_t time_to_index(int64_t t_us)
+{
+    return t_us * s_ref.rate / 1000000;
+}
+
+static void set_input_rate(int rate_hz)
+{
+    s_ref.in_rate = rate_hz;
+    s_ref.step = (float)rate_hz / (float)s_ref.rate;
+    float fc = LPF_FRACTION * (float)(rate_hz < s_ref.rate ? rate_hz : s_ref.rate);
+    static const float q[2] = { 0.5412f, 1.3066f };
+    for (int i = 0; i < 2; i++) {
+        float b0, b1, b2, a1, a2;
+        biquad_lpf_coeffs(fc, (float)rate_hz, q[i], &b0, &b1, &b2, &a1, &a2);
+        biquad_init(&s_ref.lpf[i], b0, b1, b2, a1, a2);
+    }
+}
+
+static void reset_resampler(void)
+{
+    biquad_reset(&s_ref.lpf[0]);
+    biquad_reset(&s_ref.lpf[1]);
+    s_ref.frac = 1.0f;     // The first output sample is the first input sample
+    s_ref.last = 0.0f;
+}
+
+esp_err_t echo_reference_init(int sample_rate_hz)
+{
+    if (s_ref.ring) {
+        return ESP_OK;
+    }
+    int16_t *ring = heap_caps_calloc(RING_SAMPLES, sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring) {
+        ring = heap_caps_calloc(RING_SAMPLES, sizeof(int16_t), MALLOC_CAP_8BIT);
+    }
+    if (!ring) {
+        ESP_LOGE(TAG, "No memory for the echo reference");
+        return ESP_ERR_NO_MEM;
+    }
+    s_ref.rate = sample_rate_hz;
+    s_ref.in_rate = 0;
+    s_ref.end = 0;
+    s_ref.written = false;
+    portENTER_CRITICAL(&s_ref.lock);
+    s_ref.ring = ring;
+    portEXIT_CRITICAL(&s_ref.lock);
+    return ESP_OK;
+}
+
+void echo_reference_deinit(void)
+{
+    portENTER_CRITICAL(&s_ref.lock);
+    int16_t *ring = s_ref.ring;
+    s_ref.ring = NULL;
+    portEXIT_CRITICAL(&s_ref.lock);
+    heap_caps_free(ring);
+}
+
+void echo_reference_write(const int16_t *frames, size_t frame_count, int channels, int rate_hz,
+                          int64_t play_at_us)
+{
+    if (!s_ref.ring || !frames || rate_hz <= 0 || (channels != 1 && channels != 2)) {
+        return;
+    }
+    if (rate_hz != s_ref.in_rate) {
+        set_input_rate(rate_hz);
+        reset_resampler();
+    }
+
+    // Continue the previous chunk unless playback stopped in between; a gap
+    // reads as silence and restarts the resampler
+    int64_t start = time_to_index(play_at_us);
+    int64_t pos = s_ref.end;
+    int64_t slack = time_to_index(CONTINUOUS_US);
+    if (!s_ref.written || start > pos + slack) {
+        int64_t from = pos > start - RING_SAMPLES ? pos : start - RING_SAMPLES;
+        for (int64_t i = from; i < start; i++) {
+            s_ref.ring[i & RING_MASK] = 0;
+        }
+        pos = start;
+        reset_resampler();
+    }
+
+    int16_t *ring = s_ref.ring;
+    float frac = s_ref.frac;
+    float last = s_ref.last;
+    for (size_t i = 0; i < frame_count; i++) {
+        float x = channels == 2 ? 0.5f * ((float)frames[2 * i] + (float)frames[2 * i + 1]) : (float)frames[i];
+        x = biquad_process(&s_ref.lpf[1], biquad_process(&s_ref.lpf[0], x));
+        while (frac < 1.0f) {
+            float v = last + (x - last) * frac;
+            ring[pos++ & RING_MASK] = v > 32767.0f ? 32767 : v < -32768.0f ? -32768 : (int16_t)v;
+            frac += s_ref.step;
+        }
+        frac -= 1.0f;
+        last = x;
+    }
+    s_ref.frac = frac;
+    s_ref.last = last;
+
+    portENTER_CRITICAL(&s_ref.lock);
+    s_ref.end = pos;
+    s_ref.written = true;
+    portEXIT_CRITICAL(&s_ref.lock);
+}
+
+void echo_reference_read(int64_t start_us, int16_t *out, size_t samples)
+{
+    portENTER_CRITICAL(&s_ref.lock);
+    const int16_t *ring = s_ref.ring;
+    int64_t end = s_ref.end;
+    portEXIT_CRITICAL(&s_ref.lock);
+    if (!ring) {
+        memset(out, 0, samples * sizeof(int16_t));
+        return;
+    }
+    // The writer works ahead of the DAC and the reader behind the
+    // microphone, so everything in [end - RING_SAMPLES, end) is stable
+    int64_t idx = time_to_index(start_us);
+    for (size_t i = 0; i < samples; i++) {
+        int64_t a = idx + (int64_t)i;
+        out[i] = a < end && a >= end - RING_SAMPLES ? ring[a & RING_MASK] : 0;
+    }
+}
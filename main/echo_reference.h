@@ -0,0 +1,56 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Echo reference
+ *
+ * The last second of what the speaker played, downmixed and resampled to
+ * the microphone rate and stored by the time each sample reaches the DAC.
+ * The player writes every chunk it queues to I2S with that time; the
+ * capture side reads back what was audible while a block was recorded and
+ * hands it to the echo canceller. Times with nothing written read as
+ * silence. One writer and one reader; both calls are cheap no-ops before
+ * echo_reference_init().
+ */
+
+/**
+ * Allocate the reference buffer (PSRAM when available)
+ * @param sample_rate_hz: Microphone rate
+ * @return ESP_OK, ESP_ERR_NO_MEM
+ */
+esp_err_t echo_reference_init(int sample_rate_hz);
+
+/**
+ * Free the reference buffer
+ */
+void echo_reference_deinit(void);
+
+/**
+ * Record a chunk handed to the DAC
+ * @param frames: Interleaved PCM frames as written to I2S
+ * @param frame_count: Number of frames
+ * @param channels: 1 or 2
+ * @param rate_hz: Playback rate
+ * @param play_at_us: esp_timer time at which the first frame is heard
+ */
+void echo_reference_write(const int16_t *frames, size_t frame_count, int channels, int rate_hz,
+                          int64_t play_at_us);
+
+/**
+ * Read what was played from a given time on
+ * @param start_us: esp_timer time of the first sample
+ * @param out: Output samples at the microphone rate
+ * @param samples: Number of samples
+ */
+void echo_reference_read(int64_t start_us, int16_t *out, size_t samples);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,450 @@
+#include "local_intent.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_TOKENS      24
+#define MAX_TOKEN_LEN   15
+#define MAX_NUMBER      100000
+#define MAX_DURATION_S  (24 * 3600)
+
+typedef struct {
+    char word[MAX_TOKENS][MAX_TOKEN_LEN + 1];
+    size_t n;
+} tokens_t;
+
+// Phrasings, one pattern each. Items are separated by spaces: a word, a
+// set of words that may stand in the same place ("up|louder"), an optional
+// set ("[the|my]"), <num> (0-100) or <dur> (a duration, in seconds). The
+// value of a pattern without a slot is taken from the table.
+typedef struct {
+    local_intent_type_t type;
+    const char *pattern;
+    int value;
+} intent_pattern_t;
+
+static const intent_pattern_t PATTERNS[] = {
+    { LOCAL_INTENT_STOP, "stop|cancel|quiet|silence|enough|hush", 0 },
+    { LOCAL_INTENT_STOP, "stop talking|playing|speaking|it|that|this", 0 },
+    { LOCAL_INTENT_STOP, "stop the music|audio|sound", 0 },
+    { LOCAL_INTENT_STOP, "never mind", 0 },
+    { LOCAL_INTENT_STOP, "nevermind", 0 },
+    { LOCAL_INTENT_STOP, "forget it", 0 },
+    { LOCAL_INTENT_STOP, "be quiet", 0 },
+    { LOCAL_INTENT_STOP, "shut up", 0 },
+    { LOCAL_INTENT_STOP, "thats enough", 0 },
+    { LOCAL_INTENT_STOP, "that is enough", 0 },
+
+    { LOCAL_INTENT_VOLUME_UP, "[turn] [the] volume up", 0 },
+    { LOCAL_INTENT_VOLUME_UP, "turn it|that|this up [a] [little] [bit]", 0 },
+    { LOCAL_INTENT_VOLUME_UP, "turn up [the] volume", 0 },
+    { LOCAL_INTENT_VOLUME_UP, "increase|raise [the] volume", 0 },
+    { LOCAL_INTENT_VOLUME_UP, "[a] [little] [bit] louder", 0 },
+    { LOCAL_INTENT_VOLUME_UP, "make it|that [a] [little] [bit] louder", 0 },
+    { LOCAL_INTENT_VOLUME_UP, "speak|talk up|louder", 0 },
+
+    { LOCAL_INTENT_VOLUME_DOWN, "[turn] [the] volume down", 0 },
+    { LOCAL_INTENT_VOLUME_DOWN, "turn it|that|this down [a] [little] [bit]", 0 },
+    { LOCAL_INTENT_VOLUME_DOWN, "turn down [the] volume", 0 },
+    { LOCAL_INTENT_VOLUME_DOWN, "decrease|lower|reduce [the] volume", 0 },
+    { LOCAL_INTENT_VOLUME_DOWN, "[a] [little] [bit] quieter|softer", 0 },
+    { LOCAL_INTENT_VOLUME_DOWN, "make it|that [a] [little] [bit] quieter|softer", 0 },
+    { LOCAL_INTENT_VOLUME_DOWN, "speak|talk quieter|softer|quietly|softly", 0 },
+
+    { LOCAL_INTENT_VOLUME_SET, "[set|change|turn] [the] volume [up|down] [to|at] <num> [percent]", 0 },
+    { LOCAL_INTENT_VOLUME_SET, "turn it [up|down] to <num> [percent]", 0 },
+    { LOCAL_INTENT_VOLUME_SET, "[set|turn] [the] volume [to] max|maximum|full", 100 },
+    { LOCAL_INTENT_VOLUME_SET, "max|maximum|full volume", 100 },
+
+    { LOCAL_INTENT_TIME, "[what] time is it", 0 },
+    { LOCAL_INTENT_TIME, "what|whats [is] the [current] time", 0 },
+    { LOCAL_INTENT_TIME, "[tell|give] me the time", 0 },
+    { LOCAL_INTENT_TIME, "[the] [current] time", 0 },
+    { LOCAL_INTENT_TIME, "do you know what time it is", 0 },
+    { LOCAL_INTENT_TIME, "tell me what time it is", 0 },
+
+    { LOCAL_INTENT_TIMER_SET, "set|start|make [a|an|the|me] timer|alarm for|in <dur>", 0 },
+    { LOCAL_INTENT_TIMER_SET, "timer [for] <dur>", 0 },
+    { LOCAL_INTENT_TIMER_SET, "[set|start] [a|an] <dur> timer", 0 },
+    { LOCAL_INTENT_TIMER_SET, "remind|wake me [up] in <dur>", 0 },
+
+    { LOCAL_INTENT_TIMER_CANCEL, "cancel|stop|delete|clear|remove [the|my|all] [the|my] timer|timers|alarm", 0 },
+    { LOCAL_INTENT_TIMER_CANCEL, "turn off [the|my] timer|alarm", 0 },
+
+    { LOCAL_INTENT_TIMER_QUERY, "how much time [is] left|remaining [on] [the|my] [timer]", 0 },
+    { LOCAL_INTENT_TIMER_QUERY, "how long [is] left|remaining [on] [the|my] [timer]", 0 },
+    { LOCAL_INTENT_TIMER_QUERY, "how much longer [on] [the|my] [timer]", 0 },
+    { LOCAL_INTENT_TIMER_QUERY, "how long until|till [the|my] timer [is] [done|finished]", 0 },
+    { LOCAL_INTENT_TIMER_QUERY, "check [the|my] timer", 0 },
+};
+
+// Courtesy words around a command, set aside before matching
+static const char *const LEADING_FILLERS[] = {
+    "hey", "ok", "okay", "please", "so", "um", "uh", "oh", "alright", "and", "just",
+};
+static const char *const LEADING_PAIRS[][2] = {
+    { "can", "you" }, { "could", "you" }, { "would", "you" }, { "will", "you" },
+};
+static const char *const TRAILING_FILLERS[] = {
+    "please", "now", "thanks", "already",
+};
+static const char *const TRAILING_PAIRS[][2] = {
+    { "thank", "you" }, { "for", "me" },
+};
+
+static const char *const UNITS[] = {
+    "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine", "ten",
+    "eleven", "twelve", "thirteen", "fourteen", "fifteen", "sixteen", "seventeen", "eighteen", "nineteen",
+};
+static const char *const TENS[] = {
+    "", "", "twenty", "thirty", "forty", "fifty", "sixty", "seventy", "eighty", "ninety",
+};
+
+static const char *const NAMES[LOCAL_INTENT_COUNT] = {
+    "none", "stop", "volume_up", "volume_down", "volume_set",
+    "time", "timer_set", "timer_cancel", "timer_query",
+};
+
+const char *local_intent_name(local_intent_type_t type)
+{
+    return type < LOCAL_INTENT_COUNT ? NAMES[type] : "?";
+}
+
+// Lower-case words of letters and digits; apostrophes are dropped
+// ("what's" -> "whats"), "%" is a word of its own
+static bool tokenize(const char *text, tokens_t *t)
+{
+    t->n = 0;
+    size_t len = 0;
+    for (const char *p = text;; p++) {
+        char c = *p;
+        if (c >= 'A' && c <= 'Z') {
+            c = (char)(c - 'A' + 'a');
+        }
+        bool word_char = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (unsigned char)c >= 0x80;
+        if (word_char) {
+            if (len == MAX_TOKEN_LEN) {
+                return false;
+            }
+            if (len == 0 && t->n == MAX_TOKENS) {
+                return false;
+            }
+            t->word[t->n][len++] = c;
+            continue;
+        }
+        if (c == '\'' && len > 0) {
+            continue;
+        }
+        if (len > 0) {
+            t->word[t->n++][len] = '\0';
+            len = 0;
+        }
+        if (c == '%') {
+            if (t->n == MAX_TOKENS) {
+                return false;
+            }
+            strcpy(t->word[t->n++], "percent");
+        }
+        if (c == '\0') {
+            return true;
+        }
+    }
+}
+
+static bool in_list(const char *word, const char *const *list, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(word, list[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_pair(const tokens_t *t, size_t at, const char *const pair[2])
+{
+    return at + 1 < t->n && strcmp(t->word[at], pair[0]) == 0 && strcmp(t->word[at + 1], pair[1]) == 0;
+}
+
+// Narrow [*begin, *end) to the command between courtesy words
+static void strip_fillers(const tokens_t *t, size_t *begin, size_t *end)
+{
+    bool stripped = true;
+    while (stripped && *begin < *end) {
+        stripped = false;
+        if (in_list(t->word[*begin], LEADING_FILLERS, sizeof(LEADING_FILLERS) / sizeof(LEADING_FILLERS[0]))) {
+            (*begin)++;
+            stripped = true;
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(LEADING_PAIRS) / sizeof(LEADING_PAIRS[0]); i++) {
+            if (*begin + 2 <= *end && is_pair(t, *begin, LEADING_PAIRS[i])) {
+                *begin += 2;
+                stripped = true;
+                break;
+            }
+        }
+    }
+    stripped = true;
+    while (stripped && *begin < *end) {
+        stripped = false;
+        if (in_list(t->word[*end - 1], TRAILING_FILLERS, sizeof(TRAILING_FILLERS) / sizeof(TRAILING_FILLERS[0]))) {
+            (*end)--;
+            stripped = true;
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(TRAILING_PAIRS) / sizeof(TRAILING_PAIRS[0]); i++) {
+            if (*end >= *begin + 2 && is_pair(t, *end - 2, TRAILING_PAIRS[i])) {
+                *end -= 2;
+                stripped = true;
+                break;
+            }
+        }
+    }
+}
+
+static int word_index(const char *word, const char *const *list, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (list[i][0] && strcmp(word, list[i]) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static bool parse_digits(const char *word, int *value)
+{
+    int v = 0;
+    for (const char *p = word; *p; p++) {
+        if (*p < '0' || *p > '9' || v > MAX_NUMBER / 10) {
+            return false;
+        }
+        v = v * 10 + (*p - '0');
+    }
+    *value = v;
+    return true;
+}
+
+// A number spelled by exactly the `count` words at `at`: "42", "a",
+// "seven", "twenty five", "a hundred", "one hundred"
+static bool parse_number(const tokens_t *t, size_t at, size_t count, int *value)
+{
+    const char *first = t->word[at];
+    int unit = word_index(first, UNITS, sizeof(UNITS) / sizeof(UNITS[0]));
+    bool one = strcmp(first, "a") == 0 || strcmp(first, "an") == 0 || unit == 1;
+    if (count == 1) {
+        if (parse_digits(first, value)) {
+            return true;
+        }
+        if (strcmp(first, "a") == 0 || strcmp(first, "an") == 0) {
+            *value = 1;
+            return true;
+        }
+        if (strcmp(first, "hundred") == 0) {
+            *value = 100;
+            return true;
+        }
+        int tens = word_index(first, TENS, sizeof(TENS) / sizeof(TENS[0]));
+        if (unit >= 0 || tens >= 0) {
+            *value = unit >= 0 ? unit : tens * 10;
+            return true;
+        }
+        return false;
+    }
+    if (count == 2) {
+        const char *second = t->word[at + 1];
+        if (one && strcmp(second, "hundred") == 0) {
+            *value = 100;
+            return true;
+        }
+        int tens = word_index(first, TENS, sizeof(TENS) / sizeof(TENS[0]));
+        int ones = word_index(second, UNITS, sizeof(UNITS) / sizeof(UNITS[0]));
+        if (tens >= 0 && ones >= 1 && ones <= 9) {
+            *value = tens * 10 + ones;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int unit_seconds(const char *word)
+{
+    static const struct {
+        const char *word;
+        int seconds;
+    } DURATION_UNITS[] = {
+        { "second", 1 }, { "seconds", 1 }, { "sec", 1 }, { "secs", 1 },
+        { "minute", 60 }, { "minutes", 60 }, { "min", 60 }, { "mins", 60 },
+        { "hour", 3600 }, { "hours", 3600 }, { "hr", 3600 }, { "hrs", 3600 },
+    };
+    for (size_t i = 0; i < sizeof(DURATION_UNITS) / sizeof(DURATION_UNITS[0]); i++) {
+        if (strcmp(word, DURATION_UNITS[i].word) == 0) {
+            return DURATION_UNITS[i].seconds;
+        }
+    }
+    return 0;
+}
+
+static bool is_and_a_half(const tokens_t *t, size_t at, size_t end)
+{
+    return at + 3 <= end && strcmp(t->word[at], "and") == 0 &&
+           (strcmp(t->word[at + 1], "a") == 0 || strcmp(t->word[at + 1], "an") == 0) &&
+           strcmp(t->word[at + 2], "half") == 0;
+}
+
+// A duration spelled by exactly the words in [at, end): "5 minutes",
+// "an hour and a half", "1 hour and 30 minutes", "two and a half minutes",
+// "half an hour", "90 seconds"
+static bool parse_duration(const tokens_t *t, size_t at, size_t end, int *seconds)
+{
+    long total = 0;
+    while (at < end) {
+        if (total > 0 && strcmp(t->word[at], "and") == 0 && !is_and_a_half(t, at, end)) {
+            at++;
+            continue;
+        }
+        // "half an hour", "half a minute"
+        if (strcmp(t->word[at], "half") == 0 && at + 3 <= end &&
+            (strcmp(t->word[at + 1], "a") == 0 || strcmp(t->word[at + 1], "an") == 0) &&
+            unit_seconds(t->word[at + 2]) > 0) {
+            total += unit_seconds(t->word[at + 2]) / 2;
+            at += 3;
+            continue;
+        }
+        // NUMBER [and a half] UNIT [and a half]
+        bool matched = false;
+        for (size_t count = 2; count >= 1 && !matched; count--) {
+            int number;
+            if (at + count > end || !parse_number(t, at, count, &number)) {
+                continue;
+            }
+            size_t next = at + count;
+            bool half = is_and_a_half(t, next, end);
+            if (half) {
+                next += 3;
+            }
+            int unit = next < end ? unit_seconds(t->word[next]) : 0;
+            if (unit == 0) {
+                continue;
+            }
+            next++;
+            if (!half && is_and_a_half(t, next, end)) {
+                half = true;
+                next += 3;
+            }
+            total += (long)number * unit + (half ? unit / 2 : 0);
+            at = next;
+            matched = true;
+        }
+        if (!matched || total > MAX_DURATION_S) {
+            return false;
+        }
+    }
+    if (total <= 0) {
+        return false;
+    }
+    *seconds = (int)total;
+    return true;
+}
+
+// Next item of a pattern: [*item, *item + len); advances *p
+static bool next_item(const char **p, const char **item, size_t *len)
+{
+    while (**p == ' ') {
+        (*p)++;
+    }
+    if (!**p) {
+        return false;
+    }
+    *item = *p;
+    while (**p && **p != ' ') {
+        (*p)++;
+    }
+    *len = (size_t)(*p - *item);
+    return true;
+}
+
+// Is `word` one of the '|'-separated alternatives in [alts, alts + len)?
+static bool is_alternative(const char *word, const char *alts, size_t len)
+{
+    size_t wlen = strlen(word);
+    const char *end = alts + len;
+    while (alts < end) {
+        const char *bar = memchr(alts, '|', (size_t)(end - alts));
+        size_t alen = (size_t)((bar ? bar : end) - alts);
+        if (alen == wlen && memcmp(alts, word, wlen) == 0) {
+            return true;
+        }
+        alts += alen + 1;
+    }
+    return false;
+}
+
+// Does the rest of the pattern consume exactly the words in [at, end)?
+static bool match_from(const char *pattern, const tokens_t *t, size_t at, size_t end, int *value)
+{
+    const char *item;
+    size_t len;
+    if (!next_item(&pattern, &item, &len)) {
+        return at == end;
+    }
+    if (item[0] == '[') {
+        // Optional: with the word if it is there, else without
+        if (at < end && is_alternative(t->word[at], item + 1, len - 2) &&
+            match_from(pattern, t, at + 1, end, value)) {
+            return true;
+        }
+        return match_from(pattern, t, at, end, value);
+    }
+    if (len == 5 && memcmp(item, "<num>", 5) == 0) {
+        for (size_t count = 2; count >= 1; count--) {
+            int number;
+            if (at + count <= end && parse_number(t, at, count, &number) && number <= 100 &&
+                match_from(pattern, t, at + count, end, value)) {
+                *value = number;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (len == 5 && memcmp(item, "<dur>", 5) == 0) {
+        for (size_t stop = end; stop > at; stop--) {
+            int seconds;
+            if (parse_duration(t, at, stop, &seconds) && match_from(pattern, t, stop, end, value)) {
+                *value = seconds;
+                return true;
+            }
+        }
+        return false;
+    }
+    return at < end && is_alternative(t->word[at], item, len) && match_from(pattern, t, at + 1, end, value);
+}
+
+bool local_intent_match(const char *transcript, local_intent_t *intent)
+{
+    intent->type = LOCAL_INTENT_NONE;
+    intent->value = 0;
+    if (!transcript) {
+        return false;
+    }
+    tokens_t t;
+    if (!tokenize(transcript, &t)) {
+        return false;
+    }
+    size_t begin = 0;
+    size_t end = t.n;
+    strip_fillers(&t, &begin, &end);
+    if (begin == end) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(PATTERNS) / sizeof(PATTERNS[0]); i++) {
+        int value = PATTERNS[i].value;
+        if (match_from(PATTERNS[i].pattern, &t, begin, end, &value)) {
+            intent->type = PATTERNS[i].type;
+            intent->value = value;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Local intents
+ *
+ * Recognizes the short device commands that do not need the LLM (stop,
+ * volume, time, timers) in a transcript, so they can be carried out and
+ * answered on the device. The whole transcript must fit one of a fixed
+ * set of phrasings, after courtesy words ("please", "can you", "thanks")
+ * are set aside; anything longer or different is left to the LLM, so
+ * "how do I stop a dripping tap" is not taken for "stop". Numbers may be
+ * digits or words ("twenty five", "an hour and a half").
+ */
+
+typedef enum {
+    LOCAL_INTENT_NONE,
+    LOCAL_INTENT_STOP,              // Stop talking / playing
+    LOCAL_INTENT_VOLUME_UP,
+    LOCAL_INTENT_VOLUME_DOWN,
+    LOCAL_INTENT_VOLUME_SET,        // value: percent (0-100)
+    LOCAL_INTENT_TIME,              // What time is it
+    LOCAL_INTENT_TIMER_SET,         // value: seconds
+    LOCAL_INTENT_TIMER_CANCEL,
+    LOCAL_INTENT_TIMER_QUERY,       // How long is left
+    LOCAL_INTENT_COUNT,
+} local_intent_type_t;
+
+typedef struct {
+    local_intent_type_t type;
+    int value;
+} local_intent_t;
+
+/**
+ * Match a transcript against the local intents
+ * @param transcript: Text from Speech-to-Text
+ * @param intent: OUT: matched intent (type LOCAL_INTENT_NONE otherwise)
+ * @return true when the transcript is a local intent
+ */
+bool local_intent_match(const char *transcript, local_intent_t *intent);
+
+/**
+ * Name of an intent type for logs ("volume_up", ...)
+ */
+const char *local_intent_name(local_intent_type_t type);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,142 @@
+#include "sentence_segmenter.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+// Words that end in '.' without ending the sentence
+static const char *const s_abbreviations[] = {
+    "mr", "mrs", "ms", "dr", "prof", "sr", "jr", "st", "vs", "etc", "approx", "no", "fig",
+};
+
+static bool is_closing(char c)
+{
+    return c == '"' || c == '\'' || c == ')' || c == ']';
+}
+
+// Is the '.' at buf[dot] part of an abbreviation or initial rather than a full stop?
+static bool is_abbreviation(const char *buf, size_t dot)
+{
+    size_t start = dot;
+    while (start > 0 && isalpha((unsigned char)buf[start - 1])) {
+        start--;
+    }
+    size_t word_len = dot - start;
+    if (word_len == 0) {
+        return false;
+    }
+    // Single letters: initials ("J. Smith") and dotted forms ("e.g.", "U.S.")
+    if (word_len == 1) {
+        return isupper((unsigned char)buf[start]) || (start > 0 && buf[start - 1] == '.');
+    }
+    for (size_t i = 0; i < sizeof(s_abbreviations) / sizeof(s_abbreviations[0]); i++) {
+        if (strlen(s_abbreviations[i]) == word_len && strncasecmp(buf + start, s_abbreviations[i], word_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Does buf[0..end) finish a sentence? `end` is the whitespace position.
+static bool ends_sentence(const char *buf, size_t end)
+{
+    size_t i = end;
+    while (i > 0 && is_closing(buf[i - 1])) {
+        i--;
+    }
+    if (i == 0) {
+        return false;
+    }
+    char c = buf[i - 1];
+    if (c == '!' || c == '?') {
+        return true;
+    }
+    if (c == '.') {
+        return !is_abbreviation(buf, i - 1);
+    }
+    return false;
+}
+
+// Emit buf[0..n) and keep buf[skip..len) as the start of the next sentence
+static void emit(sentence_segmenter_t *seg, size_t n, size_t skip)
+{
+    while (n > 0 && isspace((unsigned char)seg->buf[n - 1])) {
+        n--;
+    }
+    if (n > 0) {
+        char saved = seg->buf[n];
+        seg->buf[n] = '\0';
+        seg->cb(seg->buf, seg->ctx);
+        seg->buf[n] = saved;
+        seg->emitted++;
+    }
+
+    while (skip < seg->len && isspace((unsigned char)seg->buf[skip])) {
+        skip++;
+    }
+    memmove(seg->buf, seg->buf + skip, seg->len - skip);
+    seg->len -= skip;
+}
+
+// Buffer full without a sentence end: cut at the last clause or word boundary
+static void split_long(sentence_segmenter_t *seg)
+{
+    size_t cut = 0;
+    for (size_t i = seg->len; i > 0; i--) {
+        char c = seg->buf[i - 1];
+        if (c == ',' || c == ';' || c == ':') {
+            cut = i;
+            break;
+        }
+    }
+    if (cut == 0) {
+        for (size_t i = seg->len; i > 0; i--) {
+            if (isspace((unsigned char)seg->buf[i - 1])) {
+                cut = i;
+                break;
+            }
+        }
+    }
+    if (cut == 0) {
+        cut = seg->len;
+    }
+    emit(seg, cut, cut);
+}
+
+void sentence_segmenter_init(sentence_segmenter_t *seg, sentence_cb_t cb, void *ctx)
+{
+    memset(seg, 0, sizeof(*seg));
+    seg->cb = cb;
+    seg->ctx = ctx;
+}
+
+void sentence_segmenter_feed(sentence_segmenter_t *seg, const char *text)
+{
+    if (!seg || !text) {
+        return;
+    }
+    for (const char *p = text; *p; p++) {
+        char c = *p;
+        if (seg->len == 0 && isspace((unsigned char)c)) {
+            continue;
+        }
+        if (seg->len == SENTENCE_SEGMENTER_MAX_LEN) {
+            split_long(seg);
+        }
+        seg->buf[seg->len++] = c;
+
+        if (c == '\n') {
+            emit(seg, seg->len - 1, seg->len);
+        } else if (isspace((unsigned char)c) && ends_sentence(seg->buf, seg->len - 1)) {
+            emit(seg, seg->len - 1, seg->len);
+        }
+    }
+}
+
+void sentence_segmenter_flush(sentence_segmenter_t *seg)
+{
+    if (!seg) {
+        return;
+    }
+    emit(seg, seg->len, seg->len);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Longest fragment handed to TTS; longer runs are split at a clause boundary
+#define SENTENCE_SEGMENTER_MAX_LEN 160
+
+/**
+ * Sentence callback
+ * @param sentence: Complete sentence, trimmed (valid only during the call)
+ * @param ctx: User context
+ */
+typedef void (*sentence_cb_t)(const char *sentence, void *ctx);
+
+/**
+ * Incremental sentence segmenter
+ * Accepts streamed LLM text deltas and emits each sentence as soon as its
+ * terminating punctuation is followed by whitespace, so speech synthesis can
+ * start before generation finishes.
+ */
+typedef struct {
+    char buf[SENTENCE_SEGMENTER_MAX_LEN + 1];
+    size_t len;
+    sentence_cb_t cb;
+    void *ctx;
+    size_t emitted;     // Sentences emitted since init
+} sentence_segmenter_t;
+
+/**
+ * Initialize a segmenter
+ * @param seg: Segmenter state
+ * @param cb: Called once per sentence
+ * @param ctx: Context for cb
+ */
+void sentence_segmenter_init(sentence_segmenter_t *seg, sentence_cb_t cb, void *ctx);
+
+/**
+ * Feed a text delta
+ * @param seg: Segmenter state
+ * @param text: NUL-terminated text fragment
+ */
+void sentence_segmenter_feed(sentence_segmenter_t *seg, const char *text);
+
+/**
+ * Emit whatever text remains as the final sentence
+ * @param seg: Segmenter state
+ */
+void sentence_segmenter_flush(sentence_segmenter_t *seg);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,497 @@
+#include "tts_scheduler.h"
+#include "gemini_api.h"
+#include "audio_player.h"
+#include "turn_arena.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+static const char *TAG = "tts_scheduler";
+
+#define JOB_EXIT            0xFF
+#define IDLE_BIT            BIT0
+#define WORKER_STACK_SIZE   GEMINI_TTS_MIN_STACK_SIZE   // TLS + response decoding
+#define PLAYER_STACK_SIZE   4096
+#define EXIT_TIMEOUT_MS     5000
+
+// Sentence lifecycle: FREE -> QUEUED -> SYNTH -> READY/FAILED -> FREE
+// Playback may start during SYNTH; the `playing` flag then hands the release
+// of the slot to the player.
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_SYNTH,
+    SLOT_READY,
+    SLOT_FAILED,
+} slot_state_t;
+
+typedef struct {
+    slot_state_t state;
+    uint32_t seq;           // Playback order
+    uint32_t generation;    // Bumped by tts_scheduler_cancel()
+    char *text;
+    bool persist;           // Prompt: keep in the flash cache
+    int16_t *pcm;
+    volatile size_t samples; // pcm[0 .. samples) is decoded and playable
+    bool playing;           // Owned by the player until it lets go
+    gemini_cancel_t cancel;
+} tts_slot_t;
+
+static struct {
+    bool initialized;
+    volatile bool exiting;
+    tts_scheduler_config_t cfg;
+    tts_slot_t *slots;
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t free_slots;   // Counts FREE slots; submit blocks on it
+    SemaphoreHandle_t progress;     // Wakes the player when a slot changes state
+    SemaphoreHandle_t exited;       // Given by each task on its way out
+    QueueHandle_t jobs;             // Slot indices in submission order
+    EventGroupHandle_t events;
+    int tasks;
+    uint32_t next_seq;              // Sequence number of the next submission
+    uint32_t play_seq;              // Sequence number the player waits for
+    uint32_t generation;
+    uint32_t outstanding;           // Non-FREE slots
+    int in_flight;                  // Requests currently in gemini_tts
+    int64_t busy_since_us;
+    bool played_since_idle;
+    tts_scheduler_stats_t stats;
+} s_sched = {0};
+
+// Must be called with s_sched.lock held
+static void release_slot_locked(tts_slot_t *slot)
+{
+    turn_arena_free(slot->text);
+    slot->text = NULL;
+    slot->samples = 0;
+    slot->persist = false;
+    slot->playing = false;
+    slot->state = SLOT_FREE;
+    if (--s_sched.outstanding == 0) {
+        s_sched.played_since_idle = false;
+        xEventGroupSetBits(s_sched.events, IDLE_BIT);
+    }
+    xSemaphoreGive(s_sched.free_slots);
+}
+
+// Called on the worker while the response downloads
+static void on_slot_progress(size_t samples_ready, void *user_ctx)
+{
+    tts_slot_t *slot = (tts_slot_t *)user_ctx;
+    slot->samples = samples_ready;
+    xSemaphoreGive(s_sched.progress);
+}
+
+static void worker_task(void *arg)
+{
+    uint8_t idx;
+    while (xQueueReceive(s_sched.jobs, &idx, portMAX_DELAY) == pdTRUE && idx != JOB_EXIT) {
+        tts_slot_t *slot = &s_sched.slots[idx];
+
+        xSemaphoreTake(s_sched.lock, portMAX_DELAY);
+        if (slot->generation != s_sched.generation) {
+            // Cancelled while still queued
+            s_sched.stats.cancelled++;
+            release_slot_locked(slot);
+            xSemaphoreGive(s_sched.lock);
+            continue;
+        }
+        slot->state = SLOT_SYNTH;
+        if (s_sched.in_flight++ == 0) {
+            s_sched.busy_since_us = esp_timer_get_time();
+        }
+        xSemaphoreGive(s_sched.lock);
+
+        int64_t start_us = esp_timer_get_time();
+        size_t samples = 0;
+        const gemini_tts_opts_t opts = {
+            .cancel = &slot->cancel,
+            .on_progress = on_slot_progress,
+            .user_ctx = slot,
+            .persist = slot->persist,
+        };
+        esp_err_t ret = gemini_tts_ex(slot->text, slot->pcm, s_sched.cfg.max_samples, &samples, &opts);
+        int64_t now_us = esp_timer_get_time();
+
+        xSemaphoreTake(s_sched.lock, portMAX_DELAY);
+        if (--s_sched.in_flight == 0) {
+            s_sched.stats.synth_busy_us += now_us - s_sched.busy_since_us;
+        }
+        if (slot->generation != s_sched.generation && !slot->playing) {
+            s_sched.stats.cancelled++;
+            release_slot_locked(slot);
+        } else if (ret == ESP_OK) {
+            slot->samples = samples;
+            slot->state = SLOT_READY;
+            s_sched.stats.samples_synthesized += samples;
+            ESP_LOGI(TAG, "#%lu ready: %lu ms of audio in %lld ms (%d in flight)",
+                     (unsigned long)slot->seq,
+                     (unsigned long)(samples * 1000 / s_sched.cfg.sample_rate_hz),
+                     (long long)((now_us - start_us) / 1000), s_sched.in_flight);
+        } else {
+            if (ret != ESP_ERR_NOT_FINISHED) {
+                ESP_LOGE(TAG, "#%lu TTS failed: %s", (unsigned long)slot->seq, esp_err_to_name(ret));
+            }
+            slot->state = SLOT_FAILED;
+        }
+        xSemaphoreGive(s_sched.lock);
+        xSemaphoreGive(s_sched.progress);
+    }
+
+    xSemaphoreGive(s_sched.exited);
+    vTaskDelete(NULL);
+}
+
+// Must be called with s_sched.lock held
+static tts_slot_t *next_to_play_locked(void)
+{
+    for (int i = 0; i < s_sched.cfg.max_in_flight; i++) {
+        tts_slot_t *slot = &s_sched.slots[i];
+        if (slot->state >= SLOT_SYNTH && !slot->playing &&
+            slot->seq == s_sched.play_seq && slot->generation == s_sched.generation) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static void player_task(void *arg)
+{
+    // Submit in ~100 ms pieces so a barge-in cuts playback off quickly
+    const size_t piece = s_sched.cfg.sample_rate_hz / 10;
+
+    while (!s_sched.exiting) {
+        xSemaphoreTake(s_sched.lock, portMAX_DELAY);
+        tts_slot_t *slot = next_to_play_locked();
+        // While the sentence is still downloading, wait for one piece so a
+        // slow link does not turn into a stutter on the first frames
+        if (slot && slot->state == SLOT_SYNTH && slot->samples < piece) {
+            slot = NULL;
+        }
+        if (!slot) {
+            xSemaphoreGive(s_sched.lock);
+            xSemaphoreTake(s_sched.progress, portMAX_DELAY);
+            continue;
+        }
+        if (slot->state == SLOT_FAILED && slot->samples == 0) {
+            // Skip the gap rather than stall the rest of the answer
+            s_sched.stats.failed++;
+            s_sched.play_seq++;
+            release_slot_locked(slot);
+            xSemaphoreGive(s_sched.lock);
+            continue;
+        }
+        slot->playing = true;
+        int64_t first_us = 0;
+        if (!s_sched.played_since_idle) {
+            s_sched.played_since_idle = true;
+            first_us = esp_timer_get_time();
+            s_sched.stats.first_play_us = first_us;
+        }
+        xSemaphoreGive(s_sched.lock);
+        if (first_us && s_sched.cfg.on_play_start) {
+            s_sched.cfg.on_play_start(first_us, s_sched.cfg.ctx);
+        }
+
+        // Play what has been decoded so far, then wait for the worker to
+        // decode more, until synthesis has finished and everything is out
+        size_t off = 0;
+        bool output_ok = true;
+        while (!slot->cancel.cancelled) {
+            xSemaphoreTake(s_sched.lock, portMAX_DELAY);
+            size_t ready = slot->samples;
+            bool done = slot->state != SLOT_SYNTH;
+            xSemaphoreGive(s_sched.lock);
+
+            if (off < ready) {
+                size_t n = ready - off < piece ? ready - off : piece;
+                if (output_ok) {
+                    esp_err_t ret = audio_player_submit_pcm(slot->pcm + off, n, s_sched.cfg.sample_rate_hz, 1);
+                    if (ret != ESP_OK) {
+                        ESP_LOGW(TAG, "Audio playback failed: %s", esp_err_to_name(ret));
+                        output_ok = false;
+                    }
+                }
+                off += n;
+            } else if (done) {
+                break;
+            } else {
+                xSemaphoreTake(s_sched.progress, pdMS_TO_TICKS(100));
+            }
+        }
+
+        xSemaphoreTake(s_sched.lock, portMAX_DELAY);
+        slot->playing = false;
+        if (slot->state == SLOT_SYNTH) {
+            // Cancelled mid-download: the worker releases it when the request returns
+            xSemaphoreGive(s_sched.lock);
+            continue;
+        }
+        if (slot->generation != s_sched.generation) {
+            s_sched.stats.cancelled++;
+        } else {
+            if (slot->state == SLOT_FAILED) {
+                s_sched.stats.failed++;
+            } else {
+                s_sched.stats.played++;
+            }
+            s_sched.play_seq++;
+        }
+        release_slot_locked(slot);
+        xSemaphoreGive(s_sched.lock);
+    }
+
+    xSemaphoreGive(s_sched.exited);
+    vTaskDelete(NULL);
+}
+
+static void free_resources(void)
+{
+    if (s_sched.slots) {
+        for (int i = 0; i < s_sched.cfg.max_in_flight; i++) {
+            turn_arena_free(s_sched.slots[i].text);
+            heap_caps_free(s_sched.slots[i].pcm);
+        }
+        free(s_sched.slots);
+        s_sched.slots = NULL;
+    }
+    if (s_sched.jobs) {
+        vQueueDelete(s_sched.jobs);
+        s_sched.jobs = NULL;
+    }
+    if (s_sched.events) {
+        vEventGroupDelete(s_sched.events);
+        s_sched.events = NULL;
+    }
+    SemaphoreHandle_t *sems[] = { &s_sched.lock, &s_sched.free_slots, &s_sched.progress, &s_sched.exited };
+    for (size_t i = 0; i < sizeof(sems) / sizeof(sems[0]); i++) {
+        if (*sems[i]) {
+            vSemaphoreDelete(*sems[i]);
+            *sems[i] = NULL;
+        }
+    }
+}
+
+// Ask all tasks to leave and wait for them; false if one is stuck
+static bool stop_tasks(void)
+{
+    s_sched.exiting = true;
+    uint8_t exit_job = JOB_EXIT;
+    for (int i = 0; i < s_sched.tasks; i++) {
+        xQueueSend(s_sched.jobs, &exit_job, portMAX_DELAY);
+    }
+    xSemaphoreGive(s_sched.progress);
+
+    bool all_exited = true;
+    for (int i = 0; i < s_sched.tasks; i++) {
+        if (xSemaphoreTake(s_sched.exited, pdMS_TO_TICKS(EXIT_TIMEOUT_MS)) != pdTRUE) {
+            all_exited = false;
+            break;
+        }
+    }
+    s_sched.tasks = 0;
+    return all_exited;
+}
+
+esp_err_t tts_scheduler_init(const tts_scheduler_config_t *config)
+{
+    if (s_sched.initialized) {
+        return ESP_OK;
+    }
+
+    if (!config || config->max_in_flight < 1 || config->max_in_flight >= JOB_EXIT ||
+        config->max_samples == 0 || config->sample_rate_hz <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(&s_sched, 0, sizeof(s_sched));
+    s_sched.cfg = *config;
+    const int k = config->max_in_flight;
+
+    s_sched.lock = xSemaphoreCreateMutex();
+    s_sched.free_slots = xSemaphoreCreateCounting(k, k);
+    s_sched.progress = xSemaphoreCreateBinary();
+    s_sched.exited = xSemaphoreCreateCounting(k + 1, 0);
+    s_sched.jobs = xQueueCreate(2 * k, sizeof(uint8_t));   // Jobs + one exit marker per worker
+    s_sched.events = xEventGroupCreate();
+    s_sched.slots = calloc(k, sizeof(tts_slot_t));
+    if (!s_sched.lock || !s_sched.free_slots || !s_sched.progress || !s_sched.exited ||
+        !s_sched.jobs || !s_sched.events || !s_sched.slots) {
+        ESP_LOGE(TAG, "Failed to create scheduler state");
+        free_resources();
+        return ESP_ERR_NO_MEM;
+    }
+    xEventGroupSetBits(s_sched.events, IDLE_BIT);
+
+    // Sentence buffers: PSRAM first, internal RAM as fallback
+    size_t buffer_bytes = config->max_samples * sizeof(int16_t);
+    for (int i = 0; i < k; i++) {
+        int16_t *pcm = heap_caps_malloc(buffer_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!pcm) {
+            pcm = heap_caps_malloc(buffer_bytes, MALLOC_CAP_8BIT);
+        }
+        if (!pcm) {
+            ESP_LOGE(TAG, "Failed to allocate sentence buffer %d (%lu bytes)", i, (unsigned long)buffer_bytes);
+            free_resources();
+            return ESP_ERR_NO_MEM;
+        }
+        s_sched.slots[i].pcm = pcm;
+    }
+
+    for (int i = 0; i < k; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "tts_worker%d", i);
+        if (xTaskCreate(worker_task, name, WORKER_STACK_SIZE, NULL, 5, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create %s", name);
+            stop_tasks();
+            free_resources();
+            return ESP_ERR_NO_MEM;
+        }
+        s_sched.tasks++;
+    }
+    // Player runs above the workers so playback never starves behind JSON parsing
+    if (xTaskCreate(player_task, "tts_player", PLAYER_STACK_SIZE, NULL, 6, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create player task");
+        stop_tasks();
+        free_resources();
+        return ESP_ERR_NO_MEM;
+    }
+    s_sched.tasks++;
+
+    s_sched.initialized = true;
+    ESP_LOGI(TAG, "TTS scheduler ready (%d in flight, %lu KB of sentence buffers)",
+             k, (unsigned long)(k * buffer_bytes / 1024));
+    return ESP_OK;
+}
+
+static esp_err_t submit(const char *text, bool persist)
+{
+    if (!s_sched.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!text || !text[0]) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char *copy = turn_arena_strdup(text);
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Backpressure: wait for a sentence buffer to come back from the player
+    xSemaphoreTake(s_sched.free_slots, portMAX_DELAY);
+
+    xSemaphoreTake(s_sched.lock, portMAX_DELAY);
+    uint8_t idx = 0;
+    while (s_sched.slots[idx].state != SLOT_FREE) {
+        idx++;
+    }
+    tts_slot_t *slot = &s_sched.slots[idx];
+    slot->state = SLOT_QUEUED;
+    slot->seq = s_sched.next_seq++;
+    slot->generation = s_sched.generation;
+    slot->text = copy;
+    slot->persist = persist;
+    slot->cancel.cancelled = false;
+    s_sched.outstanding++;
+    s_sched.stats.submitted++;
+    xEventGroupClearBits(s_sched.events, IDLE_BIT);
+    xSemaphoreGive(s_sched.lock);
+
+    xQueueSend(s_sched.jobs, &idx, portMAX_DELAY);
+    return ESP_OK;
+}
+
+esp_err_t tts_scheduler_submit(const char *text)
+{
+    return submit(text, false);
+}
+
+esp_err_t tts_scheduler_submit_prompt(const char *text)
+{
+    return submit(text, true);
+}
+
+esp_err_t tts_scheduler_wait_idle(TickType_t timeout)
+{
+    if (!s_sched.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    EventBits_t bits = xEventGroupWaitBits(s_sched.events, IDLE_BIT, pdFALSE, pdTRUE, timeout);
+    return (bits & IDLE_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void tts_scheduler_cancel(void)
+{
+    if (!s_sched.initialized) {
+        return;
+    }
+
+    xSemaphoreTake(s_sched.lock, portMAX_DELAY);
+    s_sched.generation++;
+    s_sched.play_seq = s_sched.next_seq;
+    int dropped = 0;
+    for (int i = 0; i < s_sched.cfg.max_in_flight; i++) {
+        tts_slot_t *slot = &s_sched.slots[i];
+        if (slot->state == SLOT_FREE) {
+            continue;
+        }
+        // QUEUED / SYNTH slots are released by their worker, playing ones by the player
+        slot->cancel.cancelled = true;
+        if ((slot->state == SLOT_READY || slot->state == SLOT_FAILED) && !slot->playing) {
+            s_sched.stats.cancelled++;
+            release_slot_locked(slot);
+        }
+        dropped++;
+    }
+    xSemaphoreGive(s_sched.lock);
+    xSemaphoreGive(s_sched.progress);
+
+    if (dropped) {
+        ESP_LOGI(TAG, "Barge-in: cancelled %d sentence(s)", dropped);
+    }
+}
+
+void tts_scheduler_get_stats(tts_scheduler_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!s_sched.initialized) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_sched.lock, portMAX_DELAY);
+    *stats = s_sched.stats;
+    if (s_sched.in_flight > 0) {
+        stats->synth_busy_us += esp_timer_get_time() - s_sched.busy_since_us;
+    }
+    xSemaphoreGive(s_sched.lock);
+}
+
+void tts_scheduler_deinit(void)
+{
+    if (!s_sched.initialized) {
+        return;
+    }
+
+    tts_scheduler_cancel();
+    s_sched.initialized = false;
+    if (!stop_tasks()) {
+        // A worker is still blocked in a request; its buffers must outlive it
+        ESP_LOGE(TAG, "TTS tasks did not exit, leaking scheduler state");
+        return;
+    }
+    free_resources();
+    ESP_LOGI(TAG, "TTS scheduler deinitialized");
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * TTS scheduler
+ *
+ * Keeps up to `max_in_flight` Gemini TTS requests running concurrently, one
+ * per worker task, and releases the synthesized audio to the player strictly
+ * in submission order. Each in-flight sentence owns one PCM buffer from a
+ * fixed set allocated at init, so memory is bounded by
+ * max_in_flight * max_samples * 2 bytes no matter how long the answer is.
+ * The sentence at the head of the order starts playing as soon as its first
+ * audio is decoded, while the rest of its response is still downloading.
+ */
+
+/**
+ * Scheduler configuration
+ */
+typedef struct {
+    int max_in_flight;      // Concurrent TTS requests / sentence buffers (K)
+    size_t max_samples;     // Capacity of one sentence buffer (in samples)
+    int sample_rate_hz;     // Sample rate of the TTS output
+    void (*on_play_start)(int64_t at_us, void *ctx);    // Optional: first audio after idle (player task)
+    void *ctx;              // Passed to on_play_start
+} tts_scheduler_config_t;
+
+/**
+ * Scheduler statistics
+ */
+typedef struct {
+    uint32_t submitted;         // Sentences accepted by tts_scheduler_submit()
+    uint32_t played;            // Sentences played to completion
+    uint32_t failed;            // Sentences whose TTS request failed (skipped)
+    uint32_t cancelled;         // Sentences dropped by tts_scheduler_cancel()
+    uint64_t samples_synthesized;
+    int64_t synth_busy_us;      // Wall time with at least one request in flight
+    int64_t first_play_us;      // esp_timer time the latest busy period started playing
+} tts_scheduler_stats_t;
+
+/**
+ * Create worker and player tasks and allocate sentence buffers
+ * @param config: Scheduler configuration
+ * @return ESP_OK on success
+ */
+esp_err_t tts_scheduler_init(const tts_scheduler_config_t *config);
+
+/**
+ * Queue a sentence for synthesis and ordered playback
+ * Blocks while all sentence buffers are busy.
+ * @param text: Sentence text (copied)
+ * @return ESP_OK on success
+ */
+esp_err_t tts_scheduler_submit(const char *text);
+
+/**
+ * Queue a fixed prompt (greeting, error, confirmation)
+ * Same as tts_scheduler_submit(), but the audio is also persisted to the
+ * flash TTS cache.
+ * @param text: Prompt text (copied)
+ * @return ESP_OK on success
+ */
+esp_err_t tts_scheduler_submit_prompt(const char *text);
+
+/**
+ * Wait until every submitted sentence has been played, failed or cancelled
+ * @param timeout: Maximum time to wait
+ * @return ESP_OK when idle, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t tts_scheduler_wait_idle(TickType_t timeout);
+
+/**
+ * Barge-in: drop queued sentences, abort in-flight TTS requests and stop
+ * the sentence currently playing. Returns without waiting for the workers.
+ */
+void tts_scheduler_cancel(void);
+
+/**
+ * Snapshot scheduler statistics
+ * @param stats: Output statistics
+ */
+void tts_scheduler_get_stats(tts_scheduler_stats_t *stats);
+
+/**
+ * Stop tasks and free buffers
+ */
+void tts_scheduler_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
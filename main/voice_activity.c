@@ -0,0 +1,135 @@
+#include "voice_activity.h"
+#include <math.h>
+#include <string.h>
+
+#define NOISE_MIN_DB        20.0f   // Floor of the noise estimate (RMS 10 LSB)
+#define SPEECH_MIN_DB       30.0f   // Quieter frames are never speech (about -60 dBFS)
+#define NOISE_FALL          0.3f    // Share of the gap closed per frame when quieter
+#define NOISE_RISE_DB_S     3.0f    // Rise of the floor during non-speech
+#define HUM_CORRELATION     0.995f  // Lag-1 correlation of a tone below ~250 Hz
+#define HISS_CORRELATION    0.1f    // Flat spectrum: no tilt either way...
+#define HISS_CROSSINGS      0.4f    // ...and crossings near those of white noise
+
+void voice_activity_init(voice_activity_t *vad, const voice_activity_config_t *cfg)
+{
+    memset(vad, 0, sizeof(*vad));
+    vad->cfg = *cfg;
+    vad->frame_len = (uint32_t)(cfg->sample_rate_hz / 1000 * cfg->frame_ms);
+    vad->onset_frames = (uint32_t)((cfg->onset_ms + cfg->frame_ms - 1) / cfg->frame_ms);
+    vad->hangover_frames = (uint32_t)((cfg->hangover_ms + cfg->frame_ms - 1) / cfg->frame_ms);
+    if (vad->onset_frames == 0) {
+        vad->onset_frames = 1;
+    }
+    if (vad->hangover_frames == 0) {
+        vad->hangover_frames = 1;
+    }
+    vad->noise_db = -1.0f;  // Set by the first frame
+}
+
+// Speech or not, from the features of the frame just completed
+static bool classify_frame(voice_activity_t *vad)
+{
+    float mean_sq = (float)vad->sum_sq / (float)vad->n;
+    float energy_db = 10.0f * log10f(mean_sq + 1.0f);
+    float rho = vad->sum_sq > 0 ? (float)vad->sum_lag / (float)vad->sum_sq : 0.0f;
+    float zcr = (float)vad->crossings / (float)vad->n;
+
+    if (vad->noise_db < 0.0f) {
+        vad->noise_db = energy_db > NOISE_MIN_DB ? energy_db : NOISE_MIN_DB;
+    }
+
+    bool loud = energy_db > vad->noise_db + (float)vad->cfg.threshold_db && energy_db > SPEECH_MIN_DB;
+    bool hum = rho > HUM_CORRELATION;
+    bool hiss = fabsf(rho) < HISS_CORRELATION && zcr > HISS_CROSSINGS;
+    bool speech = loud && !hum && !hiss;
+
+    // Track the floor outside speech: down quickly, up slowly, so a step in
+    // background noise is absorbed within seconds but words are not
+    if (!speech) {
+        if (energy_db < vad->noise_db) {
+            vad->noise_db += (energy_db - vad->noise_db) * NOISE_FALL;
+        } else {
+            float rise = NOISE_RISE_DB_S * (float)vad->cfg.frame_ms / 1000.0f;
+            float gap = energy_db - vad->noise_db;
+            vad->noise_db += gap < rise ? gap : rise;
+        }
+        if (vad->noise_db < NOISE_MIN_DB) {
+            vad->noise_db = NOISE_MIN_DB;
+        }
+    }
+    return speech;
+}
+
+// Advance the utterance state by one frame ending at vad->samples
+static voice_activity_event_t decide(voice_activity_t *vad, bool speech)
+{
+    if (speech) {
+        vad->speech_frames++;
+    }
+    if (!vad->in_speech) {
+        if (!speech) {
+            vad->run = 0;
+            return VOICE_ACTIVITY_NONE;
+        }
+        if (++vad->run < vad->onset_frames) {
+            return VOICE_ACTIVITY_NONE;
+        }
+        vad->in_speech = true;
+        vad->run = 0;
+        vad->speech_start = vad->samples - (size_t)vad->onset_frames * vad->frame_len;
+        vad->speech_end = vad->samples;
+        return VOICE_ACTIVITY_START;
+    }
+    if (speech) {
+        vad->speech_end = vad->samples;
+        vad->run = 0;
+        if (vad->paused) {
+            vad->paused = false;
+            return VOICE_ACTIVITY_RESUME;
+        }
+        return VOICE_ACTIVITY_NONE;
+    }
+    vad->run++;
+    if (vad->run >= vad->hangover_frames) {
+        vad->in_speech = false;
+        vad->paused = false;
+        vad->run = 0;
+        return VOICE_ACTIVITY_END;
+    }
+    if (!vad->paused) {
+        vad->paused = true;
+        return VOICE_ACTIVITY_PAUSE;
+    }
+    return VOICE_ACTIVITY_NONE;
+}
+
+voice_activity_event_t voice_activity_feed(voice_activity_t *vad, const int16_t *pcm, size_t samples,
+                                           size_t *consumed)
+{
+    int16_t prev = vad->prev;
+    for (size_t i = 0; i < samples; i++) {
+        int32_t x = pcm[i];
+        vad->sum_sq += x * x;
+        vad->sum_lag += x * (int32_t)prev;
+        vad->crossings += (x ^ prev) < 0;
+        prev = (int16_t)x;
+        if (++vad->n < vad->frame_len) {
+            continue;
+        }
+        vad->samples += vad->n;
+        bool speech = classify_frame(vad);
+        vad->n = 0;
+        vad->sum_sq = 0;
+        vad->sum_lag = 0;
+        vad->crossings = 0;
+        voice_activity_event_t event = decide(vad, speech);
+        if (event != VOICE_ACTIVITY_NONE) {
+            vad->prev = prev;
+            *consumed = i + 1;
+            return event;
+        }
+    }
+    vad->prev = prev;
+    *consumed = samples;
+    return VOICE_ACTIVITY_NONE;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Streaming voice-activity detector
+ *
+ * Classifies fixed frames of 16-bit mono audio as speech or not from three
+ * features: frame energy against an adaptive noise floor, the normalized
+ * lag-1 autocorrelation (spectral tilt: high for voiced speech and for hum,
+ * near zero for hiss) and the zero-crossing rate (high for fricatives).
+ * Speech starts after `onset_ms` of speech frames and ends after
+ * `hangover_ms` without one, so short pauses between words do not end an
+ * utterance. Input may be fed in pieces of any size; nothing is copied.
+ */
+
+/**
+ * Detector configuration
+ */
+typedef struct {
+    int sample_rate_hz;
+    int frame_ms;           // Analysis frame (10-30 ms)
+    int threshold_db;       // Frame energy above the noise floor counted as speech
+    int onset_ms;           // Speech needed before an utterance starts
+    int hangover_ms;        // Silence needed before it ends
+} voice_activity_config_t;
+
+/**
+ * Events, each returned once by voice_activity_feed()
+ */
+typedef enum {
+    VOICE_ACTIVITY_NONE,
+    VOICE_ACTIVITY_START,   // Utterance started at speech_start
+    VOICE_ACTIVITY_PAUSE,   // First silent frame after speech; hangover running
+    VOICE_ACTIVITY_RESUME,  // Speech again within the hangover
+    VOICE_ACTIVITY_END,     // Hangover expired; the utterance ended at speech_end
+} voice_activity_event_t;
+
+typedef struct {
+    voice_activity_config_t cfg;
+    uint32_t frame_len;     // Samples per frame
+    // Current frame
+    uint32_t n;
+    int64_t sum_sq;
+    int64_t sum_lag;        // Sum of x[i] * x[i-1]
+    uint32_t crossings;
+    int16_t prev;
+    // Decision state
+    float noise_db;         // Noise floor estimate
+    bool in_speech;         // Between START and END
+    bool paused;            // In the hangover
+    uint32_t run;           // Consecutive speech (before START) or silent frames
+    uint32_t onset_frames;
+    uint32_t hangover_frames;
+    // Positions in samples since init
+    size_t samples;         // Fed so far
+    size_t speech_start;    // First sample of the utterance
+    size_t speech_end;      // One past the last speech frame
+    uint32_t speech_frames; // Frames classified as speech
+} voice_activity_t;
+
+/**
+ * Initialize (or reset) a detector
+ * @param vad: Detector state
+ * @param cfg: Configuration (copied)
+ */
+void voice_activity_init(voice_activity_t *vad, const voice_activity_config_t *cfg);
+
+/**
+ * Feed audio up to the next event
+ * Stops right after the frame that produced an event, so call again with
+ * the rest of the input until everything is consumed.
+ * @param vad: Detector state
+ * @param pcm: Samples
+ * @param samples: Number of samples
+ * @param consumed: OUT: samples used (== samples when no event)
+ * @return Event, or VOICE_ACTIVITY_NONE
+ */
+voice_activity_event_t voice_activity_feed(voice_activity_t *vad, const int16_t *pcm, size_t samples,
+                                           size_t *consumed);
+
+#ifdef __cplusplus
+}
+#endif
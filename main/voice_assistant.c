@@ -1,111 +1,838 @@
 #include "voice_assistant.h"
 #include "gemini_api.h"
+#include "gemini_live.h"
 #include "wake_word_manager.h"
 #include "audio_player.h"
+#include "sentence_segmenter.h"
+#include "tts_scheduler.h"
+#include "voice_activity.h"
+#include "audio_ring.h"
+#include "span_trace.h"
+#include "turn_arena.h"
+#include "local_intent.h"
+#include "earcon.h"
 #include "esp_log.h"
-#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+#include "esp_netif_sntp.h"
+#endif
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
 
 static const char *TAG = "voice_assistant";
 
 static voice_assistant_config_t s_config = {0};
 static bool s_initialized = false;
 static bool s_active = false;
-static TaskHandle_t s_assistant_task = NULL;
-static QueueHandle_t s_command_queue = NULL;
 
-// Voice command processing task
-static void assistant_task(void *pvParameters)
+// Turn pipeline. The controller task owns the state machine and only reacts
+// to events (wake, end of speech, first audio, turn done), so a trigger is
+// handled as soon as it is posted rather than on the next poll. The turn
+// task runs STT and the LLM for one utterance at a time and is started with
+// a task notification. Capture runs on the microphone task that calls
+// voice_assistant_feed_audio(); TTS and playback run on the scheduler's
+// workers and player.
+#define CAPTURE_RATE_HZ         16000
+#define CAPTURE_MAX_SAMPLES     (CONFIG_VOICE_ASSISTANT_MAX_UTTERANCE_MS * (CAPTURE_RATE_HZ / 1000))
+#define NO_SPEECH_SAMPLES       (CONFIG_VOICE_ASSISTANT_NO_SPEECH_TIMEOUT_MS * (CAPTURE_RATE_HZ / 1000))
+#define TRIM_PAD_SAMPLES        (CONFIG_VOICE_ASSISTANT_VAD_PAD_MS * (CAPTURE_RATE_HZ / 1000))
+#define PREROLL_US              ((int64_t)CONFIG_VOICE_ASSISTANT_PREROLL_MS * 1000)
+// Microphone history kept while idle (the longest pre-roll), plus room for
+// the controller to close a full utterance before its start is overwritten
+#define RING_HISTORY_MS         2000
+#define RING_SLACK_MS           500
+#define RING_SAMPLES            ((RING_HISTORY_MS + RING_SLACK_MS) * (CAPTURE_RATE_HZ / 1000) + CAPTURE_MAX_SAMPLES)
+#define VAD_FRAME_MS            20
+#define VAD_ONSET_MS            60
+#define EVENT_QUEUE_LEN         8
+#define EXIT_TIMEOUT_MS         5000
+// Controller: short handlers only; above the TTS player (6) so transitions
+// are taken promptly, any core
+#define CONTROLLER_STACK_SIZE   4096
+#define CONTROLLER_PRIORITY     7
+// Turn task: TLS and JSON, on the core that runs Wi-Fi and lwIP, below the
+// audio tasks
+#define TURN_STACK_SIZE         16384
+#define TURN_PRIORITY           5
+#define TURN_CORE               0
+// Hosts the turn will call, opened while the user speaks
+#if CONFIG_VOICE_ASSISTANT_AUDIO_QUERY
+#define PREWARM_SERVICES        (GEMINI_SERVICE_LLM | GEMINI_SERVICE_TTS)
+#else
+#define PREWARM_SERVICES        (GEMINI_SERVICE_STT | GEMINI_SERVICE_LLM | GEMINI_SERVICE_TTS)
+#endif
+
+typedef enum {
+    EVT_WAKE,
+    EVT_SPEECH_PAUSE,       // VAD: silence after speech, hangover running
+    EVT_SPEECH_RESUME,      // VAD: speech again within the hangover
+    EVT_END_OF_SPEECH,      // VAD hangover expired, or voice_assistant_end_of_speech()
+    EVT_NO_SPEECH,          // Nothing said within the no-speech timeout
+    EVT_CAPTURE_FULL,
+    EVT_PLAY_START,
+    EVT_TURN_DONE,
+    EVT_TIMER_DONE,         // A timer set by voice ran out
+    EVT_STOP,
+} va_event_type_t;
+
+typedef struct {
+    va_event_type_t type;
+    int64_t at_us;          // When it happened (not when it is handled)
+} va_event_t;
+
+static QueueHandle_t s_events = NULL;
+static TaskHandle_t s_controller_task = NULL;
+static TaskHandle_t s_turn_task = NULL;
+static SemaphoreHandle_t s_exited = NULL;
+static volatile voice_assistant_state_t s_state = VOICE_ASSISTANT_STATE_IDLE;
+static voice_assistant_timeline_t s_timeline;       // Turn in progress (controller only)
+static voice_assistant_timeline_t s_last_turn;
+static bool s_have_last_turn = false;
+static bool s_listen_again = false;                 // Woken during an answer
+static int64_t s_listen_again_us = 0;               // ... at this time
+static uint32_t s_turns = 0;
+static uint32_t s_trace_turn = 0;                   // span_trace turn of s_timeline
+
+// Microphone ring, written by the microphone task whenever the assistant
+// runs. A capture is a range of it that starts a pre-roll before the wake:
+// the microphone task endpoints it from s_vad_pos, the controller trims it
+// to s_utterance (pointers into the ring, held against overwriting) once it
+// is closed and the turn task uploads that
+static SemaphoreHandle_t s_capture_lock = NULL;
+static audio_ring_t *s_ring = NULL;
+static uint64_t s_capture_start = 0;
+static uint64_t s_vad_pos = 0;
+static volatile bool s_capturing = false;
+static voice_activity_t s_vad;
+static bool s_speech_heard = false;
+static gemini_pcm_parts_t s_utterance;
+static uint64_t s_ring_dropped = 0;                 // Reported so far
+
+static const char *const STATE_NAMES[VOICE_ASSISTANT_STATE_COUNT] = {
+    "idle", "listening", "endpointing", "thinking", "speaking",
+};
+
+// Sentence-level TTS: the LLM stream is cut into sentences on the calling
+// task and handed to the TTS scheduler, which synthesizes several at once and
+// plays them in order while the rest of the answer is still being generated.
+#define TTS_SENTENCE_MAX_SAMPLES 72000  // 3 seconds at 24kHz
+#define TTS_SAMPLE_RATE_HZ 24000
+#define TTS_IDLE_TIMEOUT_MS 30000       // Test prompt: synthesis + playback
+#define TRANSCRIPT_MAX_LEN 512
+
+// Working state of one answer, carved from the turn arena rather than the
+// turn task's stack
+typedef struct {
+    char transcript[TRANSCRIPT_MAX_LEN];
+    sentence_segmenter_t segmenter;
+} turn_scratch_t;
+
+static int64_t s_turn_start_us = 0;
+static volatile bool s_barge_in = false;
+
+// Live session: model audio goes straight to the player from the session's
+// receive task. The first microphone buffer after end of speech starts a
+// new user turn, which also silences the answer still playing.
+static gemini_live_session_t *s_live = NULL;
+static volatile bool s_live_user_turn = false;
+static volatile bool s_live_muted = false;
+
+static esp_err_t process_voice_command(const gemini_pcm_parts_t *audio);
+
+static esp_err_t post_event(va_event_type_t type, int64_t at_us)
+{
+    if (!s_events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const va_event_t event = { .type = type, .at_us = at_us };
+    if (xQueueSend(s_events, &event, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Event queue full, dropping event %d", type);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static void free_pipeline(void)
+{
+    if (s_events) {
+        vQueueDelete(s_events);
+        s_events = NULL;
+    }
+    if (s_capture_lock) {
+        vSemaphoreDelete(s_capture_lock);
+        s_capture_lock = NULL;
+    }
+    if (s_exited) {
+        vSemaphoreDelete(s_exited);
+        s_exited = NULL;
+    }
+}
+
+// TTS scheduler callback on the player task
+static void on_play_start(int64_t at_us, void *ctx)
+{
+    post_event(EVT_PLAY_START, at_us);
+}
+
+static void set_state(voice_assistant_state_t state, int64_t at_us)
+{
+    ESP_LOGD(TAG, "%s -> %s", STATE_NAMES[s_state], STATE_NAMES[state]);
+    s_timeline.enter_us[state] = at_us;
+    s_state = state;
+}
+
+// When `state` ended: at the next state the turn entered
+static int64_t stage_end_us(const voice_assistant_timeline_t *t, voice_assistant_state_t state)
+{
+    for (int next = state + 1; next < VOICE_ASSISTANT_STATE_COUNT; next++) {
+        if (t->enter_us[next] != 0) {
+            return t->enter_us[next];
+        }
+    }
+    return t->enter_us[VOICE_ASSISTANT_STATE_IDLE];
+}
+
+// Time spent in `state`
+static long long stage_ms(const voice_assistant_timeline_t *t, voice_assistant_state_t state)
+{
+    if (t->enter_us[state] == 0) {
+        return -1;
+    }
+    return (long long)((stage_end_us(t, state) - t->enter_us[state]) / 1000);
+}
+
+// The turn and its states as spans, next to what the other tasks recorded
+static void trace_timeline(const voice_assistant_timeline_t *t)
+{
+    const int64_t *at = t->enter_us;
+    span_trace_add("turn", NULL, at[VOICE_ASSISTANT_STATE_LISTENING], at[VOICE_ASSISTANT_STATE_IDLE]);
+    for (int state = VOICE_ASSISTANT_STATE_LISTENING; state < VOICE_ASSISTANT_STATE_COUNT; state++) {
+        if (at[state] != 0) {
+            span_trace_add(STATE_NAMES[state], NULL, at[state], stage_end_us(t, state));
+        }
+    }
+}
+
+static void log_timeline(const voice_assistant_timeline_t *t)
+{
+    const int64_t *at = t->enter_us;
+    if (at[VOICE_ASSISTANT_STATE_SPEAKING] != 0) {
+        ESP_LOGI(TAG, "⏱ Turn %lu: first audio %lld ms after end of speech",
+                 (unsigned long)t->turn,
+                 (long long)((at[VOICE_ASSISTANT_STATE_SPEAKING] - at[VOICE_ASSISTANT_STATE_ENDPOINTING]) / 1000));
+    }
+    ESP_LOGI(TAG, "⏱ Turn %lu: listening %lld ms (%zu samples, %zu trimmed), endpointing %lld ms, "
+             "thinking %lld ms, speaking %lld ms%s", (unsigned long)t->turn,
+             stage_ms(t, VOICE_ASSISTANT_STATE_LISTENING), t->samples, t->trimmed,
+             stage_ms(t, VOICE_ASSISTANT_STATE_ENDPOINTING),
+             stage_ms(t, VOICE_ASSISTANT_STATE_THINKING),
+             stage_ms(t, VOICE_ASSISTANT_STATE_SPEAKING),
+             t->interrupted ? " (interrupted)" : "");
+#if CONFIG_VOICE_ASSISTANT_EARCONS
+    earcon_stats_t earcons;
+    earcon_get_stats(&earcons);
+    if (earcons.played > 0) {
+        ESP_LOGI(TAG, "⏱ Earcons: trigger to DMA last %lu us, avg %lu us, max %lu us (%lu played)",
+                 (unsigned long)earcons.last_latency_us, (unsigned long)earcons.avg_latency_us,
+                 (unsigned long)earcons.max_latency_us, (unsigned long)earcons.played);
+    }
+#endif
+}
+
+static void start_listening(int64_t at_us)
+{
+    memset(&s_timeline, 0, sizeof(s_timeline));
+    s_timeline.turn = ++s_turns;
+    s_trace_turn = span_trace_new_turn();
+    span_trace_mark("wake", at_us);
+#if CONFIG_VOICE_ASSISTANT_NET_PREWARM
+    gemini_api_prewarm(PREWARM_SERVICES);
+#endif
+    const voice_activity_config_t vad_cfg = {
+        .sample_rate_hz = CAPTURE_RATE_HZ,
+        .frame_ms = VAD_FRAME_MS,
+        .threshold_db = CONFIG_VOICE_ASSISTANT_VAD_THRESHOLD_DB,
+        .onset_ms = VAD_ONSET_MS,
+        .hangover_ms = CONFIG_VOICE_ASSISTANT_VAD_HANGOVER_MS,
+    };
+    // Words spoken while the detector was still deciding are already in
+    // the ring; the VAD catches up on them with the next microphone buffer
+    uint64_t start = audio_ring_pos_at(s_ring, at_us - PREROLL_US);
+    xSemaphoreTake(s_capture_lock, portMAX_DELAY);
+    voice_activity_init(&s_vad, &vad_cfg);
+    s_speech_heard = false;
+    s_capture_start = start;
+    s_vad_pos = start;
+    s_capturing = true;
+    xSemaphoreGive(s_capture_lock);
+    set_state(VOICE_ASSISTANT_STATE_LISTENING, at_us);
+}
+
+// The utterance has been uploaded: let the microphone ring move over it
+static void release_utterance(void)
+{
+    if (!s_ring) {
+        return;
+    }
+    audio_ring_release(s_ring);
+    uint64_t dropped = audio_ring_dropped(s_ring);
+    if (dropped > s_ring_dropped) {
+        ESP_LOGW(TAG, "Slow upload: %llu ms of microphone history not kept",
+                 (unsigned long long)((dropped - s_ring_dropped) * 1000 / CAPTURE_RATE_HZ));
+        s_ring_dropped = dropped;
+    }
+}
+
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+// Local intents: device commands are carried out on the turn task and
+// answered through the TTS prompt path, which keeps every answer in the
+// flash cache, so a repeated command needs neither the LLM nor TTS
+#define LOCAL_VOLUME_STEP   10
+#define LOCAL_TIMERS        4
+#define LOCAL_ANSWER_LEN    96
+#define TIME_VALID_YEAR     2024    // Earlier: SNTP has not set the clock yet
+
+static esp_timer_handle_t s_timers[LOCAL_TIMERS];
+static int64_t s_timer_due_us[LOCAL_TIMERS];        // Turn task only; free once passed
+static bool s_alarm_pending = false;                // Ran out during an answer (controller)
+static bool s_sntp_started = false;
+static uint32_t s_intent_turns = 0;                 // Transcripts checked
+static uint32_t s_local_turns = 0;                  // ... answered here
+
+// esp_timer task
+static void on_timer_done(void *arg)
+{
+    post_event(EVT_TIMER_DONE, esp_timer_get_time());
+}
+
+static esp_err_t create_timers(void)
+{
+    for (int i = 0; i < LOCAL_TIMERS; i++) {
+        const esp_timer_create_args_t args = {
+            .callback = on_timer_done,
+            .name = "va_timer",
+        };
+        esp_err_t ret = esp_timer_create(&args, &s_timers[i]);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        s_timer_due_us[i] = 0;
+    }
+    return ESP_OK;
+}
+
+static void delete_timers(void)
+{
+    for (int i = 0; i < LOCAL_TIMERS; i++) {
+        if (s_timers[i]) {
+            esp_timer_stop(s_timers[i]);
+            esp_timer_delete(s_timers[i]);
+            s_timers[i] = NULL;
+        }
+    }
+}
+
+// Queue a spoken answer; returns the sentences queued. Only fixed phrases
+// are persisted to the flash cache: a time or a duration would rarely be
+// asked for again and would only fill flash with single-use entries
+static size_t say_ex(const char *text, bool fixed)
+{
+    esp_err_t ret = fixed ? tts_scheduler_submit_prompt(text) : tts_scheduler_submit(text);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Dropping answer \"%s\": %s", text, esp_err_to_name(ret));
+        return 0;
+    }
+    return 1;
+}
+
+static size_t say(const char *text)
+{
+    return say_ex(text, true);
+}
+
+// Answer built from a time, count or duration
+static size_t say_dynamic(const char *text)
+{
+    return say_ex(text, false);
+}
+
+// Controller; only while nothing is being answered, when every sentence
+// buffer is free and the prompt does not block
+static void announce_timer_done(void)
+{
+    ESP_LOGI(TAG, "Timer done");
+    say("Your timer is done.");
+}
+
+// "1 hour and 30 minutes"
+static void format_duration(int seconds, char *out, size_t len)
+{
+    const int amounts[3] = { seconds / 3600, seconds % 3600 / 60, seconds % 60 };
+    static const char *const UNIT_NAMES[3] = { "hour", "minute", "second" };
+    int parts = 0;
+    for (int i = 0; i < 3; i++) {
+        parts += amounts[i] > 0;
+    }
+    size_t at = 0;
+    out[0] = '\0';
+    for (int i = 0, written = 0; i < 3 && at < len; i++) {
+        if (amounts[i] == 0) {
+            continue;
+        }
+        const char *sep = written == 0 ? "" : written == parts - 1 ? " and " : ", ";
+        at += snprintf(out + at, len - at, "%s%d %s%s", sep, amounts[i], UNIT_NAMES[i], amounts[i] == 1 ? "" : "s");
+        written++;
+    }
+}
+
+// Carry out a matched intent; returns the sentences queued as its answer
+static size_t run_local_intent(const local_intent_t *intent)
+{
+    char answer[LOCAL_ANSWER_LEN];
+    char duration[48];
+    int64_t now_us = esp_timer_get_time();
+    switch (intent->type) {
+    case LOCAL_INTENT_STOP:
+        // Silences a timer announcement or anything else still queued
+        tts_scheduler_cancel();
+        return 0;
+    case LOCAL_INTENT_VOLUME_UP:
+    case LOCAL_INTENT_VOLUME_DOWN: {
+        int volume = audio_player_get_volume();
+        bool up = intent->type == LOCAL_INTENT_VOLUME_UP;
+        if (up ? volume >= 100 : volume <= LOCAL_VOLUME_STEP) {
+            return say(up ? "That's as loud as it goes." : "That's as quiet as it goes.");
+        }
+        volume += up ? LOCAL_VOLUME_STEP : -LOCAL_VOLUME_STEP;
+        audio_player_set_volume(volume < LOCAL_VOLUME_STEP ? LOCAL_VOLUME_STEP : volume);
+        return say(up ? "Volume up." : "Volume down.");
+    }
+    case LOCAL_INTENT_VOLUME_SET:
+        audio_player_set_volume(intent->value);
+        if (intent->value == 0) {
+            return 0;
+        }
+        snprintf(answer, sizeof(answer), "Volume %d percent.", intent->value);
+        return say_dynamic(answer);
+    case LOCAL_INTENT_TIME: {
+        time_t now = time(NULL);
+        struct tm local;
+        localtime_r(&now, &local);
+        if (local.tm_year + 1900 < TIME_VALID_YEAR) {
+            return say("Sorry, I don't know the time yet.");
+        }
+        int hour = local.tm_hour % 12 == 0 ? 12 : local.tm_hour % 12;
+        snprintf(answer, sizeof(answer), "It's %d:%02d %s.", hour, local.tm_min, local.tm_hour < 12 ? "AM" : "PM");
+        return say_dynamic(answer);
+    }
+    case LOCAL_INTENT_TIMER_SET:
+        for (int i = 0; i < LOCAL_TIMERS; i++) {
+            if (s_timer_due_us[i] > now_us) {
+                continue;
+            }
+            if (esp_timer_start_once(s_timers[i], (uint64_t)intent->value * 1000000) != ESP_OK) {
+                return say("Sorry, I couldn't set the timer.");
+            }
+            s_timer_due_us[i] = now_us + (int64_t)intent->value * 1000000;
+            format_duration(intent->value, duration, sizeof(duration));
+            snprintf(answer, sizeof(answer), "Timer set for %s.", duration);
+            return say_dynamic(answer);
+        }
+        return say("You already have four timers running.");
+    case LOCAL_INTENT_TIMER_CANCEL: {
+        int cancelled = 0;
+        for (int i = 0; i < LOCAL_TIMERS; i++) {
+            if (s_timer_due_us[i] > now_us) {
+                esp_timer_stop(s_timers[i]);
+                cancelled++;
+            }
+            s_timer_due_us[i] = 0;
+        }
+        return say(cancelled == 0 ? "There's no timer running." :
+                   cancelled == 1 ? "Timer cancelled." : "Timers cancelled.");
+    }
+    case LOCAL_INTENT_TIMER_QUERY: {
+        int64_t next_us = 0;
+        for (int i = 0; i < LOCAL_TIMERS; i++) {
+            if (s_timer_due_us[i] > now_us && (next_us == 0 || s_timer_due_us[i] < next_us)) {
+                next_us = s_timer_due_us[i];
+            }
+        }
+        if (next_us == 0) {
+            return say("There's no timer running.");
+        }
+        // Whole minutes from two minutes up, so the answer is not stale
+        // by the time it has been spoken
+        int left = (int)((next_us - now_us + 999999) / 1000000);
+        if (left >= 120) {
+            left = (left + 30) / 60 * 60;
+        }
+        format_duration(left, duration, sizeof(duration));
+        snprintf(answer, sizeof(answer), "About %s left.", duration);
+        return say_dynamic(answer);
+    }
+    case LOCAL_INTENT_NONE:
+    case LOCAL_INTENT_COUNT:
+        break;
+    }
+    return 0;
+}
+#endif
+
+static void finish_turn(int64_t at_us)
+{
+    set_state(VOICE_ASSISTANT_STATE_IDLE, at_us);
+    s_last_turn = s_timeline;
+    s_have_last_turn = true;
+    log_timeline(&s_timeline);
+    trace_timeline(&s_timeline);
+#if CONFIG_VOICE_ASSISTANT_TRACE_DUMP
+    span_trace_dump_console(s_trace_turn);
+#endif
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+    if (s_alarm_pending) {
+        s_alarm_pending = false;
+        announce_timer_done();
+    }
+#endif
+    if (s_listen_again) {
+        s_listen_again = false;
+        start_listening(s_listen_again_us);
+    }
+}
+
+// The user stopped talking: close the utterance, cut the silence around
+// the speech and hand the rest to the turn task
+static void end_capture(va_event_type_t reason, int64_t at_us)
+{
+    xSemaphoreTake(s_capture_lock, portMAX_DELAY);
+    s_capturing = false;
+    size_t captured = (size_t)(s_vad_pos - s_capture_start);
+    size_t begin = 0;
+    size_t end = captured;
+    if (s_speech_heard) {
+        begin = s_vad.speech_start > TRIM_PAD_SAMPLES ? s_vad.speech_start - TRIM_PAD_SAMPLES : 0;
+        // Cut after the last speech frame, unless the capture was closed
+        // while the user was still talking (explicit end, full buffer)
+        if (!s_vad.in_speech || s_vad.paused) {
+            end = s_vad.speech_end + TRIM_PAD_SAMPLES < end ? s_vad.speech_end + TRIM_PAD_SAMPLES : end;
+        }
+    } else if (reason == EVT_NO_SPEECH) {
+        end = 0;
+    }
+    // Uploaded from where it lies in the ring (two pieces if it wraps)
+    memset(&s_utterance, 0, sizeof(s_utterance));
+    if (end > begin) {
+        if (audio_ring_peek(s_ring, s_capture_start + begin, s_capture_start + end,
+                            &s_utterance.pcm[0], &s_utterance.samples[0],
+                            &s_utterance.pcm[1], &s_utterance.samples[1]) == ESP_OK) {
+            audio_ring_hold(s_ring, s_capture_start + begin);
+        } else {
+            ESP_LOGE(TAG, "Utterance overwritten before it was closed");
+            end = begin;
+        }
+    }
+    s_timeline.trimmed = captured - (end - begin);
+    xSemaphoreGive(s_capture_lock);
+
+    s_timeline.samples = end - begin;
+    if (s_state == VOICE_ASSISTANT_STATE_LISTENING) {
+        set_state(VOICE_ASSISTANT_STATE_ENDPOINTING, at_us);
+    }
+    if (s_timeline.samples == 0) {
+        ESP_LOGI(TAG, "No speech heard, back to idle");
+        finish_turn(esp_timer_get_time());
+        return;
+    }
+    s_barge_in = false;
+#if CONFIG_VOICE_ASSISTANT_EARCONS
+    earcon_play(EARCON_THINKING);
+#endif
+    set_state(VOICE_ASSISTANT_STATE_THINKING, esp_timer_get_time());
+    xTaskNotifyGive(s_turn_task);
+}
+
+// State machine: every transition is taken here, in event order
+static void controller_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Voice assistant task started");
-    
-    while (s_active) {
-        // Wait for wake word detection or manual command
-        // For now, we'll process commands from the queue
-        // In a full implementation, this would be triggered by wake word detection
-        vTaskDelay(pdMS_TO_TICKS(100));
-        
-        // TODO: Get audio from wake word detection or queue
-        // This is a placeholder - actual implementation would:
-        // 1. Wait for wake word detection
-        // 2. Record audio after wake word
-        // 3. Process through STT -> LLM -> TTS -> Playback
+
+    va_event_t event;
+    while (xQueueReceive(s_events, &event, portMAX_DELAY) == pdTRUE && event.type != EVT_STOP) {
+        switch (event.type) {
+        case EVT_WAKE:
+            if (s_state == VOICE_ASSISTANT_STATE_IDLE) {
+                start_listening(event.at_us);
+            } else if (s_state == VOICE_ASSISTANT_STATE_THINKING || s_state == VOICE_ASSISTANT_STATE_SPEAKING) {
+                // Stop the answer; listening resumes once the turn task is done
+                s_timeline.interrupted = true;
+                s_listen_again = true;
+                s_listen_again_us = event.at_us;
+                voice_assistant_barge_in();
+            }
+            break;
+        case EVT_SPEECH_PAUSE:
+            if (s_state == VOICE_ASSISTANT_STATE_LISTENING) {
+                set_state(VOICE_ASSISTANT_STATE_ENDPOINTING, event.at_us);
+            }
+            break;
+        case EVT_SPEECH_RESUME:
+            if (s_state == VOICE_ASSISTANT_STATE_ENDPOINTING) {
+                // A pause between words: listening keeps its original start
+                s_timeline.enter_us[VOICE_ASSISTANT_STATE_ENDPOINTING] = 0;
+                s_state = VOICE_ASSISTANT_STATE_LISTENING;
+            }
+            break;
+        case EVT_END_OF_SPEECH:
+        case EVT_NO_SPEECH:
+        case EVT_CAPTURE_FULL:
+            if (s_state == VOICE_ASSISTANT_STATE_LISTENING || s_state == VOICE_ASSISTANT_STATE_ENDPOINTING) {
+                if (event.type == EVT_CAPTURE_FULL) {
+                    ESP_LOGW(TAG, "Utterance reached %d ms, answering what was captured",
+                             CONFIG_VOICE_ASSISTANT_MAX_UTTERANCE_MS);
+                }
+                end_capture(event.type, event.at_us);
+            }
+            break;
+        case EVT_PLAY_START:
+            if (s_state == VOICE_ASSISTANT_STATE_THINKING) {
+                set_state(VOICE_ASSISTANT_STATE_SPEAKING, event.at_us);
+            }
+            break;
+        case EVT_TURN_DONE:
+            if (s_state == VOICE_ASSISTANT_STATE_THINKING || s_state == VOICE_ASSISTANT_STATE_SPEAKING) {
+                finish_turn(event.at_us);
+            }
+            break;
+        case EVT_TIMER_DONE:
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+            if (s_state == VOICE_ASSISTANT_STATE_THINKING || s_state == VOICE_ASSISTANT_STATE_SPEAKING) {
+                s_alarm_pending = true;
+            } else {
+                announce_timer_done();
+            }
+#endif
+            break;
+        case EVT_STOP:
+            break;
+        }
     }
-    
+
     ESP_LOGI(TAG, "Voice assistant task stopped");
+    xSemaphoreGive(s_exited);
     vTaskDelete(NULL);
 }
 
-// Wake word callback - triggered when wake word is detected
-__attribute__((unused)) static void on_wake_word_detected(const char *wake_word)
+// Every stage of the answer has finished with its scratch memory: empty
+// the arena for the next turn
+static void end_turn_arena(void)
 {
-    ESP_LOGI(TAG, "Wake word '%s' detected - starting voice command capture", wake_word);
-    
-    // TODO: Start recording audio for command
-    // For now, this is a placeholder
-    // In full implementation:
-    // 1. Start recording from microphone
-    // 2. Record for ~5 seconds or until silence detected
-    // 3. Send to voice_assistant_process_command()
+    turn_arena_reset();
+    turn_arena_stats_t stats;
+    turn_arena_get_stats(&stats);
+    ESP_LOGI(TAG, "Turn arena: %zu of %zu KB used, %lu request(s) sent to the heap since boot",
+             stats.turn_peak / 1024, stats.capacity / 1024, (unsigned long)stats.overflows);
 }
 
-// Process complete voice command: STT -> LLM -> TTS -> Playback
-static esp_err_t process_voice_command(const int16_t *audio_data, size_t audio_len)
+// Runs one utterance per notification from the controller
+static void turn_task(void *pvParameters)
 {
-    ESP_LOGI(TAG, "Processing voice command (%zu samples)", audio_len);
-    
-    // Step 1: Speech-to-Text
-    char transcribed_text[512];
-    esp_err_t ret = gemini_stt(audio_data, audio_len, transcribed_text, sizeof(transcribed_text));
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "STT failed: %s", esp_err_to_name(ret));
-        return ret;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!s_active) {
+            break;
+        }
+        span_trace_id_t span = span_trace_begin("answer", NULL);
+        turn_arena_begin();
+        process_voice_command(&s_utterance);
+        release_utterance();
+        end_turn_arena();
+        span_trace_end(span);
+        post_event(EVT_TURN_DONE, esp_timer_get_time());
     }
-    
-    ESP_LOGI(TAG, "Transcribed: %s", transcribed_text);
-    
-    // Step 2: LLM - Get response from Gemini
-    char llm_response[2048];
-    ret = gemini_llm(transcribed_text, llm_response, sizeof(llm_response));
+    xSemaphoreGive(s_exited);
+    vTaskDelete(NULL);
+}
+
+// Segmenter output: hand each finished sentence to the TTS scheduler
+static void on_sentence(const char *sentence, void *ctx)
+{
+    if (s_barge_in) {
+        return;
+    }
+    ESP_LOGI(TAG, "Sentence -> TTS: %s", sentence);
+    span_trace_mark("sentence", esp_timer_get_time());
+    // Blocks while every sentence buffer is in use
+    esp_err_t ret = tts_scheduler_submit(sentence);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "LLM failed: %s", esp_err_to_name(ret));
-        return ret;
+        ESP_LOGE(TAG, "Dropping sentence: %s", esp_err_to_name(ret));
+    }
+}
+
+// LLM stream output: accumulate deltas into sentences
+static bool on_llm_text(const char *text, void *ctx)
+{
+#if CONFIG_VOICE_ASSISTANT_AUDIO_QUERY
+    // The answer only starts once the whole request has been sent
+    release_utterance();
+#endif
+    sentence_segmenter_feed((sentence_segmenter_t *)ctx, text);
+    return !s_barge_in;
+}
+
+// A request the user cut off with the wake word is not an error to them
+static void play_error_earcon(void)
+{
+#if CONFIG_VOICE_ASSISTANT_EARCONS
+    if (!s_barge_in) {
+        earcon_play(EARCON_ERROR);
     }
+#endif
+}
+
+// Process complete voice command: STT -> streaming LLM -> sentence TTS -> Playback
+// (or audio query -> sentence TTS -> Playback with CONFIG_VOICE_ASSISTANT_AUDIO_QUERY)
+static esp_err_t process_voice_command(const gemini_pcm_parts_t *audio)
+{
+    ESP_LOGI(TAG, "Processing voice command (%zu samples)", audio->samples[0] + audio->samples[1]);
+    s_turn_start_us = esp_timer_get_time();
+    gemini_api_metrics_turn_begin();
     
-    ESP_LOGI(TAG, "LLM response: %s", llm_response);
+    tts_scheduler_stats_t before;
+    tts_scheduler_get_stats(&before);
     
-    // Step 3: Text-to-Speech
-    const size_t tts_buffer_size = 48000; // ~2 seconds at 24kHz
-    int16_t *tts_audio = (int16_t *)malloc(tts_buffer_size * sizeof(int16_t));
-    if (!tts_audio) {
-        ESP_LOGE(TAG, "Failed to allocate TTS buffer");
+    turn_scratch_t *scratch = turn_arena_malloc(sizeof(turn_scratch_t));
+    if (!scratch) {
+        gemini_api_metrics_turn_end();
         return ESP_ERR_NO_MEM;
     }
+    sentence_segmenter_t *segmenter = &scratch->segmenter;
+    size_t spoken = 0;
     
-    size_t samples_written = 0;
-    ret = gemini_tts(llm_response, tts_audio, tts_buffer_size, &samples_written);
+#if CONFIG_VOICE_ASSISTANT_AUDIO_QUERY
+    // Step 1-3: one request: the utterance goes to Gemini as audio and the
+    // answer streams back; every complete sentence is queued for TTS
+    sentence_segmenter_init(segmenter, on_sentence, NULL);
+    esp_err_t ret = gemini_audio_query_parts(audio, NULL, on_llm_text, segmenter);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Audio query failed: %s", esp_err_to_name(ret));
+        play_error_earcon();
+    }
+    sentence_segmenter_flush(segmenter);
+    spoken = segmenter->emitted;
+#else
+    // Step 1: Speech-to-Text
+    esp_err_t ret = gemini_stt_parts(audio, scratch->transcript, sizeof(scratch->transcript));
+    release_utterance();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "TTS failed: %s", esp_err_to_name(ret));
-        free(tts_audio);
+        ESP_LOGE(TAG, "STT failed: %s", esp_err_to_name(ret));
+        play_error_earcon();
+        turn_arena_free(scratch);
+        gemini_api_metrics_turn_end();
+        gemini_api_log_turn_metrics();
         return ret;
     }
     
-    ESP_LOGI(TAG, "TTS generated %zu samples", samples_written);
+    ESP_LOGI(TAG, "Transcribed: %s", scratch->transcript);
     
-    // Step 4: Play audio response
-    // Note: TTS typically outputs at 24kHz, but our audio player may be at 48kHz
-    // We'll need to resample or configure TTS for 48kHz
-    ret = audio_player_submit_pcm(tts_audio, samples_written, 24000, 1); // Mono, 24kHz
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Audio playback failed: %s", esp_err_to_name(ret));
+    sentence_segmenter_init(segmenter, on_sentence, NULL);
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+    // Device commands (stop, volume, time, timers) are carried out here
+    // and answered from the TTS cache instead of asking the LLM
+    local_intent_t intent;
+    s_intent_turns++;
+    if (local_intent_match(scratch->transcript, &intent)) {
+        int64_t matched_us = esp_timer_get_time();
+        spoken = run_local_intent(&intent);
+        s_local_turns++;
+        ESP_LOGI(TAG, "Local intent %s (%d): handled in %lld ms, LLM skipped; %lu of %lu turns local",
+                 local_intent_name(intent.type), intent.value,
+                 (long long)((esp_timer_get_time() - matched_us) / 1000),
+                 (unsigned long)s_local_turns, (unsigned long)s_intent_turns);
+    } else
+#endif
+    {
+        // Step 2+3: Stream the LLM answer; every complete sentence is queued for
+        // TTS and playback while generation continues
+        ret = gemini_llm_stream(scratch->transcript, on_llm_text, segmenter);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "LLM failed: %s", esp_err_to_name(ret));
+            play_error_earcon();
+        }
+        sentence_segmenter_flush(segmenter);
+        spoken = segmenter->emitted;
     }
+#endif
     
-    free(tts_audio);
-    return ESP_OK;
+    // Step 4: Wait until the last queued sentence has played (or was cancelled)
+    span_trace_id_t span = span_trace_begin("playback", NULL);
+    tts_scheduler_wait_idle(portMAX_DELAY);
+    span_trace_end(span);
+    
+    tts_scheduler_stats_t after;
+    tts_scheduler_get_stats(&after);
+    uint64_t audio_ms = (after.samples_synthesized - before.samples_synthesized) * 1000 / TTS_SAMPLE_RATE_HZ;
+    int64_t busy_ms = (after.synth_busy_us - before.synth_busy_us) / 1000;
+    if (after.first_play_us > s_turn_start_us) {
+        ESP_LOGI(TAG, "⏱ First audio %lld ms after end of speech",
+                 (long long)((after.first_play_us - s_turn_start_us) / 1000));
+    }
+    ESP_LOGI(TAG, "Voice turn complete: %zu sentence(s) in %lld ms, synthesized %llu ms of audio in %lld ms%s",
+             spoken, (long long)((esp_timer_get_time() - s_turn_start_us) / 1000),
+             (unsigned long long)audio_ms, (long long)busy_ms, s_barge_in ? " (barge-in)" : "");
+    gemini_api_metrics_turn_end();
+    gemini_api_log_turn_metrics();
+    if (spoken > 0) {
+        ret = ESP_OK;
+    }
+    turn_arena_free(scratch);
+    return ret;
+}
+
+static void on_live_audio(const int16_t *pcm, size_t samples, int sample_rate_hz, void *ctx)
+{
+    if (s_live_muted) {
+        return;
+    }
+    // Blocks while the I2S buffers are full, which holds back the socket
+    esp_err_t ret = audio_player_submit_pcm(pcm, samples, sample_rate_hz, 1);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Live audio playback failed: %s", esp_err_to_name(ret));
+    }
+}
+
+static void on_live_event(gemini_live_event_t event, const char *text, void *ctx)
+{
+    switch (event) {
+    case GEMINI_LIVE_EVENT_INPUT_TRANSCRIPT:
+        ESP_LOGI(TAG, "Heard: %s", text);
+        break;
+    case GEMINI_LIVE_EVENT_OUTPUT_TRANSCRIPT:
+        ESP_LOGI(TAG, "Answer: %s", text);
+        break;
+    case GEMINI_LIVE_EVENT_INTERRUPTED:
+        s_live_muted = true;
+        break;
+    case GEMINI_LIVE_EVENT_TURN_COMPLETE: {
+        gemini_live_stats_t stats;
+        gemini_live_get_stats(s_live, &stats);
+        if (stats.last_latency_us >= 0) {
+            ESP_LOGI(TAG, "⏱ Live turn: first audio %lld ms after end of speech",
+                     (long long)(stats.last_latency_us / 1000));
+        }
+        break;
+    }
+    case GEMINI_LIVE_EVENT_GO_AWAY:
+    case GEMINI_LIVE_EVENT_CLOSED:
+        ESP_LOGW(TAG, "Live session ending; call voice_assistant_live_start() to reconnect");
+        break;
+    }
 }
 
 esp_err_t voice_assistant_init(const voice_assistant_config_t *config)
@@ -135,10 +862,35 @@ esp_err_t voice_assistant_init(const voice_assistant_config_t *config)
         return ret;
     }
     
-    // Create command queue
-    s_command_queue = xQueueCreate(4, sizeof(size_t)); // Store audio buffer pointers
-    if (!s_command_queue) {
-        ESP_LOGE(TAG, "Failed to create command queue");
+    // Scratch memory for every turn, reserved once and reused, so turns
+    // do not fragment the heap
+    ret = turn_arena_init(CONFIG_TURN_ARENA_SIZE_KB * 1024);
+    if (ret != ESP_OK) {
+        gemini_api_deinit();
+        return ret;
+    }
+    
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+    // Local time for "what time is it"
+    setenv("TZ", CONFIG_VOICE_ASSISTANT_TIMEZONE, 1);
+    tzset();
+    if (!s_sntp_started) {
+        esp_sntp_config_t sntp_cfg = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
+        if (esp_netif_sntp_init(&sntp_cfg) == ESP_OK) {
+            s_sntp_started = true;
+        } else {
+            ESP_LOGW(TAG, "SNTP not started; local time answers unavailable");
+        }
+    }
+#endif
+    
+    // Pipeline events, capture lock, task exit signal
+    s_events = xQueueCreate(EVENT_QUEUE_LEN, sizeof(va_event_t));
+    s_capture_lock = xSemaphoreCreateMutex();
+    s_exited = xSemaphoreCreateCounting(2, 0);
+    if (!s_events || !s_capture_lock || !s_exited) {
+        ESP_LOGE(TAG, "Failed to create pipeline queue");
+        free_pipeline();
         gemini_api_deinit();
         return ESP_ERR_NO_MEM;
     }
@@ -160,26 +912,95 @@ esp_err_t voice_assistant_start(void)
     
     s_active = true;
     
-    // Create assistant task with increased stack for TTS buffer allocation
-    xTaskCreate(
-        assistant_task,
-        "voice_assistant",
-        16384,  // Increased from 8192 to accommodate 144KB TTS buffer + heap operations
-        NULL,
-        5,
-        &s_assistant_task
-    );
-    
-    if (!s_assistant_task) {
+    tts_scheduler_config_t tts_cfg = {
+        .max_in_flight = CONFIG_TTS_MAX_IN_FLIGHT,
+        .max_samples = TTS_SENTENCE_MAX_SAMPLES,
+        .sample_rate_hz = TTS_SAMPLE_RATE_HZ,
+        .on_play_start = on_play_start,
+    };
+    esp_err_t ret = tts_scheduler_init(&tts_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start TTS scheduler: %s", esp_err_to_name(ret));
+        voice_assistant_stop();
+        return ret;
+    }
+    
+    // Microphone ring: PSRAM first, internal RAM as fallback
+    ret = audio_ring_create(RING_SAMPLES, CAPTURE_RATE_HZ, &s_ring);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to allocate microphone ring (%lu bytes)",
+                 (unsigned long)(RING_SAMPLES * sizeof(int16_t)));
+        voice_assistant_stop();
+        return ret;
+    }
+    s_ring_dropped = 0;
+    
+#if CONFIG_VOICE_ASSISTANT_EARCONS
+    // Rendered at the TTS rate so a tone never restarts I2S mid-answer
+    ret = earcon_init(TTS_SAMPLE_RATE_HZ);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to prepare earcons: %s", esp_err_to_name(ret));
+        voice_assistant_stop();
+        return ret;
+    }
+#endif
+    
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+    ret = create_timers();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create timers: %s", esp_err_to_name(ret));
+        voice_assistant_stop();
+        return ret;
+    }
+#endif
+    
+    xQueueReset(s_events);
+    s_state = VOICE_ASSISTANT_STATE_IDLE;
+    s_listen_again = false;
+    if (xTaskCreatePinnedToCore(turn_task, "va_turn", TURN_STACK_SIZE, NULL, TURN_PRIORITY,
+                                &s_turn_task, TURN_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create turn task");
+        s_turn_task = NULL;
+        voice_assistant_stop();
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(controller_task, "voice_assistant", CONTROLLER_STACK_SIZE, NULL, CONTROLLER_PRIORITY,
+                    &s_controller_task) != pdPASS) {
         ESP_LOGE(TAG, "Failed to create assistant task");
-        s_active = false;
+        s_controller_task = NULL;
+        voice_assistant_stop();
         return ESP_ERR_NO_MEM;
     }
     
-    ESP_LOGI(TAG, "Voice assistant started");
+    ESP_LOGI(TAG, "Voice assistant started (utterances up to %d ms, %d ms pre-roll)",
+             CONFIG_VOICE_ASSISTANT_MAX_UTTERANCE_MS, CONFIG_VOICE_ASSISTANT_PREROLL_MS);
     return ESP_OK;
 }
 
+// Ask both pipeline tasks to leave and wait for them; false if one is stuck
+static bool stop_tasks(void)
+{
+    int tasks = 0;
+    if (s_controller_task) {
+        const va_event_t stop = { .type = EVT_STOP };
+        xQueueSend(s_events, &stop, portMAX_DELAY);
+        tasks++;
+    }
+    if (s_turn_task) {
+        xTaskNotifyGive(s_turn_task);
+        tasks++;
+    }
+    s_controller_task = NULL;
+    s_turn_task = NULL;
+
+    for (int i = 0; i < tasks; i++) {
+        if (xSemaphoreTake(s_exited, pdMS_TO_TICKS(EXIT_TIMEOUT_MS)) != pdTRUE) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void voice_assistant_stop(void)
 {
     if (!s_active) {
@@ -187,23 +1008,236 @@ void voice_assistant_stop(void)
     }
     
     s_active = false;
+    s_capturing = false;
+    voice_assistant_live_stop();
+    voice_assistant_barge_in();
     
-    if (s_assistant_task) {
-        vTaskDelay(pdMS_TO_TICKS(200));
-        vTaskDelete(s_assistant_task);
-        s_assistant_task = NULL;
+    bool exited = stop_tasks();
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+    delete_timers();
+    s_alarm_pending = false;
+#endif
+    tts_scheduler_deinit();
+#if CONFIG_VOICE_ASSISTANT_EARCONS
+    earcon_deinit();
+#endif
+    audio_ring_t *ring = s_ring;
+    s_ring = NULL;
+    if (exited) {
+        audio_ring_destroy(ring);
+    } else {
+        // The turn task is still blocked in a request and reads the utterance
+        ESP_LOGE(TAG, "Turn task did not exit, leaking microphone ring");
     }
+    s_state = VOICE_ASSISTANT_STATE_IDLE;
     
     ESP_LOGI(TAG, "Voice assistant stopped");
 }
 
+esp_err_t voice_assistant_wake(void)
+{
+    if (!s_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+#if CONFIG_VOICE_ASSISTANT_EARCONS
+    // Straight from the detector's task: the tone does not wait for the
+    // controller. A wake while already listening is ignored below.
+    voice_assistant_state_t state = s_state;
+    if (state != VOICE_ASSISTANT_STATE_LISTENING && state != VOICE_ASSISTANT_STATE_ENDPOINTING) {
+        earcon_play(EARCON_WAKE);
+    }
+#endif
+    return post_event(EVT_WAKE, esp_timer_get_time());
+}
+
+// esp_timer time of a capture position (samples since the capture start)
+static int64_t capture_time_us(size_t position)
+{
+    return audio_ring_time_at(s_ring, s_capture_start + position);
+}
+
+// Run the VAD over one span of the ring; called with the capture lock held
+static void endpoint_span(const int16_t *pcm, size_t samples)
+{
+    size_t off = 0;
+    while (off < samples && s_capturing) {
+        size_t used = 0;
+        voice_activity_event_t event = voice_activity_feed(&s_vad, pcm + off, samples - off, &used);
+        off += used;
+        switch (event) {
+        case VOICE_ACTIVITY_START:
+            s_speech_heard = true;
+            break;
+        case VOICE_ACTIVITY_PAUSE:
+            // Endpointing starts where the speech stopped
+            post_event(EVT_SPEECH_PAUSE, capture_time_us(s_vad.speech_end));
+            break;
+        case VOICE_ACTIVITY_RESUME:
+            post_event(EVT_SPEECH_RESUME, capture_time_us(s_vad.samples));
+            break;
+        case VOICE_ACTIVITY_END:
+            s_capturing = false;
+            post_event(EVT_END_OF_SPEECH, capture_time_us(s_vad.samples));
+            break;
+        case VOICE_ACTIVITY_NONE:
+            break;
+        }
+    }
+    s_vad_pos += off;
+}
+
+// Run the VAD over everything captured since it last ran, straight from
+// the ring; called with the capture lock held
+static void endpoint_capture(int64_t now_us)
+{
+    uint64_t head = audio_ring_head(s_ring);
+    uint64_t limit = s_capture_start + CAPTURE_MAX_SAMPLES;
+    const int16_t *span[2];
+    size_t len[2];
+    if (audio_ring_peek(s_ring, s_vad_pos, head < limit ? head : limit,
+                        &span[0], &len[0], &span[1], &len[1]) != ESP_OK) {
+        return;
+    }
+    endpoint_span(span[0], len[0]);
+    endpoint_span(span[1], len[1]);
+
+    if (s_capturing && !s_speech_heard && s_vad_pos - s_capture_start >= NO_SPEECH_SAMPLES) {
+        s_capturing = false;
+        post_event(EVT_NO_SPEECH, now_us);
+    }
+    if (s_capturing && s_vad_pos == limit) {
+        s_capturing = false;
+        post_event(EVT_CAPTURE_FULL, now_us);
+    }
+}
+
+void voice_assistant_feed_audio(const int16_t *pcm, size_t samples)
+{
+    audio_ring_t *ring = s_ring;
+    if (!s_active || !ring || !pcm) {
+        return;
+    }
+    // Always recorded, so a capture can start before the wake word fired
+    int64_t now_us = esp_timer_get_time();
+    audio_ring_write(ring, pcm, samples, now_us);
+    if (!s_capturing) {
+        return;
+    }
+    xSemaphoreTake(s_capture_lock, portMAX_DELAY);
+    if (s_capturing) {
+        endpoint_capture(now_us);
+    }
+    xSemaphoreGive(s_capture_lock);
+}
+
+esp_err_t voice_assistant_end_of_speech(void)
+{
+    if (!s_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return post_event(EVT_END_OF_SPEECH, esp_timer_get_time());
+}
+
+voice_assistant_state_t voice_assistant_get_state(void)
+{
+    return s_state;
+}
+
+esp_err_t voice_assistant_get_last_turn(voice_assistant_timeline_t *timeline)
+{
+    if (!timeline) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_have_last_turn) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *timeline = s_last_turn;
+    return ESP_OK;
+}
+
 esp_err_t voice_assistant_process_command(const int16_t *audio_data, size_t audio_len)
 {
     if (!s_initialized || !s_active) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    return process_voice_command(audio_data, audio_len);
+    s_barge_in = false;
+    const gemini_pcm_parts_t audio = { .pcm = { audio_data }, .samples = { audio_len } };
+    turn_arena_begin();
+    esp_err_t ret = process_voice_command(&audio);
+    end_turn_arena();
+    return ret;
+}
+
+void voice_assistant_barge_in(void)
+{
+    // Stops the LLM stream at its next delta and silences queued speech
+    s_barge_in = true;
+    tts_scheduler_cancel();
+    if (s_live) {
+        s_live_muted = true;
+        gemini_live_interrupt(s_live);
+    }
+}
+
+esp_err_t voice_assistant_live_start(void)
+{
+    if (!s_initialized || !s_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_live && gemini_live_is_open(s_live)) {
+        return ESP_OK;
+    }
+    voice_assistant_live_stop();
+
+    const gemini_live_config_t cfg = {
+        .client_activity = true,  // Turns are delimited by voice_assistant_live_end_of_speech()
+        .transcripts = true,
+        .on_audio = on_live_audio,
+        .on_event = on_live_event,
+    };
+    s_live_user_turn = false;
+    s_live_muted = false;
+    esp_err_t ret = gemini_live_start(&cfg, &s_live);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open Live session: %s", esp_err_to_name(ret));
+        s_live = NULL;
+    }
+    return ret;
+}
+
+esp_err_t voice_assistant_live_feed(const int16_t *pcm, size_t samples)
+{
+    if (!s_live) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!s_live_user_turn) {
+        // New user turn: the server stops generating, playback stops here
+        s_live_user_turn = true;
+        s_live_muted = true;
+        gemini_live_activity_start(s_live);
+    }
+    return gemini_live_send_audio(s_live, pcm, samples);
+}
+
+esp_err_t voice_assistant_live_end_of_speech(void)
+{
+    if (!s_live) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_live_user_turn = false;
+    s_live_muted = false;
+    return gemini_live_activity_end(s_live);
+}
+
+void voice_assistant_live_stop(void)
+{
+    if (!s_live) {
+        return;
+    }
+    gemini_live_stop(s_live);
+    s_live = NULL;
+    s_live_user_turn = false;
 }
 
 bool voice_assistant_is_active(void)
@@ -214,11 +1248,13 @@ bool voice_assistant_is_active(void)
 void voice_assistant_deinit(void)
 {
     voice_assistant_stop();
-    
-    if (s_command_queue) {
-        vQueueDelete(s_command_queue);
-        s_command_queue = NULL;
+    free_pipeline();
+#if CONFIG_VOICE_ASSISTANT_LOCAL_INTENTS
+    if (s_sntp_started) {
+        esp_netif_sntp_deinit();
+        s_sntp_started = false;
     }
+#endif
     
     gemini_api_deinit();
     s_initialized = false;
@@ -229,92 +1265,38 @@ void voice_assistant_deinit(void)
 // Test TTS function - generate and play audio from text
 esp_err_t voice_assistant_test_tts(const char *text)
 {
-    if (!s_initialized) {
-        ESP_LOGE(TAG, "Voice assistant not initialized");
+    if (!s_initialized || !s_active) {
+        // Synthesis runs on the scheduler's workers, which have the stack
+        // the MP3 decoder needs; the caller's task may not
+        ESP_LOGE(TAG, "Voice assistant not running");
         return ESP_ERR_INVALID_STATE;
     }
     
     ESP_LOGI(TAG, "🎤 Testing TTS with text: \"%s\"", text);
     
-    // Allocate buffer for TTS audio (24kHz, mono, ~3 seconds max)
-    // Reduced to fit in available internal RAM (192KB largest block)
-    const size_t tts_buffer_size = 72000; // 3 seconds at 24kHz = 144KB
-    size_t buffer_bytes = tts_buffer_size * sizeof(int16_t);
-    
-    int16_t *tts_audio = NULL;
-    
-    // Check available memory for diagnostics
-    size_t total_free = esp_get_free_heap_size();
-    size_t internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
-    size_t spiram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-    size_t largest_internal = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
-    size_t largest_spiram = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
-    size_t largest_default = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
-    
-    ESP_LOGI(TAG, "Memory check: Total free=%lu bytes, Need=%lu bytes", 
-             (unsigned long)total_free, (unsigned long)buffer_bytes);
-    ESP_LOGI(TAG, "  Internal: free=%lu, largest=%lu", 
-             (unsigned long)internal_free, (unsigned long)largest_internal);
-    ESP_LOGI(TAG, "  PSRAM: free=%lu, largest=%lu", 
-             (unsigned long)spiram_free, (unsigned long)largest_spiram);
-    ESP_LOGI(TAG, "  Default: largest=%lu", (unsigned long)largest_default);
-    
-    // Try PSRAM first (if available and large enough)
-    if (spiram_free >= buffer_bytes && largest_spiram >= buffer_bytes) {
-        ESP_LOGI(TAG, "Attempting PSRAM allocation...");
-        tts_audio = (int16_t *)heap_caps_malloc(buffer_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (tts_audio) {
-            ESP_LOGI(TAG, "✅ TTS buffer allocated from PSRAM: %lu bytes", (unsigned long)buffer_bytes);
-        } else {
-            ESP_LOGW(TAG, "PSRAM allocation failed, trying default heap...");
-        }
-    }
-    
-    // Fall back to default heap (which may include PSRAM if configured)
-    if (!tts_audio) {
-        tts_audio = (int16_t *)heap_caps_malloc(buffer_bytes, MALLOC_CAP_8BIT);
-        if (tts_audio) {
-            ESP_LOGI(TAG, "✅ TTS buffer allocated from default heap: %lu bytes", (unsigned long)buffer_bytes);
-        }
-    }
-    
-    // Last resort: try regular malloc
-    if (!tts_audio) {
-        tts_audio = (int16_t *)malloc(buffer_bytes);
-        if (tts_audio) {
-            ESP_LOGI(TAG, "✅ TTS buffer allocated via malloc: %lu bytes", (unsigned long)buffer_bytes);
-        }
+    // Fixed phrases go through the persistent cache: after the first boot this
+    // plays straight from flash with no network round trip
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = tts_scheduler_submit_prompt(text);
+    if (ret == ESP_OK) {
+        ret = tts_scheduler_wait_idle(pdMS_TO_TICKS(TTS_IDLE_TIMEOUT_MS));
     }
-    
-    if (!tts_audio) {
-        ESP_LOGE(TAG, "Failed to allocate TTS buffer (%lu bytes)", (unsigned long)buffer_bytes);
-        ESP_LOGE(TAG, "Total free heap: %lu bytes, Largest free block: %lu bytes", 
-                 (unsigned long)total_free, (unsigned long)largest_default);
-        return ESP_ERR_NO_MEM;
-    }
-    
-    size_t samples_written = 0;
-    esp_err_t ret = gemini_tts(text, tts_audio, tts_buffer_size, &samples_written);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "TTS generation failed: %s", esp_err_to_name(ret));
-        free(tts_audio);
+        ESP_LOGE(TAG, "TTS test failed: %s", esp_err_to_name(ret));
         return ret;
     }
     
-    ESP_LOGI(TAG, "✅ TTS generated %zu samples (%.2f seconds at 24kHz)", 
-             samples_written, (float)samples_written / 24000.0f);
-    
-    // Play audio through audio player
-    // audio_player_submit_pcm automatically handles sample rate conversion via ensure_sample_rate
-    ret = audio_player_submit_pcm(tts_audio, samples_written, 24000, 1); // Mono, 24kHz
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Audio playback submission failed: %s", esp_err_to_name(ret));
-        ESP_LOGW(TAG, "Note: TTS outputs 24kHz, but player may expect 48kHz - resampling may be needed");
-    } else {
-        ESP_LOGI(TAG, "✅ TTS audio submitted for playback");
+    tts_scheduler_stats_t stats;
+    tts_scheduler_get_stats(&stats);
+    if (stats.first_play_us >= start_us) {
+        ESP_LOGI(TAG, "✅ TTS test: first audio after %lld ms",
+                 (long long)((stats.first_play_us - start_us) / 1000));
     }
     
-    // Free the buffer
-    free(tts_audio);
-    return ret;
+    gemini_tts_cache_stats_t cache;
+    gemini_api_get_tts_cache_stats(&cache);
+    ESP_LOGI(TAG, "TTS cache: %lu RAM hit(s), %lu flash hit(s), %lu miss(es); flash %lu/%lu KB",
+             (unsigned long)cache.ram_hits, (unsigned long)cache.flash_hits, (unsigned long)cache.misses,
+             (unsigned long)(cache.flash_bytes / 1024), (unsigned long)(cache.flash_capacity / 1024));
+    return ESP_OK;
 }
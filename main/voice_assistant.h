@@ -2,6 +2,8 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -15,6 +17,35 @@ typedef struct {
     char gemini_model[64];     // Gemini model name (default: "gemini-1.5-flash")
 } voice_assistant_config_t;
 
+/**
+ * Pipeline state
+ * IDLE -> LISTENING (wake word) -> ENDPOINTING (user stopped talking)
+ * -> THINKING (utterance handed to STT/LLM) -> SPEAKING (first answer audio)
+ * -> IDLE (answer played, failed or interrupted)
+ */
+typedef enum {
+    VOICE_ASSISTANT_STATE_IDLE,
+    VOICE_ASSISTANT_STATE_LISTENING,
+    VOICE_ASSISTANT_STATE_ENDPOINTING,
+    VOICE_ASSISTANT_STATE_THINKING,
+    VOICE_ASSISTANT_STATE_SPEAKING,
+    VOICE_ASSISTANT_STATE_COUNT
+} voice_assistant_state_t;
+
+/**
+ * Timeline of one turn
+ * enter_us[state] is the esp_timer time the turn entered that state (0 if
+ * it never did); the time of the event that caused the transition, not the
+ * time the state machine got to it.
+ */
+typedef struct {
+    uint32_t turn;                                  // Turn counter since start
+    int64_t enter_us[VOICE_ASSISTANT_STATE_COUNT];  // enter_us[IDLE]: end of the turn
+    size_t samples;                                 // Utterance uploaded (16 kHz samples)
+    size_t trimmed;                                 // Silence cut from the capture before upload
+    bool interrupted;                               // Ended by barge-in
+} voice_assistant_timeline_t;
+
 /**
  * Initialize voice assistant
  * @param config: Configuration (API key, model, etc.)
@@ -34,6 +65,45 @@ esp_err_t voice_assistant_start(void);
  */
 void voice_assistant_stop(void);
 
+/**
+ * Wake the assistant (wake word detected, button pressed)
+ * The utterance is taken from VOICE_ASSISTANT_PREROLL_MS before the call
+ * (the microphone is recorded all the time). While an answer is being prepared or played, interrupts it and
+ * listens again once it has stopped. Never blocks.
+ * @return ESP_OK if queued, ESP_ERR_INVALID_STATE if not started
+ */
+esp_err_t voice_assistant_wake(void);
+
+/**
+ * Microphone input (16-bit 16kHz mono), called for every capture buffer
+ * Recorded into a ring that keeps the last few seconds; an utterance is
+ * uploaded straight from the ring, without another copy. A voice-activity detector ends the utterance once the user has been
+ * silent for VOICE_ASSISTANT_VAD_HANGOVER_MS, and the silence before and
+ * after the speech is not uploaded. Never blocks on the network.
+ * @param pcm: Samples
+ * @param samples: Number of samples
+ */
+void voice_assistant_feed_audio(const int16_t *pcm, size_t samples);
+
+/**
+ * The user has stopped talking: close the utterance and answer it
+ * Not needed with the VAD; for push-to-talk and tests.
+ * @return ESP_OK if queued, ESP_ERR_INVALID_STATE if not started
+ */
+esp_err_t voice_assistant_end_of_speech(void);
+
+/**
+ * Current pipeline state
+ */
+voice_assistant_state_t voice_assistant_get_state(void);
+
+/**
+ * Timeline of the last completed turn
+ * @param timeline: Output
+ * @return ESP_OK, ESP_ERR_NOT_FOUND before the first turn completes
+ */
+esp_err_t voice_assistant_get_last_turn(voice_assistant_timeline_t *timeline);
+
 /**
  * Process a voice command manually (for testing)
  * @param audio_data: PCM audio samples (16-bit, 16kHz mono)
@@ -42,6 +112,44 @@ void voice_assistant_stop(void);
  */
 esp_err_t voice_assistant_process_command(const int16_t *audio_data, size_t audio_len);
 
+/**
+ * Interrupt the current answer (user started speaking)
+ * Stops the LLM stream, aborts pending TTS requests and cuts playback;
+ * in a Live session the rest of the model's answer is discarded.
+ */
+void voice_assistant_barge_in(void);
+
+/**
+ * Open a Gemini Live session
+ * Audio goes up and the spoken answer comes back over one WebSocket, so a
+ * turn has no separate STT, LLM and TTS requests. Microphone audio is
+ * passed in with voice_assistant_live_feed() and the answer is played as
+ * it arrives.
+ * @return ESP_OK on success (also if a session is already open)
+ */
+esp_err_t voice_assistant_live_start(void);
+
+/**
+ * Stream microphone audio into the Live session (never blocks)
+ * The first call after an answer starts a new user turn and stops
+ * whatever is still playing.
+ * @param pcm: 16-bit 16kHz mono samples
+ * @param samples: Number of samples
+ * @return ESP_OK if queued, ESP_ERR_INVALID_STATE without an open session
+ */
+esp_err_t voice_assistant_live_feed(const int16_t *pcm, size_t samples);
+
+/**
+ * Mark the end of the user's utterance; the model answers now
+ * @return ESP_OK on success
+ */
+esp_err_t voice_assistant_live_end_of_speech(void);
+
+/**
+ * Close the Live session
+ */
+void voice_assistant_live_stop(void);
+
 /**
  * Check if voice assistant is active
  * @return true if active
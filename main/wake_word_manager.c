@@ -1,31 +1,133 @@
 #include "wake_word_manager.h"
+#include "voice_assistant.h"
 #include "openwakeword_esp32.h"
 #include "board_config.h"
+#include "korvo1.h"
+#include "echo_canceller.h"
+#include "echo_reference.h"
 #include "esp_log.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
 static const char *TAG = "wake_word_mgr";
 
+// Capture must never miss a DMA buffer: above every pipeline task, on the
+// core without Wi-Fi
+#define MIC_TASK_PRIORITY   8
+#define MIC_TASK_CORE       1
+#define MIC_RATE_HZ         16000
+
+// The reference is read this much earlier than the estimated capture time,
+// so alignment error either way stays inside the canceller's tail
+#define AEC_LEAD_US         8000
+#define AEC_RESYNC_US       2000    // Mic clock drift tolerated before re-anchoring
+#define AEC_BUDGET_US       2000    // CPU per 8 ms block; a warning when exceeded on average
+#define AEC_REPORT_US       (10 * 1000 * 1000)
+
+#define WAKE_BUTTON_GPIO    CONFIG_VOICE_ASSISTANT_WAKE_BUTTON_GPIO
+
 static korvo1_t s_mic = {0};
 static bool s_initialized = false;
 static bool s_running = false;
+#if WAKE_BUTTON_GPIO >= 0
+static int s_button_level = 1;      // Idle high (pull-up)
+#endif
+
+#if CONFIG_VOICE_ASSISTANT_AEC
+static echo_canceller_t *s_aec = NULL;
+static int64_t s_mic_clock_us = 0;  // Capture time of the next sample, kept continuous
+static struct {
+    uint32_t blocks;
+    int64_t busy_us;
+    int64_t max_us;
+    int64_t since_us;
+} s_aec_load;
+
+static void report_aec_load(int64_t now_us)
+{
+    echo_canceller_stats_t st;
+    echo_canceller_get_stats(s_aec, &st);
+    static uint32_t s_last_active = 0;
+    if (st.active_blocks != s_last_active && s_aec_load.blocks > 0) {
+        int64_t avg = s_aec_load.busy_us / s_aec_load.blocks;
+        ESP_LOGI(TAG, "AEC: ERLE %.1f dB, leak %.3f, %" PRId64 " us/block avg, %" PRId64 " max, %" PRIu32 " resets",
+                 st.erle_db, st.leak, avg, s_aec_load.max_us, st.resets);
+        if (avg > AEC_BUDGET_US) {
+            ESP_LOGW(TAG, "AEC over budget (%d us per block); lower VOICE_ASSISTANT_AEC_TAIL_MS", AEC_BUDGET_US);
+        }
+    }
+    s_last_active = st.active_blocks;
+    s_aec_load.blocks = 0;
+    s_aec_load.busy_us = 0;
+    s_aec_load.max_us = 0;
+    s_aec_load.since_us = now_us;
+}
+
+// Remove the speaker's echo from one microphone buffer, in place. The
+// driver returns a buffer as soon as its last DMA block fills, so the last
+// sample was captured at about read_us; a tail shorter than a canceller
+// block passes through
+static void cancel_echo(int16_t *pcm, size_t samples, int64_t read_us)
+{
+    int64_t span_us = (int64_t)samples * 1000000 / MIC_RATE_HZ;
+    int64_t start_us = read_us - span_us;
+    if (llabs(start_us - s_mic_clock_us) > AEC_RESYNC_US) {
+        s_mic_clock_us = start_us;
+    }
+    int16_t ref[ECHO_CANCELLER_BLOCK];
+    for (size_t off = 0; off + ECHO_CANCELLER_BLOCK <= samples; off += ECHO_CANCELLER_BLOCK) {
+        int64_t block_us = s_mic_clock_us + (int64_t)off * 1000000 / MIC_RATE_HZ;
+        echo_reference_read(block_us - AEC_LEAD_US, ref, ECHO_CANCELLER_BLOCK);
+        int64_t t0 = esp_timer_get_time();
+        echo_canceller_process(s_aec, pcm + off, ref, pcm + off);
+        int64_t us = esp_timer_get_time() - t0;
+        s_aec_load.blocks++;
+        s_aec_load.busy_us += us;
+        if (us > s_aec_load.max_us) {
+            s_aec_load.max_us = us;
+        }
+    }
+    s_mic_clock_us += span_us;
+    if (read_us - s_aec_load.since_us > AEC_REPORT_US) {
+        report_aec_load(read_us);
+    }
+}
+#endif
 
 // Wake word detection callback
 static void on_wake_word_detected(const char *wake_word)
 {
     ESP_LOGI(TAG, "*** WAKE WORD DETECTED: %s ***", wake_word);
     
-    // TODO: Trigger Google Assistant or other action
-    // Example:
-    // - Start Google Assistant session
-    // - Play acknowledgment sound
-    // - Update LED status
-    // - etc.
+    // The assistant starts capturing from the next buffer
+    esp_err_t ret = voice_assistant_wake();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Voice assistant not woken: %s", esp_err_to_name(ret));
+    }
 }
 
+#if WAKE_BUTTON_GPIO >= 0
+// Polled once per microphone buffer: 32 ms between reads also debounces
+static void poll_wake_button(void)
+{
+    int level = gpio_get_level(WAKE_BUTTON_GPIO);
+    if (level == 0 && s_button_level == 1) {
+        ESP_LOGI(TAG, "Wake button pressed");
+        esp_err_t ret = voice_assistant_wake();
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Voice assistant not woken: %s", esp_err_to_name(ret));
+        }
+    }
+    s_button_level = level;
+}
+#endif
+
 // Microphone audio capture task
 static void mic_capture_task(void *pvParameters)
 {
@@ -49,9 +151,20 @@ static void mic_capture_task(void *pvParameters)
         
         if (ret == ESP_OK && bytes_read > 0) {
             size_t samples_read = bytes_read / sizeof(int16_t);
+
+#if CONFIG_VOICE_ASSISTANT_AEC
+            // Wake word and capture both see the echo-cancelled signal, so
+            // they keep working while TTS or music plays
+            cancel_echo(audio_buffer, samples_read, esp_timer_get_time());
+#endif
             
-            // Process audio through OpenWakeWord
+            // Process audio through OpenWakeWord, then hand it to the
+            // assistant (kept only while it is listening)
             openwakeword_process(audio_buffer, samples_read);
+#if WAKE_BUTTON_GPIO >= 0
+            poll_wake_button();
+#endif
+            voice_assistant_feed_audio(audio_buffer, samples_read);
         } else if (ret != ESP_ERR_TIMEOUT) {
             ESP_LOGW(TAG, "Microphone read error: %s", esp_err_to_name(ret));
         }
@@ -78,14 +191,15 @@ esp_err_t wake_word_manager_init(void)
     }
     
     // Initialize Korvo1 microphone
-    // Korvo1 microphone uses PDM mode on I2S1
+    // PDM RX is only available on I2S0, which the board header assigns to
+    // the microphone (the speaker takes I2S1)
     korvo1_config_t mic_config = {
-        .port = I2S_NUM_1,  // Use I2S1 for microphone (I2S0 is for speaker)
-        .din_io_num = GPIO_NUM_35,  // PDM data input (check Korvo1 pinout)
-        .bclk_io_num = GPIO_NUM_36, // PDM bit clock
-        .ws_io_num = GPIO_NUM_37,   // PDM word select
-        .mclk_io_num = GPIO_NUM_0,  // Master clock (if needed)
-        .sample_rate_hz = 16000,    // 16kHz for wake word detection
+        .port = MIC_I2S_NUM,
+        .din_io_num = GPIO_I2S1_DIN,    // PDM data input
+        .bclk_io_num = GPIO_I2S1_BCLK,  // PDM bit clock
+        .ws_io_num = GPIO_I2S1_WS,      // PDM word select
+        .mclk_io_num = GPIO_I2S1_MCLK,  // Not used by PDM; keeps GPIO 0 for the button
+        .sample_rate_hz = MIC_RATE_HZ, // 16kHz for wake word detection
         .dma_buffer_count = 4,
         .dma_buffer_len = 256,
         .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT, // Mono
@@ -97,6 +211,40 @@ esp_err_t wake_word_manager_init(void)
         openwakeword_deinit();
         return ret;
     }
+
+#if CONFIG_VOICE_ASSISTANT_AEC
+    echo_canceller_config_t aec_config = {
+        .sample_rate_hz = MIC_RATE_HZ,
+        .tail_ms = CONFIG_VOICE_ASSISTANT_AEC_TAIL_MS,
+        .suppress_residual = true,
+    };
+    ret = echo_reference_init(MIC_RATE_HZ);
+    if (ret == ESP_OK) {
+        ret = echo_canceller_create(&aec_config, &s_aec);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize echo canceller: %s", esp_err_to_name(ret));
+        echo_reference_deinit();
+        korvo1_deinit(&s_mic);
+        openwakeword_deinit();
+        return ret;
+    }
+#endif
+
+#if WAKE_BUTTON_GPIO >= 0
+    gpio_config_t button_config = {
+        .pin_bit_mask = 1ULL << WAKE_BUTTON_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    if (gpio_config(&button_config) != ESP_OK) {
+        ESP_LOGW(TAG, "Wake button on GPIO %d not available", WAKE_BUTTON_GPIO);
+    } else {
+        ESP_LOGI(TAG, "Wake button on GPIO %d", WAKE_BUTTON_GPIO);
+    }
+#endif
     
     s_initialized = true;
     ESP_LOGI(TAG, "Wake word manager initialized");
@@ -130,14 +278,15 @@ esp_err_t wake_word_manager_start(void)
     
     // Create microphone capture task
     s_running = true;
-    TaskHandle_t task_handle;
-    xTaskCreate(
+    TaskHandle_t task_handle = NULL;
+    xTaskCreatePinnedToCore(
         mic_capture_task,
         "mic_capture",
         4096,
         NULL,
-        5,
-        &task_handle
+        MIC_TASK_PRIORITY,
+        &task_handle,
+        MIC_TASK_CORE
     );
     
     if (!task_handle) {
@@ -184,6 +333,11 @@ void wake_word_manager_deinit(void)
     if (s_initialized) {
         korvo1_deinit(&s_mic);
         openwakeword_deinit();
+#if CONFIG_VOICE_ASSISTANT_AEC
+        echo_canceller_destroy(s_aec);
+        s_aec = NULL;
+        echo_reference_deinit();
+#endif
         s_initialized = false;
     }
     
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""
+Save the latency traces printed by the firmware as Chrome trace files
+
+With VOICE_ASSISTANT_TRACE_DUMP enabled every voice turn prints its spans
+between "=== span_trace begin turn=N ===" and "=== span_trace end ===".
+This reads a monitor log (a file, or stdin with "-"), keeps only the trace
+lines between the markers (log lines from other tasks that landed in
+between are dropped), checks the JSON and writes one file per turn:
+
+    idf.py monitor | tee monitor.log
+    python3 scripts/span_trace_extract.py monitor.log --out traces/
+
+Open the files in chrome://tracing or https://ui.perfetto.dev.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+BEGIN = re.compile(r"=== span_trace begin turn=(\d+) ===")
+END = "=== span_trace end ==="
+# The dump writes one JSON fragment per line; anything else is log output
+TRACE_LINE = re.compile(r'^(\{"displayTimeUnit"|,?\{"name"|\]\})')
+ANSI = re.compile(r"\x1b\[[0-9;]*m")
+
+
+def extract(lines):
+    turn, body = None, []
+    for raw in lines:
+        line = ANSI.sub("", raw).strip()
+        match = BEGIN.search(line)
+        if match:
+            turn, body = int(match.group(1)), []
+        elif turn is not None and line == END:
+            yield turn, "\n".join(body)
+            turn = None
+        elif turn is not None and TRACE_LINE.match(line):
+            body.append(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="monitor log, or - for stdin")
+    parser.add_argument("--out", default=".", help="directory for turn_<N>.json files")
+    args = parser.parse_args()
+
+    source = sys.stdin if args.log == "-" else open(args.log, encoding="utf-8", errors="replace")
+    os.makedirs(args.out, exist_ok=True)
+    saved = 0
+    for turn, text in extract(source):
+        try:
+            trace = json.loads(text)
+        except json.JSONDecodeError as err:
+            print(f"turn {turn}: skipped, trace is damaged ({err})", file=sys.stderr)
+            continue
+        path = os.path.join(args.out, f"turn_{turn}.json")
+        with open(path, "w", encoding="utf-8") as f:
+            json.dump(trace, f)
+        spans = sum(1 for e in trace["traceEvents"] if e.get("ph") != "M")
+        print(f"{path}: {spans} spans")
+        saved += 1
+    return 0 if saved else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
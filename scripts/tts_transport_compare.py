@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Compare TTS transport encodings (LINEAR16 vs MP3) on a throttled link
+
+Fetches the same sentence from Google Cloud text:synthesize in both encodings
+(or reuses responses saved earlier) and reports, for each link speed:
+  - bytes on the wire (JSON + base64 body)
+  - total download time
+  - time to first audio, using the same start rule as the firmware
+    (the player starts once 100 ms of PCM is decoded; the MP3 decoder first
+    needs MP3_SYNC_BYTES buffered to lock on)
+  - whether the download keeps up with real-time playback
+
+The link is simulated: time = RTT + bytes * 8 / rate, which is what a
+bandwidth-limited Wi-Fi link converges to for bodies of this size.
+"""
+
+import argparse
+import base64
+import json
+import os
+import sys
+import urllib.request
+
+TTS_URL = "https://texttospeech.googleapis.com/v1/text:synthesize?key={key}"
+VOICE = {"languageCode": "en-US", "name": "en-US-Neural2-D"}
+SAMPLE_RATE_HZ = 24000
+
+# Keep in sync with main/tts_scheduler.c and components/gemini/gemini_tts_stream.c
+PLAYER_START_SAMPLES = SAMPLE_RATE_HZ // 10
+MP3_SYNC_BYTES = 1024
+WAV_HEADER_BYTES = 44
+
+# MPEG-2/2.5 layer III bitrates (kbps) and sample rates, enough for TTS output
+MPEG2_L3_KBPS = [0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160]
+MPEG1_L3_KBPS = [0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320]
+SAMPLE_RATES = {3: [44100, 48000, 32000], 2: [22050, 24000, 16000], 0: [11025, 12000, 8000]}
+
+DEFAULT_TEXT = ("Sure. It is currently seventy two degrees and sunny, "
+                "with a light breeze from the west.")
+
+
+def synthesize(api_key, text, encoding):
+    """Return the raw text:synthesize response body"""
+    body = json.dumps({
+        "input": {"text": text},
+        "voice": VOICE,
+        "audioConfig": {"audioEncoding": encoding, "sampleRateHertz": SAMPLE_RATE_HZ},
+    }).encode()
+    req = urllib.request.Request(TTS_URL.format(key=api_key), data=body,
+                                 headers={"Content-Type": "application/json"})
+    with urllib.request.urlopen(req, timeout=30) as resp:
+        return resp.read()
+
+
+def mp3_frames(data):
+    """Yield (offset, frame_bytes, samples) for each layer III frame"""
+    i = 0
+    while i + 4 <= len(data):
+        h = data[i:i + 4]
+        if h[0] != 0xFF or (h[1] & 0xE0) != 0xE0 or ((h[1] >> 1) & 3) != 1:
+            i += 1
+            continue
+        version = (h[1] >> 3) & 3
+        rate_idx = (h[2] >> 2) & 3
+        kbps_idx = h[2] >> 4
+        if version == 1 or rate_idx == 3 or kbps_idx in (0, 15):
+            i += 1
+            continue
+        padding = (h[2] >> 1) & 1
+        hz = SAMPLE_RATES[version][rate_idx]
+        if version == 3:
+            samples = 1152
+            size = 144 * MPEG1_L3_KBPS[kbps_idx] * 1000 // hz + padding
+        else:
+            samples = 576
+            size = 72 * MPEG2_L3_KBPS[kbps_idx] * 1000 // hz + padding
+        yield i, size, samples
+        i += size
+
+
+def analyze(body, encoding):
+    """Audio duration and the response prefix needed before playback starts"""
+    text = body.decode()
+    key = text.index('"audioContent"')
+    value_start = text.index('"', text.index(":", key)) + 1
+    audio = base64.b64decode(text[value_start:text.index('"', value_start)].replace("\\/", "/"))
+
+    if encoding == "LINEAR16":
+        duration_s = (len(audio) - WAV_HEADER_BYTES) / 2 / SAMPLE_RATE_HZ
+        start_audio_bytes = WAV_HEADER_BYTES + 2 * PLAYER_START_SAMPLES
+    else:
+        total = 0
+        start_audio_bytes = None
+        frames = list(mp3_frames(audio))
+        for n, (offset, size, samples) in enumerate(frames):
+            total += samples
+            if start_audio_bytes is None and total >= PLAYER_START_SAMPLES:
+                # The decoder keeps one frame of lookahead behind the current one
+                lookahead = frames[n + 1][1] if n + 1 < len(frames) else 0
+                start_audio_bytes = max(MP3_SYNC_BYTES, offset + size + lookahead + 8)
+        duration_s = total / SAMPLE_RATE_HZ
+        if start_audio_bytes is None:
+            start_audio_bytes = len(audio)
+
+    start_audio_bytes = min(start_audio_bytes, len(audio))
+    # base64 expands 3 bytes to 4 characters
+    start_body_bytes = value_start + (start_audio_bytes + 2) // 3 * 4
+    return duration_s, start_body_bytes
+
+
+def synthetic_body(encoding, seconds):
+    """Silent response of nominal size (24 kHz LINEAR16 / 32 kbps MP3), for offline runs"""
+    if encoding == "LINEAR16":
+        audio = b"RIFF" + bytes(WAV_HEADER_BYTES - 4) + bytes(int(2 * SAMPLE_RATE_HZ * seconds))
+    else:
+        # MPEG-2 layer III, 32 kbps, 24 kHz, mono: 96-byte frames of 576 samples
+        frame = bytes([0xFF, 0xF3, 0x44, 0xC0]) + bytes(92)
+        audio = frame * round(SAMPLE_RATE_HZ * seconds / 576)
+    return json.dumps({"audioContent": base64.b64encode(audio).decode()}, indent=2).encode()
+
+
+def transfer_s(nbytes, kbps, rtt_ms):
+    return rtt_ms / 1000 + nbytes * 8 / (kbps * 1000)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare LINEAR16 and MP3 TTS transport")
+    parser.add_argument("--api-key", default=os.environ.get("GEMINI_API_KEY"),
+                        help="Google API key (default: $GEMINI_API_KEY)")
+    parser.add_argument("--text", default=DEFAULT_TEXT, help="Sentence to synthesize")
+    parser.add_argument("--links", default="128,256,512,1000,4000",
+                        help="Comma-separated link rates to simulate (kbps)")
+    parser.add_argument("--rtt-ms", type=float, default=80, help="Round-trip time added to each request")
+    parser.add_argument("--save-dir", help="Save the raw responses here")
+    parser.add_argument("--from-dir", help="Replay responses saved with --save-dir instead of calling the API")
+    parser.add_argument("--synthetic", type=float, metavar="SECONDS",
+                        help="Use silent responses of nominal size instead of calling the API")
+    args = parser.parse_args()
+
+    if not args.from_dir and args.synthetic is None and not args.api_key:
+        parser.error("--api-key (or $GEMINI_API_KEY) is required unless --from-dir or --synthetic is given")
+
+    results = {}
+    for encoding in ("LINEAR16", "MP3"):
+        if args.synthetic is not None:
+            body = synthetic_body(encoding, args.synthetic)
+        elif args.from_dir:
+            with open(os.path.join(args.from_dir, f"tts_{encoding.lower()}.json"), "rb") as f:
+                body = f.read()
+        else:
+            body = synthesize(args.api_key, args.text, encoding)
+        if args.save_dir:
+            os.makedirs(args.save_dir, exist_ok=True)
+            with open(os.path.join(args.save_dir, f"tts_{encoding.lower()}.json"), "wb") as f:
+                f.write(body)
+        duration_s, start_bytes = analyze(body, encoding)
+        results[encoding] = (len(body), duration_s, start_bytes)
+
+    for encoding, (nbytes, duration_s, start_bytes) in results.items():
+        print(f"{encoding:9s} {nbytes:8d} bytes on the wire, {duration_s:.2f} s of audio, "
+              f"{nbytes * 8 / duration_s / 1000:.0f} kbps needed for real time")
+    pcm_bytes = results["LINEAR16"][0]
+    mp3_bytes = results["MP3"][0]
+    print(f"MP3 is {pcm_bytes / mp3_bytes:.1f}x smaller\n")
+
+    print(f"{'link':>12s} | {'LINEAR16 TTFA':>13s} {'download':>9s} | {'MP3 TTFA':>9s} {'download':>9s}")
+    for kbps in (float(x) for x in args.links.split(",")):
+        row = [f"{kbps:7.0f} kbps"]
+        for encoding in ("LINEAR16", "MP3"):
+            nbytes, duration_s, start_bytes = results[encoding]
+            ttfa = transfer_s(start_bytes, kbps, args.rtt_ms)
+            total = transfer_s(nbytes, kbps, args.rtt_ms)
+            # Playback stalls if the body arrives slower than it plays
+            stall = "*" if total - ttfa > duration_s else " "
+            width = 13 if encoding == "LINEAR16" else 9
+            row.append(f"{ttfa * 1000:{width - 3}.0f} ms {total:8.2f}s{stall}")
+        print(" | ".join(row))
+    print("\n* download slower than real time: playback underruns")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())